@@ -0,0 +1,79 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __KM_BLKCACHE_H
+#define __KM_BLKCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "blkdev.h"
+#include "utils.h"
+
+typedef struct km_blkcache_line_s km_blkcache_line_t;
+typedef struct km_blkcache_s km_blkcache_t;
+
+struct km_blkcache_line_s {
+  km_list_node_t base;  // LRU list (head is the least recently used)
+  km_blkcache_line_t *hash_next;
+  uint32_t lba;  // line address: block * lines per block + line in block
+  bool valid;
+  bool dirty;
+  uint8_t *data;
+};
+
+typedef struct {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t writebacks;
+} km_blkcache_stats_t;
+
+/**
+ * LRU write-back cache of a block device. The cache is a block device
+ * itself, so a file system can use it in place of the device. A line is
+ * the buffer size of the device (ioctl 7), which is the read/prog unit of
+ * the file systems. The geometry is taken from the device on first
+ * access and reset on init/shutdown, when dirty lines are written back.
+ */
+struct km_blkcache_s {
+  km_blkdev_t blkdev;
+  km_blkdev_t *dev;
+  uint32_t size;       // cache size in bytes
+  uint32_t readahead;  // lines to read ahead on a miss
+  uint32_t block_size;
+  uint32_t block_count;
+  uint32_t line_size;
+  uint32_t line_count;
+  km_blkcache_line_t *lines;
+  km_blkcache_line_t **buckets;
+  uint32_t bucket_mask;
+  uint8_t *data;
+  uint8_t *scratch;
+  km_list_t lru;
+  km_blkcache_stats_t stats;
+};
+
+km_blkcache_t *km_blkcache_new(km_blkdev_t *dev, uint32_t size,
+                               uint32_t readahead);
+void km_blkcache_free(km_blkcache_t *cache);
+int km_blkcache_flush(km_blkcache_t *cache);
+
+#endif /* __KM_BLKCACHE_H */
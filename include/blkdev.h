@@ -0,0 +1,84 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __KM_BLKDEV_H
+#define __KM_BLKDEV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "jerryscript.h"
+
+/**
+ * Block device operations (same as `op` of blockdev.ioctl() in JS)
+ */
+#define KM_BLKDEV_IOCTL_INIT 1
+#define KM_BLKDEV_IOCTL_SHUTDOWN 2
+#define KM_BLKDEV_IOCTL_SYNC 3
+#define KM_BLKDEV_IOCTL_BLOCK_COUNT 4
+#define KM_BLKDEV_IOCTL_BLOCK_SIZE 5
+#define KM_BLKDEV_IOCTL_BLOCK_ERASE 6
+#define KM_BLKDEV_IOCTL_BUFFER_SIZE 7
+
+typedef struct km_blkdev_s km_blkdev_t;
+
+/**
+ * Native block device interface. Native block devices (e.g. Flash, SDCard)
+ * set a km_blkdev_t as the native pointer of their JS object with
+ * `km_blkdev_native_info`, so file systems can call them directly instead
+ * of calling the JS methods. All functions return negative on error.
+ */
+typedef struct {
+  int (*read)(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+              uint8_t *buffer, uint32_t size);
+  int (*write)(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+               const uint8_t *buffer, uint32_t size);
+  int (*ioctl)(km_blkdev_t *blkdev, int op, int arg);
+  void (*free)(km_blkdev_t *blkdev);  // called when the JS object is freed
+} km_blkdev_ops_t;
+
+struct km_blkdev_s {
+  const km_blkdev_ops_t *ops;
+};
+
+extern const jerry_object_native_info_t km_blkdev_native_info;
+
+/**
+ * Get the native block device of a JS object, NULL if the object is a
+ * user-defined block device implemented in JS
+ */
+km_blkdev_t *km_blkdev_get(jerry_value_t blkdev_js);
+
+/**
+ * Get a block device to access a JS object: its native block device, or
+ * an adapter calling the JS methods for user-defined block devices. The
+ * JS object must be kept alive until km_blkdev_close() is called.
+ */
+km_blkdev_t *km_blkdev_open(jerry_value_t blkdev_js);
+void km_blkdev_close(km_blkdev_t *blkdev);
+
+int km_blkdev_read(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+                   uint8_t *buffer, uint32_t size);
+int km_blkdev_write(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+                    const uint8_t *buffer, uint32_t size);
+int km_blkdev_ioctl(km_blkdev_t *blkdev, int op, int arg);
+
+#endif /* __KM_BLKDEV_H */
@@ -26,4 +26,10 @@
 
 void km_global_init();
 
+/**
+ * Release the values kept by the global objects. Must be called before
+ * jerry_cleanup().
+ */
+void km_global_cleanup();
+
 #endif /* __KM_GLOBAL_H */
@@ -37,6 +37,7 @@ typedef struct km_io_watch_handle_s km_io_watch_handle_t;
 typedef struct km_io_uart_handle_s km_io_uart_handle_t;
 typedef struct km_io_idle_handle_s km_io_idle_handle_t;
 typedef struct km_io_stream_handle_s km_io_stream_handle_t;
+typedef struct km_io_irq_handle_s km_io_irq_handle_t;
 
 /* handle flags */
 
@@ -55,7 +56,8 @@ typedef enum km_io_type {
   KM_IO_WATCH,
   KM_IO_UART,
   KM_IO_IDLE,
-  KM_IO_STREAM
+  KM_IO_STREAM,
+  KM_IO_IRQ
 } km_io_type_t;
 
 typedef void (*km_io_close_cb)(km_io_handle_t *);
@@ -80,8 +82,24 @@ struct km_io_timer_handle_s {
   uint64_t interval;
   bool repeat;
   uint32_t tag;  // for application use
+  int32_t heap_index;  // position in the timer heap (-1 if not scheduled)
+  uint32_t seq;        // insertion order (tie-breaker for same timeout)
+  km_io_timer_handle_t *hash_next;  // next handle in the same id bucket
+  km_io_timer_handle_t *due_next;   // next handle in the due list
 };
 
+/* timer heap (ordered by timeout) and id hash table */
+
+typedef struct {
+  km_io_timer_handle_t **heap;
+  uint32_t heap_size;
+  uint32_t heap_capacity;
+  km_io_timer_handle_t **buckets;
+  uint32_t bucket_count;
+  uint32_t count;
+  uint32_t seq;
+} km_io_timer_queue_t;
+
 /* TTY handle types */
 
 typedef void (*km_io_tty_read_cb)(uint8_t *, size_t);
@@ -107,8 +125,10 @@ struct km_io_watch_handle_s {
   km_io_handle_t base;
   km_io_watch_mode_t mode;
   uint8_t pin;
-  uint64_t debounce_time;
-  uint32_t debounce_delay;
+  bool irq;      // driven by edge interrupts (polled if false)
+  bool pending;  // an edge is waiting for the debounce delay (irq only)
+  uint64_t debounce_time;  // time of the last change (usec if irq, else msec)
+  uint32_t debounce_delay;  // msec
   uint8_t last_val;
   uint8_t val;
   km_io_watch_cb watch_cb;
@@ -150,17 +170,45 @@ struct km_io_stream_handle_s {
   km_io_stream_read_cb read_cb;
 };
 
+/* GPIO interrupt handle types */
+
+#define KM_IO_IRQ_QUEUE_SIZE 256  // must be a power of two
+#define KM_IO_IRQ_PIN_MAX 64
+
+typedef struct {
+  uint64_t time;  // microseconds (km_micro_gettime)
+  uint8_t pin;
+  uint8_t events;  // KM_IO_WATCH_MODE_FALLING and/or KM_IO_WATCH_MODE_RISING
+} km_io_irq_event_t;
+
+typedef void (*km_io_irq_cb)(km_io_irq_handle_t *, km_io_irq_event_t *,
+                             size_t count, uint32_t overflow);
+
+struct km_io_irq_handle_s {
+  km_io_handle_t base;
+  uint8_t pin;
+  uint8_t events;  // events to deliver
+  bool batch;      // deliver pending events in batches
+  uint32_t count;     // number of events delivered
+  uint32_t overflow;  // number of events lost because the queue was full
+  uint32_t overflow_mark;
+  km_io_irq_cb irq_cb;
+  jerry_value_t irq_js_cb;
+};
+
 /* loop type */
 
 struct km_io_loop_s {
   bool stop_flag;
   uint64_t time;
   km_list_t timer_handles;
+  km_io_timer_queue_t timer_queue;
   km_list_t tty_handles;
   km_list_t watch_handles;
   km_list_t uart_handles;
   km_list_t idle_handles;
   km_list_t stream_handles;
+  km_list_t irq_handles;
   km_list_t closing_handles;
 };
 
@@ -179,8 +227,8 @@ km_io_handle_t *km_io_handle_get_by_id(uint32_t id, km_list_t *handle_list);
 /* timer functions */
 
 void km_io_timer_init(km_io_timer_handle_t *timer);
-void km_io_timer_start(km_io_timer_handle_t *timer, km_io_timer_cb timer_cb,
-                       uint64_t interval, bool repeat);
+int km_io_timer_start(km_io_timer_handle_t *timer, km_io_timer_cb timer_cb,
+                      uint64_t interval, bool repeat);
 void km_io_timer_stop(km_io_timer_handle_t *timer);
 km_io_timer_handle_t *km_io_timer_get_by_id(uint32_t id);
 void km_io_timer_cleanup();
@@ -230,7 +278,18 @@ void km_io_stream_read_stop(km_io_stream_handle_t *stream);
 void km_io_stream_cleanup();
 // int km_io_stream_is_readable(km_io_stream_handle_t *stream);
 // int km_io_stream_read(km_io_stream_handle_t *stream);
-// void km_io_stream_push(km_io_stream_handle_t *stream, uint8_t *buffer, size_t
-// size); // push to read buffer
+void km_io_stream_push(km_io_stream_handle_t *stream, uint8_t *buffer,
+                       size_t size);  // push data read from the device
+
+/* GPIO interrupt functions */
+
+void km_io_irq_init(km_io_irq_handle_t *irq);
+int km_io_irq_start(km_io_irq_handle_t *irq, km_io_irq_cb irq_cb, uint8_t pin,
+                    uint8_t events, bool batch);
+void km_io_irq_stop(km_io_irq_handle_t *irq);
+km_io_irq_handle_t *km_io_irq_get_by_id(uint32_t id);
+km_io_irq_handle_t *km_io_irq_get_by_pin(uint8_t pin);
+void km_io_irq_cleanup();
+void km_io_irq_push(uint8_t pin, uint8_t events);  // ISR-safe
 
 #endif /* ___KM_IO_H */
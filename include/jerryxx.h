@@ -260,6 +260,23 @@ double jerryxx_get_property_number(jerry_value_t object, const char *name,
 bool jerryxx_get_property_boolean(jerry_value_t object, const char *name,
                                   bool default_value);
 
+// interned property keys: a string value created once for each magic
+// string, indexed by the generated MSTR_*_KEY (see kaluma_magic_strings.h).
+// The *_by_key functions save creating a string for each access.
+void jerryxx_init_keys();
+void jerryxx_cleanup_keys();
+jerry_value_t jerryxx_key(uint32_t key);
+void jerryxx_set_property_by_key(jerry_value_t object, uint32_t key,
+                                 jerry_value_t value);
+void jerryxx_set_property_number_by_key(jerry_value_t object, uint32_t key,
+                                        double value);
+jerry_value_t jerryxx_get_property_by_key(jerry_value_t object, uint32_t key);
+double jerryxx_get_property_number_by_key(jerry_value_t object, uint32_t key,
+                                          double default_value);
+bool jerryxx_get_property_boolean_by_key(jerry_value_t object, uint32_t key,
+                                         bool default_value);
+bool jerryxx_delete_property_by_key(jerry_value_t object, uint32_t key);
+
 // array functions
 uint8_t *jerryxx_get_typedarray_buffer(jerry_value_t object);
 void jerryxx_array_push_string(jerry_value_t array, jerry_value_t item);
@@ -48,6 +48,12 @@
 #define MSTR_DETACH_INTERRUPT "detachInterrupt"
 #define MSTR_ENABLE_INTERRUPTS "enableInterrupts"
 #define MSTR_DISABLE_INTERRUPTS "disableInterrupts"
+#define MSTR_INTERRUPT_STATS "interruptStats"
+#define MSTR_BATCH "batch"
+#define MSTR_EVENTS "events"
+#define MSTR_TIME "time"
+#define MSTR_COUNT "count"
+#define MSTR_OVERFLOW "overflow"
 #define MSTR_PULSE_READ "pulseRead"
 #define MSTR_TIMEOUT "timeout"
 #define MSTR_START_STATE "startState"
@@ -94,6 +100,9 @@
 #define MSTR_BINDING "binding"
 #define MSTR_BUILTIN_MODULES "builtin_modules"
 #define MSTR_GET_BUILTIN_MODULE "getBuiltinModule"
+#define MSTR_COMPILE_MODULE "compileModule"
+#define MSTR_SNAPSHOT_MODULE "snapshotModule"
+#define MSTR_LOAD_MODULE_SNAPSHOT "loadModuleSnapshot"
 #define MSTR_DEVICES "devices"
 #define MSTR_BOARD "board"
 #define MSTR_UID "uid"
@@ -174,4 +183,8 @@
 #define MSTR_HEAP_PEAK "heapPeak"
 #define MSTR_HEAP_USED "heapUsed"
 
+#define MSTR_BLKDEV_READ "read"
+#define MSTR_BLKDEV_WRITE "write"
+#define MSTR_BLKDEV_IOCTL "ioctl"
+
 #endif /* __MAGIC_STRINGS_H */
@@ -27,6 +27,14 @@
 
 extern const uint8_t *km_flash_addr;
 
+typedef struct {
+  uint32_t program_count;      // number of program operations
+  uint32_t program_bytes;      // number of bytes programmed
+  uint32_t program_conflicts;  // bytes programmed without erase (0 to 1)
+  uint32_t erase_count;        // number of sectors erased
+  uint32_t erase_max;          // erase count of the most worn sector
+} km_flash_stats_t;
+
 /**
  * @brief Initialize flash
  */
@@ -58,4 +66,12 @@ int km_flash_program(uint32_t sector, uint32_t offset, uint8_t *buffer,
  */
 int km_flash_erase(uint32_t sector, size_t count);
 
+/**
+ * @brief Read the program and erase counters since the system started. The
+ * counters a target does not track are zero.
+ *
+ * @param stats
+ */
+void km_flash_get_stats(km_flash_stats_t *stats);
+
 #endif /* __KM_FLASH_H */
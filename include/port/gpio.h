@@ -42,6 +42,10 @@ typedef enum {
 #define KM_GPIO_PULL_UP 0
 #define KM_GPIO_PULL_DOWN 1
 
+/* interrupt events (same bits as KM_IO_WATCH_MODE_FALLING/RISING) */
+#define KM_GPIO_IRQ_FALLING 4
+#define KM_GPIO_IRQ_RISING 8
+
 typedef void (*km_gpio_irq_callback_t)(uint8_t pin, km_gpio_io_mode_t mode);
 
 /**
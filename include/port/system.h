@@ -73,6 +73,22 @@ uint64_t km_micro_gettime(void);
  */
 void km_micro_delay(uint32_t usec);
 
+/**
+ * Wait for an event (I/O, interrupt, ...) or until the timeout is elapsed.
+ * The event loop calls this in every iteration, with the time until the next
+ * timer. It is allowed to return earlier than the timeout.
+ *
+ * @param {uint32_t} timeout  Max waiting time in milliseconds. 0 means to
+ *   check pending events (if any) and return immediately.
+ */
+void km_wait_for_event(uint32_t timeout);
+
+/**
+ * Check if the port has I/O sources other than the event loop handles (e.g.
+ * polled sockets) which keep the event loop alive.
+ */
+uint8_t km_has_active_io();
+
 /**
  * check script running mode - skipping or running user script
  */
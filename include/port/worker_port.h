@@ -0,0 +1,71 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __KM_WORKER_PORT_H
+#define __KM_WORKER_PORT_H
+
+#include <stdint.h>
+
+/**
+ * Start the worker context (the second core, or a thread) which runs the
+ * given entry function.
+ *
+ * @param entry
+ * @return Returns 0 on success or negative errno on failure.
+ */
+int km_worker_port_start(void (*entry)(void));
+
+/**
+ * Wait until the worker entry function returns and release the worker
+ * context. Called after the entry function is asked to return.
+ */
+void km_worker_port_join();
+
+/**
+ * Sleep the worker until it is notified (called in the worker context).
+ * Spurious wakeups are allowed.
+ */
+void km_worker_port_wait();
+
+/**
+ * Wake the worker up (called in the main context).
+ */
+void km_worker_port_notify();
+
+/**
+ * Wake the main event loop up when a job is completed (called in the worker
+ * context).
+ */
+void km_worker_port_signal();
+
+/**
+ * Pause the worker while the flash is programmed or erased, since the worker
+ * may be executing code from the flash. Does nothing if the worker is not
+ * running.
+ */
+void km_worker_port_lockout_start();
+
+/**
+ * Resume the worker paused by km_worker_port_lockout_start().
+ */
+void km_worker_port_lockout_end();
+
+#endif /* __KM_WORKER_PORT_H */
@@ -35,4 +35,25 @@ uint32_t km_prog_get_size();
 uint32_t km_prog_max_size();
 uint8_t *km_prog_addr();
 
+/**
+ * Header of the bytecode snapshot stored after the program source. The
+ * snapshot starts at the first sector boundary after the source (and its
+ * null terminator) so it can be erased and rewritten on its own.
+ */
+#define KM_PROG_SNAPSHOT_MAGIC 0x4E534D4B  // "KMSN"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;      // fingerprint of the engine and firmware
+  uint32_t source_size;  // size of the source compiled
+  uint32_t source_crc;   // CRC32 of the source compiled
+  uint32_t size;         // snapshot size (0 if the source can't be compiled)
+  uint32_t crc;          // CRC32 of the snapshot
+} km_prog_snapshot_header_t;
+
+km_prog_snapshot_header_t *km_prog_snapshot_header();
+uint32_t *km_prog_snapshot_addr();
+uint32_t km_prog_snapshot_max_size();
+int km_prog_write_snapshot(km_prog_snapshot_header_t *header, uint8_t *data);
+
 #endif /* __KM_PROG_H */
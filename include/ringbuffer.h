@@ -3,15 +3,30 @@
 
 #include <stdint.h>
 
+/**
+ * Ring buffer of bytes.
+ *
+ * The capacity is a power of two, and r_ptr/w_ptr are free-running counters
+ * masked on access, so the whole capacity can be used. The ring buffer is
+ * lock-free for a single producer and a single consumer (e.g. an IRQ handler
+ * and the main loop) without disabling interrupts:
+ * - producer: ringbuffer_write, ringbuffer_reserve_contiguous,
+ *   ringbuffer_commit
+ * - consumer: ringbuffer_read, ringbuffer_look_at, ringbuffer_look,
+ *   ringbuffer_flush, ringbuffer_find, ringbuffer_peek_contiguous
+ */
 typedef struct {
   uint8_t *buf;
   uint32_t length;
+  uint32_t mask;
   uint32_t r_ptr;
   uint32_t w_ptr;
 } ringbuffer_t;
 
 /**
- * Initialize a ringbuffer with a given alocated buffer.
+ * Initialize a ringbuffer with a given alocated buffer. The capacity is
+ * rounded down to a power of two, so allocate the buffer with
+ * ringbuffer_round_size() to hold at least the requested size.
  *
  * @param ringbuffer
  * @param pbuf pointer to internal buffer
@@ -19,6 +34,14 @@ typedef struct {
  */
 void ringbuffer_init(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len);
 
+/**
+ * Return the smallest power of two not less than a size.
+ *
+ * @param len requested capacity
+ * @return length of the buffer to allocate
+ */
+uint32_t ringbuffer_round_size(uint32_t len);
+
 /**
  * Return the size of ring buffer.
  *
@@ -53,13 +76,16 @@ uint32_t ringbuffer_freespace(ringbuffer_t *ringbuffer);
 void ringbuffer_read(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len);
 
 /**
- * Write into data from the ring buffer.
+ * Write into data from the ring buffer. Data exceeding the free space is
+ * dropped.
  *
  * @param ringbuffer
  * @param buf data to write.
  * @param len size of data to write.
+ * @return size of data written.
  */
-void ringbuffer_write(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len);
+uint32_t ringbuffer_write(ringbuffer_t *ringbuffer, uint8_t *buf,
+                          uint32_t len);
 
 /**
  * Look a character at the specified position in the ring buffer.
@@ -98,4 +124,33 @@ void ringbuffer_flush(ringbuffer_t *ringbuffer, uint32_t len);
  */
 int ringbuffer_find(ringbuffer_t *ringbuffer, uint8_t ch);
 
+/**
+ * Get the contiguous data to read without copy. Call ringbuffer_flush()
+ * after consuming the data.
+ *
+ * @param ringbuffer
+ * @param buf pointer to the data is stored.
+ * @return length of the contiguous data (may be less than the whole data).
+ */
+uint32_t ringbuffer_peek_contiguous(ringbuffer_t *ringbuffer, uint8_t **buf);
+
+/**
+ * Get the contiguous free space to write without copy. Call
+ * ringbuffer_commit() after writing the data.
+ *
+ * @param ringbuffer
+ * @param buf pointer to the free space is stored.
+ * @return length of the contiguous free space.
+ */
+uint32_t ringbuffer_reserve_contiguous(ringbuffer_t *ringbuffer,
+                                       uint8_t **buf);
+
+/**
+ * Commit data written to the space from ringbuffer_reserve_contiguous().
+ *
+ * @param ringbuffer
+ * @param len length of data written.
+ */
+void ringbuffer_commit(ringbuffer_t *ringbuffer, uint32_t len);
+
 #endif /* __RINGBUFFER_H */
@@ -27,6 +27,31 @@
 void km_runtime_init(bool load, bool first);
 void km_runtime_cleanup();
 void km_runtime_load();
+int km_runtime_compile();
+bool km_runtime_snapshot_in_use();
 void km_runtime_set_vm_stop(uint8_t stop);
 
+/**
+ * Compile a module source into its wrapper function
+ * `(exports, require, module, __filename, __dirname)`.
+ * @return the function, or an error (e.g. SyntaxError)
+ */
+jerry_value_t km_runtime_compile_module(const char *filename,
+                                        const uint8_t *source, size_t size);
+
+/**
+ * Compile a module source into a snapshot to be cached with the source.
+ * @return Uint8Array of the snapshot, or undefined if it can't be generated
+ */
+jerry_value_t km_runtime_snapshot_module(const char *filename,
+                                         const uint8_t *source, size_t size);
+
+/**
+ * Load a module wrapper function from a cached snapshot.
+ * @return the function, or undefined if the snapshot is not valid for the
+ * source and the running firmware
+ */
+jerry_value_t km_runtime_load_module(const uint8_t *snapshot, size_t len,
+                                     const uint8_t *source, size_t size);
+
 #endif /* __KM_RUNTIME_H */
\ No newline at end of file
@@ -22,6 +22,7 @@
 #ifndef __KM_UTILS_H
 #define __KM_UTILS_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct km_list_node_s km_list_node_t;
@@ -43,4 +44,6 @@ void km_list_remove(km_list_t *list, km_list_node_t *node);
 
 uint8_t km_hex1(char hex);
 uint8_t km_hex2bin(unsigned char *hex);
+uint32_t km_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
 #endif /* __KM_UTILS_H */
\ No newline at end of file
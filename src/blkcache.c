@@ -0,0 +1,392 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "blkcache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+
+// --------------------------------------------------------------------------
+// PRIVATE FUNCTIONS
+// --------------------------------------------------------------------------
+
+static uint32_t lines_per_block(km_blkcache_t *cache) {
+  return cache->block_size / cache->line_size;
+}
+
+static km_blkcache_line_t **line_bucket(km_blkcache_t *cache, uint32_t lba) {
+  return &cache->buckets[(lba ^ (lba >> 16)) & cache->bucket_mask];
+}
+
+static km_blkcache_line_t *line_lookup(km_blkcache_t *cache, uint32_t lba) {
+  km_blkcache_line_t *line = *line_bucket(cache, lba);
+  while (line != NULL && line->lba != lba) {
+    line = line->hash_next;
+  }
+  return line;
+}
+
+static void line_hash_remove(km_blkcache_t *cache, km_blkcache_line_t *line) {
+  km_blkcache_line_t **p = line_bucket(cache, line->lba);
+  while (*p != NULL) {
+    if (*p == line) {
+      *p = line->hash_next;
+      break;
+    }
+    p = &(*p)->hash_next;
+  }
+  line->hash_next = NULL;
+}
+
+static void line_touch(km_blkcache_t *cache, km_blkcache_line_t *line) {
+  km_list_remove(&cache->lru, (km_list_node_t *)line);
+  km_list_append(&cache->lru, (km_list_node_t *)line);
+}
+
+static void line_drop(km_blkcache_t *cache, km_blkcache_line_t *line) {
+  line_hash_remove(cache, line);
+  line->valid = false;
+  line->dirty = false;
+}
+
+/**
+ * Read or write consecutive lines on the device, split at block boundaries
+ */
+static int dev_transfer(km_blkcache_t *cache, bool write, uint32_t lba,
+                        uint32_t n, uint8_t *buffer) {
+  uint32_t lpb = lines_per_block(cache);
+  while (n > 0) {
+    uint32_t block = lba / lpb;
+    uint32_t offset = (lba % lpb) * cache->line_size;
+    uint32_t k = lpb - (lba % lpb);
+    if (k > n) k = n;
+    int ret = write ? cache->dev->ops->write(cache->dev, block, offset, buffer,
+                                             k * cache->line_size)
+                    : cache->dev->ops->read(cache->dev, block, offset, buffer,
+                                            k * cache->line_size);
+    if (ret < 0) return ret;
+    lba += k;
+    n -= k;
+    buffer += k * cache->line_size;
+  }
+  return 0;
+}
+
+static int line_writeback(km_blkcache_t *cache, km_blkcache_line_t *line) {
+  int ret = dev_transfer(cache, true, line->lba, 1, line->data);
+  if (ret < 0) return ret;
+  line->dirty = false;
+  cache->stats.writebacks++;
+  return 0;
+}
+
+/**
+ * Take the least recently used line for lba (the data is not filled)
+ */
+static km_blkcache_line_t *line_alloc(km_blkcache_t *cache, uint32_t lba,
+                                      int *err) {
+  km_blkcache_line_t *line = (km_blkcache_line_t *)cache->lru.head;
+  if (line->dirty) {
+    int ret = line_writeback(cache, line);
+    if (ret < 0) {
+      *err = ret;
+      return NULL;
+    }
+  }
+  if (line->valid) {
+    line_hash_remove(cache, line);
+  }
+  line->lba = lba;
+  line->valid = true;
+  line->dirty = false;
+  km_blkcache_line_t **bucket = line_bucket(cache, lba);
+  line->hash_next = *bucket;
+  *bucket = line;
+  line_touch(cache, line);
+  return line;
+}
+
+/**
+ * Read a missing line from the device, with the following uncached lines
+ * in the same device read when read-ahead is enabled
+ */
+static km_blkcache_line_t *line_fill(km_blkcache_t *cache, uint32_t lba,
+                                     int *err) {
+  uint32_t total = cache->block_count * lines_per_block(cache);
+  uint32_t n = 1;
+  if (cache->scratch != NULL) {
+    while (n < 1 + cache->readahead && n < cache->line_count &&
+           lba + n < total && line_lookup(cache, lba + n) == NULL) {
+      n++;
+    }
+  }
+  km_blkcache_line_t *line = line_alloc(cache, lba, err);
+  if (line == NULL) return NULL;
+  uint8_t *buffer = (n > 1) ? cache->scratch : line->data;
+  int ret = dev_transfer(cache, false, lba, n, buffer);
+  if (ret < 0) {
+    line_drop(cache, line);
+    *err = ret;
+    return NULL;
+  }
+  if (n > 1) {
+    memcpy(line->data, buffer, cache->line_size);
+    for (uint32_t i = 1; i < n; i++) {
+      km_blkcache_line_t *ahead = line_alloc(cache, lba + i, err);
+      if (ahead == NULL) break;
+      memcpy(ahead->data, buffer + i * cache->line_size, cache->line_size);
+    }
+    line_touch(cache, line);  // the requested line is the most recent
+  }
+  return line;
+}
+
+static void cache_teardown(km_blkcache_t *cache) {
+  free(cache->lines);
+  free(cache->buckets);
+  free(cache->data);
+  free(cache->scratch);
+  cache->lines = NULL;
+  cache->buckets = NULL;
+  cache->data = NULL;
+  cache->scratch = NULL;
+  cache->line_count = 0;
+  km_list_init(&cache->lru);
+}
+
+/**
+ * Take the geometry from the device and allocate lines. Returns false if
+ * the cache can't be used (yet), then the device is accessed directly.
+ */
+static bool cache_setup(km_blkcache_t *cache) {
+  if (cache->line_count > 0) return true;
+  if (cache->size == 0) return false;
+  km_blkdev_t *dev = cache->dev;
+  int block_size = dev->ops->ioctl(dev, KM_BLKDEV_IOCTL_BLOCK_SIZE, 0);
+  int block_count = dev->ops->ioctl(dev, KM_BLKDEV_IOCTL_BLOCK_COUNT, 0);
+  int line_size = dev->ops->ioctl(dev, KM_BLKDEV_IOCTL_BUFFER_SIZE, 0);
+  if (block_size <= 0 || block_count <= 0 || line_size <= 0) {
+    return false;  // not initialized yet
+  }
+  uint32_t count = cache->size / line_size;
+  if (block_size % line_size != 0 || count == 0) {
+    cache->size = 0;  // never usable for this device
+    return false;
+  }
+  uint32_t buckets = 1;
+  while (buckets < count) buckets <<= 1;
+  cache->block_size = block_size;
+  cache->block_count = block_count;
+  cache->line_size = line_size;
+  cache->lines =
+      (km_blkcache_line_t *)calloc(count, sizeof(km_blkcache_line_t));
+  cache->buckets =
+      (km_blkcache_line_t **)calloc(buckets, sizeof(km_blkcache_line_t *));
+  cache->data = (uint8_t *)malloc(count * line_size);
+  if (cache->readahead > 0) {
+    cache->scratch = (uint8_t *)malloc((1 + cache->readahead) * line_size);
+  }
+  if (cache->lines == NULL || cache->buckets == NULL || cache->data == NULL) {
+    cache_teardown(cache);
+    cache->size = 0;
+    return false;
+  }
+  cache->line_count = count;
+  cache->bucket_mask = buckets - 1;
+  km_list_init(&cache->lru);
+  for (uint32_t i = 0; i < count; i++) {
+    cache->lines[i].data = cache->data + i * line_size;
+    km_list_append(&cache->lru, (km_list_node_t *)&cache->lines[i]);
+  }
+  return true;
+}
+
+static int cache_read(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+                      uint8_t *buffer, uint32_t size) {
+  km_blkcache_t *cache = (km_blkcache_t *)blkdev;
+  if (!cache_setup(cache)) {
+    return cache->dev->ops->read(cache->dev, block, offset, buffer, size);
+  }
+  uint32_t ls = cache->line_size;
+  uint32_t lba = block * lines_per_block(cache) + offset / ls;
+  uint32_t skip = offset % ls;
+  bool single = (skip + size <= ls);
+  while (size > 0) {
+    uint32_t len = (ls - skip < size) ? ls - skip : size;
+    km_blkcache_line_t *line = line_lookup(cache, lba);
+    if (line != NULL) {
+      cache->stats.hits++;
+      line_touch(cache, line);
+    } else if (single || len < ls) {
+      cache->stats.misses++;
+      int err = 0;
+      line = line_fill(cache, lba, &err);
+      if (line == NULL) return err;
+    } else {
+      // uncached full lines of a large read go to the buffer directly
+      uint32_t n = 1;
+      while ((n + 1) * ls <= size && line_lookup(cache, lba + n) == NULL) {
+        n++;
+      }
+      cache->stats.misses += n;
+      int ret = dev_transfer(cache, false, lba, n, buffer);
+      if (ret < 0) return ret;
+      len = n * ls;
+      lba += n - 1;
+    }
+    if (line != NULL) {
+      memcpy(buffer, line->data + skip, len);
+    }
+    buffer += len;
+    size -= len;
+    lba++;
+    skip = 0;
+  }
+  return 0;
+}
+
+static int cache_write(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+                       const uint8_t *buffer, uint32_t size) {
+  km_blkcache_t *cache = (km_blkcache_t *)blkdev;
+  if (!cache_setup(cache)) {
+    return cache->dev->ops->write(cache->dev, block, offset, buffer, size);
+  }
+  uint32_t ls = cache->line_size;
+  uint32_t lba = block * lines_per_block(cache) + offset / ls;
+  uint32_t skip = offset % ls;
+  bool single = (skip + size <= ls);
+  while (size > 0) {
+    uint32_t len = (ls - skip < size) ? ls - skip : size;
+    km_blkcache_line_t *line = line_lookup(cache, lba);
+    int err = 0;
+    if (line != NULL) {
+      cache->stats.hits++;
+      line_touch(cache, line);
+    } else if (len < ls) {
+      // partial line: read the rest of the line first
+      cache->stats.misses++;
+      line = line_fill(cache, lba, &err);
+      if (line == NULL) return err;
+    } else if (single) {
+      cache->stats.misses++;
+      line = line_alloc(cache, lba, &err);
+      if (line == NULL) return err;
+    } else {
+      // uncached full lines of a large write go to the device directly
+      uint32_t n = 1;
+      while ((n + 1) * ls <= size && line_lookup(cache, lba + n) == NULL) {
+        n++;
+      }
+      cache->stats.misses += n;
+      int ret = dev_transfer(cache, true, lba, n, (uint8_t *)buffer);
+      if (ret < 0) return ret;
+      len = n * ls;
+      lba += n - 1;
+    }
+    if (line != NULL) {
+      memcpy(line->data + skip, buffer, len);
+      line->dirty = true;
+    }
+    buffer += len;
+    size -= len;
+    lba++;
+    skip = 0;
+  }
+  return 0;
+}
+
+static int cache_ioctl(km_blkdev_t *blkdev, int op, int arg) {
+  km_blkcache_t *cache = (km_blkcache_t *)blkdev;
+  int ret;
+  switch (op) {
+    case KM_BLKDEV_IOCTL_SYNC:
+      ret = km_blkcache_flush(cache);
+      if (ret < 0) return ret;
+      break;
+    case KM_BLKDEV_IOCTL_BLOCK_ERASE:
+      // erased data replaces anything cached for the block
+      if (cache->line_count > 0 && arg >= 0) {
+        uint32_t lpb = lines_per_block(cache);
+        for (uint32_t i = 0; i < lpb; i++) {
+          km_blkcache_line_t *line = line_lookup(cache, arg * lpb + i);
+          if (line != NULL) {
+            line_drop(cache, line);
+          }
+        }
+      }
+      break;
+    case KM_BLKDEV_IOCTL_INIT:
+    case KM_BLKDEV_IOCTL_SHUTDOWN:
+      // the geometry may change
+      ret = km_blkcache_flush(cache);
+      cache_teardown(cache);
+      if (ret < 0) return ret;
+      break;
+  }
+  return cache->dev->ops->ioctl(cache->dev, op, arg);
+}
+
+static const km_blkdev_ops_t cache_ops = {.read = cache_read,
+                                          .write = cache_write,
+                                          .ioctl = cache_ioctl,
+                                          .free = NULL};
+
+// --------------------------------------------------------------------------
+// PUBLIC FUNCTIONS
+// --------------------------------------------------------------------------
+
+km_blkcache_t *km_blkcache_new(km_blkdev_t *dev, uint32_t size,
+                               uint32_t readahead) {
+  km_blkcache_t *cache = (km_blkcache_t *)calloc(1, sizeof(km_blkcache_t));
+  if (cache == NULL) return NULL;
+  cache->blkdev.ops = &cache_ops;
+  cache->dev = dev;
+  cache->size = size;
+  cache->readahead = readahead;
+  km_list_init(&cache->lru);
+  return cache;
+}
+
+/**
+ * Free the cache. Dirty lines are not written back, so flush (or sync or
+ * shutdown through the cache) first.
+ */
+void km_blkcache_free(km_blkcache_t *cache) {
+  cache_teardown(cache);
+  free(cache);
+}
+
+/**
+ * Write back all dirty lines. Returns the first error, if any.
+ */
+int km_blkcache_flush(km_blkcache_t *cache) {
+  int ret = 0;
+  for (uint32_t i = 0; i < cache->line_count; i++) {
+    km_blkcache_line_t *line = &cache->lines[i];
+    if (line->valid && line->dirty) {
+      int r = line_writeback(cache, line);
+      if (r < 0 && ret == 0) ret = r;
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,154 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "blkdev.h"
+
+#include <stdlib.h>
+
+#include "err.h"
+#include "jerryxx.h"
+#include "kaluma_magic_strings.h"
+
+/**
+ * Adapter for block devices implemented in JS (blockdev.read(), write()
+ * and ioctl()). The JS object is not acquired; it must be kept alive by
+ * the owner of the adapter.
+ */
+typedef struct {
+  km_blkdev_t blkdev;
+  jerry_value_t blkdev_js;
+} js_blkdev_t;
+
+static void blkdev_freecb(void *native_p) {
+  km_blkdev_t *blkdev = (km_blkdev_t *)native_p;
+  if (blkdev->ops->free != NULL) {
+    blkdev->ops->free(blkdev);
+  }
+}
+
+static int js_blkdev_transfer(jerry_value_t blkdev_js, uint32_t method,
+                              uint32_t block, uint32_t offset,
+                              uint8_t *buffer, uint32_t size) {
+  jerry_value_t arraybuffer =
+      jerry_create_arraybuffer_external(size, buffer, NULL);
+  jerry_value_t buffer_js = jerry_create_typedarray_for_arraybuffer(
+      JERRY_TYPEDARRAY_UINT8, arraybuffer);
+  jerry_value_t method_js = jerryxx_get_property_by_key(blkdev_js, method);
+  jerry_value_t block_js = jerry_create_number(block);
+  jerry_value_t offset_js = jerry_create_number(offset);
+  jerry_value_t args[3] = {block_js, buffer_js, offset_js};
+  jerry_value_t ret = jerry_call_function(method_js, blkdev_js, args, 3);
+  int ret_value = jerry_value_is_error(ret) ? EIO : 0;
+  jerry_release_value(ret);
+  jerry_release_value(offset_js);
+  jerry_release_value(block_js);
+  jerry_release_value(method_js);
+  jerry_release_value(buffer_js);
+  jerry_release_value(arraybuffer);
+  return ret_value;
+}
+
+static int js_blkdev_read(km_blkdev_t *blkdev, uint32_t block,
+                          uint32_t offset, uint8_t *buffer, uint32_t size) {
+  // call blockdev.read(block, buffer, offset)
+  return js_blkdev_transfer(((js_blkdev_t *)blkdev)->blkdev_js,
+                            MSTR_BLKDEV_READ_KEY, block, offset, buffer, size);
+}
+
+static int js_blkdev_write(km_blkdev_t *blkdev, uint32_t block,
+                           uint32_t offset, const uint8_t *buffer,
+                           uint32_t size) {
+  // call blockdev.write(block, buffer, offset)
+  return js_blkdev_transfer(((js_blkdev_t *)blkdev)->blkdev_js,
+                            MSTR_BLKDEV_WRITE_KEY, block, offset,
+                            (uint8_t *)buffer, size);
+}
+
+static int js_blkdev_ioctl(km_blkdev_t *blkdev, int op, int arg) {
+  jerry_value_t blkdev_js = ((js_blkdev_t *)blkdev)->blkdev_js;
+  jerry_value_t ioctl_js =
+      jerryxx_get_property_by_key(blkdev_js, MSTR_BLKDEV_IOCTL_KEY);
+  jerry_value_t op_js = jerry_create_number(op);
+  jerry_value_t arg_js = jerry_create_number(arg);
+  jerry_value_t args[2] = {op_js, arg_js};
+  jerry_value_t ret = jerry_call_function(ioctl_js, blkdev_js, args, 2);
+  int ret_value = 0;
+  if (jerry_value_is_number(ret)) {
+    ret_value = (int)jerry_get_number_value(ret);
+  }
+  jerry_release_value(ret);
+  jerry_release_value(arg_js);
+  jerry_release_value(op_js);
+  jerry_release_value(ioctl_js);
+  return ret_value;
+}
+
+static const km_blkdev_ops_t js_blkdev_ops = {.read = js_blkdev_read,
+                                              .write = js_blkdev_write,
+                                              .ioctl = js_blkdev_ioctl,
+                                              .free = NULL};
+
+const jerry_object_native_info_t km_blkdev_native_info = {
+    .free_cb = blkdev_freecb};
+
+km_blkdev_t *km_blkdev_get(jerry_value_t blkdev_js) {
+  void *native_p;
+  if (jerry_value_is_object(blkdev_js) &&
+      jerry_get_object_native_pointer(blkdev_js, &native_p,
+                                      &km_blkdev_native_info)) {
+    return (km_blkdev_t *)native_p;
+  }
+  return NULL;
+}
+
+km_blkdev_t *km_blkdev_open(jerry_value_t blkdev_js) {
+  km_blkdev_t *blkdev = km_blkdev_get(blkdev_js);
+  if (blkdev != NULL) {
+    return blkdev;
+  }
+  js_blkdev_t *js_blkdev = (js_blkdev_t *)malloc(sizeof(js_blkdev_t));
+  if (js_blkdev == NULL) {
+    return NULL;
+  }
+  js_blkdev->blkdev.ops = &js_blkdev_ops;
+  js_blkdev->blkdev_js = blkdev_js;
+  return &js_blkdev->blkdev;
+}
+
+void km_blkdev_close(km_blkdev_t *blkdev) {
+  if (blkdev != NULL && blkdev->ops == &js_blkdev_ops) {
+    free(blkdev);
+  }
+}
+
+int km_blkdev_read(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+                   uint8_t *buffer, uint32_t size) {
+  return blkdev->ops->read(blkdev, block, offset, buffer, size);
+}
+
+int km_blkdev_write(km_blkdev_t *blkdev, uint32_t block, uint32_t offset,
+                    const uint8_t *buffer, uint32_t size) {
+  return blkdev->ops->write(blkdev, block, offset, buffer, size);
+}
+
+int km_blkdev_ioctl(km_blkdev_t *blkdev, int op, int arg) {
+  return blkdev->ops->ioctl(blkdev, op, arg);
+}
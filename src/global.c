@@ -421,68 +421,143 @@ static void register_global_digital_io() {
 /*                                                                          */
 /****************************************************************************/
 
-static jerry_value_t irq_js_cb[GPIO_MAX];
-
+/*
+ * The GPIO interrupt handler only queues the event with a timestamp. Events
+ * are delivered to JS callbacks in the event loop (see km_io_irq_run()).
+ */
 static void irq_cb(uint8_t pin, km_gpio_io_mode_t mode) {
-  jerry_value_t cb = irq_js_cb[pin];
-  if (jerry_value_is_function(cb)) {
+  km_io_irq_push(pin, (uint8_t)mode);
+}
+
+static void irq_close_cb(km_io_handle_t *handle) { free(handle); }
+
+static jerry_value_t create_irq_event(km_io_irq_event_t *event) {
+  jerry_value_t obj = jerry_create_object();
+  jerryxx_set_property_number(obj, MSTR_PIN, event->pin);
+  jerryxx_set_property_number(obj, MSTR_EVENTS, event->events);
+  jerryxx_set_property_number(obj, MSTR_TIME, (double)event->time);
+  return obj;
+}
+
+static void attach_interrupt_cb(km_io_irq_handle_t *irq,
+                                km_io_irq_event_t *events, size_t count,
+                                uint32_t overflow) {
+  if (jerry_value_is_function(irq->irq_js_cb)) {
     jerry_value_t this_val = jerry_create_undefined();
-    jerry_value_t arg_pin = jerry_create_number(pin);
-    jerry_value_t arg_mode = jerry_create_number(mode);
-    jerry_value_t args_p[2] = {arg_pin, arg_mode};
-    jerry_value_t ret_val = jerry_call_function(cb, this_val, args_p, 2);
+    jerry_value_t ret_val;
+    if (irq->batch) {
+      jerry_value_t arr = jerry_create_array(count);
+      for (size_t i = 0; i < count; i++) {
+        jerry_value_t obj = create_irq_event(&events[i]);
+        jerry_release_value(jerry_set_property_by_index(arr, i, obj));
+        jerry_release_value(obj);
+      }
+      jerry_value_t arg_overflow = jerry_create_number(overflow);
+      jerry_value_t args_p[2] = {arr, arg_overflow};
+      ret_val = jerry_call_function(irq->irq_js_cb, this_val, args_p, 2);
+      jerry_release_value(arg_overflow);
+      jerry_release_value(arr);
+    } else {
+      jerry_value_t arg_pin = jerry_create_number(events[0].pin);
+      jerry_value_t arg_mode = jerry_create_number(events[0].events);
+      jerry_value_t arg_time = jerry_create_number((double)events[0].time);
+      jerry_value_t args_p[3] = {arg_pin, arg_mode, arg_time};
+      ret_val = jerry_call_function(irq->irq_js_cb, this_val, args_p, 3);
+      jerry_release_value(arg_pin);
+      jerry_release_value(arg_mode);
+      jerry_release_value(arg_time);
+    }
     if (jerry_value_is_error(ret_val)) {
       // print error
       jerryxx_print_error(ret_val, true);
     }
-    jerry_release_value(arg_pin);
-    jerry_release_value(arg_mode);
     jerry_release_value(ret_val);
     jerry_release_value(this_val);
   }
-  jerry_release_value(cb);
 }
 
+static void detach_interrupt(uint8_t pin) {
+  km_io_irq_handle_t *irq = km_io_irq_get_by_pin(pin);
+  if (irq != NULL) {
+    jerry_release_value(irq->irq_js_cb);
+    km_io_irq_stop(irq);
+    km_io_handle_close((km_io_handle_t *)irq, irq_close_cb);
+  }
+}
+
+/**
+ * attachInterrupt(pin, callback, events, options)
+ * options:
+ *   batch {boolean} callback(events, overflow) is called with an array of
+ *     the pending events ({pin, events, time}, up to 64 per call) instead
+ *     of callback(pin, events, time) for each event.
+ */
 JERRYXX_FUN(attach_interrupt_fn) {
   JERRYXX_CHECK_ARG_NUMBER(0, "pin");
   JERRYXX_CHECK_ARG_FUNCTION(1, "callback");
   JERRYXX_CHECK_ARG_NUMBER_OPT(2, "events");
+  JERRYXX_CHECK_ARG_OBJECT_OPT(3, "options");
   uint8_t pin = (uint8_t)JERRYXX_GET_ARG_NUMBER(0);
   jerry_value_t callback = JERRYXX_GET_ARG(1);
   km_io_watch_mode_t events =
       JERRYXX_GET_ARG_NUMBER_OPT(2, KM_IO_WATCH_MODE_CHANGE);
+  bool batch = false;
+  if (JERRYXX_HAS_ARG(3)) {
+    batch = jerryxx_get_property_boolean(JERRYXX_GET_ARG(3), MSTR_BATCH,
+                                         false);
+  }
   if ((events & KM_IO_WATCH_MODE_CHANGE) == 0) {
     char errmsg[255];
     sprintf(errmsg,
             "Only RISING, FALLING and CHANGE can be set for interrupt event.");
     return jerry_create_error(JERRY_ERROR_RANGE, (const jerry_char_t *)errmsg);
   }
-  if (jerry_value_is_function(callback)) {
-    irq_js_cb[pin] = jerry_acquire_value(callback);
-    km_gpio_irq_set_callback(irq_cb);
+  detach_interrupt(pin);
+  km_io_irq_handle_t *irq = malloc(sizeof(km_io_irq_handle_t));
+  if (irq == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
   }
-  if (km_gpio_irq_attach(pin, events) < 0) {
+  km_io_irq_init(irq);
+  if (km_io_irq_start(irq, attach_interrupt_cb, pin, events, batch) < 0) {
+    free(irq);
     char errmsg[255];
     sprintf(errmsg, "The pin \"%d\" can't be used for GPIO", pin);
     return jerry_create_error(JERRY_ERROR_RANGE, (const jerry_char_t *)errmsg);
   }
+  irq->irq_js_cb = jerry_acquire_value(callback);
   return jerry_create_undefined();
 }
 
 JERRYXX_FUN(detach_interrupt_fn) {
   JERRYXX_CHECK_ARG_NUMBER(0, "pin");
   uint8_t pin = (uint8_t)JERRYXX_GET_ARG_NUMBER(0);
-  if (km_gpio_irq_detach(pin) < 0) {
+  if (km_gpio_read(pin) < 0) {
     char errmsg[255];
     sprintf(errmsg, "The pin \"%d\" can't be used for GPIO", pin);
     return jerry_create_error(JERRY_ERROR_RANGE, (const jerry_char_t *)errmsg);
   }
-  km_gpio_irq_detach(pin);
-  jerry_release_value(irq_js_cb[pin]);
-  irq_js_cb[pin] = 0;
+  // the pin interrupt stays enabled while setWatch() uses it
+  detach_interrupt(pin);
   return jerry_create_undefined();
 }
 
+/**
+ * interruptStats(pin)
+ * Return the number of delivered and lost (queue overflow) events.
+ */
+JERRYXX_FUN(interrupt_stats_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "pin");
+  uint8_t pin = (uint8_t)JERRYXX_GET_ARG_NUMBER(0);
+  km_io_irq_handle_t *irq = km_io_irq_get_by_pin(pin);
+  if (irq == NULL) {
+    return jerry_create_undefined();
+  }
+  jerry_value_t obj = jerry_create_object();
+  jerryxx_set_property_number(obj, MSTR_COUNT, irq->count);
+  jerryxx_set_property_number(obj, MSTR_OVERFLOW, irq->overflow);
+  return obj;
+}
+
 JERRYXX_FUN(enable_interrupts_fn) {
   km_gpio_irq_set_callback(irq_cb);
   km_gpio_irq_enable();
@@ -505,6 +580,8 @@ static void register_global_interrupts() {
                                 enable_interrupts_fn);
   jerryxx_set_property_function(global, MSTR_DISABLE_INTERRUPTS,
                                 disable_interrupts_fn);
+  jerryxx_set_property_function(global, MSTR_INTERRUPT_STATS,
+                                interrupt_stats_fn);
   jerry_release_value(global);
 }
 
@@ -546,9 +623,16 @@ JERRYXX_FUN(set_timeout_fn) {
   jerry_value_t callback = JERRYXX_GET_ARG(0);
   uint64_t delay = (uint64_t)JERRYXX_GET_ARG_NUMBER(1);
   km_io_timer_handle_t *timer = malloc(sizeof(km_io_timer_handle_t));
+  if (timer == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
   km_io_timer_init(timer);
+  int ret = km_io_timer_start(timer, set_timer_cb, delay, false);
+  if (ret < 0) {
+    free(timer);
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
   timer->timer_js_cb = jerry_acquire_value(callback);
-  km_io_timer_start(timer, set_timer_cb, delay, false);
   return jerry_create_number(timer->base.id);
 }
 
@@ -558,9 +642,16 @@ JERRYXX_FUN(set_interval_fn) {
   jerry_value_t callback = JERRYXX_GET_ARG(0);
   uint64_t delay = (uint64_t)JERRYXX_GET_ARG_NUMBER(1);
   km_io_timer_handle_t *timer = malloc(sizeof(km_io_timer_handle_t));
+  if (timer == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
   km_io_timer_init(timer);
+  int ret = km_io_timer_start(timer, set_timer_cb, delay, true);
+  if (ret < 0) {
+    free(timer);
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
   timer->timer_js_cb = jerry_acquire_value(callback);
-  km_io_timer_start(timer, set_timer_cb, delay, true);
   return jerry_create_number(timer->base.id);
 }
 
@@ -711,9 +802,22 @@ JERRYXX_FUN(tone_fn) {
     // setup timer for duration
     if (duration > 0) {
       km_io_timer_handle_t *timer = malloc(sizeof(km_io_timer_handle_t));
-      km_io_timer_init(timer);
-      timer->tag = pin;
-      km_io_timer_start(timer, tone_timeout_cb, duration, false);
+      int ret = ENOMEM;
+      if (timer != NULL) {
+        km_io_timer_init(timer);
+        timer->tag = pin;
+        ret = km_io_timer_start(timer, tone_timeout_cb, duration, false);
+        if (ret < 0) {
+          free(timer);
+        }
+      }
+      if (ret < 0) {
+        km_pwm_stop(pin);
+        if (inversion >= 0) {
+          km_pwm_stop(inversion);
+        }
+        return jerry_create_error_from_value(create_system_error(ret), true);
+      }
     }
     return jerry_create_undefined();
   }
@@ -798,15 +902,39 @@ static void register_global_console_object() {
 /*                                                                          */
 /****************************************************************************/
 
+/**
+ * Exports of native modules, created once per runtime and shared by every
+ * process.binding() and require() of the same module.
+ */
+static jerry_value_t *native_exports = NULL;
+
+static jerry_value_t get_native_exports(int index) {
+  if (native_exports == NULL) {
+    native_exports = malloc(builtin_modules_length * sizeof(jerry_value_t));
+    if (native_exports == NULL) {
+      return builtin_modules[index].fn();
+    }
+    for (int i = 0; i < builtin_modules_length; i++) {
+      native_exports[i] = jerry_create_undefined();
+    }
+  }
+  if (jerry_value_is_undefined(native_exports[index])) {
+    jerry_value_t res = builtin_modules[index].fn();
+    if (jerry_value_is_error(res)) {
+      return res;
+    }
+    native_exports[index] = res;
+  }
+  return jerry_acquire_value(native_exports[index]);
+}
+
 JERRYXX_FUN(process_binding_fn) {
   JERRYXX_CHECK_ARG_STRING(0, "native_module_name")
   JERRYXX_GET_ARG_STRING_AS_CHAR(0, native_module_name)
   /* Return a native initialized object */
-  for (int i = 0; i < builtin_modules_length; i++) {
-    if (strcmp(builtin_modules[i].name, native_module_name) == 0 &&
-        builtin_modules[i].fn != NULL) {
-      return builtin_modules[i].fn();
-    }
+  int i = builtin_module_find(native_module_name);
+  if (i >= 0 && builtin_modules[i].fn != NULL) {
+    return get_native_exports(i);
   }
   /* If no corresponding module, return undefined */
   return jerry_create_undefined();
@@ -825,13 +953,14 @@ JERRYXX_FUN(native_module_wrapper_fn) {
   module_name[module_name_sz] = '\0';
   jerry_release_value(id);
   /* Find corresponding native module */
-  for (int i = 0; i < builtin_modules_length; i++) {
-    if (strcmp(builtin_modules[i].name, module_name) == 0 &&
-        builtin_modules[i].fn != NULL) {
-      jerry_value_t res = builtin_modules[i].fn();
-      jerryxx_set_property(module, MSTR_EXPORTS, res);
-      jerry_release_value(res);
+  int i = builtin_module_find(module_name);
+  if (i >= 0 && builtin_modules[i].fn != NULL) {
+    jerry_value_t res = get_native_exports(i);
+    if (jerry_value_is_error(res)) {
+      return res;
     }
+    jerryxx_set_property(module, MSTR_EXPORTS, res);
+    jerry_release_value(res);
   }
   return jerry_create_undefined();
 }
@@ -840,23 +969,80 @@ JERRYXX_FUN(process_get_builtin_module_fn) {
   JERRYXX_CHECK_ARG_STRING(0, "builtin_module_name")
   JERRYXX_GET_ARG_STRING_AS_CHAR(0, builtin_module_name)
   /* Find a builtin js module, return the module function */
-  for (int i = 0; i < builtin_modules_length; i++) {
-    if (strcmp(builtin_modules[i].name, builtin_module_name) == 0) {
-      if (builtin_modules[i].size > 0) { /* has js module */
-        jerry_value_t fn = jerry_exec_snapshot(
-            builtin_modules[i].code, builtin_modules[i].size, 0,
-            JERRY_SNAPSHOT_EXEC_ALLOW_STATIC);
-        return fn;
-      } else if (builtin_modules[i].fn != NULL) { /* has native module */
-        jerry_value_t fn =
-            jerry_create_external_function(native_module_wrapper_fn);
-        return fn;
-      }
+  int i = builtin_module_find(builtin_module_name);
+  if (i >= 0) {
+    if (builtin_modules[i].size > 0) { /* has js module */
+      jerry_value_t fn =
+          jerry_exec_snapshot(builtin_modules[i].code, builtin_modules[i].size,
+                              0, JERRY_SNAPSHOT_EXEC_ALLOW_STATIC);
+      return fn;
+    } else if (builtin_modules[i].fn != NULL) { /* has native module */
+      jerry_value_t fn =
+          jerry_create_external_function(native_module_wrapper_fn);
+      return fn;
     }
   }
   return jerry_create_undefined();
 }
 
+/**
+ * Get the bytes viewed by a typed array argument.
+ * @return false if the value is not a typed array
+ */
+static bool get_typedarray_bytes(jerry_value_t value, uint8_t **data,
+                                 size_t *size) {
+  if (!jerry_value_is_typedarray(value)) return false;
+  jerry_length_t offset = 0;
+  jerry_length_t length = 0;
+  jerry_value_t buffer = jerry_get_typedarray_buffer(value, &offset, &length);
+  *data = jerry_get_arraybuffer_pointer(buffer) + offset;
+  *size = length;
+  jerry_release_value(buffer);
+  return true;
+}
+
+JERRYXX_FUN(process_compile_module_fn) {
+  JERRYXX_CHECK_ARG(0, "source")
+  JERRYXX_CHECK_ARG_STRING(1, "filename")
+  JERRYXX_GET_ARG_STRING_AS_CHAR(1, filename)
+  uint8_t *source;
+  size_t size;
+  if (!get_typedarray_bytes(JERRYXX_GET_ARG(0), &source, &size)) {
+    return jerry_create_error(JERRY_ERROR_TYPE,
+                              (const jerry_char_t *)"source must be Uint8Array");
+  }
+  return km_runtime_compile_module(filename, source, size);
+}
+
+JERRYXX_FUN(process_snapshot_module_fn) {
+  JERRYXX_CHECK_ARG(0, "source")
+  JERRYXX_CHECK_ARG_STRING(1, "filename")
+  JERRYXX_GET_ARG_STRING_AS_CHAR(1, filename)
+  uint8_t *source;
+  size_t size;
+  if (!get_typedarray_bytes(JERRYXX_GET_ARG(0), &source, &size)) {
+    return jerry_create_error(JERRY_ERROR_TYPE,
+                              (const jerry_char_t *)"source must be Uint8Array");
+  }
+  return km_runtime_snapshot_module(filename, source, size);
+}
+
+JERRYXX_FUN(process_load_module_snapshot_fn) {
+  JERRYXX_CHECK_ARG(0, "snapshot")
+  JERRYXX_CHECK_ARG(1, "source")
+  uint8_t *snapshot;
+  size_t len;
+  uint8_t *source;
+  size_t size;
+  if (!get_typedarray_bytes(JERRYXX_GET_ARG(0), &snapshot, &len) ||
+      !get_typedarray_bytes(JERRYXX_GET_ARG(1), &source, &size)) {
+    return jerry_create_error(
+        JERRY_ERROR_TYPE,
+        (const jerry_char_t *)"snapshot and source must be Uint8Array");
+  }
+  return km_runtime_load_module(snapshot, len, source, size);
+}
+
 JERRYXX_FUN(process_memory_usage_fn) {
   jerry_heap_stats_t stats = {0};
   bool stats_ret = jerry_get_memory_stats(&stats);
@@ -952,6 +1138,14 @@ static void register_global_process_object() {
   jerryxx_set_property_function(process, MSTR_GET_BUILTIN_MODULE,
                                 process_get_builtin_module_fn);
 
+  // add functions loading user modules (see startup.js)
+  jerryxx_set_property_function(process, MSTR_COMPILE_MODULE,
+                                process_compile_module_fn);
+  jerryxx_set_property_function(process, MSTR_SNAPSHOT_MODULE,
+                                process_snapshot_module_fn);
+  jerryxx_set_property_function(process, MSTR_LOAD_MODULE_SNAPSHOT,
+                                process_load_module_snapshot_fn);
+
   // add stdin and stdout readonly properties
   jerryxx_define_own_property(process, MSTR_STDIN, process_stdin_getter_fn,
                               NULL);
@@ -1403,3 +1597,13 @@ void km_global_init() {
   run_startup_module();
   run_board_module();
 }
+
+void km_global_cleanup() {
+  if (native_exports != NULL) {
+    for (int i = 0; i < builtin_modules_length; i++) {
+      jerry_release_value(native_exports[i]);
+    }
+    free(native_exports);
+    native_exports = NULL;
+  }
+}
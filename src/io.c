@@ -24,13 +24,18 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "err.h"
 #include "gpio.h"
 #include "system.h"
 #include "tty.h"
 #include "uart.h"
 
 #include "kaluma_modules.h"
+#ifdef MODULE_WORKER_SELECTED
+#include "worker.h"
+#endif
 
 km_io_loop_t loop;
 
@@ -41,7 +46,12 @@ static void km_io_tty_run();
 static void km_io_watch_run();
 static void km_io_uart_run();
 static void km_io_idle_run();
-static void km_io_idle_run();
+static void km_io_irq_run();
+static bool km_io_irq_pending();
+static int km_io_irq_update_pin(uint8_t pin);
+static uint32_t km_io_watch_wait_timeout(uint32_t timeout);
+static void km_io_watch_irq_event(km_io_watch_handle_t *watch,
+                                  km_io_irq_event_t *event);
 
 /* general handle functions */
 
@@ -73,6 +83,50 @@ km_io_handle_t *km_io_handle_get_by_id(uint32_t id, km_list_t *handle_list) {
 
 static void km_io_update_time() { loop.time = km_gettime(); }
 
+#define KM_IO_WAIT_MAX 1000  // msec
+
+/**
+ * True if work outside the handle lists (worker jobs, port I/O such as
+ * sockets) still has to complete.
+ */
+static bool km_io_has_pending_work() {
+#ifdef MODULE_WORKER_SELECTED
+  // worker jobs complete through the idle handle of the worker
+  if (km_worker_pending() > 0) {
+    return true;
+  }
+#endif
+  return km_has_active_io();
+}
+
+/**
+ * Return how long (in msec) the loop can wait for an event. It is the time
+ * until the earliest timer is expired, or 0 if there are handles to be
+ * processed without waiting.
+ */
+static uint32_t km_io_wait_timeout() {
+  if (loop.closing_handles.head != NULL || km_io_irq_pending()) {
+    return 0;
+  }
+#ifdef MODULE_XPT2046_SELECTED
+  return 0;  // touch is polled
+#else
+  uint64_t timeout = KM_IO_WAIT_MAX;
+  if (loop.timer_queue.heap_size > 0) {
+    // timer is expired when the current time passed the clamped timeout
+    uint64_t expire = loop.timer_queue.heap[0]->clamped_timeout + 1;
+    uint64_t now = km_gettime();
+    if (expire <= now) {
+      return 0;
+    }
+    if (expire - now < timeout) {
+      timeout = expire - now;
+    }
+  }
+  return km_io_watch_wait_timeout((uint32_t)timeout);
+#endif
+}
+
 static void km_io_handle_closing() {
   while (loop.closing_handles.head != NULL) {
     km_io_handle_t *handle = (km_io_handle_t *)loop.closing_handles.head;
@@ -90,10 +144,12 @@ void km_io_init() {
   km_io_update_time();
   km_list_init(&loop.tty_handles);
   km_list_init(&loop.timer_handles);
+  memset(&loop.timer_queue, 0, sizeof(km_io_timer_queue_t));
   km_list_init(&loop.watch_handles);
   km_list_init(&loop.uart_handles);
   km_list_init(&loop.idle_handles);
   km_list_init(&loop.stream_handles);
+  km_list_init(&loop.irq_handles);
   km_list_init(&loop.closing_handles);
 }
 
@@ -101,6 +157,7 @@ void km_io_cleanup() {
   km_io_timer_cleanup();
   km_io_watch_cleanup();
   km_io_uart_cleanup();
+  km_io_irq_cleanup();
   // km_io_idle_cleanup();
   // Do not cleanup tty I/O to keep terminal communication
   km_io_stream_cleanup();
@@ -110,6 +167,7 @@ void km_io_run(bool infinite) {
   while (loop.stop_flag == false) {
     km_io_update_time();
     km_io_timer_run();
+    km_io_irq_run();
     km_io_tty_run();
     km_io_watch_run();
     km_io_uart_run();
@@ -124,40 +182,235 @@ void km_io_run(bool infinite) {
     // quite if there no IO handles
     if (!infinite) {
       if (loop.timer_handles.head == NULL && loop.watch_handles.head == NULL &&
-          loop.uart_handles.head == NULL && loop.closing_handles.head == NULL) {
+          loop.irq_handles.head == NULL && loop.uart_handles.head == NULL &&
+          loop.closing_handles.head == NULL && !km_io_has_pending_work()) {
         loop.stop_flag = true;
       }
     }
+
+    // sleep until the next timer or an event
+    if (loop.stop_flag == false) {
+      km_wait_for_event(km_io_wait_timeout());
+    }
   }
 }
 
 /* timer functions */
 
-uint32_t timer_count = 0;
+#define KM_IO_TIMER_HEAP_INIT_CAPACITY 16
+#define KM_IO_TIMER_BUCKET_INIT_COUNT 16
+
+/**
+ * Compare two timers by timeout. Timers with the same timeout are ordered by
+ * the sequence they were scheduled in.
+ */
+static bool km_io_timer_less(km_io_timer_handle_t *a, km_io_timer_handle_t *b) {
+  if (a->clamped_timeout != b->clamped_timeout) {
+    return a->clamped_timeout < b->clamped_timeout;
+  }
+  return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static void km_io_timer_heap_set(uint32_t index, km_io_timer_handle_t *timer) {
+  loop.timer_queue.heap[index] = timer;
+  timer->heap_index = (int32_t)index;
+}
+
+static void km_io_timer_heap_up(uint32_t index) {
+  km_io_timer_handle_t **heap = loop.timer_queue.heap;
+  km_io_timer_handle_t *timer = heap[index];
+  while (index > 0) {
+    uint32_t parent = (index - 1) / 2;
+    if (!km_io_timer_less(timer, heap[parent])) {
+      break;
+    }
+    km_io_timer_heap_set(index, heap[parent]);
+    index = parent;
+  }
+  km_io_timer_heap_set(index, timer);
+}
+
+static void km_io_timer_heap_down(uint32_t index) {
+  km_io_timer_handle_t **heap = loop.timer_queue.heap;
+  uint32_t size = loop.timer_queue.heap_size;
+  km_io_timer_handle_t *timer = heap[index];
+  while (true) {
+    uint32_t child = index * 2 + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && km_io_timer_less(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!km_io_timer_less(heap[child], timer)) {
+      break;
+    }
+    km_io_timer_heap_set(index, heap[child]);
+    index = child;
+  }
+  km_io_timer_heap_set(index, timer);
+}
+
+/**
+ * Grow the heap to hold at least `size` timers
+ */
+static bool km_io_timer_heap_reserve(uint32_t size) {
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  if (size > queue->heap_capacity) {
+    uint32_t capacity = queue->heap_capacity > 0
+                            ? queue->heap_capacity * 2
+                            : KM_IO_TIMER_HEAP_INIT_CAPACITY;
+    while (capacity < size) {
+      capacity *= 2;
+    }
+    km_io_timer_handle_t **heap =
+        realloc(queue->heap, capacity * sizeof(km_io_timer_handle_t *));
+    if (heap == NULL) {
+      return false;
+    }
+    queue->heap = heap;
+    queue->heap_capacity = capacity;
+  }
+  return true;
+}
+
+/**
+ * Push a timer to the heap. The capacity is reserved for all started timers
+ * in km_io_timer_start(), so this never fails.
+ */
+static void km_io_timer_heap_push(km_io_timer_handle_t *timer) {
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  timer->seq = queue->seq++;
+  queue->heap[queue->heap_size] = timer;
+  queue->heap_size++;
+  km_io_timer_heap_up(queue->heap_size - 1);
+}
+
+static void km_io_timer_heap_remove(km_io_timer_handle_t *timer) {
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  if (timer->heap_index < 0) {
+    return;
+  }
+  uint32_t index = (uint32_t)timer->heap_index;
+  timer->heap_index = -1;
+  queue->heap_size--;
+  if (index < queue->heap_size) {
+    km_io_timer_handle_t *last = queue->heap[queue->heap_size];
+    km_io_timer_heap_set(index, last);
+    if (index > 0 && km_io_timer_less(last, queue->heap[(index - 1) / 2])) {
+      km_io_timer_heap_up(index);
+    } else {
+      km_io_timer_heap_down(index);
+    }
+  }
+}
+
+static void km_io_timer_hash_grow() {
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  uint32_t count = queue->bucket_count > 0 ? queue->bucket_count * 2
+                                           : KM_IO_TIMER_BUCKET_INIT_COUNT;
+  km_io_timer_handle_t **buckets =
+      calloc(count, sizeof(km_io_timer_handle_t *));
+  if (buckets == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i < queue->bucket_count; i++) {
+    km_io_timer_handle_t *timer = queue->buckets[i];
+    while (timer != NULL) {
+      km_io_timer_handle_t *next = timer->hash_next;
+      uint32_t index = timer->base.id & (count - 1);
+      timer->hash_next = buckets[index];
+      buckets[index] = timer;
+      timer = next;
+    }
+  }
+  free(queue->buckets);
+  queue->buckets = buckets;
+  queue->bucket_count = count;
+}
+
+/**
+ * Add a timer to the hash. Fails only if no bucket could be allocated, as
+ * the chains just get longer when growing fails.
+ */
+static bool km_io_timer_hash_add(km_io_timer_handle_t *timer) {
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  if (queue->count >= queue->bucket_count) {
+    km_io_timer_hash_grow();
+  }
+  if (queue->bucket_count == 0) {
+    return false;
+  }
+  uint32_t index = timer->base.id & (queue->bucket_count - 1);
+  timer->hash_next = queue->buckets[index];
+  queue->buckets[index] = timer;
+  queue->count++;
+  return true;
+}
+
+static void km_io_timer_hash_remove(km_io_timer_handle_t *timer) {
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  if (queue->bucket_count > 0) {
+    uint32_t index = timer->base.id & (queue->bucket_count - 1);
+    km_io_timer_handle_t **link = &queue->buckets[index];
+    while (*link != NULL) {
+      if (*link == timer) {
+        *link = timer->hash_next;
+        timer->hash_next = NULL;
+        queue->count--;
+        return;
+      }
+      link = &(*link)->hash_next;
+    }
+  }
+}
 
 void km_io_timer_init(km_io_timer_handle_t *timer) {
   km_io_handle_init((km_io_handle_t *)timer, KM_IO_TIMER);
   timer->timer_cb = NULL;
+  timer->heap_index = -1;
+  timer->hash_next = NULL;
+  timer->due_next = NULL;
 }
 
-void km_io_timer_start(km_io_timer_handle_t *timer, km_io_timer_cb timer_cb,
-                       uint64_t interval, bool repeat) {
+int km_io_timer_start(km_io_timer_handle_t *timer, km_io_timer_cb timer_cb,
+                      uint64_t interval, bool repeat) {
+  // reserve a heap slot for every started timer, so that repeating timers
+  // can always be re-scheduled in km_io_timer_run()
+  if (!km_io_timer_heap_reserve(loop.timer_queue.count + 1) ||
+      !km_io_timer_hash_add(timer)) {
+    return ENOMEM;
+  }
   KM_IO_SET_FLAG_ON(timer->base.flags, KM_IO_FLAG_ACTIVE);
   timer->timer_cb = timer_cb;
   timer->clamped_timeout = loop.time + interval;
   timer->interval = interval;
   timer->repeat = repeat;
   km_list_append(&loop.timer_handles, (km_list_node_t *)timer);
+  km_io_timer_heap_push(timer);
+  return 0;
 }
 
 void km_io_timer_stop(km_io_timer_handle_t *timer) {
   KM_IO_SET_FLAG_OFF(timer->base.flags, KM_IO_FLAG_ACTIVE);
   km_list_remove(&loop.timer_handles, (km_list_node_t *)timer);
+  km_io_timer_hash_remove(timer);
+  km_io_timer_heap_remove(timer);
 }
 
 km_io_timer_handle_t *km_io_timer_get_by_id(uint32_t id) {
-  return (km_io_timer_handle_t *)km_io_handle_get_by_id(id,
-                                                        &loop.timer_handles);
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  if (queue->bucket_count > 0) {
+    km_io_timer_handle_t *timer =
+        queue->buckets[id & (queue->bucket_count - 1)];
+    while (timer != NULL) {
+      if (timer->base.id == id) {
+        return timer;
+      }
+      timer = timer->hash_next;
+    }
+  }
+  return NULL;
 }
 
 void km_io_timer_cleanup() {
@@ -170,25 +423,51 @@ void km_io_timer_cleanup() {
     handle = next;
   }
   km_list_init(&loop.timer_handles);
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  free(queue->heap);
+  free(queue->buckets);
+  queue->heap = NULL;
+  queue->heap_size = 0;
+  queue->heap_capacity = 0;
+  queue->buckets = NULL;
+  queue->bucket_count = 0;
+  queue->count = 0;
 }
 
 static void km_io_timer_run() {
-  km_io_timer_handle_t *handle =
-      (km_io_timer_handle_t *)loop.timer_handles.head;
-  while (handle != NULL) {
-    if (KM_IO_HAS_FLAG(handle->base.flags, KM_IO_FLAG_ACTIVE)) {
-      if (handle->clamped_timeout < loop.time) {
-        if (handle->repeat) {
-          handle->clamped_timeout = handle->clamped_timeout + handle->interval;
-        } else {
-          KM_IO_SET_FLAG_OFF(handle->base.flags, KM_IO_FLAG_ACTIVE);
-        }
-        if (handle->timer_cb) {
-          handle->timer_cb(handle);
-        }
+  km_io_timer_queue_t *queue = &loop.timer_queue;
+  km_io_timer_handle_t *due_head = NULL;
+  km_io_timer_handle_t *due_tail = NULL;
+  /* take out all expired timers first, so each timer is fired at most once
+     per iteration even if it is re-scheduled to the past */
+  while (queue->heap_size > 0 && queue->heap[0]->clamped_timeout < loop.time) {
+    km_io_timer_handle_t *handle = queue->heap[0];
+    km_io_timer_heap_remove(handle);
+    handle->due_next = NULL;
+    if (due_tail != NULL) {
+      due_tail->due_next = handle;
+    } else {
+      due_head = handle;
+    }
+    due_tail = handle;
+  }
+  while (due_head != NULL) {
+    km_io_timer_handle_t *handle = due_head;
+    due_head = handle->due_next;
+    handle->due_next = NULL;
+    /* skip if stopped (or re-started) by a previous callback */
+    if (KM_IO_HAS_FLAG(handle->base.flags, KM_IO_FLAG_ACTIVE) &&
+        handle->heap_index < 0) {
+      if (handle->repeat) {
+        handle->clamped_timeout = handle->clamped_timeout + handle->interval;
+        km_io_timer_heap_push(handle);
+      } else {
+        KM_IO_SET_FLAG_OFF(handle->base.flags, KM_IO_FLAG_ACTIVE);
+      }
+      if (handle->timer_cb) {
+        handle->timer_cb(handle);
       }
     }
-    handle = (km_io_timer_handle_t *)((km_list_node_t *)handle)->next;
   }
 }
 
@@ -246,6 +525,11 @@ void km_io_watch_init(km_io_watch_handle_t *watch) {
   watch->watch_cb = NULL;
 }
 
+static bool km_io_watch_is_edge(km_io_watch_mode_t mode) {
+  return mode == KM_IO_WATCH_MODE_FALLING || mode == KM_IO_WATCH_MODE_RISING ||
+         mode == KM_IO_WATCH_MODE_CHANGE;
+}
+
 void km_io_watch_start(km_io_watch_handle_t *watch, km_io_watch_cb watch_cb,
                        uint8_t pin, km_io_watch_mode_t mode,
                        uint32_t debounce) {
@@ -253,16 +537,25 @@ void km_io_watch_start(km_io_watch_handle_t *watch, km_io_watch_cb watch_cb,
   watch->watch_cb = watch_cb;
   watch->pin = pin;
   watch->mode = mode;
+  watch->pending = false;
   watch->debounce_time = 0;
   watch->debounce_delay = debounce;
   watch->last_val = (uint8_t)km_gpio_read(watch->pin);
   watch->val = (uint8_t)km_gpio_read(watch->pin);
   km_list_append(&loop.watch_handles, (km_list_node_t *)watch);
+  // edges are watched by interrupt if the port supports it
+  watch->irq = km_io_watch_is_edge(mode);
+  if (watch->irq && km_io_irq_update_pin(pin) < 0) {
+    watch->irq = false;
+  }
 }
 
 void km_io_watch_stop(km_io_watch_handle_t *watch) {
   KM_IO_SET_FLAG_OFF(watch->base.flags, KM_IO_FLAG_ACTIVE);
   km_list_remove(&loop.watch_handles, (km_list_node_t *)watch);
+  if (watch->irq) {
+    km_io_irq_update_pin(watch->pin);
+  }
 }
 
 km_io_watch_handle_t *km_io_watch_get_by_id(uint32_t id) {
@@ -282,50 +575,339 @@ void km_io_watch_cleanup() {
   km_list_init(&loop.watch_handles);
 }
 
+/**
+ * Return how long (in msec) the loop can wait for watches, up to `timeout`.
+ * Polled watches need every iteration, interrupt-driven watches only need to
+ * wake up when a debounce delay is elapsed.
+ */
+static uint32_t km_io_watch_wait_timeout(uint32_t timeout) {
+  uint64_t now = 0;
+  km_io_watch_handle_t *handle =
+      (km_io_watch_handle_t *)loop.watch_handles.head;
+  while (handle != NULL) {
+    if (!handle->irq) {
+      return 0;  // polled
+    }
+    if (handle->pending) {
+      if (now == 0) {
+        now = km_micro_gettime();
+      }
+      uint64_t expire = handle->debounce_time +
+                        (uint64_t)handle->debounce_delay * 1000;
+      if (expire <= now) {
+        return 0;
+      }
+      uint64_t remain = (expire - now + 999) / 1000;
+      if (remain < timeout) {
+        timeout = (uint32_t)remain;
+      }
+    }
+    handle = (km_io_watch_handle_t *)((km_list_node_t *)handle)->next;
+  }
+  return timeout;
+}
+
+/**
+ * Update the stable value of a watch and call back if it matches the mode
+ */
+static void km_io_watch_settle(km_io_watch_handle_t *handle, uint8_t value) {
+  if (value != handle->val) {
+    handle->val = value;
+    switch (handle->mode) {
+      case KM_IO_WATCH_MODE_CHANGE:
+        if (handle->watch_cb) {
+          handle->watch_cb(handle);
+        }
+        break;
+      case KM_IO_WATCH_MODE_RISING:
+        if (handle->val == 1 && handle->watch_cb) {
+          handle->watch_cb(handle);
+        }
+        break;
+      case KM_IO_WATCH_MODE_FALLING:
+        if (handle->val == 0 && handle->watch_cb) {
+          handle->watch_cb(handle);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/**
+ * Feed an edge interrupt to a watch. Each edge restarts the debounce delay,
+ * so the value settles when the pin is quiet for the delay.
+ */
+static void km_io_watch_irq_event(km_io_watch_handle_t *watch,
+                                  km_io_irq_event_t *event) {
+  if (event->events == KM_IO_WATCH_MODE_RISING) {
+    watch->last_val = 1;
+  } else if (event->events == KM_IO_WATCH_MODE_FALLING) {
+    watch->last_val = 0;
+  } else {  // both edges are latched
+    watch->last_val = (uint8_t)km_gpio_read(watch->pin);
+  }
+  if (watch->debounce_delay == 0) {
+    km_io_watch_settle(watch, watch->last_val);
+  } else {
+    watch->pending = true;
+    watch->debounce_time = event->time;
+  }
+}
+
+static void km_io_watch_poll(km_io_watch_handle_t *handle) {
+  uint8_t reading = (uint8_t)km_gpio_read(handle->pin);
+  if (handle->last_val != reading) { /* changed by noise or pressing */
+    handle->debounce_time = km_gettime();
+  }
+  /* debounce delay elapsed */
+  uint32_t elapsed_time = km_gettime() - handle->debounce_time;
+  if ((handle->watch_cb) &&
+      (((handle->mode == KM_IO_WATCH_MODE_LOW_LEVEL) && (reading == 0)) ||
+       ((handle->mode == KM_IO_WATCH_MODE_HIGH_LEVEL) && (reading == 1)))) {
+    handle->watch_cb(handle);
+  } else if (handle->debounce_time > 0 &&
+             elapsed_time >= handle->debounce_delay) {
+    km_io_watch_settle(handle, reading);
+    handle->debounce_time = 0;
+  }
+  handle->last_val = reading;
+}
+
 static void km_io_watch_run() {
+  uint64_t now = 0;
   km_io_watch_handle_t *handle =
       (km_io_watch_handle_t *)loop.watch_handles.head;
   while (handle != NULL) {
+    km_io_watch_handle_t *next =
+        (km_io_watch_handle_t *)((km_list_node_t *)handle)->next;
     if (KM_IO_HAS_FLAG(handle->base.flags, KM_IO_FLAG_ACTIVE)) {
-      uint8_t reading = (uint8_t)km_gpio_read(handle->pin);
-      if (handle->last_val != reading) { /* changed by noise or pressing */
-        handle->debounce_time = km_gettime();
+      if (!handle->irq) {
+        km_io_watch_poll(handle);
+      } else if (handle->pending) {
+        if (now == 0) {
+          now = km_micro_gettime();
+        }
+        if (now - handle->debounce_time >=
+            (uint64_t)handle->debounce_delay * 1000) {
+          handle->pending = false;
+          // the pin level is the truth even if an edge was lost
+          km_io_watch_settle(handle, (uint8_t)km_gpio_read(handle->pin));
+        }
+      }
+    }
+    handle = next;
+  }
+}
+
+/* GPIO interrupt functions */
+
+/*
+ * Interrupt events are queued by the interrupt handler and delivered to the
+ * handles in the loop. The queue has a single producer (interrupt handler)
+ * and a single consumer (loop), so it is lock-free. When the queue is full,
+ * events are counted per pin as overflow instead.
+ */
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define KM_IO_IRQ_DRAIN_MAX 64  // events delivered per dispatch
+
+static km_io_irq_event_t irq_queue[KM_IO_IRQ_QUEUE_SIZE];
+static km_io_irq_event_t irq_drain[KM_IO_IRQ_DRAIN_MAX];
+static km_io_irq_event_t irq_matched[KM_IO_IRQ_DRAIN_MAX];
+static uint32_t irq_queue_head = 0;  // written by the interrupt handler only
+static uint32_t irq_queue_tail = 0;  // written by the loop only
+static uint32_t irq_overflow[KM_IO_IRQ_PIN_MAX];  // interrupt handler only
+
+void km_io_irq_push(uint8_t pin, uint8_t events) {
+  uint32_t head = irq_queue_head;
+  if (head - LOAD_ACQUIRE(&irq_queue_tail) >= KM_IO_IRQ_QUEUE_SIZE) {
+    if (pin < KM_IO_IRQ_PIN_MAX) {
+      STORE_RELEASE(&irq_overflow[pin], irq_overflow[pin] + 1);
+    }
+    return;
+  }
+  km_io_irq_event_t *event = &irq_queue[head & (KM_IO_IRQ_QUEUE_SIZE - 1)];
+  event->time = km_micro_gettime();
+  event->pin = pin;
+  event->events = events;
+  STORE_RELEASE(&irq_queue_head, head + 1);
+}
+
+static bool km_io_irq_pending() {
+  return LOAD_ACQUIRE(&irq_queue_head) != irq_queue_tail;
+}
+
+static void km_io_gpio_irq_cb(uint8_t pin, km_gpio_io_mode_t mode) {
+  km_io_irq_push(pin, (uint8_t)mode);
+}
+
+/**
+ * Attach the GPIO interrupt of a pin for all events required by interrupt
+ * handles and watches on the pin, or detach it if nothing is left.
+ */
+static int km_io_irq_update_pin(uint8_t pin) {
+  uint8_t events = 0;
+  km_io_irq_handle_t *irq = (km_io_irq_handle_t *)loop.irq_handles.head;
+  while (irq != NULL) {
+    if (irq->pin == pin) {
+      events |= irq->events;
+    }
+    irq = (km_io_irq_handle_t *)((km_list_node_t *)irq)->next;
+  }
+  km_io_watch_handle_t *watch =
+      (km_io_watch_handle_t *)loop.watch_handles.head;
+  while (watch != NULL) {
+    if (watch->pin == pin && watch->irq) {
+      events |= KM_IO_WATCH_MODE_CHANGE;  // both edges to track the level
+    }
+    watch = (km_io_watch_handle_t *)((km_list_node_t *)watch)->next;
+  }
+  if (events == 0) {
+    return km_gpio_irq_detach(pin);
+  }
+  km_gpio_irq_set_callback(km_io_gpio_irq_cb);
+  return km_gpio_irq_attach(pin, events);
+}
+
+void km_io_irq_init(km_io_irq_handle_t *irq) {
+  km_io_handle_init((km_io_handle_t *)irq, KM_IO_IRQ);
+  irq->irq_cb = NULL;
+}
+
+int km_io_irq_start(km_io_irq_handle_t *irq, km_io_irq_cb irq_cb, uint8_t pin,
+                    uint8_t events, bool batch) {
+  KM_IO_SET_FLAG_ON(irq->base.flags, KM_IO_FLAG_ACTIVE);
+  irq->irq_cb = irq_cb;
+  irq->pin = pin;
+  irq->events = events;
+  irq->batch = batch;
+  irq->count = 0;
+  irq->overflow = 0;
+  irq->overflow_mark =
+      pin < KM_IO_IRQ_PIN_MAX ? LOAD_ACQUIRE(&irq_overflow[pin]) : 0;
+  km_list_append(&loop.irq_handles, (km_list_node_t *)irq);
+  int ret = km_io_irq_update_pin(pin);
+  if (ret < 0) {
+    km_io_irq_stop(irq);
+  }
+  return ret;
+}
+
+void km_io_irq_stop(km_io_irq_handle_t *irq) {
+  KM_IO_SET_FLAG_OFF(irq->base.flags, KM_IO_FLAG_ACTIVE);
+  km_list_remove(&loop.irq_handles, (km_list_node_t *)irq);
+  km_io_irq_update_pin(irq->pin);
+}
+
+km_io_irq_handle_t *km_io_irq_get_by_id(uint32_t id) {
+  return (km_io_irq_handle_t *)km_io_handle_get_by_id(id, &loop.irq_handles);
+}
+
+km_io_irq_handle_t *km_io_irq_get_by_pin(uint8_t pin) {
+  km_io_irq_handle_t *handle = (km_io_irq_handle_t *)loop.irq_handles.head;
+  while (handle != NULL) {
+    if (handle->pin == pin) {
+      return handle;
+    }
+    handle = (km_io_irq_handle_t *)((km_list_node_t *)handle)->next;
+  }
+  return NULL;
+}
+
+void km_io_irq_cleanup() {
+  km_io_irq_handle_t *handle = (km_io_irq_handle_t *)loop.irq_handles.head;
+  while (handle != NULL) {
+    km_io_irq_handle_t *next =
+        (km_io_irq_handle_t *)((km_list_node_t *)handle)->next;
+    free(handle);
+    handle = next;
+  }
+  km_list_init(&loop.irq_handles);
+  STORE_RELEASE(&irq_queue_tail, LOAD_ACQUIRE(&irq_queue_head));
+}
+
+/**
+ * Deliver events to the interrupt handles. `matched` is a scratch buffer of
+ * the same length as `events`.
+ */
+static void km_io_irq_dispatch(km_io_irq_event_t *events, size_t count,
+                               km_io_irq_event_t *matched) {
+  km_io_irq_handle_t *handle = (km_io_irq_handle_t *)loop.irq_handles.head;
+  while (handle != NULL) {
+    // the callback may stop this or other handles
+    km_io_irq_handle_t *next =
+        (km_io_irq_handle_t *)((km_list_node_t *)handle)->next;
+    if (handle->base.type == KM_IO_IRQ &&
+        KM_IO_HAS_FLAG(handle->base.flags, KM_IO_FLAG_ACTIVE) &&
+        handle->irq_cb != NULL) {
+      uint32_t overflow = 0;
+      if (handle->pin < KM_IO_IRQ_PIN_MAX) {
+        uint32_t mark = LOAD_ACQUIRE(&irq_overflow[handle->pin]);
+        overflow = mark - handle->overflow_mark;
+        handle->overflow_mark = mark;
+        handle->overflow += overflow;
+      }
+      size_t n = 0;
+      for (size_t i = 0; i < count; i++) {
+        if (events[i].pin == handle->pin &&
+            (events[i].events & handle->events)) {
+          matched[n++] = events[i];
+        }
       }
-      /* debounce delay elapsed */
-      uint32_t elapsed_time = km_gettime() - handle->debounce_time;
-      if ((handle->watch_cb) &&
-          (((handle->mode == KM_IO_WATCH_MODE_LOW_LEVEL) && (reading == 0)) ||
-           ((handle->mode == KM_IO_WATCH_MODE_HIGH_LEVEL) && (reading == 1)))) {
-        handle->watch_cb(handle);
-      } else if (handle->debounce_time > 0 &&
-                 elapsed_time >= handle->debounce_delay) {
-        if (reading != handle->val) {
-          handle->val = reading;
-          switch (handle->mode) {
-            case KM_IO_WATCH_MODE_CHANGE:
-              if (handle->watch_cb) {
-                handle->watch_cb(handle);
-              }
-              break;
-            case KM_IO_WATCH_MODE_RISING:
-              if (handle->val == 1 && handle->watch_cb) {
-                handle->watch_cb(handle);
-              }
-              break;
-            case KM_IO_WATCH_MODE_FALLING:
-              if (handle->val == 0 && handle->watch_cb) {
-                handle->watch_cb(handle);
-              }
-              break;
-            default:
-              break;
-          }
+      handle->count += n;
+      if (handle->batch) {
+        if (n > 0 || overflow > 0) {
+          handle->irq_cb(handle, matched, n, overflow);
+        }
+      } else {
+        for (size_t i = 0; i < n; i++) {
+          if (!KM_IO_HAS_FLAG(handle->base.flags, KM_IO_FLAG_ACTIVE)) break;
+          handle->irq_cb(handle, &matched[i], 1, i == 0 ? overflow : 0);
         }
-        handle->debounce_time = 0;
       }
-      handle->last_val = reading;
     }
-    handle = (km_io_watch_handle_t *)((km_list_node_t *)handle)->next;
+    handle = next;
+  }
+  // edges for interrupt-driven watches
+  for (size_t i = 0; i < count; i++) {
+    km_io_watch_handle_t *watch =
+        (km_io_watch_handle_t *)loop.watch_handles.head;
+    while (watch != NULL) {
+      km_io_watch_handle_t *next =
+          (km_io_watch_handle_t *)((km_list_node_t *)watch)->next;
+      if (watch->irq && watch->pin == events[i].pin &&
+          KM_IO_HAS_FLAG(watch->base.flags, KM_IO_FLAG_ACTIVE)) {
+        km_io_watch_irq_event(watch, &events[i]);
+      }
+      watch = next;
+    }
+  }
+}
+
+static void km_io_irq_run() {
+  uint32_t tail = irq_queue_tail;
+  uint32_t head = LOAD_ACQUIRE(&irq_queue_head);
+  if (loop.irq_handles.head == NULL && loop.watch_handles.head == NULL) {
+    STORE_RELEASE(&irq_queue_tail, head);  // no one to deliver
+    return;
+  }
+  // drain only what is queued now, not to starve the loop at high rates
+  while (tail != head) {
+    uint32_t count = head - tail;
+    if (count > KM_IO_IRQ_DRAIN_MAX) {
+      count = KM_IO_IRQ_DRAIN_MAX;
+    }
+    // copy out and release the queue before calling back
+    for (uint32_t i = 0; i < count; i++) {
+      irq_drain[i] = irq_queue[(tail + i) & (KM_IO_IRQ_QUEUE_SIZE - 1)];
+    }
+    tail += count;
+    STORE_RELEASE(&irq_queue_tail, tail);
+    km_io_irq_dispatch(irq_drain, count, irq_matched);
   }
 }
 
@@ -464,6 +1046,18 @@ void km_io_stream_cleanup() {
   km_list_init(&loop.stream_handles);
 }
 
+/**
+ * Push data read from the underlying device (e.g. when its fd is readable).
+ * This should be called in the event loop, not in an interrupt handler.
+ */
+void km_io_stream_push(km_io_stream_handle_t *stream, uint8_t *buffer,
+                       size_t size) {
+  if (KM_IO_HAS_FLAG(stream->base.flags, KM_IO_FLAG_ACTIVE) &&
+      stream->read_cb != NULL && size > 0) {
+    stream->read_cb(stream, buffer, size);
+  }
+}
+
 /*
 static void km_io_stream_run() {
   km_io_stream_handle_t *handle =
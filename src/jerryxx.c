@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "jerryscript.h"
+#include "kaluma_magic_strings.h"
 #include "magic_strings.h"
 #include "repl.h"
 #include "tty.h"
@@ -123,6 +124,81 @@ bool jerryxx_get_property_boolean(jerry_value_t object, const char *name,
   return value;
 }
 
+/**
+ * Interned keys, indexed the same as magic_string_items. The strings are
+ * registered as external magic strings, so the values don't take heap.
+ */
+static jerry_value_t *jerryxx_keys = NULL;
+
+void jerryxx_init_keys() {
+  jerryxx_keys = malloc(num_magic_string_items * sizeof(jerry_value_t));
+  if (jerryxx_keys == NULL) return;
+  for (uint32_t i = 0; i < num_magic_string_items; i++) {
+    jerryxx_keys[i] =
+        jerry_create_string_sz(magic_string_items[i], magic_string_lengths[i]);
+  }
+}
+
+void jerryxx_cleanup_keys() {
+  if (jerryxx_keys != NULL) {
+    for (uint32_t i = 0; i < num_magic_string_items; i++) {
+      jerry_release_value(jerryxx_keys[i]);
+    }
+    free(jerryxx_keys);
+    jerryxx_keys = NULL;
+  }
+}
+
+/**
+ * Get an interned key. The value is owned by the table, so it must not be
+ * released (acquire it to keep).
+ */
+jerry_value_t jerryxx_key(uint32_t key) { return jerryxx_keys[key]; }
+
+void jerryxx_set_property_by_key(jerry_value_t object, uint32_t key,
+                                 jerry_value_t value) {
+  jerry_value_t ret = jerry_set_property(object, jerryxx_keys[key], value);
+  jerry_release_value(ret);
+}
+
+void jerryxx_set_property_number_by_key(jerry_value_t object, uint32_t key,
+                                        double value) {
+  jerry_value_t val = jerry_create_number(value);
+  jerry_value_t ret = jerry_set_property(object, jerryxx_keys[key], val);
+  jerry_release_value(ret);
+  jerry_release_value(val);
+}
+
+jerry_value_t jerryxx_get_property_by_key(jerry_value_t object, uint32_t key) {
+  return jerry_get_property(object, jerryxx_keys[key]);
+}
+
+double jerryxx_get_property_number_by_key(jerry_value_t object, uint32_t key,
+                                          double default_value) {
+  jerry_value_t ret = jerry_get_property(object, jerryxx_keys[key]);
+  double value = default_value;
+  if (jerry_value_is_number(ret)) {
+    value = jerry_get_number_value(ret);
+  }
+  jerry_release_value(ret);
+  return value;
+}
+
+bool jerryxx_get_property_boolean_by_key(jerry_value_t object, uint32_t key,
+                                         bool default_value) {
+  jerry_value_t ret = jerry_get_property(object, jerryxx_keys[key]);
+  bool value = default_value;
+  if (jerry_value_is_boolean(ret)) {
+    value = jerry_get_boolean_value(ret);
+  }
+  jerry_release_value(ret);
+  return value;
+}
+
+bool jerryxx_delete_property_by_key(jerry_value_t object, uint32_t key) {
+  return jerry_delete_property(object, jerryxx_keys[key]);
+}
+
 uint8_t *jerryxx_get_typedarray_buffer(jerry_value_t object) {
   jerry_length_t length = 0;
   jerry_length_t offset = 0;
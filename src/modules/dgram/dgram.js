@@ -0,0 +1,167 @@
+var EventEmitter = require('events').EventEmitter;
+
+/**
+ * Datagram (UDP) socket class
+ */
+class Socket extends EventEmitter {
+  constructor(type) {
+    super();
+    if (!global.__netdev) {
+      throw new Error('Network device not found');
+    }
+    if (type !== 'udp4') {
+      throw new TypeError('Unsupported socket type: ' + type);
+    }
+    this._dev = global.__netdev;
+    this._fd = -1;
+    this._bound = false;
+  }
+
+  _open() {
+    if (this._fd < 0) {
+      this._fd = this._dev.socket('AF_INET', 'DGRAM');
+      if (this._fd < 0) {
+        this.emit('error', new SystemError(this._dev.errno));
+        return false;
+      }
+      var sck = this._dev.get(this._fd);
+      sck.message_cb = (batch) => { this._onmessage(batch) }
+      sck.close_cb = () => { this._onclose() }
+    }
+    return true;
+  }
+
+  /**
+   * Emit 'message' for each datagram in a batch received at once
+   * @param {Uint8Array} batch
+   */
+  _onmessage(batch) {
+    var off = 0;
+    while (off + 8 <= batch.length) {
+      var size = batch[off] | (batch[off + 1] << 8);
+      var rinfo = {
+        address: batch[off + 4] + '.' + batch[off + 5] + '.' + batch[off + 6] +
+          '.' + batch[off + 7],
+        family: 'IPv4',
+        port: batch[off + 2] | (batch[off + 3] << 8),
+        size: size
+      };
+      this.emit('message', batch.subarray(off + 8, off + 8 + size), rinfo);
+      off += 8 + size;
+    }
+  }
+
+  _onclose() {
+    this._fd = -1;
+    this._bound = false;
+    this.emit('close');
+  }
+
+  /**
+   * Bind the socket to receive datagrams
+   * @param {number} port (0 or omitted for any port)
+   * @param {string} address
+   * @param {function} cb
+   * @return {this}
+   */
+  bind(port, address, cb) {
+    if (typeof port === 'function') {
+      cb = port;
+      port = 0;
+    } else if (typeof address === 'function') {
+      cb = address;
+      address = undefined;
+    }
+    if (this._bound) {
+      this.emit('error', new SystemError(22)); // EINVAL
+      return this;
+    }
+    if (this._open()) {
+      this._bound = true;
+      this._dev.bind(this._fd, address || this._dev.ip, port || 0, (err) => {
+        if (err) {
+          this._bound = false;
+          this.emit('error', new SystemError(this._dev.errno));
+        } else {
+          if (cb) this.once('listening', cb);
+          this.emit('listening');
+        }
+      });
+    }
+    return this;
+  }
+
+  /**
+   * Send a datagram
+   * @param {Uint8Array|ArrayBuffer|string} msg
+   * @param {number} port
+   * @param {string} address (default: '127.0.0.1')
+   * @param {function} cb
+   */
+  send(msg, port, address, cb) {
+    if (typeof address === 'function') {
+      cb = address;
+      address = undefined;
+    }
+    if (!this._bound) {
+      this.bind(0); // bind to any port to receive replies
+    }
+    if (this._fd < 0) {
+      if (cb) cb(new SystemError(9)); // EBADF
+      return;
+    }
+    this._dev.sendto(this._fd, msg, address || '127.0.0.1', port, (err) => {
+      if (err) {
+        var e = new SystemError(this._dev.errno);
+        if (cb) {
+          cb(e);
+        } else {
+          this.emit('error', e);
+        }
+      } else {
+        if (cb) cb(null);
+      }
+    });
+  }
+
+  /**
+   * Get the bound address
+   * @return {object} {address, family, port}
+   */
+  address() {
+    var sck = this._fd > -1 ? this._dev.get(this._fd) : null;
+    if (!sck) {
+      throw new SystemError(9); // EBADF
+    }
+    return { address: sck.laddr, family: 'IPv4', port: sck.lport };
+  }
+
+  /**
+   * Close the socket
+   * @param {function} cb
+   * @return {this}
+   */
+  close(cb) {
+    if (cb) this.once('close', cb);
+    if (this._fd > -1) {
+      this._dev.close(this._fd);
+    }
+    return this;
+  }
+}
+
+exports.Socket = Socket;
+
+/**
+ * Create a datagram socket
+ * @param {string} type 'udp4'
+ * @param {function} cb listener of 'message' events
+ * @return {Socket}
+ */
+exports.createSocket = function (type, cb) {
+  var socket = new Socket(type);
+  if (cb) {
+    socket.on('message', cb);
+  }
+  return socket;
+}
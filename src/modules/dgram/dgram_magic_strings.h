@@ -0,0 +1,35 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DGRAM_MAGIC_STRINGS_H
+#define __DGRAM_MAGIC_STRINGS_H
+
+#define MSTR_DGRAM_DGRAM "dgram"
+#define MSTR_DGRAM_CREATE_SOCKET "createSocket"
+#define MSTR_DGRAM_SOCKET "Socket"
+#define MSTR_DGRAM_SEND "send"
+#define MSTR_DGRAM_MESSAGE "message"
+#define MSTR_DGRAM_RINFO_ADDRESS "address"
+#define MSTR_DGRAM_RINFO_FAMILY "family"
+#define MSTR_DGRAM_RINFO_PORT "port"
+#define MSTR_DGRAM_RINFO_SIZE "size"
+
+#endif /* __DGRAM_MAGIC_STRINGS_H */
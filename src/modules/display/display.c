@@ -0,0 +1,517 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "display.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+#include "gc.h"
+#include "gpio.h"
+#include "i2c.h"
+#include "spi.h"
+#include "system.h"
+
+#define DISPLAY_TIMEOUT 5000
+#define DISPLAY_CHUNK_SIZE 512  // bytes per transfer when streaming a fill
+#define DISPLAY_I2C_CHUNK_SIZE 64
+#define DISPLAY_DELAY 0x80  // argument count flag: a delay (ms) follows
+
+/**
+ * Display driver. Init sequences are encoded as: number of commands, then
+ * for each command: command, argument count (| DISPLAY_DELAY), arguments
+ * and an optional delay in milliseconds.
+ */
+struct display_driver_s {
+  uint8_t bpp;
+  int16_t width;
+  int16_t height;
+  int16_t col_offset;
+  uint8_t madctl;  // memory access control (TFT controllers)
+  bool bgr;
+  bool invert;
+  const uint8_t *init_seq;
+  const gc_panel_ops_t *ops;
+};
+
+/* ************************************************************************** */
+/*                                 TRANSPORT                                  */
+/* ************************************************************************** */
+
+static uint8_t display_chunk[DISPLAY_CHUNK_SIZE];
+
+/**
+ * Send bytes over the bus. Over I2C, each chunk is prefixed by the control
+ * byte (0x00 for commands, 0x40 for data).
+ */
+static int display_send(display_t *display, bool data, const uint8_t *buf,
+                        size_t len) {
+  display_config_t *config = &display->config;
+  if (config->transport == DISPLAY_SPI) {
+    int ret = km_spi_send(config->bus, (uint8_t *)buf, len, DISPLAY_TIMEOUT);
+    return ret < 0 ? ret : 0;
+  }
+  uint8_t chunk[1 + DISPLAY_I2C_CHUNK_SIZE];
+  chunk[0] = data ? 0x40 : 0x00;
+  while (len > 0) {
+    size_t n = len < DISPLAY_I2C_CHUNK_SIZE ? len : DISPLAY_I2C_CHUNK_SIZE;
+    memcpy(chunk + 1, buf, n);
+    int ret = km_i2c_write_master(config->bus, config->address, chunk, n + 1,
+                                  DISPLAY_TIMEOUT);
+    if (ret < 0) return ret;
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+static void display_select(display_t *display, bool data) {
+  if (display->config.transport == DISPLAY_SPI) {
+    if (display->config.dc >= 0) {
+      km_gpio_write(display->config.dc, data ? KM_GPIO_HIGH : KM_GPIO_LOW);
+    }
+    if (display->config.cs >= 0) {
+      km_gpio_write(display->config.cs, KM_GPIO_LOW);
+    }
+  }
+}
+
+static void display_deselect(display_t *display) {
+  if (display->config.transport == DISPLAY_SPI && display->config.cs >= 0) {
+    km_gpio_write(display->config.cs, KM_GPIO_HIGH);
+  }
+}
+
+/**
+ * Send a command with its arguments. TFT controllers take arguments as
+ * data; monochrome OLED controllers take them as command bytes.
+ */
+static int display_command(display_t *display, uint8_t cmd,
+                           const uint8_t *args, uint8_t argc) {
+  bool args_as_data = display->driver->bpp == 16;
+  int ret;
+  if (display->config.transport == DISPLAY_I2C) {
+    uint8_t buf[1 + 16];
+    buf[0] = cmd;
+    if (argc > 0) {
+      memcpy(buf + 1, args, argc);
+    }
+    return display_send(display, false, buf, 1 + argc);
+  }
+  display_select(display, false);
+  ret = display_send(display, false, &cmd, 1);
+  if (ret == 0 && argc > 0) {
+    if (args_as_data) {
+      display_select(display, true);
+    }
+    ret = display_send(display, args_as_data, args, argc);
+  }
+  display_deselect(display);
+  return ret;
+}
+
+/**
+ * Start a data transfer, preceded by `cmd` (if >= 0) in the same SPI
+ * transaction, so the controller's memory write is not interrupted.
+ */
+static int display_write_begin(display_t *display, int16_t cmd) {
+  int ret = 0;
+  if (cmd >= 0) {
+    uint8_t c = cmd;
+    display_select(display, false);
+    ret = display_send(display, false, &c, 1);
+  }
+  display_select(display, true);
+  return ret;
+}
+
+static int display_write(display_t *display, const uint8_t *buf, size_t len) {
+  return display_send(display, true, buf, len);
+}
+
+static void display_write_end(display_t *display) { display_deselect(display); }
+
+static int display_run_sequence(display_t *display, const uint8_t *seq) {
+  uint8_t count = *seq++;
+  while (count--) {
+    uint8_t cmd = *seq++;
+    uint8_t argc = *seq++;
+    bool delay = argc & DISPLAY_DELAY;
+    argc &= ~DISPLAY_DELAY;
+    int ret = display_command(display, cmd, seq, argc);
+    if (ret < 0) return ret;
+    seq += argc;
+    if (delay) {
+      km_delay(*seq++);
+    }
+  }
+  return 0;
+}
+
+/* ************************************************************************** */
+/*                      MONOCHROME OLED (SSD1306, SH1106)                     */
+/* ************************************************************************** */
+
+static const uint8_t ssd1306_init_seq[] = {
+    13,
+    0xAE, 0,        // display off
+    0xD5, 1, 0x80,  // clock divide ratio
+    0xD3, 1, 0x00,  // display offset
+    0x40, 0,        // start line 0
+    0x8D, 1, 0x14,  // charge pump on
+    0x20, 1, 0x00,  // horizontal addressing mode
+    0xA1, 0,        // segment remap
+    0xC8, 0,        // COM scan direction: remapped
+    0x81, 1, 0xCF,  // contrast
+    0xD9, 1, 0xF1,  // pre-charge period
+    0xDB, 1, 0x40,  // VCOMH deselect level
+    0xA4, 0,        // display follows RAM
+    0x2E, 0,        // deactivate scroll
+};
+
+static const uint8_t sh1106_init_seq[] = {
+    11,
+    0xAE, 0,        // display off
+    0xD5, 1, 0x80,  // clock divide ratio
+    0xD3, 1, 0x00,  // display offset
+    0x40, 0,        // start line 0
+    0xAD, 1, 0x8B,  // DC-DC converter on
+    0xA1, 0,        // segment remap
+    0xC8, 0,        // COM scan direction: remapped
+    0x81, 1, 0x80,  // contrast
+    0xD9, 1, 0x22,  // pre-charge period
+    0xDB, 1, 0x35,  // VCOMH deselect level
+    0xA4, 0,        // display follows RAM
+};
+
+static int oled_init(display_t *display) {
+  int16_t height = display->config.height;
+  uint8_t multiplex = height - 1;
+  uint8_t com_pins = (height == 32 || height == 16) ? 0x02 : 0x12;
+  int ret = display_run_sequence(display, display->driver->init_seq);
+  if (ret == 0) ret = display_command(display, 0xA8, &multiplex, 1);
+  if (ret == 0) ret = display_command(display, 0xDA, &com_pins, 1);
+  if (ret == 0) {
+    ret = display_command(display, display->config.invert ? 0xA7 : 0xA6, NULL,
+                          0);
+  }
+  if (ret == 0) ret = display_command(display, 0xAF, NULL, 0);  // on
+  return ret;
+}
+
+/**
+ * Flush pages of a 1-bit buffer with SSD1306 horizontal addressing: the
+ * column/page window wraps rows, so the whole region is one data transfer
+ * when it spans the full width.
+ */
+static int ssd1306_flush(gc_panel_t *panel, const uint8_t *buffer,
+                         int16_t buffer_y, const gc_rect_t *rect) {
+  display_t *display = (display_t *)panel;
+  int16_t col = rect->x + display->config.col_offset;
+  int16_t page0 = rect->y / 8;
+  int16_t page1 = (rect->y + rect->h - 1) / 8;
+  uint8_t cols[2] = {col, col + rect->w - 1};
+  uint8_t pages[2] = {page0, page1};
+  int ret = display_command(display, 0x21, cols, 2);
+  if (ret == 0) ret = display_command(display, 0x22, pages, 2);
+  if (ret < 0) return ret;
+  display_write_begin(display, -1);
+  const uint8_t *src =
+      buffer + (page0 - buffer_y / 8) * panel->width + rect->x;
+  if (rect->w == panel->width) {
+    ret = display_write(display, src, (page1 - page0 + 1) * panel->width);
+  } else {
+    for (int16_t page = page0; page <= page1 && ret == 0; page++) {
+      ret = display_write(display, src, rect->w);
+      src += panel->width;
+    }
+  }
+  display_write_end(display);
+  return ret;
+}
+
+/**
+ * Flush pages of a 1-bit buffer to SH1106, which only has page addressing.
+ */
+static int sh1106_flush(gc_panel_t *panel, const uint8_t *buffer,
+                        int16_t buffer_y, const gc_rect_t *rect) {
+  display_t *display = (display_t *)panel;
+  int16_t col = rect->x + display->config.col_offset;
+  int ret = 0;
+  for (int16_t page = rect->y / 8; page <= (rect->y + rect->h - 1) / 8;
+       page++) {
+    ret = display_command(display, 0xB0 | page, NULL, 0);
+    if (ret == 0) ret = display_command(display, 0x00 | (col & 0x0F), NULL, 0);
+    if (ret == 0) ret = display_command(display, 0x10 | (col >> 4), NULL, 0);
+    if (ret < 0) return ret;
+    display_write_begin(display, -1);
+    ret = display_write(
+        display, buffer + (page - buffer_y / 8) * panel->width + rect->x,
+        rect->w);
+    display_write_end(display);
+    if (ret < 0) return ret;
+  }
+  return 0;
+}
+
+static void display_free(gc_panel_t *panel) { free(panel); }
+
+static const gc_panel_ops_t ssd1306_ops = {
+    .flush = ssd1306_flush, .fill = NULL, .write = NULL, .free = display_free};
+
+static const gc_panel_ops_t sh1106_ops = {
+    .flush = sh1106_flush, .fill = NULL, .write = NULL, .free = display_free};
+
+/* ************************************************************************** */
+/*                    TFT (ST7735, ST7789, ILI9341), RGB565                   */
+/* ************************************************************************** */
+
+static const uint8_t st7735_init_seq[] = {
+    16,
+    0x01, DISPLAY_DELAY, 150,                          // software reset
+    0x11, DISPLAY_DELAY, 200,                          // sleep out
+    0xB1, 3, 0x01, 0x2C, 0x2D,                         // frame rate control
+    0xB2, 3, 0x01, 0x2C, 0x2D,
+    0xB3, 6, 0x01, 0x2C, 0x2D, 0x01, 0x2C, 0x2D,
+    0xB4, 1, 0x07,                                     // inversion control
+    0xC0, 3, 0xA2, 0x02, 0x84,                         // power control
+    0xC1, 1, 0xC5,
+    0xC2, 2, 0x0A, 0x00,
+    0xC3, 2, 0x8A, 0x2A,
+    0xC4, 2, 0x8A, 0xEE,
+    0xC5, 1, 0x0E,                                     // VCOM control
+    0x3A, 1, 0x05,                                     // 16-bit color
+    0xE0, 16, 0x02, 0x1C, 0x07, 0x12, 0x37, 0x32, 0x29, 0x2D,  // gamma
+              0x29, 0x25, 0x2B, 0x39, 0x00, 0x01, 0x03, 0x10,
+    0xE1, 16, 0x03, 0x1D, 0x07, 0x06, 0x2E, 0x2C, 0x29, 0x2D,
+              0x2E, 0x2E, 0x37, 0x3F, 0x00, 0x00, 0x02, 0x10,
+    0x13, DISPLAY_DELAY, 10,                           // normal display on
+};
+
+static const uint8_t st7789_init_seq[] = {
+    4,
+    0x01, DISPLAY_DELAY, 150,           // software reset
+    0x11, DISPLAY_DELAY, 120,           // sleep out
+    0x3A, 1 | DISPLAY_DELAY, 0x55, 10,  // 16-bit color
+    0x13, DISPLAY_DELAY, 10,            // normal display on
+};
+
+static const uint8_t ili9341_init_seq[] = {
+    21,
+    0x01, DISPLAY_DELAY, 150,                     // software reset
+    0xEF, 3, 0x03, 0x80, 0x02,
+    0xCF, 3, 0x00, 0xC1, 0x30,                    // power control B
+    0xED, 4, 0x64, 0x03, 0x12, 0x81,              // power on sequence
+    0xE8, 3, 0x85, 0x00, 0x78,                    // driver timing control A
+    0xCB, 5, 0x39, 0x2C, 0x00, 0x34, 0x02,        // power control A
+    0xF7, 1, 0x20,                                // pump ratio
+    0xEA, 2, 0x00, 0x00,                          // driver timing control B
+    0xC0, 1, 0x23,                                // power control 1
+    0xC1, 1, 0x10,                                // power control 2
+    0xC5, 2, 0x3E, 0x28,                          // VCOM control 1
+    0xC7, 1, 0x86,                                // VCOM control 2
+    0x37, 1, 0x00,                                // vertical scroll start
+    0x3A, 1, 0x55,                                // 16-bit color
+    0xB1, 2, 0x00, 0x18,                          // frame rate control
+    0xB6, 3, 0x08, 0x82, 0x27,                    // display function control
+    0xF2, 1, 0x00,                                // 3-gamma off
+    0x26, 1, 0x01,                                // gamma curve
+    0xE0, 15, 0x0F, 0x31, 0x2B, 0x0C, 0x0E, 0x08, 0x4E, 0xF1,  // gamma
+              0x37, 0x07, 0x10, 0x03, 0x0E, 0x09, 0x00,
+    0xE1, 15, 0x00, 0x0E, 0x14, 0x03, 0x11, 0x07, 0x31, 0xC1,
+              0x48, 0x08, 0x0F, 0x0C, 0x31, 0x36, 0x0F,
+    0x11, DISPLAY_DELAY, 120,                     // sleep out
+};
+
+static int tft_init(display_t *display) {
+  uint8_t madctl = display->driver->madctl | (display->config.bgr ? 0x08 : 0);
+  int ret = display_run_sequence(display, display->driver->init_seq);
+  if (ret == 0) ret = display_command(display, 0x36, &madctl, 1);
+  if (ret == 0) {
+    ret = display_command(display, display->config.invert ? 0x21 : 0x20, NULL,
+                          0);
+  }
+  if (ret == 0) ret = display_command(display, 0x29, NULL, 0);  // on
+  if (ret == 0) km_delay(20);
+  return ret;
+}
+
+/**
+ * Set the address window and start a memory write. The column and row
+ * ranges are only sent when they changed since the last window.
+ */
+static int tft_begin_window(display_t *display, const gc_rect_t *rect) {
+  int ret = 0;
+  if (rect->x != display->window.x || rect->w != display->window.w) {
+    uint16_t x0 = rect->x + display->config.col_offset;
+    uint16_t x1 = x0 + rect->w - 1;
+    uint8_t caset[4] = {x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF};
+    ret = display_command(display, 0x2A, caset, 4);
+  }
+  if (ret == 0 &&
+      (rect->y != display->window.y || rect->h != display->window.h)) {
+    uint16_t y0 = rect->y + display->config.row_offset;
+    uint16_t y1 = y0 + rect->h - 1;
+    uint8_t raset[4] = {y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF};
+    ret = display_command(display, 0x2B, raset, 4);
+  }
+  if (ret < 0) {
+    display->window.w = 0;  // unknown: resend next time
+    return ret;
+  }
+  display->window = *rect;
+  return display_write_begin(display, 0x2C);  // memory write
+}
+
+static int tft_write(gc_panel_t *panel, const gc_rect_t *rect,
+                     const uint8_t *pixels, uint32_t stride) {
+  display_t *display = (display_t *)panel;
+  int ret = tft_begin_window(display, rect);
+  if (ret == 0) {
+    if (stride == (uint32_t)rect->w * 2) {  // contiguous: one transfer
+      ret = display_write(display, pixels, stride * rect->h);
+    } else {
+      for (int16_t i = 0; i < rect->h && ret == 0; i++) {
+        ret = display_write(display, pixels + i * stride, rect->w * 2);
+      }
+    }
+  }
+  display_write_end(display);
+  return ret;
+}
+
+static int tft_flush(gc_panel_t *panel, const uint8_t *buffer,
+                     int16_t buffer_y, const gc_rect_t *rect) {
+  uint32_t stride = panel->width * 2;
+  uint32_t row = rect->y - buffer_y;
+  return tft_write(panel, rect, buffer + (row * panel->width + rect->x) * 2,
+                   stride);
+}
+
+static int tft_fill(gc_panel_t *panel, const gc_rect_t *rect,
+                    uint16_t color) {
+  display_t *display = (display_t *)panel;
+  uint32_t remain = (uint32_t)rect->w * rect->h * 2;
+  uint32_t chunk = remain < DISPLAY_CHUNK_SIZE ? remain : DISPLAY_CHUNK_SIZE;
+  for (uint32_t i = 0; i < chunk; i += 2) {
+    display_chunk[i] = color >> 8;
+    display_chunk[i + 1] = color & 0xFF;
+  }
+  int ret = tft_begin_window(display, rect);
+  while (ret == 0 && remain > 0) {
+    uint32_t n = remain < chunk ? remain : chunk;
+    ret = display_write(display, display_chunk, n);
+    remain -= n;
+  }
+  display_write_end(display);
+  return ret;
+}
+
+static const gc_panel_ops_t tft_ops = {
+    .flush = tft_flush, .fill = tft_fill, .write = tft_write,
+    .free = display_free};
+
+/* ************************************************************************** */
+/*                                  DISPLAY                                   */
+/* ************************************************************************** */
+
+static const display_driver_t display_drivers[DISPLAY_TYPE_COUNT] = {
+    [DISPLAY_SSD1306] = {.bpp = 1, .width = 128, .height = 64,
+                         .init_seq = ssd1306_init_seq, .ops = &ssd1306_ops},
+    [DISPLAY_SH1106] = {.bpp = 1, .width = 128, .height = 64,
+                        .col_offset = 2, .init_seq = sh1106_init_seq,
+                        .ops = &sh1106_ops},
+    [DISPLAY_ST7735] = {.bpp = 16, .width = 128, .height = 160, .madctl = 0xC0,
+                        .bgr = true, .init_seq = st7735_init_seq,
+                        .ops = &tft_ops},
+    [DISPLAY_ST7789] = {.bpp = 16, .width = 240, .height = 240, .madctl = 0x00,
+                        .invert = true, .init_seq = st7789_init_seq,
+                        .ops = &tft_ops},
+    [DISPLAY_ILI9341] = {.bpp = 16, .width = 240, .height = 320,
+                         .madctl = 0x40, .bgr = true,
+                         .init_seq = ili9341_init_seq, .ops = &tft_ops},
+};
+
+/**
+ * Fill the configuration with the defaults of the controller
+ */
+void display_default_config(display_type_t type, display_config_t *config) {
+  const display_driver_t *driver = &display_drivers[type];
+  config->transport = DISPLAY_SPI;
+  config->bus = 0;
+  config->address = 0x3C;
+  config->cs = -1;
+  config->dc = -1;
+  config->rst = -1;
+  config->width = driver->width;
+  config->height = driver->height;
+  config->col_offset = driver->col_offset;
+  config->row_offset = 0;
+  config->bgr = driver->bgr;
+  config->invert = driver->invert;
+}
+
+/**
+ * Allocate a display. Returns NULL if out of memory.
+ */
+display_t *display_create(display_type_t type, const display_config_t *config) {
+  display_t *display = (display_t *)malloc(sizeof(display_t));
+  if (display == NULL) return NULL;
+  display->driver = &display_drivers[type];
+  display->config = *config;
+  display->panel.ops = display->driver->ops;
+  display->panel.width = config->width;
+  display->panel.height = config->height;
+  display->panel.bpp = display->driver->bpp;
+  display->window.x = display->window.y = -1;
+  display->window.w = display->window.h = 0;
+  return display;
+}
+
+/**
+ * Set up the pins, reset and initialize the controller
+ */
+int display_init(display_t *display) {
+  display_config_t *config = &display->config;
+  if (config->transport == DISPLAY_SPI) {
+    if (config->cs >= 0) {
+      km_gpio_set_io_mode(config->cs, KM_GPIO_IO_MODE_OUTPUT);
+      km_gpio_write(config->cs, KM_GPIO_HIGH);
+    }
+    if (config->dc >= 0) {
+      km_gpio_set_io_mode(config->dc, KM_GPIO_IO_MODE_OUTPUT);
+    }
+  }
+  if (config->rst >= 0) {
+    km_gpio_set_io_mode(config->rst, KM_GPIO_IO_MODE_OUTPUT);
+    km_gpio_write(config->rst, KM_GPIO_HIGH);
+    km_delay(1);
+    km_gpio_write(config->rst, KM_GPIO_LOW);
+    km_delay(10);
+    km_gpio_write(config->rst, KM_GPIO_HIGH);
+    km_delay(120);
+  }
+  if (display->driver->bpp == 16) {
+    return tft_init(display);
+  }
+  return oled_init(display);
+}
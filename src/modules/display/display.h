@@ -0,0 +1,73 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DISPLAY_H
+#define __DISPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gc.h"
+
+typedef enum {
+  DISPLAY_SSD1306,
+  DISPLAY_SH1106,
+  DISPLAY_ST7735,
+  DISPLAY_ST7789,
+  DISPLAY_ILI9341,
+  DISPLAY_TYPE_COUNT
+} display_type_t;
+
+typedef enum { DISPLAY_SPI, DISPLAY_I2C } display_transport_t;
+
+typedef struct {
+  display_transport_t transport;
+  uint8_t bus;
+  uint8_t address;  // I2C address
+  int8_t cs;        // SPI chip select pin (-1 if not used)
+  int8_t dc;        // SPI data/command pin (-1 if not used)
+  int8_t rst;       // reset pin (-1 if not used)
+  int16_t width;
+  int16_t height;
+  int16_t col_offset;  // offset of the panel in the controller's RAM
+  int16_t row_offset;
+  bool bgr;
+  bool invert;
+} display_config_t;
+
+typedef struct display_driver_s display_driver_t;
+
+/**
+ * Native display. The embedded gc_panel_t lets graphic contexts flush their
+ * buffer to it or draw on it directly.
+ */
+typedef struct {
+  gc_panel_t panel;
+  const display_driver_t *driver;
+  display_config_t config;
+  gc_rect_t window;  // last address window set (TFT controllers)
+} display_t;
+
+void display_default_config(display_type_t type, display_config_t *config);
+display_t *display_create(display_type_t type, const display_config_t *config);
+int display_init(display_t *display);
+
+#endif /* __DISPLAY_H */
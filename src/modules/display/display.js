@@ -0,0 +1,73 @@
+const display_native = process.binding(process.binding.display);
+const {I2C} = require('i2c');
+const {GraphicsContext, BufferedGraphicsContext} = require('graphics');
+
+/**
+ * Native display driver. The controller is initialized and driven in
+ * native code, so graphics contexts created by getContext() transfer
+ * pixels to the panel without calling back into JS.
+ * @param {number} type
+ */
+function Display(type) {
+  this.type = type;
+  this.panel = null;
+  this.width = 0;
+  this.height = 0;
+  this.rotation = 0;
+  this.bandHeight = 0;
+}
+
+/**
+ * Setup the display
+ * @param {SPI|I2C} bus
+ * @param {object} options
+ *   width, height {number}
+ *   address {number} I2C address (default: 0x3C)
+ *   cs, dc, rst {number} pins
+ *   colOffset, rowOffset {number}
+ *   bgr, invert {boolean}
+ *   rotation {number}
+ *   bandHeight {number} render buffered contexts in bands of this many rows
+ */
+Display.prototype.setup = function (bus, options) {
+  options = options || {};
+  const transport =
+    bus instanceof I2C ? display_native.I2C : display_native.SPI;
+  this.panel = new display_native.Panel(this.type, transport, bus, options);
+  this.width = this.panel.width;
+  this.height = this.panel.height;
+  this.rotation = options.rotation || 0;
+  this.bandHeight = options.bandHeight || 0;
+};
+
+/**
+ * Return a graphics context of the display
+ * @param {string} type 'buffer' (default) or 'direct'. A buffered
+ *   context sends dirty regions on display(), a direct context draws
+ *   every primitive to the panel immediately.
+ * @return {GraphicsContext|BufferedGraphicsContext}
+ */
+Display.prototype.getContext = function (type) {
+  const options = {rotation: this.rotation, panel: this.panel};
+  if (type === 'direct') {
+    return new GraphicsContext(this.width, this.height, options);
+  }
+  options.bandHeight = this.bandHeight;
+  return new BufferedGraphicsContext(this.width, this.height, options);
+};
+
+function defineDriver(type) {
+  function Driver() {
+    Display.call(this, type);
+  }
+  Driver.prototype = Object.create(Display.prototype);
+  Driver.prototype.constructor = Driver;
+  return Driver;
+}
+
+exports.Display = Display;
+exports.SSD1306 = defineDriver(display_native.SSD1306);
+exports.SH1106 = defineDriver(display_native.SH1106);
+exports.ST7735 = defineDriver(display_native.ST7735);
+exports.ST7789 = defineDriver(display_native.ST7789);
+exports.ILI9341 = defineDriver(display_native.ILI9341);
@@ -0,0 +1,46 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __DISPLAY_MAGIC_STRINGS_H
+#define __DISPLAY_MAGIC_STRINGS_H
+
+#define MSTR_DISPLAY_PANEL "Panel"
+#define MSTR_DISPLAY_SSD1306 "SSD1306"
+#define MSTR_DISPLAY_SH1106 "SH1106"
+#define MSTR_DISPLAY_ST7735 "ST7735"
+#define MSTR_DISPLAY_ST7789 "ST7789"
+#define MSTR_DISPLAY_ILI9341 "ILI9341"
+#define MSTR_DISPLAY_SPI "SPI"
+#define MSTR_DISPLAY_I2C "I2C"
+#define MSTR_DISPLAY_BUS "bus"
+#define MSTR_DISPLAY_WIDTH "width"
+#define MSTR_DISPLAY_HEIGHT "height"
+#define MSTR_DISPLAY_BPP "bpp"
+#define MSTR_DISPLAY_ADDRESS "address"
+#define MSTR_DISPLAY_CS "cs"
+#define MSTR_DISPLAY_DC "dc"
+#define MSTR_DISPLAY_RST "rst"
+#define MSTR_DISPLAY_COL_OFFSET "colOffset"
+#define MSTR_DISPLAY_ROW_OFFSET "rowOffset"
+#define MSTR_DISPLAY_BGR "bgr"
+#define MSTR_DISPLAY_INVERT "invert"
+
+#endif /* __DISPLAY_MAGIC_STRINGS_H */
@@ -0,0 +1,4 @@
+list(APPEND SOURCES
+  ${SRC_DIR}/modules/display/display.c
+  ${SRC_DIR}/modules/display/module_display.c)
+include_directories(${SRC_DIR}/modules/display)
@@ -0,0 +1,141 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "module_display.h"
+
+#include <stdlib.h>
+
+#include "display.h"
+#include "display_magic_strings.h"
+#include "err.h"
+#include "gc.h"
+#include "jerryscript.h"
+#include "jerryxx.h"
+#include "magic_strings.h"
+
+/**
+ * Panel() constructor
+ * args:
+ *   type {number} controller (SSD1306, SH1106, ST7735, ST7789, ILI9341)
+ *   transport {number} SPI or I2C
+ *   bus {SPI|I2C} an open bus object
+ *   options {object}
+ *     width, height {number}
+ *     address {number} I2C address
+ *     cs, dc, rst {number} pins (-1 if not connected)
+ *     colOffset, rowOffset {number} offset of the panel in the controller RAM
+ *     bgr, invert {boolean}
+ */
+JERRYXX_FUN(panel_ctor_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "type")
+  JERRYXX_CHECK_ARG_NUMBER(1, "transport")
+  JERRYXX_CHECK_ARG_OBJECT(2, "bus")
+  JERRYXX_CHECK_ARG_OBJECT_OPT(3, "options")
+  int type = (int)JERRYXX_GET_ARG_NUMBER(0);
+  int transport = (int)JERRYXX_GET_ARG_NUMBER(1);
+  if (type < 0 || type >= DISPLAY_TYPE_COUNT) {
+    return jerry_create_error(JERRY_ERROR_RANGE,
+                              (const jerry_char_t *)"Unknown display type.");
+  }
+  if (transport != DISPLAY_SPI && transport != DISPLAY_I2C) {
+    return jerry_create_error(JERRY_ERROR_RANGE,
+                              (const jerry_char_t *)"Unknown transport.");
+  }
+  int bus = (int)jerryxx_get_property_number(JERRYXX_GET_ARG(2),
+                                             MSTR_DISPLAY_BUS, -1);
+  if (bus < 0) {
+    return jerry_create_error(JERRY_ERROR_TYPE,
+                              (const jerry_char_t *)"Bus is not opened.");
+  }
+
+  // read options
+  display_config_t config;
+  display_default_config(type, &config);
+  config.transport = transport;
+  config.bus = bus;
+  if (JERRYXX_HAS_ARG(3)) {
+    jerry_value_t options = JERRYXX_GET_ARG(3);
+    config.width = (int16_t)jerryxx_get_property_number(
+        options, MSTR_DISPLAY_WIDTH, config.width);
+    config.height = (int16_t)jerryxx_get_property_number(
+        options, MSTR_DISPLAY_HEIGHT, config.height);
+    config.address = (uint8_t)jerryxx_get_property_number(
+        options, MSTR_DISPLAY_ADDRESS, config.address);
+    config.cs =
+        (int8_t)jerryxx_get_property_number(options, MSTR_DISPLAY_CS, -1);
+    config.dc =
+        (int8_t)jerryxx_get_property_number(options, MSTR_DISPLAY_DC, -1);
+    config.rst =
+        (int8_t)jerryxx_get_property_number(options, MSTR_DISPLAY_RST, -1);
+    config.col_offset = (int16_t)jerryxx_get_property_number(
+        options, MSTR_DISPLAY_COL_OFFSET, config.col_offset);
+    config.row_offset = (int16_t)jerryxx_get_property_number(
+        options, MSTR_DISPLAY_ROW_OFFSET, config.row_offset);
+    config.bgr =
+        jerryxx_get_property_boolean(options, MSTR_DISPLAY_BGR, config.bgr);
+    config.invert = jerryxx_get_property_boolean(options, MSTR_DISPLAY_INVERT,
+                                                 config.invert);
+  }
+
+  // create and initialize the display
+  display_t *display = display_create(type, &config);
+  if (display == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  int ret = display_init(display);
+  if (ret < 0) {
+    free(display);
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  jerry_set_object_native_pointer(JERRYXX_GET_THIS, &display->panel,
+                                  &gc_panel_native_info);
+  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_DISPLAY_WIDTH,
+                              config.width);
+  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_DISPLAY_HEIGHT,
+                              config.height);
+  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_DISPLAY_BPP,
+                              display->panel.bpp);
+  return jerry_create_undefined();
+}
+
+/**
+ * Initialize 'display' module and return exports
+ */
+jerry_value_t module_display_init() {
+  /* Panel class */
+  jerry_value_t panel_ctor = jerry_create_external_function(panel_ctor_fn);
+  jerry_value_t panel_prototype = jerry_create_object();
+  jerryxx_set_property(panel_ctor, MSTR_PROTOTYPE, panel_prototype);
+  jerry_release_value(panel_prototype);
+
+  /* display module exports */
+  jerry_value_t exports = jerry_create_object();
+  jerryxx_set_property(exports, MSTR_DISPLAY_PANEL, panel_ctor);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_SSD1306, DISPLAY_SSD1306);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_SH1106, DISPLAY_SH1106);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_ST7735, DISPLAY_ST7735);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_ST7789, DISPLAY_ST7789);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_ILI9341, DISPLAY_ILI9341);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_SPI, DISPLAY_SPI);
+  jerryxx_set_property_number(exports, MSTR_DISPLAY_I2C, DISPLAY_I2C);
+  jerry_release_value(panel_ctor);
+  return exports;
+}
@@ -27,5 +27,11 @@
 #define MSTR_FLASH_READ "read"
 #define MSTR_FLASH_WRITE "write"
 #define MSTR_FLASH_IOCTL "ioctl"
+#define MSTR_FLASH_STATS "stats"
+#define MSTR_FLASH_PROGRAM_COUNT "programCount"
+#define MSTR_FLASH_PROGRAM_BYTES "programBytes"
+#define MSTR_FLASH_PROGRAM_CONFLICTS "programConflicts"
+#define MSTR_FLASH_ERASE_COUNT "eraseCount"
+#define MSTR_FLASH_ERASE_MAX "eraseMax"
 
 #endif /* __FLASH_MAGIC_STRINGS_H */
@@ -21,8 +21,11 @@
 
 #include "module_flash.h"
 
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "blkdev.h"
 #include "board.h"
 #include "err.h"
 #include "flash.h"
@@ -31,6 +34,94 @@
 #include "jerryxx.h"
 #include "magic_strings.h"
 
+typedef struct {
+  km_blkdev_t blkdev;
+  uint32_t base;
+  uint32_t count;
+} flash_blkdev_t;
+
+/**
+ * Check the range is in the block device (without overflowing uint32)
+ */
+static bool flash_blkdev_check_range(flash_blkdev_t *flash, uint32_t block,
+                                     uint32_t offset, uint32_t size) {
+  if (block >= flash->count) {
+    return false;
+  }
+  uint32_t limit = (flash->count - block) * KALUMA_FLASH_SECTOR_SIZE;
+  return offset <= limit && size <= limit - offset;
+}
+
+static int flash_blkdev_read(km_blkdev_t *blkdev, uint32_t block,
+                             uint32_t offset, uint8_t *buffer, uint32_t size) {
+  flash_blkdev_t *flash = (flash_blkdev_t *)blkdev;
+  if (!flash_blkdev_check_range(flash, block, offset, size)) {
+    return EINVAL;
+  }
+  memcpy(buffer,
+         km_flash_addr + (flash->base + block) * KALUMA_FLASH_SECTOR_SIZE +
+             offset,
+         size);
+  return 0;
+}
+
+static int flash_blkdev_write(km_blkdev_t *blkdev, uint32_t block,
+                              uint32_t offset, const uint8_t *buffer,
+                              uint32_t size) {
+  flash_blkdev_t *flash = (flash_blkdev_t *)blkdev;
+  if (!flash_blkdev_check_range(flash, block, offset, size)) {
+    return EINVAL;
+  }
+  return km_flash_program(flash->base + block, offset, (uint8_t *)buffer,
+                          size);
+}
+
+static int flash_blkdev_ioctl(km_blkdev_t *blkdev, int op, int arg) {
+  flash_blkdev_t *flash = (flash_blkdev_t *)blkdev;
+  switch (op) {
+    case KM_BLKDEV_IOCTL_INIT:
+    case KM_BLKDEV_IOCTL_SHUTDOWN:
+    case KM_BLKDEV_IOCTL_SYNC:
+      return 0;
+    case KM_BLKDEV_IOCTL_BLOCK_COUNT:
+      return flash->count;
+    case KM_BLKDEV_IOCTL_BLOCK_SIZE:
+      return KALUMA_FLASH_SECTOR_SIZE;
+    case KM_BLKDEV_IOCTL_BLOCK_ERASE:
+      if (arg < 0 || (uint32_t)arg >= flash->count) return EINVAL;
+      return km_flash_erase(flash->base + arg, 1);
+    case KM_BLKDEV_IOCTL_BUFFER_SIZE:  // flash page size
+      return KALUMA_FLASH_PAGE_SIZE;
+    default:
+      return -1;
+  }
+}
+
+static void flash_blkdev_free(km_blkdev_t *blkdev) { free(blkdev); }
+
+static const km_blkdev_ops_t flash_blkdev_ops = {
+    .read = flash_blkdev_read,
+    .write = flash_blkdev_write,
+    .ioctl = flash_blkdev_ioctl,
+    .free = flash_blkdev_free};
+
+/**
+ * Get pointer and length of the Uint8Array
+ */
+static uint8_t *get_buffer_pointer(jerry_value_t buffer,
+                                   jerry_length_t *length) {
+  jerry_length_t buffer_offset = 0;
+  jerry_value_t arrbuf =
+      jerry_get_typedarray_buffer(buffer, &buffer_offset, length);
+  uint8_t *buffer_pointer = jerry_get_arraybuffer_pointer(arrbuf);
+  jerry_release_value(arrbuf);
+  return buffer_pointer + buffer_offset;
+}
+
+static jerry_value_t create_blkdev_error(int ret) {
+  return jerry_create_error_from_value(create_system_error(ret), true);
+}
+
 /**
  * Flash (block device) constructor
  * args:
@@ -49,6 +140,17 @@ JERRYXX_FUN(flash_ctor_fn) {
   jerryxx_set_property_number(JERRYXX_GET_THIS, "base", base);
   jerryxx_set_property_number(JERRYXX_GET_THIS, "count", count);
   jerryxx_set_property_number(JERRYXX_GET_THIS, "size", size);
+
+  // native block device
+  flash_blkdev_t *flash = (flash_blkdev_t *)malloc(sizeof(flash_blkdev_t));
+  if (flash == NULL) {
+    return create_blkdev_error(ENOMEM);
+  }
+  flash->blkdev.ops = &flash_blkdev_ops;
+  flash->base = base;
+  flash->count = count;
+  jerry_set_object_native_pointer(JERRYXX_GET_THIS, flash,
+                                  &km_blkdev_native_info);
   return jerry_create_undefined();
 }
 
@@ -67,23 +169,18 @@ JERRYXX_FUN(flash_read_fn) {
   int block = JERRYXX_GET_ARG_NUMBER(0);
   jerry_value_t buffer = JERRYXX_GET_ARG(1);
   int offset = JERRYXX_GET_ARG_NUMBER_OPT(2, 0);
-
-  // get buffer pointer
-  jerry_length_t buffer_length = 0;
-  jerry_length_t buffer_offset = 0;
-  jerry_value_t arrbuf =
-      jerry_get_typedarray_buffer(buffer, &buffer_offset, &buffer_length);
-  uint8_t *buffer_pointer = jerry_get_arraybuffer_pointer(arrbuf);
-  jerry_release_value(arrbuf);
-
-  // printf("bd.read(%d, %d, %d)\r\n", block, buffer_length, offset);
+  JERRYXX_GET_NATIVE_HANDLE(blkdev, km_blkdev_t, km_blkdev_native_info);
+  if (block < 0 || offset < 0) {
+    return create_blkdev_error(EINVAL);
+  }
 
   // read from flash
-  int base = jerryxx_get_property_number(JERRYXX_GET_THIS, "base", 0);
-  int size = jerryxx_get_property_number(JERRYXX_GET_THIS, "size", 0);
-  const uint8_t *addr = km_flash_addr;
-  for (int i = 0; i < buffer_length; i++) {
-    buffer_pointer[i] = addr[((base + block) * size) + offset + i];
+  jerry_length_t buffer_length = 0;
+  uint8_t *buffer_pointer = get_buffer_pointer(buffer, &buffer_length);
+  int ret =
+      km_blkdev_read(blkdev, block, offset, buffer_pointer, buffer_length);
+  if (ret < 0) {
+    return create_blkdev_error(ret);
   }
   return jerry_create_undefined();
 }
@@ -103,20 +200,19 @@ JERRYXX_FUN(flash_write_fn) {
   int block = JERRYXX_GET_ARG_NUMBER(0);
   jerry_value_t buffer = JERRYXX_GET_ARG(1);
   int offset = JERRYXX_GET_ARG_NUMBER_OPT(2, 0);
+  JERRYXX_GET_NATIVE_HANDLE(blkdev, km_blkdev_t, km_blkdev_native_info);
+  if (block < 0 || offset < 0) {
+    return create_blkdev_error(EINVAL);
+  }
 
-  // get buffer pointer
+  // write to flash
   jerry_length_t buffer_length = 0;
-  jerry_length_t buffer_offset = 0;
-  jerry_value_t arrbuf =
-      jerry_get_typedarray_buffer(buffer, &buffer_offset, &buffer_length);
-  uint8_t *buffer_pointer = jerry_get_arraybuffer_pointer(arrbuf);
-  jerry_release_value(arrbuf);
-
-  // printf("bd.write(%d, %d, %d)\r\n", block, buffer_length, offset);
-
-  // write to buffer
-  int base = jerryxx_get_property_number(JERRYXX_GET_THIS, "base", 0);
-  km_flash_program(base + block, offset, buffer_pointer, buffer_length);
+  uint8_t *buffer_pointer = get_buffer_pointer(buffer, &buffer_length);
+  int ret =
+      km_blkdev_write(blkdev, block, offset, buffer_pointer, buffer_length);
+  if (ret < 0) {
+    return create_blkdev_error(ret);
+  }
   return jerry_create_undefined();
 }
 
@@ -132,31 +228,26 @@ JERRYXX_FUN(flash_ioctl_fn) {
   JERRYXX_CHECK_ARG_NUMBER_OPT(1, "arg")
   int op = JERRYXX_GET_ARG_NUMBER(0);
   int arg = JERRYXX_GET_ARG_NUMBER_OPT(1, 0);
-  int base = (int)jerryxx_get_property_number(JERRYXX_GET_THIS, "base", 0);
-
-  // printf("bd.ioctl(%d, %d)\r\n", op, arg);
+  JERRYXX_GET_NATIVE_HANDLE(blkdev, km_blkdev_t, km_blkdev_native_info);
+  return jerry_create_number(km_blkdev_ioctl(blkdev, op, arg));
+}
 
-  switch (op) {
-    case 1:  // init
-      return jerry_create_number(0);
-    case 2:  // shutdown
-      return jerry_create_number(0);
-    case 3:  // sync
-      return jerry_create_number(0);
-    case 4:  // block count
-      return jerry_create_number(
-          jerryxx_get_property_number(JERRYXX_GET_THIS, "count", 0));
-    case 5:  // block size
-      return jerry_create_number(
-          jerryxx_get_property_number(JERRYXX_GET_THIS, "size", 0));
-    case 6:  // erase block
-      km_flash_erase(base + arg, 1);
-      return jerry_create_number(0);
-    case 7:  // buffer size (= flash page size)
-      return jerry_create_number(256);
-    default:
-      return jerry_create_number(-1);
-  }
+/**
+ * stats() function. Returns the program and erase counters.
+ */
+JERRYXX_FUN(flash_stats_fn) {
+  km_flash_stats_t stats;
+  km_flash_get_stats(&stats);
+  jerry_value_t obj = jerry_create_object();
+  jerryxx_set_property_number(obj, MSTR_FLASH_PROGRAM_COUNT,
+                              stats.program_count);
+  jerryxx_set_property_number(obj, MSTR_FLASH_PROGRAM_BYTES,
+                              stats.program_bytes);
+  jerryxx_set_property_number(obj, MSTR_FLASH_PROGRAM_CONFLICTS,
+                              stats.program_conflicts);
+  jerryxx_set_property_number(obj, MSTR_FLASH_ERASE_COUNT, stats.erase_count);
+  jerryxx_set_property_number(obj, MSTR_FLASH_ERASE_MAX, stats.erase_max);
+  return obj;
 }
 
 /**
@@ -178,6 +269,7 @@ jerry_value_t module_flash_init() {
   /* flash module exports */
   jerry_value_t exports = jerry_create_object();
   jerryxx_set_property(exports, MSTR_FLASH_FLASH, flash_ctor);
+  jerryxx_set_property_function(exports, MSTR_FLASH_STATS, flash_stats_fn);
   jerry_release_value(flash_ctor);
   return exports;
 }
@@ -131,8 +131,12 @@ function mkfs(blkdev, fstype) {
  * @param {BlockDevice} blkdev
  * @param {string} fstype
  * @param {boolean} mkfs
+ * @param {object} options
+ *   cache {number} block cache size in bytes (0 = no cache)
+ *   lookahead {number} lookahead buffer size in bytes (littlefs only)
+ *   readahead {number} number of cache lines to read ahead on a miss
  */
-function mount(path, blkdev, fstype, mkfs) {
+function mount(path, blkdev, fstype, mkfs, options) {
   path = __path.normalize(path);
   const _parent = __path.join(path, "..");
   if (_parent !== "/") {
@@ -147,7 +151,7 @@ function mount(path, blkdev, fstype, mkfs) {
   if (!fsctr) {
     throw new SystemError(-22); // EINVAL (?)
   }
-  const vfs = new fsctr(blkdev);
+  const vfs = new fsctr(blkdev, options || {});
 
   // try to mount (try mkfs if mount failed)
   try {
@@ -183,6 +187,16 @@ function unmount(path) {
   }
 }
 
+/**
+ * Return block cache statistics of a mounted VFS
+ * @param {string} path
+ * @returns {object} {hits, misses, writebacks} or undefined if no cache
+ */
+function cacheStats(path) {
+  const vfs = __lookup(path);
+  return typeof vfs.cacheStats === "function" ? vfs.cacheStats() : undefined;
+}
+
 /**
  * Return current working directory
  * @returns {string}
@@ -391,6 +405,7 @@ exports.unregister = unregister;
 exports.mkfs = mkfs;
 exports.mount = mount;
 exports.unmount = unmount;
+exports.cacheStats = cacheStats;
 exports.chdir = chdir;
 exports.cwd = cwd;
 exports.close = close;
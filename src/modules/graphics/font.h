@@ -49,5 +49,6 @@ typedef struct {
 } gc_font_t;
 
 extern const uint8_t font_default_bitmap[];
+extern gc_font_t custom_font;  // font set by the last setFont()
 
 #endif /* __FONT_H */
@@ -28,12 +28,258 @@
 
 #include "gc.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "font.h"
+#include "gc_dlist.h"
 #include "jerryscript.h"
 
+/* ************************************************************************** */
+/*                          DIRTY RECTANGLE TRACKING                          */
+/* ************************************************************************** */
+
+static int32_t gc_rect_area(const gc_rect_t *rect) {
+  return (int32_t)rect->w * rect->h;
+}
+
+static void gc_rect_union(gc_rect_t *dst, const gc_rect_t *a,
+                          const gc_rect_t *b) {
+  int16_t x0 = MIN(a->x, b->x);
+  int16_t y0 = MIN(a->y, b->y);
+  int16_t x1 = MAX(a->x + a->w, b->x + b->w);
+  int16_t y1 = MAX(a->y + a->h, b->y + b->h);
+  dst->x = x0;
+  dst->y = y0;
+  dst->w = x1 - x0;
+  dst->h = y1 - y0;
+}
+
+/**
+ * @brief Add a rectangle to the dirty list, coalescing with existing ones
+ * @param handle Graphic context handle
+ * @param rect Rectangle in device coordinates
+ *
+ * A rectangle is merged with the entry whose union wastes the least area
+ * when the union costs nothing (overlapping or adjoining) or when the list
+ * is full. The merged result is re-inserted so merges can cascade.
+ */
+static void gc_dirty_add(gc_handle_t *handle, gc_rect_t rect) {
+  while (true) {
+    int8_t best = -1;
+    int32_t best_waste = INT32_MAX;
+    for (uint8_t i = 0; i < handle->dirty_count; i++) {
+      gc_rect_t u;
+      gc_rect_union(&u, &handle->dirty_rects[i], &rect);
+      int32_t waste = gc_rect_area(&u) -
+                      gc_rect_area(&handle->dirty_rects[i]) -
+                      gc_rect_area(&rect);
+      if (waste < best_waste) {
+        best = i;
+        best_waste = waste;
+      }
+    }
+    if (best >= 0 &&
+        (best_waste <= 0 || handle->dirty_count >= GC_DIRTY_RECTS_MAX)) {
+      gc_rect_union(&rect, &handle->dirty_rects[best], &rect);
+      handle->dirty_count--;
+      handle->dirty_rects[best] = handle->dirty_rects[handle->dirty_count];
+    } else {
+      handle->dirty_rects[handle->dirty_count] = rect;
+      handle->dirty_count++;
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Clip a rectangle to the screen and map it to device coordinates.
+ * Rotations are multiples of 90 degrees, so a logical rectangle is also a
+ * rectangle on the device. The result is also clipped to the clip rect.
+ * @param handle Graphic context handle
+ * @param x
+ * @param y
+ * @param w
+ * @param h Rectangle in logical (rotated) coordinates
+ * @param rect Returned rectangle in device coordinates
+ * @return false if nothing is left after clipping
+ */
+bool gc_clip_to_device(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
+                       int16_t h, gc_rect_t *rect) {
+  int32_t x0 = MAX(x, 0);
+  int32_t y0 = MAX(y, 0);
+  int32_t x1 = MIN((int32_t)x + w, handle->width);
+  int32_t y1 = MIN((int32_t)y + h, handle->height);
+  if (x0 >= x1 || y0 >= y1) return false;
+  // same transforms as the set_pixel primitives
+  switch (handle->rotation) {
+    case 1:
+      rect->x = handle->device_width - y1;
+      rect->y = x0;
+      rect->w = y1 - y0;
+      rect->h = x1 - x0;
+      break;
+    case 2:
+      rect->x = handle->device_width - x1;
+      rect->y = handle->device_height - y1;
+      rect->w = x1 - x0;
+      rect->h = y1 - y0;
+      break;
+    case 3:
+      rect->x = y0;
+      rect->y = handle->device_height - x1;
+      rect->w = y1 - y0;
+      rect->h = x1 - x0;
+      break;
+    default:
+      rect->x = x0;
+      rect->y = y0;
+      rect->w = x1 - x0;
+      rect->h = y1 - y0;
+      break;
+  }
+  const gc_rect_t *clip = &handle->clip;
+  int16_t cx0 = MAX(rect->x, clip->x);
+  int16_t cy0 = MAX(rect->y, clip->y);
+  int16_t cx1 = MIN(rect->x + rect->w, clip->x + clip->w);
+  int16_t cy1 = MIN(rect->y + rect->h, clip->y + clip->h);
+  if (cx0 >= cx1 || cy0 >= cy1) return false;
+  rect->x = cx0;
+  rect->y = cy0;
+  rect->w = cx1 - cx0;
+  rect->h = cy1 - cy0;
+  return true;
+}
+
+/**
+ * @brief Reset the clip rect to the whole device
+ * @param handle Graphic context handle
+ */
+void gc_reset_clip(gc_handle_t *handle) {
+  handle->clip.x = 0;
+  handle->clip.y = 0;
+  handle->clip.w = handle->device_width;
+  handle->clip.h = handle->device_height;
+}
+
+/**
+ * @brief Map the clip rect back to logical (rotated) coordinates
+ * @param handle Graphic context handle
+ * @param rect Returned rectangle in logical coordinates
+ */
+void gc_get_logical_clip(gc_handle_t *handle, gc_rect_t *rect) {
+  const gc_rect_t *clip = &handle->clip;
+  // inverse of the transforms in gc_clip_to_device()
+  switch (handle->rotation) {
+    case 1:
+      rect->x = clip->y;
+      rect->y = handle->device_width - clip->x - clip->w;
+      rect->w = clip->h;
+      rect->h = clip->w;
+      break;
+    case 2:
+      rect->x = handle->device_width - clip->x - clip->w;
+      rect->y = handle->device_height - clip->y - clip->h;
+      rect->w = clip->w;
+      rect->h = clip->h;
+      break;
+    case 3:
+      rect->x = handle->device_height - clip->y - clip->h;
+      rect->y = clip->x;
+      rect->w = clip->h;
+      rect->h = clip->w;
+      break;
+    default:
+      *rect = *clip;
+      break;
+  }
+}
+
+/**
+ * @brief Mark a region as modified. Only buffered contexts track damage.
+ * @param handle Graphic context handle
+ * @param x
+ * @param y
+ * @param w
+ * @param h Region in logical (rotated) coordinates
+ */
+void gc_mark_dirty(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
+                   int16_t h) {
+  gc_rect_t rect;
+  if (handle->buffer == NULL) return;
+  if (gc_clip_to_device(handle, x, y, w, h, &rect)) {
+    gc_dirty_add(handle, rect);
+  }
+}
+
+/**
+ * @brief Mark the whole buffer as modified
+ * @param handle Graphic context handle
+ */
+void gc_mark_dirty_all(gc_handle_t *handle) {
+  if (handle->buffer == NULL) return;
+  handle->dirty_rects[0].x = 0;
+  handle->dirty_rects[0].y = 0;
+  handle->dirty_rects[0].w = handle->device_width;
+  handle->dirty_rects[0].h = handle->device_height;
+  handle->dirty_count = 1;
+}
+
+/**
+ * @brief Forget all tracked damage (after the buffer has been flushed)
+ * @param handle Graphic context handle
+ */
+void gc_clear_dirty(gc_handle_t *handle) { handle->dirty_count = 0; }
+
+/**
+ * @brief Align a dirty rectangle to the byte layout of the buffer and locate
+ * its bytes. Rows are pixel rows, except for 1-bit buffers where a row is a
+ * page of 8 pixel rows. A rectangle too large to copy cheaply is widened to
+ * a full-width band so that its rows are contiguous.
+ * @param handle Graphic context handle
+ * @param rect Dirty rectangle (device coordinates), adjusted in place
+ * @param row_bytes Bytes per row of the rectangle
+ * @param rows Number of rows
+ * @param stride Bytes between the starts of consecutive rows in the buffer
+ * @return Byte offset of the first row in the buffer
+ */
+uint32_t gc_dirty_rect_layout(gc_handle_t *handle, gc_rect_t *rect,
+                              uint32_t *row_bytes, uint32_t *rows,
+                              uint32_t *stride) {
+  int16_t dw = handle->device_width;
+  if (handle->bpp == 1) {  // pages of 8 vertical pixels
+    int16_t y1 = MIN((rect->y + rect->h + 7) & ~7, handle->device_height);
+    rect->y &= ~7;
+    rect->h = y1 - rect->y;
+  } else if (handle->bpp == 3) {  // two pixels per byte
+    int16_t x1 = MIN((rect->x + rect->w + 1) & ~1, dw);
+    rect->x &= ~1;
+    rect->w = x1 - rect->x;
+  }
+  uint32_t bpr = handle->bpp == 16 ? 2 * rect->w
+                 : handle->bpp == 3 ? rect->w / 2
+                                    : rect->w;
+  uint32_t nrows = handle->bpp == 1 ? (rect->h + 7) / 8 : rect->h;
+  if (rect->w < dw && bpr * nrows > GC_DIRTY_COPY_MAX) {
+    rect->x = 0;
+    rect->w = dw;
+    bpr = handle->bpp == 16 ? 2 * dw : handle->bpp == 3 ? dw / 2 : dw;
+  }
+  *row_bytes = bpr;
+  *rows = nrows;
+  if (handle->bpp == 16) {
+    *stride = dw * 2;
+    return ((uint32_t)rect->y * dw + rect->x) * 2;
+  } else if (handle->bpp == 3) {
+    *stride = dw / 2;
+    return ((uint32_t)rect->y * dw + rect->x) / 2;
+  } else {
+    *stride = dw;
+    return (uint32_t)(rect->y / 8) * dw + rect->x;
+  }
+}
+
 /* ************************************************************************** */
 /*                      GRAPHIC DEVICE_NEUTRAL FUNCTIONS                      */
 /* ************************************************************************** */
@@ -53,7 +299,7 @@ uint16_t gc_color16(gc_handle_t *handle, uint8_t r, uint8_t g, uint8_t b) {
  * @brief Clear screen
  * @param handle Graphic context handle
  */
-void gc_clear_screen(gc_handle_t *handle) { handle->fill_screen_cb(handle, 0); }
+void gc_clear_screen(gc_handle_t *handle) { gc_fill_screen(handle, 0); }
 
 /**
  * @brief Fill screen
@@ -61,7 +307,13 @@ void gc_clear_screen(gc_handle_t *handle) { handle->fill_screen_cb(handle, 0); }
  * @param color
  */
 void gc_fill_screen(gc_handle_t *handle, uint16_t color) {
+  if (handle->dlist != NULL) {  // everything recorded so far is covered
+    gc_dlist_begin(handle->dlist, handle);
+    gc_dlist_put(handle->dlist, GC_OP_FILL_SCREEN, 1, color);
+    return;
+  }
   handle->fill_screen_cb(handle, color);
+  gc_mark_dirty_all(handle);
 }
 
 /**
@@ -71,6 +323,9 @@ void gc_fill_screen(gc_handle_t *handle, uint16_t color) {
  */
 void gc_set_rotation(gc_handle_t *handle, uint8_t rotation) {
   handle->rotation = (rotation & 3);
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_ROTATION, 1, handle->rotation);
+  }
   switch (handle->rotation) {
     case 0:
     case 2:
@@ -99,6 +354,9 @@ uint8_t gc_get_rotation(gc_handle_t *handle) { return handle->rotation; }
  */
 void gc_set_color(gc_handle_t *handle, uint16_t color) {
   handle->color = color;
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_COLOR, 1, color);
+  }
 }
 
 /**
@@ -115,6 +373,9 @@ uint16_t gc_get_color(gc_handle_t *handle) { return handle->color; }
  */
 void gc_set_fill_color(gc_handle_t *handle, uint16_t color) {
   handle->fill_color = color;
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_FILL_COLOR, 1, color);
+  }
 }
 
 /**
@@ -132,7 +393,12 @@ uint16_t gc_get_fill_color(gc_handle_t *handle) { return handle->fill_color; }
  * @param color
  */
 void gc_set_pixel(gc_handle_t *handle, int16_t x, int16_t y, uint16_t color) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_PIXEL, 3, x, y, color);
+    return;
+  }
   handle->set_pixel_cb(handle, x, y, color);
+  gc_mark_dirty(handle, x, y, 1, 1);
 }
 
 /**
@@ -148,6 +414,49 @@ uint16_t gc_get_pixel(gc_handle_t *handle, int16_t x, int16_t y) {
   return color;
 }
 
+/**
+ * @brief Save the drawing state (rotation, colors and font)
+ * @param handle Graphic context handle
+ * @param state Returned state
+ */
+void gc_save_state(gc_handle_t *handle, gc_state_t *state) {
+  state->rotation = handle->rotation;
+  state->color = handle->color;
+  state->fill_color = handle->fill_color;
+  state->font = handle->font;
+  state->font_color = handle->font_color;
+  state->font_scale_x = handle->font_scale_x;
+  state->font_scale_y = handle->font_scale_y;
+}
+
+/**
+ * @brief Restore a saved drawing state. Only the values that changed are
+ * set again (and recorded if recording).
+ * @param handle Graphic context handle
+ * @param state State saved by gc_save_state()
+ */
+void gc_restore_state(gc_handle_t *handle, const gc_state_t *state) {
+  if (handle->rotation != state->rotation) {
+    gc_set_rotation(handle, state->rotation);
+  }
+  if (handle->color != state->color) {
+    gc_set_color(handle, state->color);
+  }
+  if (handle->fill_color != state->fill_color) {
+    gc_set_fill_color(handle, state->fill_color);
+  }
+  if (handle->font != state->font) {
+    gc_set_font(handle, state->font);
+  }
+  if (handle->font_color != state->font_color) {
+    gc_set_font_color(handle, state->font_color);
+  }
+  if (handle->font_scale_x != state->font_scale_x ||
+      handle->font_scale_y != state->font_scale_y) {
+    gc_set_font_scale(handle, state->font_scale_x, state->font_scale_y);
+  }
+}
+
 /**
  * @brief Draw line (Bresenham's algorithm)
  * @param handle Graphic context handle
@@ -158,6 +467,12 @@ uint16_t gc_get_pixel(gc_handle_t *handle, int16_t x, int16_t y) {
  */
 void gc_draw_line(gc_handle_t *handle, int16_t x0, int16_t y0, int16_t x1,
                   int16_t y1) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_LINE, 4, x0, y0, x1, y1);
+    return;
+  }
+  gc_mark_dirty(handle, MIN(x0, x1), MIN(y0, y1), abs(x1 - x0) + 1,
+                abs(y1 - y0) + 1);
   int16_t steep = abs(y1 - y0) > abs(x1 - x0);
   if (steep) {
     SWAP_INT16(x0, y0);
@@ -177,13 +492,18 @@ void gc_draw_line(gc_handle_t *handle, int16_t x0, int16_t y0, int16_t x1,
   } else {
     ystep = -1;
   }
+  // emit runs of pixels sharing the same minor coordinate as line spans
+  int16_t run = x0;
   for (; x0 <= x1; x0++) {
-    if (steep) {
-      handle->set_pixel_cb(handle, y0, x0, handle->color);
-    } else {
-      handle->set_pixel_cb(handle, x0, y0, handle->color);
-    }
     err -= dy;
+    if (err < 0 || x0 == x1) {
+      if (steep) {
+        handle->draw_vline_cb(handle, y0, run, x0 - run + 1, handle->color);
+      } else {
+        handle->draw_hline_cb(handle, run, y0, x0 - run + 1, handle->color);
+      }
+      run = x0 + 1;
+    }
     if (err < 0) {
       y0 += ystep;
       err += dx;
@@ -201,6 +521,11 @@ void gc_draw_line(gc_handle_t *handle, int16_t x0, int16_t y0, int16_t x1,
  */
 void gc_draw_rect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
                   int16_t h) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_RECT, 4, x, y, w, h);
+    return;
+  }
+  gc_mark_dirty(handle, x, y, w, h);
   handle->draw_hline_cb(handle, x, y, w, handle->color);
   handle->draw_hline_cb(handle, x, y + h - 1, w, handle->color);
   handle->draw_vline_cb(handle, x, y, h, handle->color);
@@ -263,8 +588,13 @@ void gc_draw_circle_helper(gc_handle_t *handle, int16_t x, int16_t y, int16_t r,
  */
 void gc_draw_roundrect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
                        int16_t h, int16_t r) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_ROUNDRECT, 5, x, y, w, h, r);
+    return;
+  }
   int16_t max_radius = ((w < h) ? w : h) / 2;  // 1/2 minor axis
   if (r > max_radius) r = max_radius;
+  gc_mark_dirty(handle, x, y, w, h);
   // smarter version
   handle->draw_hline_cb(handle, x + r, y, w - 2 * r, handle->color);
   handle->draw_hline_cb(handle, x + r, y + h - 1, w - 2 * r, handle->color);
@@ -286,6 +616,11 @@ void gc_draw_roundrect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
  * @param r
  */
 void gc_draw_circle(gc_handle_t *handle, int16_t x, int16_t y, int16_t r) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_CIRCLE, 3, x, y, r);
+    return;
+  }
+  gc_mark_dirty(handle, x - r, y - r, 2 * r + 1, 2 * r + 1);
   int16_t f = 1 - r;
   int16_t ddF_x = 1;
   int16_t ddF_y = -2 * r;
@@ -333,6 +668,16 @@ void gc_draw_ellipse(gc_handle_t *handle, int16_t x0, int16_t y0, int16_t x1,
  */
 void gc_fill_rect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
                   int16_t h) {
+  if (handle->dlist != NULL) {
+    if (x <= 0 && y <= 0 && x + w >= handle->width &&
+        y + h >= handle->height) {
+      // everything recorded so far is covered, as by gc_fill_screen()
+      gc_dlist_begin(handle->dlist, handle);
+    }
+    gc_dlist_put(handle->dlist, GC_OP_FILL_RECT, 4, x, y, w, h);
+    return;
+  }
+  gc_mark_dirty(handle, x, y, w, h);
   handle->fill_rect_cb(handle, x, y, w, h, handle->fill_color);
 }
 
@@ -392,8 +737,13 @@ void gc_fill_circle_helper(gc_handle_t *handle, int16_t x, int16_t y, int16_t r,
  */
 void gc_fill_roundrect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
                        int16_t h, int16_t r) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_FILL_ROUNDRECT, 5, x, y, w, h, r);
+    return;
+  }
   int16_t max_radius = ((w < h) ? w : h) / 2;  // 1/2 minor axis
   if (r > max_radius) r = max_radius;
+  gc_mark_dirty(handle, x, y, w, h);
   handle->fill_rect_cb(handle, x + r, y, w - 2 * r, h, handle->fill_color);
   // draw four corners
   gc_fill_circle_helper(handle, x + w - r - 1, y + r, r, 1, h - 2 * r - 1,
@@ -410,6 +760,11 @@ void gc_fill_roundrect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
  * @param  r
  */
 void gc_fill_circle(gc_handle_t *handle, int16_t x, int16_t y, int16_t r) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_FILL_CIRCLE, 3, x, y, r);
+    return;
+  }
+  gc_mark_dirty(handle, x - r, y - r, 2 * r + 1, 2 * r + 1);
   handle->draw_vline_cb(handle, x, y - r, 2 * r + 1, handle->fill_color);
   gc_fill_circle_helper(handle, x, y, r, 3, 0, handle->fill_color);
 }
@@ -423,7 +778,12 @@ void gc_fill_ellipse(gc_handle_t *handle, int16_t x0, int16_t y0, int16_t x1,
 /**
  * @brief
  */
-void gc_set_font(gc_handle_t *handle, gc_font_t *font) { handle->font = font; }
+void gc_set_font(gc_handle_t *handle, gc_font_t *font) {
+  handle->font = font;
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_FONT, 1, font != NULL);
+  }
+}
 
 /**
  * @brief
@@ -435,6 +795,9 @@ gc_font_t *gc_get_font(gc_handle_t *handle) { return handle->font; }
  */
 void gc_set_font_color(gc_handle_t *handle, uint16_t color) {
   handle->font_color = color;
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_FONT_COLOR, 1, color);
+  }
 }
 
 /**
@@ -448,6 +811,40 @@ uint16_t gc_get_font_color(gc_handle_t *handle) { return handle->font_color; }
 void gc_set_font_scale(gc_handle_t *handle, uint8_t scale_x, uint8_t scale_y) {
   handle->font_scale_x = scale_x;
   handle->font_scale_y = scale_y;
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_FONT_SCALE, 2, scale_x, scale_y);
+  }
+}
+
+/**
+ * @brief Draw the set bits of a 1-bit bitmap row (MSB first) as runs
+ * @param handle Graphic context handle
+ * @param x Left of the row
+ * @param y Top of the row
+ * @param bits Row data
+ * @param w Row width in pixels
+ * @param scale_x
+ * @param scale_y
+ * @param flip_x Draw the row mirrored (pixel xx at w - xx)
+ * @param color
+ */
+static void gc_draw_bitmap_row(gc_handle_t *handle, int16_t x, int16_t y,
+                               const uint8_t *bits, int16_t w, uint8_t scale_x,
+                               uint8_t scale_y, bool flip_x, uint16_t color) {
+  int16_t xx = 0;
+  while (xx < w) {
+    if (!(bits[xx >> 3] & (0x80 >> (xx & 7)))) {
+      xx++;
+      continue;
+    }
+    int16_t start = xx;
+    while (xx < w && (bits[xx >> 3] & (0x80 >> (xx & 7)))) {
+      xx++;
+    }
+    int16_t n = xx - start;
+    int16_t px = x + (flip_x ? (w - start - n + 1) : start) * scale_x;
+    handle->fill_rect_cb(handle, px, y, n * scale_x, scale_y, color);
+  }
 }
 
 /**
@@ -460,50 +857,41 @@ void gc_draw_char(gc_handle_t *handle, int16_t x, int16_t y, const char ch) {
     if ((x >= handle->width) || (y >= handle->height) ||
         ((x + 6 * sx - 1) < 0) || ((y + 8 * sy - 1) < 0))
       return;
+    gc_mark_dirty(handle, x, y, 5 * sx, 8 * sy);
+    // glyphs are stored column by column: draw vertical runs of set bits
     for (int8_t i = 0; i < 5; i++) {
       uint8_t line = font_default_bitmap[ch * 5 + i];
-      for (int8_t j = 0; j < 8; j++, line >>= 1) {
+      int8_t j = 0;
+      while (line) {
         if (line & 1) {
-          if (sx == 1 && sy == 1)
-            handle->set_pixel_cb(handle, x + i, y + j, handle->font_color);
-          else
-            handle->fill_rect_cb(handle, x + i * sx, y + j * sy, sx, sy,
-                                 handle->font_color);
+          int8_t start = j;
+          while (line & 1) {
+            line >>= 1;
+            j++;
+          }
+          handle->fill_rect_cb(handle, x + i * sx, y + start * sy, sx,
+                               (j - start) * sy, handle->font_color);
+        } else {
+          line >>= 1;
+          j++;
         }
       }
     }
   } else { /* custom font */
     uint8_t w = handle->font->width;
     uint8_t h = handle->font->height;
-    uint16_t sz = (((w + 7) / 8) * h);
-    uint16_t idx = ((uint8_t)ch) - handle->font->first;
-    uint16_t offset = idx * sz;
+    uint32_t sz = (((w + 7) / 8) * h);
+    uint32_t idx = ((uint8_t)ch) - handle->font->first;
+    uint32_t offset = idx * sz;
     if ((x >= handle->width) || (y >= handle->height) ||
         ((x + w * sx - 1) < 0) || ((y + h * sy - 1) < 0))
       return;
-    uint8_t bit = 0;
-    uint8_t bits = handle->font->bitmap[offset];
-    for (uint8_t yy = 0; yy < h; yy++) {
-      for (uint8_t xx = 0; xx < w; xx++) {
-        if (bit > 7) {
-          bit = 0;
-          offset++;
-          bits = handle->font->bitmap[offset];
-        }
-        if (bits & 0x80) {
-          if (sx == 1 && sy == 1) {
-            handle->set_pixel_cb(handle, x + xx, y + yy, handle->font_color);
-          } else {
-            handle->fill_rect_cb(handle, x + xx * sx, y + yy * sy, sx, sy,
-                                 handle->font_color);
-          }
-        }
-        bits <<= 1;
-        bit++;
-      }
-      offset++;
-      bit = 0;
-      bits = handle->font->bitmap[offset];
+    gc_mark_dirty(handle, x, y, w * sx, h * sy);
+    // glyphs are stored row by row: draw horizontal runs of set bits
+    uint8_t row_bytes = (w + 7) / 8;
+    for (uint8_t yy = 0; yy < h; yy++, offset += row_bytes) {
+      gc_draw_bitmap_row(handle, x, y + yy * sy, &handle->font->bitmap[offset],
+                         w, sx, sy, false, handle->font_color);
     }
   }
 }
@@ -512,9 +900,22 @@ void gc_draw_char(gc_handle_t *handle, int16_t x, int16_t y, const char ch) {
  * @brief
  */
 void gc_draw_text(gc_handle_t *handle, int16_t x, int16_t y, const char *text) {
+  gc_draw_text_n(handle, x, y, text, strlen(text));
+}
+
+/**
+ * @brief Draw the first length characters of text
+ */
+void gc_draw_text_n(gc_handle_t *handle, int16_t x, int16_t y,
+                    const char *text, uint16_t length) {
+  if (handle->dlist != NULL) {
+    gc_dlist_put(handle->dlist, GC_OP_TEXT, 3, x, y, length);
+    gc_dlist_put_bytes(handle->dlist, (const uint8_t *)text, length);
+    return;
+  }
   int16_t cursor_x = x;
   int16_t cursor_y = y;
-  for (uint16_t i = 0; i < strlen(text); i++) {
+  for (uint16_t i = 0; i < length; i++) {
     char ch = text[i];
     if (handle->font == NULL) { /* default font */
       if (ch == '\n') {
@@ -602,35 +1003,44 @@ void gc_draw_bitmap(gc_handle_t *handle, int16_t x, int16_t y, uint8_t *bitmap,
                     bool transparent, uint16_t transparent_color,
                     uint8_t scale_x, uint8_t scale_y, bool flip_x,
                     bool flip_y) {
+  if (handle->dlist != NULL) {
+    uint8_t flags = (transparent ? GC_DLIST_BITMAP_TRANSPARENT : 0) |
+                    (flip_x ? GC_DLIST_BITMAP_FLIP_X : 0) |
+                    (flip_y ? GC_DLIST_BITMAP_FLIP_Y : 0);
+    int32_t ref = gc_dlist_find_ref(handle->dlist, bitmap);
+    if (ref >= 0) {  // pinned by the caller, see gc_dlist_pin()
+      gc_dlist_put(handle->dlist, GC_OP_BITMAP_REF, 11, x, y, w, h, bpp,
+                   color, flags, transparent_color, scale_x, scale_y, ref);
+      return;
+    }
+    gc_dlist_put(handle->dlist, GC_OP_BITMAP, 10, x, y, w, h, bpp, color,
+                 flags, transparent_color, scale_x, scale_y);
+    gc_dlist_put_bytes(handle->dlist, bitmap,
+                       gc_dlist_bitmap_size(w, h, bpp));
+    return;
+  }
   if ((x >= handle->width) || (y >= handle->height) ||
       ((x + (w * scale_x) - 1) < 0) || ((y + (h * scale_y) - 1) < 0))
     return;
+  // flipped bitmaps are drawn one pixel (scaled) further right or down
+  gc_mark_dirty(handle, x, y, (w + 1) * scale_x, (h + 1) * scale_y);
   if (bpp == 1) {
-    uint16_t offset = 0;
-    uint8_t bit = 0;
-    uint8_t bits = bitmap[offset];
+    uint16_t row_bytes = (w + 7) / 8;
     for (int16_t yy = 0; yy < h; yy++) {
-      for (int16_t xx = 0; xx < w; xx++) {
-        if (bit > 7) {
-          bit = 0;
-          offset++;
-          bits = bitmap[offset];
-        }
-        if (bits & 0x80) {
-          gc_draw_bitmap_helper(handle, x, y, w, h, xx, yy, scale_x, scale_y,
-                                flip_x, flip_y, color);
-        }
-        bits <<= 1;
-        bit++;
-      }
-      offset++;
-      bit = 0;
-      bits = bitmap[offset];
+      int16_t py = y + (flip_y ? (h - yy) : yy) * scale_y;
+      gc_draw_bitmap_row(handle, x, py, bitmap + yy * row_bytes, w, scale_x,
+                         scale_y, flip_x, color);
     }
   } else if (bpp == 16) {
+    if (handle->blit16_cb != NULL && scale_x == 1 && scale_y == 1 &&
+        !flip_x && !flip_y) {
+      handle->blit16_cb(handle, x, y, bitmap, w, h, transparent,
+                        transparent_color);
+      return;
+    }
     for (int16_t yy = 0; yy < h; yy++) {
       for (int16_t xx = 0; xx < w; xx++) {
-        uint32_t idx = ((yy * w) + xx) * 2;
+        uint32_t idx = ((uint32_t)yy * w + xx) * 2;
         color = bitmap[idx] << 8 | bitmap[idx + 1];
         if (transparent) {
           if (color != transparent_color) {
@@ -41,7 +41,42 @@
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
 #endif
 
+#ifndef MIN
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#endif
+
+/**
+ * Maximum number of dirty rectangles tracked per graphic context. When the
+ * list is full, the new rectangle is merged into the one it grows least.
+ */
+#define GC_DIRTY_RECTS_MAX 8
+
+/**
+ * Dirty rectangles whose packed copy would exceed this many bytes are widened
+ * to full-width bands, which are contiguous in the buffer and need no copy.
+ */
+#define GC_DIRTY_COPY_MAX 4096
+
+/**
+ * Rectangle in device (buffer) coordinates
+ */
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+} gc_rect_t;
+
+/**
+ * True if the device pixel (x, y) is inside the clip rectangle
+ */
+#define GC_CLIP_CONTAINS(handle, px, py)                                      \
+  ((px) >= (handle)->clip.x && (px) < (handle)->clip.x + (handle)->clip.w &&  \
+   (py) >= (handle)->clip.y && (py) < (handle)->clip.y + (handle)->clip.h)
+
 typedef struct gc_handle_s gc_handle_t;
+typedef struct gc_panel_s gc_panel_t;
+typedef struct gc_dlist_s gc_dlist_t;
 
 typedef void (*gc_set_pixel_cb)(gc_handle_t *, int16_t, int16_t, uint16_t);
 typedef void (*gc_get_pixel_cb)(gc_handle_t *, int16_t, int16_t, uint16_t *);
@@ -52,6 +87,38 @@ typedef void (*gc_draw_vline_cb)(gc_handle_t *, int16_t, int16_t, int16_t,
 typedef void (*gc_fill_rect_cb)(gc_handle_t *, int16_t, int16_t, int16_t,
                                 int16_t, uint16_t);
 typedef void (*gc_fill_screen_cb)(gc_handle_t *, uint16_t);
+typedef void (*gc_blit16_cb)(gc_handle_t *, int16_t, int16_t, const uint8_t *,
+                             int16_t, int16_t, bool, uint16_t);
+
+/**
+ * Display panel operations. Rectangles are in device coordinates. A panel
+ * takes framebuffers in its own format (see gc_panel_t.bpp).
+ */
+typedef struct {
+  // copy a region of the framebuffer to the panel (the buffer holds the
+  // device rows from `buffer_y` on)
+  int (*flush)(gc_panel_t *panel, const uint8_t *buffer, int16_t buffer_y,
+               const gc_rect_t *rect);
+  // fill a region of the panel (NULL if it can't be drawn directly)
+  int (*fill)(gc_panel_t *panel, const gc_rect_t *rect, uint16_t color);
+  // write 16-bit pixels row by row, `stride` bytes apart in `pixels`
+  int (*write)(gc_panel_t *panel, const gc_rect_t *rect,
+               const uint8_t *pixels, uint32_t stride);
+  void (*free)(gc_panel_t *panel);
+} gc_panel_ops_t;
+
+/**
+ * Display panel implemented by a native display driver. Objects carrying a
+ * panel use gc_panel_native_info as their native pointer info.
+ */
+struct gc_panel_s {
+  const gc_panel_ops_t *ops;
+  int16_t width;
+  int16_t height;
+  uint8_t bpp;
+};
+
+extern const jerry_object_native_info_t gc_panel_native_info;
 
 /**
  * Graphic context native handle
@@ -64,7 +131,12 @@ struct gc_handle_s {
   uint8_t rotation;
   uint8_t bpp;
   uint8_t *buffer;
-  uint16_t buffer_size;
+  uint32_t buffer_size;
+  int16_t buffer_y;  // first device row held in the buffer (banded rendering)
+  int16_t band_height;  // rows per band (0 if the buffer holds all rows)
+  gc_rect_t clip;    // drawing is limited to this rect (device coordinates)
+  uint8_t dirty_count;
+  gc_rect_t dirty_rects[GC_DIRTY_RECTS_MAX];
   uint16_t color;
   uint16_t fill_color;
   gc_font_t *font;
@@ -77,12 +149,28 @@ struct gc_handle_s {
   gc_draw_vline_cb draw_vline_cb;
   gc_fill_rect_cb fill_rect_cb;
   gc_fill_screen_cb fill_screen_cb;
+  gc_blit16_cb blit16_cb;  // optional: copy a 16-bit bitmap (NULL if none)
+  gc_panel_t *panel;       // native display panel (NULL if none)
+  gc_dlist_t *dlist;       // draw calls are recorded here (NULL if drawing)
   jerry_value_t display_js_cb;
   jerry_value_t set_pixel_js_cb;
   jerry_value_t get_pixel_js_cb;
   jerry_value_t fill_rect_js_cb;
 };
 
+/**
+ * Drawing state saved and restored around display list recording/replay
+ */
+typedef struct {
+  uint8_t rotation;
+  uint16_t color;
+  uint16_t fill_color;
+  gc_font_t *font;
+  uint16_t font_color;
+  uint8_t font_scale_x;
+  uint8_t font_scale_y;
+} gc_state_t;
+
 // primitive functions
 void gc_prim_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
                        uint16_t color);
@@ -109,6 +197,21 @@ void gc_prim_16bit_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
                              int16_t w, int16_t h, uint16_t color);
 void gc_prim_16bit_fill_screen(gc_handle_t *handle, uint16_t color);
 
+// device mapping and clipping
+bool gc_clip_to_device(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
+                       int16_t h, gc_rect_t *rect);
+void gc_reset_clip(gc_handle_t *handle);
+void gc_get_logical_clip(gc_handle_t *handle, gc_rect_t *rect);
+
+// dirty rectangle tracking
+void gc_mark_dirty(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
+                   int16_t h);
+void gc_mark_dirty_all(gc_handle_t *handle);
+void gc_clear_dirty(gc_handle_t *handle);
+uint32_t gc_dirty_rect_layout(gc_handle_t *handle, gc_rect_t *rect,
+                              uint32_t *row_bytes, uint32_t *rows,
+                              uint32_t *stride);
+
 // graphic device-neutral functions
 int16_t gc_get_width(gc_handle_t *handle);
 int16_t gc_get_height(gc_handle_t *handle);
@@ -123,6 +226,8 @@ void gc_set_fill_color(gc_handle_t *handle, uint16_t color);
 uint16_t gc_get_fill_color(gc_handle_t *handle);
 void gc_set_pixel(gc_handle_t *handle, int16_t x, int16_t y, uint16_t color);
 uint16_t gc_get_pixel(gc_handle_t *handle, int16_t x, int16_t y);
+void gc_save_state(gc_handle_t *handle, gc_state_t *state);
+void gc_restore_state(gc_handle_t *handle, const gc_state_t *state);
 void gc_draw_line(gc_handle_t *handle, int16_t x0, int16_t y0, int16_t x1,
                   int16_t y1);
 void gc_draw_rect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
@@ -142,6 +247,8 @@ gc_font_t *gc_get_font(gc_handle_t *handle);
 void gc_set_font_scale(gc_handle_t *handle, uint8_t scale_x, uint8_t scale_y);
 void gc_draw_char(gc_handle_t *handle, int16_t x, int16_t y, const char ch);
 void gc_draw_text(gc_handle_t *handle, int16_t x, int16_t y, const char *text);
+void gc_draw_text_n(gc_handle_t *handle, int16_t x, int16_t y,
+                    const char *text, uint16_t length);
 void gc_measure_text(gc_handle_t *handle, const char *text, uint16_t *w,
                      uint16_t *h);
 void gc_draw_bitmap(gc_handle_t *handle, int16_t x, int16_t y, uint8_t *bitmap,
@@ -23,6 +23,7 @@
 
 #include "gc_16bit_prims.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -51,7 +52,9 @@ void gc_prim_16bit_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
-    uint32_t idx = ((y * handle->device_width) + x) * 2;
+    if (!GC_CLIP_CONTAINS(handle, x, y)) return;
+    uint32_t idx =
+        ((uint32_t)(y - handle->buffer_y) * handle->device_width + x) * 2;
     handle->buffer[idx] = color >> 8;
     handle->buffer[idx + 1] = color & 0xFF;
   }
@@ -74,38 +77,146 @@ void gc_prim_16bit_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
-    uint32_t idx = ((y * handle->device_width) + x) * 2;
+    if (!GC_CLIP_CONTAINS(handle, x, y)) return;
+    uint32_t idx =
+        ((uint32_t)(y - handle->buffer_y) * handle->device_width + x) * 2;
     *color = handle->buffer[idx] << 8 | handle->buffer[idx + 1];
   }
 }
 
+/**
+ * Fill a row of w pixels. Pixels are stored big-endian, so a pair of pixels
+ * is a 32-bit pattern written a word at a time once the pointer is aligned.
+ */
+static void gc_prim_16bit_fill_row(uint8_t *p, int16_t w, uint16_t color) {
+  uint8_t hi = color >> 8;
+  uint8_t lo = color & 0xFF;
+  if (hi == lo) {
+    memset(p, hi, w * 2);
+    return;
+  }
+  while (w > 0 && ((uintptr_t)p & 3)) {
+    p[0] = hi;
+    p[1] = lo;
+    p += 2;
+    w--;
+  }
+  const uint8_t pattern[4] = {hi, lo, hi, lo};
+  uint32_t word;
+  memcpy(&word, pattern, 4);
+  uint32_t *q = (uint32_t *)p;
+  for (; w >= 2; w -= 2) {
+    *q++ = word;
+  }
+  if (w > 0) {
+    p = (uint8_t *)q;
+    p[0] = hi;
+    p[1] = lo;
+  }
+}
+
+/**
+ * Fill a rectangle in device coordinates: the first row is filled and the
+ * others are copied from it.
+ */
+static void gc_prim_16bit_fill_device_rect(gc_handle_t *handle,
+                                           const gc_rect_t *rect,
+                                           uint16_t color) {
+  uint32_t stride = handle->device_width * 2;
+  uint32_t offset =
+      (uint32_t)(rect->y - handle->buffer_y) * handle->device_width + rect->x;
+  uint8_t *row = handle->buffer + offset * 2;
+  if (rect->w == 1) {
+    for (int16_t i = 0; i < rect->h; i++, row += stride) {
+      row[0] = color >> 8;
+      row[1] = color & 0xFF;
+    }
+    return;
+  }
+  gc_prim_16bit_fill_row(row, rect->w, color);
+  for (int16_t i = 1; i < rect->h; i++) {
+    memcpy(row + i * stride, row, rect->w * 2);
+  }
+}
+
 void gc_prim_16bit_draw_vline(gc_handle_t *handle, int16_t x, int16_t y,
                               int16_t h, uint16_t color) {
-  for (int16_t i = y; i < y + h; i++) {
-    gc_prim_16bit_set_pixel(handle, x, i, color);
-  }
+  gc_prim_16bit_fill_rect(handle, x, y, 1, h, color);
 }
 
 void gc_prim_16bit_draw_hline(gc_handle_t *handle, int16_t x, int16_t y,
                               int16_t w, uint16_t color) {
-  for (int16_t i = x; i < x + w; i++) {
-    gc_prim_16bit_set_pixel(handle, i, y, color);
-  }
+  gc_prim_16bit_fill_rect(handle, x, y, w, 1, color);
 }
 
 void gc_prim_16bit_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
                              int16_t w, int16_t h, uint16_t color) {
-  for (int16_t i = x; i < x + w; i++) {
-    gc_prim_16bit_draw_vline(handle, i, y, h, color);
+  gc_rect_t rect;
+  if (gc_clip_to_device(handle, x, y, w, h, &rect)) {
+    gc_prim_16bit_fill_device_rect(handle, &rect, color);
   }
 }
 
 void gc_prim_16bit_fill_screen(gc_handle_t *handle, uint16_t color) {
-  for (int16_t y = 0; y < handle->device_height; y++) {
-    for (int16_t x = 0; x < handle->device_width; x++) {
-      uint32_t idx = ((y * handle->device_width) + x) * 2;
-      handle->buffer[idx] = color >> 8;
-      handle->buffer[idx + 1] = color;
+  gc_prim_16bit_fill_device_rect(handle, &handle->clip, color);
+}
+
+/**
+ * Copy a 16-bit (big-endian RGB565) bitmap to (x, y). The rotation is folded
+ * into per-pixel steps computed once: the device pixel index of logical
+ * (x, y) is origin + x * step_x + y * step_y.
+ */
+void gc_prim_16bit_blit(gc_handle_t *handle, int16_t x, int16_t y,
+                        const uint8_t *bitmap, int16_t w, int16_t h,
+                        bool transparent, uint16_t transparent_color) {
+  int32_t dw = handle->device_width;
+  int32_t dh = handle->device_height;
+  int32_t origin, step_x, step_y;
+  switch (handle->rotation) {
+    case 1:
+      origin = dw - 1;
+      step_x = dw;
+      step_y = -1;
+      break;
+    case 2:
+      origin = (dh - 1) * dw + dw - 1;
+      step_x = -1;
+      step_y = -dw;
+      break;
+    case 3:
+      origin = (dh - 1) * dw;
+      step_x = -dw;
+      step_y = 1;
+      break;
+    default:
+      origin = 0;
+      step_x = 1;
+      step_y = dw;
+      break;
+  }
+  origin -= (int32_t)handle->buffer_y * dw;
+  // clip once
+  gc_rect_t clip;
+  gc_get_logical_clip(handle, &clip);
+  int16_t xx0 = MAX(0, clip.x - x);
+  int16_t yy0 = MAX(0, clip.y - y);
+  int16_t xx1 = MIN(w, clip.x + clip.w - x);
+  int16_t yy1 = MIN(h, clip.y + clip.h - y);
+  if (xx0 >= xx1 || yy0 >= yy1) return;
+  uint8_t th = transparent_color >> 8;
+  uint8_t tl = transparent_color & 0xFF;
+  for (int16_t yy = yy0; yy < yy1; yy++) {
+    const uint8_t *src = bitmap + ((uint32_t)yy * w + xx0) * 2;
+    int32_t idx = origin + (x + xx0) * step_x + (y + yy) * step_y;
+    if (step_x == 1 && !transparent) {
+      memcpy(handle->buffer + idx * 2, src, (xx1 - xx0) * 2);
+      continue;
+    }
+    for (int16_t xx = xx0; xx < xx1; xx++, src += 2, idx += step_x) {
+      if (!transparent || src[0] != th || src[1] != tl) {
+        handle->buffer[idx * 2] = src[0];
+        handle->buffer[idx * 2 + 1] = src[1];
+      }
     }
   }
 }
@@ -58,7 +58,8 @@ void gc_prim_1bit_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
-    uint32_t idx = x + (y / 8) * handle->device_width;
+    if (!GC_CLIP_CONTAINS(handle, x, y)) return;
+    uint32_t idx = x + ((y - handle->buffer_y) / 8) * handle->device_width;
     uint8_t mask = (1 << (y & 7));
     if (color) {
       handle->buffer[idx] |= mask;
@@ -91,14 +92,44 @@ void gc_prim_1bit_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
-    *color = (handle->buffer[x + (y / 8) * handle->device_width] &
-              (1 << (y & 7))) > 0;
-    return;
+    if (GC_CLIP_CONTAINS(handle, x, y)) {
+      uint32_t idx = x + ((y - handle->buffer_y) / 8) * handle->device_width;
+      *color = (handle->buffer[idx] & (1 << (y & 7))) > 0;
+      return;
+    }
   }
   *color = 0;
   return;
 }
 
+/**
+ * @brief Fill a rectangle in device coordinates. Each page (8 vertical
+ * pixels per byte) is filled with one mask, whole pages with memset.
+ * @param handle Graphic context handle
+ * @param rect
+ * @param color
+ */
+static void gc_prim_1bit_fill_device_rect(gc_handle_t *handle,
+                                          const gc_rect_t *rect,
+                                          uint16_t color) {
+  int16_t y0 = rect->y;
+  int16_t y1 = rect->y + rect->h;
+  for (int16_t page = y0 / 8; page <= (y1 - 1) / 8; page++) {
+    int16_t top = MAX(y0, page * 8) - page * 8;
+    int16_t bottom = MIN(y1, page * 8 + 8) - page * 8;
+    uint8_t mask = (uint8_t)(0xFF << top) & (uint8_t)(0xFF >> (8 - bottom));
+    uint8_t *p = handle->buffer +
+                 (page - handle->buffer_y / 8) * handle->device_width + rect->x;
+    if (mask == 0xFF) {
+      memset(p, color ? 0xFF : 0x00, rect->w);
+    } else if (color) {
+      for (int16_t i = 0; i < rect->w; i++) p[i] |= mask;
+    } else {
+      for (int16_t i = 0; i < rect->w; i++) p[i] &= ~mask;
+    }
+  }
+}
+
 /**
  * @brief Primitive draw fast vertical line
  * @param handle Graphic context handle
@@ -109,9 +140,7 @@ void gc_prim_1bit_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
  */
 void gc_prim_1bit_draw_vline(gc_handle_t *handle, int16_t x, int16_t y,
                              int16_t h, uint16_t color) {
-  for (int16_t i = y; i < y + h; i++) {
-    gc_prim_1bit_set_pixel(handle, x, i, color);
-  }
+  gc_prim_1bit_fill_rect(handle, x, y, 1, h, color);
 }
 
 /**
@@ -124,9 +153,7 @@ void gc_prim_1bit_draw_vline(gc_handle_t *handle, int16_t x, int16_t y,
  */
 void gc_prim_1bit_draw_hline(gc_handle_t *handle, int16_t x, int16_t y,
                              int16_t w, uint16_t color) {
-  for (int16_t i = x; i < x + w; i++) {
-    gc_prim_1bit_set_pixel(handle, i, y, color);
-  }
+  gc_prim_1bit_fill_rect(handle, x, y, w, 1, color);
 }
 
 /**
@@ -140,8 +167,9 @@ void gc_prim_1bit_draw_hline(gc_handle_t *handle, int16_t x, int16_t y,
  */
 void gc_prim_1bit_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
                             int16_t w, int16_t h, uint16_t color) {
-  for (int16_t i = x; i < x + w; i++) {
-    gc_prim_1bit_draw_vline(handle, i, y, h, color);
+  gc_rect_t rect;
+  if (gc_clip_to_device(handle, x, y, w, h, &rect)) {
+    gc_prim_1bit_fill_device_rect(handle, &rect, color);
   }
 }
 
@@ -151,11 +179,5 @@ void gc_prim_1bit_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
  * @param color
  */
 void gc_prim_1bit_fill_screen(gc_handle_t *handle, uint16_t color) {
-  for (int i = 0; i < handle->buffer_size; i++) {
-    if (color) {
-      handle->buffer[i] = 255;
-    } else {
-      handle->buffer[i] = 0;
-    }
-  }
+  gc_prim_1bit_fill_device_rect(handle, &handle->clip, color);
 }
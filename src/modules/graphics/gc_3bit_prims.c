@@ -93,7 +93,9 @@ void gc_prim_3bit_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
-    uint32_t idx = ((y * handle->device_width) + x) / 2;
+    if (!GC_CLIP_CONTAINS(handle, x, y)) return;
+    uint32_t idx =
+        ((uint32_t)(y - handle->buffer_y) * handle->device_width + x) / 2;
     uint8_t convertedColor = color_to_3bit(color);
     bool highPixel = ((x & 1) != 0);
     uint8_t pixel = handle->buffer[idx] & (highPixel ? 0xF8 : 0xC7);
@@ -130,7 +132,12 @@ void gc_prim_3bit_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
-    uint32_t idx = ((y * handle->device_width) + x) / 2;
+    if (!GC_CLIP_CONTAINS(handle, x, y)) {
+      *color = 0;
+      return;
+    }
+    uint32_t idx =
+        ((uint32_t)(y - handle->buffer_y) * handle->device_width + x) / 2;
 
     
     if ((x & 1) != 0) {
@@ -145,6 +152,38 @@ void gc_prim_3bit_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
   return;
 }
 
+/**
+ * @brief Fill a rectangle in device coordinates. Pixel pairs inside a row
+ * are filled with memset; an odd pixel at either end is masked in.
+ * @param handle Graphic context handle
+ * @param rect
+ * @param color
+ */
+static void gc_prim_3bit_fill_device_rect(gc_handle_t *handle,
+                                          const gc_rect_t *rect,
+                                          uint16_t color) {
+  uint8_t c = color_to_3bit(color);
+  uint8_t fill = c | (c << 3);
+  for (int16_t y = rect->y; y < rect->y + rect->h; y++) {
+    uint32_t row = (uint32_t)(y - handle->buffer_y) * handle->device_width;
+    int16_t xs = rect->x;
+    int16_t xe = rect->x + rect->w;
+    if (xs & 1) {  // low bits of a pair
+      uint8_t *p = handle->buffer + (row + xs) / 2;
+      *p = (*p & 0xF8) | c;
+      xs++;
+    }
+    if ((xe & 1) && xe > xs) {  // high bits of a pair
+      xe--;
+      uint8_t *p = handle->buffer + (row + xe) / 2;
+      *p = (*p & 0xC7) | (c << 3);
+    }
+    if (xe > xs) {
+      memset(handle->buffer + (row + xs) / 2, fill, (xe - xs) / 2);
+    }
+  }
+}
+
 /**
  * @brief Primitive draw fast vertical line
  * @param handle Graphic context handle
@@ -155,9 +194,7 @@ void gc_prim_3bit_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
  */
 void gc_prim_3bit_draw_vline(gc_handle_t *handle, int16_t x, int16_t y,
                              int16_t h, uint16_t color) {
-  for (int16_t i = y; i < y + h; i++) {
-    gc_prim_3bit_set_pixel(handle, x, i, color);
-  }
+  gc_prim_3bit_fill_rect(handle, x, y, 1, h, color);
 }
 
 /**
@@ -170,9 +207,7 @@ void gc_prim_3bit_draw_vline(gc_handle_t *handle, int16_t x, int16_t y,
  */
 void gc_prim_3bit_draw_hline(gc_handle_t *handle, int16_t x, int16_t y,
                              int16_t w, uint16_t color) {
-  for (int16_t i = x; i < x + w; i++) {
-    gc_prim_3bit_set_pixel(handle, i, y, color);
-  }
+  gc_prim_3bit_fill_rect(handle, x, y, w, 1, color);
 }
 
 /**
@@ -186,8 +221,9 @@ void gc_prim_3bit_draw_hline(gc_handle_t *handle, int16_t x, int16_t y,
  */
 void gc_prim_3bit_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
                             int16_t w, int16_t h, uint16_t color) {
-  for (int16_t i = x; i < x + w; i++) {
-    gc_prim_3bit_draw_vline(handle, i, y, h, color);
+  gc_rect_t rect;
+  if (gc_clip_to_device(handle, x, y, w, h, &rect)) {
+    gc_prim_3bit_fill_device_rect(handle, &rect, color);
   }
 }
 
@@ -197,14 +233,5 @@ void gc_prim_3bit_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
  * @param color
  */
 void gc_prim_3bit_fill_screen(gc_handle_t *handle, uint16_t color) {
-
-  uint8_t tempColor = color_to_3bit(color);
-  uint8_t fillColor = (tempColor) | ((tempColor) << 3);
-  for (int16_t y = 0; y < handle->device_height; y++) {
-    uint32_t idx = (y * handle->device_width) / 2;
-    for (int16_t x = 0; x < (handle->device_width/2); x++) {
-      handle->buffer[idx + x] = fillColor;
-    }
-  }
-
+  gc_prim_3bit_fill_device_rect(handle, &handle->clip, color);
 }
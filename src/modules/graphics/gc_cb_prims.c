@@ -34,6 +34,22 @@
  * Graphic primitive functions for callback javascript functions
  */
 
+static void gc_prim_cb_call_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
+                                      uint16_t color) {
+  jerry_value_t this_val = jerry_create_undefined();
+  jerry_value_t arg_x = jerry_create_number(x);
+  jerry_value_t arg_y = jerry_create_number(y);
+  jerry_value_t arg_color = jerry_create_number(color);
+  jerry_value_t args[] = {arg_x, arg_y, arg_color};
+  jerry_value_t ret_val =
+      jerry_call_function(handle->set_pixel_js_cb, this_val, args, 3);
+  jerry_release_value(ret_val);
+  jerry_release_value(arg_x);
+  jerry_release_value(arg_y);
+  jerry_release_value(arg_color);
+  jerry_release_value(this_val);
+}
+
 void gc_prim_cb_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
                           uint16_t color) {
   if ((x >= 0) && (x < handle->width) && (y >= 0) && (y < handle->height)) {
@@ -51,19 +67,9 @@ void gc_prim_cb_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
         y = handle->device_height - y - 1;
         break;
     }
+    if (!GC_CLIP_CONTAINS(handle, x, y)) return;
     if (jerry_value_is_function(handle->set_pixel_js_cb)) {
-      jerry_value_t this_val = jerry_create_undefined();
-      jerry_value_t arg_x = jerry_create_number(x);
-      jerry_value_t arg_y = jerry_create_number(y);
-      jerry_value_t arg_color = jerry_create_number(color);
-      jerry_value_t args[] = {arg_x, arg_y, arg_color};
-      jerry_value_t ret_val =
-          jerry_call_function(handle->set_pixel_js_cb, this_val, args, 3);
-      jerry_release_value(ret_val);
-      jerry_release_value(arg_x);
-      jerry_release_value(arg_y);
-      jerry_release_value(arg_color);
-      jerry_release_value(this_val);
+      gc_prim_cb_call_set_pixel(handle, x, y, color);
     }
   }
 }
@@ -115,53 +121,15 @@ void gc_prim_cb_draw_hline(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
 
 void gc_prim_cb_fill_rect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
                           int16_t h, uint16_t color) {
-  int16_t x1 = x;
-  int16_t y1 = y;
-  int16_t x2 = x + w - 1;
-  int16_t y2 = y + h - 1;
-  // rotate
-  switch (handle->rotation) {
-    case 1:
-      SWAP_INT16(x1, y1)
-      SWAP_INT16(x2, y2)
-      x1 = handle->device_width - x1 - 1;
-      x2 = handle->device_width - x2 - 1;
-      break;
-    case 2:
-      x1 = handle->device_width - x1 - 1;
-      y1 = handle->device_height - y1 - 1;
-      x2 = handle->device_width - x2 - 1;
-      y2 = handle->device_height - y2 - 1;
-      break;
-    case 3:
-      SWAP_INT16(x1, y1)
-      SWAP_INT16(x2, y2)
-      y1 = handle->device_height - y1 - 1;
-      y2 = handle->device_height - y2 - 1;
-      break;
-  }
-  if (x1 > x2) {
-    SWAP_INT16(x1, x2)
-  }
-  if (y1 > y2) {
-    SWAP_INT16(y1, y2)
-  }
-  // clipping
-  if (x1 < 0) x1 = 0;
-  if (x1 >= handle->device_width) x1 = handle->device_width - 1;
-  if (y1 < 0) y1 = 0;
-  if (y1 >= handle->device_height) y1 = handle->device_height - 1;
-  if (x2 < 0) x2 = 0;
-  if (x2 >= handle->device_width) x2 = handle->device_width - 1;
-  if (y2 < 0) y2 = 0;
-  if (y2 >= handle->device_height) y2 = handle->device_height - 1;
+  gc_rect_t rect;
+  if (!gc_clip_to_device(handle, x, y, w, h, &rect)) return;
   // draw
   if (jerry_value_is_function(handle->fill_rect_js_cb)) {
     jerry_value_t this_val = jerry_create_undefined();
-    jerry_value_t arg_x = jerry_create_number(x1);
-    jerry_value_t arg_y = jerry_create_number(y1);
-    jerry_value_t arg_w = jerry_create_number(x2 - x1 + 1);
-    jerry_value_t arg_h = jerry_create_number(y2 - y1 + 1);
+    jerry_value_t arg_x = jerry_create_number(rect.x);
+    jerry_value_t arg_y = jerry_create_number(rect.y);
+    jerry_value_t arg_w = jerry_create_number(rect.w);
+    jerry_value_t arg_h = jerry_create_number(rect.h);
     jerry_value_t arg_color = jerry_create_number(color);
     jerry_value_t args[] = {arg_x, arg_y, arg_w, arg_h, arg_color};
     jerry_value_t ret_val =
@@ -173,10 +141,18 @@ void gc_prim_cb_fill_rect(gc_handle_t *handle, int16_t x, int16_t y, int16_t w,
     jerry_release_value(arg_h);
     jerry_release_value(arg_color);
     jerry_release_value(this_val);
+  } else if (jerry_value_is_function(handle->set_pixel_js_cb)) {
+    // fillRect callback is optional: lines, text and bitmaps end up here
+    for (int16_t py = rect.y; py < rect.y + rect.h; py++) {
+      for (int16_t px = rect.x; px < rect.x + rect.w; px++) {
+        gc_prim_cb_call_set_pixel(handle, px, py, color);
+      }
+    }
   }
 }
 
 void gc_prim_cb_fill_screen(gc_handle_t *handle, uint16_t color) {
-  gc_prim_cb_fill_rect(handle, 0, 0, handle->device_width,
-                       handle->device_height, color);
+  gc_rect_t clip;
+  gc_get_logical_clip(handle, &clip);
+  gc_prim_cb_fill_rect(handle, clip.x, clip.y, clip.w, clip.h, color);
 }
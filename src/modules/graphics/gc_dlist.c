@@ -0,0 +1,374 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gc_dlist.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+#include "font.h"
+#include "gc.h"
+
+#define GC_DLIST_INITIAL_CAPACITY 64
+#define GC_DLIST_MAX_ARGS 11
+#define GC_DLIST_REF_LOOKBACK 8  // recent refs searched for a pinned buffer
+#define GC_DLIST_MAX_CLIP_DEPTH 8
+
+/* number of 16-bit arguments of each opcode */
+static const uint8_t gc_dlist_argc[GC_OP_COUNT] = {
+    [GC_OP_COLOR] = 1,          [GC_OP_FILL_COLOR] = 1,
+    [GC_OP_FONT_COLOR] = 1,     [GC_OP_FONT] = 1,
+    [GC_OP_FONT_SCALE] = 2,     [GC_OP_ROTATION] = 1,
+    [GC_OP_FILL_SCREEN] = 1,    [GC_OP_PIXEL] = 3,
+    [GC_OP_LINE] = 4,           [GC_OP_RECT] = 4,
+    [GC_OP_FILL_RECT] = 4,      [GC_OP_CIRCLE] = 3,
+    [GC_OP_FILL_CIRCLE] = 3,    [GC_OP_ROUNDRECT] = 5,
+    [GC_OP_FILL_ROUNDRECT] = 5, [GC_OP_TEXT] = 3,
+    [GC_OP_BITMAP] = 10,        [GC_OP_CLIP] = 4,
+    [GC_OP_BITMAP_REF] = 11};
+
+void gc_dlist_init(gc_dlist_t *dlist) {
+  dlist->data = NULL;
+  dlist->length = 0;
+  dlist->capacity = 0;
+  dlist->limit = 0;
+  dlist->failed = false;
+  dlist->pin = false;
+  dlist->refs = NULL;
+  dlist->ref_count = 0;
+  dlist->ref_capacity = 0;
+}
+
+static void gc_dlist_release_refs(gc_dlist_t *dlist) {
+  for (uint16_t i = 0; i < dlist->ref_count; i++) {
+    jerry_release_value(dlist->refs[i].value);
+  }
+  dlist->ref_count = 0;
+}
+
+void gc_dlist_free(gc_dlist_t *dlist) {
+  gc_dlist_release_refs(dlist);
+  free(dlist->refs);
+  free(dlist->data);
+  gc_dlist_init(dlist);
+}
+
+/**
+ * Make room for n more bytes. Sets the failed flag if out of memory.
+ */
+static bool gc_dlist_reserve(gc_dlist_t *dlist, uint32_t n) {
+  if (dlist->failed) return false;
+  if (dlist->limit > 0 && dlist->length + n > dlist->limit) {
+    dlist->failed = true;
+    return false;
+  }
+  if (dlist->length + n <= dlist->capacity) return true;
+  uint32_t capacity = dlist->capacity ? dlist->capacity
+                                      : GC_DLIST_INITIAL_CAPACITY;
+  while (capacity < dlist->length + n) {
+    capacity *= 2;
+  }
+  uint8_t *data = (uint8_t *)realloc(dlist->data, capacity);
+  if (data == NULL) {
+    dlist->failed = true;
+    return false;
+  }
+  dlist->data = data;
+  dlist->capacity = capacity;
+  return true;
+}
+
+/**
+ * Append a command: opcode and argc 16-bit arguments (passed as int)
+ */
+void gc_dlist_put(gc_dlist_t *dlist, uint8_t op, uint8_t argc, ...) {
+  if (!gc_dlist_reserve(dlist, 1 + argc * 2)) return;
+  uint8_t *p = dlist->data + dlist->length;
+  *p++ = op;
+  va_list ap;
+  va_start(ap, argc);
+  for (uint8_t i = 0; i < argc; i++) {
+    uint16_t v = (uint16_t)va_arg(ap, int);
+    *p++ = v & 0xFF;
+    *p++ = v >> 8;
+  }
+  va_end(ap);
+  dlist->length += 1 + argc * 2;
+}
+
+/**
+ * Append the payload of a text or bitmap command
+ */
+void gc_dlist_put_bytes(gc_dlist_t *dlist, const uint8_t *bytes,
+                        uint32_t length) {
+  if (!gc_dlist_reserve(dlist, length)) return;
+  memcpy(dlist->data + dlist->length, bytes, length);
+  dlist->length += length;
+}
+
+/**
+ * Clear the list and record the current drawing state, so that replaying
+ * the list from the start reproduces it.
+ */
+void gc_dlist_begin(gc_dlist_t *dlist, gc_handle_t *handle) {
+  dlist->length = 0;
+  dlist->failed = false;
+  gc_dlist_release_refs(dlist);
+  gc_dlist_put_state(dlist, handle);
+}
+
+/**
+ * Record the current drawing state
+ */
+void gc_dlist_put_state(gc_dlist_t *dlist, gc_handle_t *handle) {
+  gc_dlist_put(dlist, GC_OP_ROTATION, 1, handle->rotation);
+  gc_dlist_put(dlist, GC_OP_COLOR, 1, handle->color);
+  gc_dlist_put(dlist, GC_OP_FILL_COLOR, 1, handle->fill_color);
+  gc_dlist_put(dlist, GC_OP_FONT_COLOR, 1, handle->font_color);
+  gc_dlist_put(dlist, GC_OP_FONT, 1, handle->font != NULL);
+  gc_dlist_put(dlist, GC_OP_FONT_SCALE, 2, handle->font_scale_x,
+               handle->font_scale_y);
+}
+
+/**
+ * Keep a buffer alive while the list references it. Does nothing unless the
+ * list pins bitmaps; the bitmap is then copied when it is recorded.
+ */
+void gc_dlist_pin(gc_dlist_t *dlist, jerry_value_t value,
+                  const uint8_t *data) {
+  if (!dlist->pin || dlist->failed || gc_dlist_find_ref(dlist, data) >= 0) {
+    return;
+  }
+  if (dlist->ref_count == dlist->ref_capacity) {
+    if (dlist->ref_capacity == UINT16_MAX) return;
+    uint32_t capacity = dlist->ref_capacity ? dlist->ref_capacity * 2 : 4;
+    capacity = MIN(capacity, UINT16_MAX);
+    gc_dlist_ref_t *refs = (gc_dlist_ref_t *)realloc(
+        dlist->refs, capacity * sizeof(gc_dlist_ref_t));
+    if (refs == NULL) return;
+    dlist->refs = refs;
+    dlist->ref_capacity = capacity;
+  }
+  dlist->refs[dlist->ref_count].value = jerry_acquire_value(value);
+  dlist->refs[dlist->ref_count].data = data;
+  dlist->ref_count++;
+}
+
+/**
+ * Return the index of a recently pinned buffer, or -1
+ */
+int32_t gc_dlist_find_ref(gc_dlist_t *dlist, const uint8_t *data) {
+  uint16_t end = dlist->ref_count > GC_DLIST_REF_LOOKBACK
+                     ? dlist->ref_count - GC_DLIST_REF_LOOKBACK
+                     : 0;
+  for (int32_t i = dlist->ref_count - 1; i >= end; i--) {
+    if (dlist->refs[i].data == data) return i;
+  }
+  return -1;
+}
+
+/**
+ * Size in bytes of a bitmap recorded by GC_OP_BITMAP
+ */
+uint32_t gc_dlist_bitmap_size(int16_t w, int16_t h, uint8_t bpp) {
+  if (w <= 0 || h <= 0) return 0;
+  if (bpp == 1) return (uint32_t)((w + 7) / 8) * h;
+  if (bpp == 16) return (uint32_t)w * h * 2;
+  return 0;
+}
+
+/**
+ * Decode the command at data[*pos] into op and args and advance *pos past
+ * its arguments.
+ * @return the number of payload bytes following the arguments, or -1 if
+ * the command is malformed or truncated
+ */
+static int32_t gc_dlist_decode(const uint8_t *data, uint32_t length,
+                               uint32_t *pos, uint8_t *op, int16_t *a) {
+  *op = data[(*pos)++];
+  if (*op == 0 || *op >= GC_OP_COUNT ||
+      *pos + gc_dlist_argc[*op] * 2 > length) {
+    return -1;
+  }
+  for (uint8_t i = 0; i < gc_dlist_argc[*op]; i++, *pos += 2) {
+    a[i] = (int16_t)(data[*pos] | data[*pos + 1] << 8);
+  }
+  uint32_t n = 0;
+  if (*op == GC_OP_TEXT) {
+    n = (uint16_t)a[2];
+  } else if (*op == GC_OP_BITMAP) {
+    n = gc_dlist_bitmap_size(a[2], a[3], a[4]);
+  }
+  return (*pos + n > length) ? -1 : (int32_t)n;
+}
+
+/**
+ * Check that a display list is well formed
+ * @return 0 if so, EINVAL otherwise
+ */
+int gc_dlist_check(const uint8_t *data, uint32_t length) {
+  uint32_t pos = 0;
+  uint8_t op;
+  int16_t a[GC_DLIST_MAX_ARGS];
+  uint8_t depth = 0;
+  while (pos < length) {
+    int32_t n = gc_dlist_decode(data, length, &pos, &op, a);
+    if (n < 0) return EINVAL;
+    if (op == GC_OP_BITMAP_REF) {
+      return EINVAL;  // refs are only valid in the list that pinned them
+    }
+    if (op == GC_OP_CLIP) {
+      if (a[2] >= 0) {
+        if (depth == GC_DLIST_MAX_CLIP_DEPTH) return EINVAL;
+        depth++;
+      } else {
+        if (depth == 0) return EINVAL;
+        depth--;
+      }
+    }
+    pos += n;
+  }
+  return depth == 0 ? 0 : EINVAL;
+}
+
+/**
+ * Draw the commands of a display list. Recording is suspended while
+ * replaying, and the clip rect is restored afterwards. Clips nest: a set
+ * intersects with the current clip and a reset pops the enclosing one.
+ * @return 0 on success, EINVAL if the list is malformed (the commands
+ * before the malformed one are drawn, so check it first)
+ */
+int gc_dlist_replay(gc_handle_t *handle, const uint8_t *data,
+                    uint32_t length) {
+  gc_dlist_t *dlist = handle->dlist;
+  gc_rect_t clip = handle->clip;
+  gc_rect_t clip_stack[GC_DLIST_MAX_CLIP_DEPTH];
+  uint8_t depth = 0;
+  handle->dlist = NULL;
+  int ret = 0;
+  uint32_t pos = 0;
+  uint8_t op;
+  int16_t a[GC_DLIST_MAX_ARGS];
+  while (pos < length) {
+    int32_t n = gc_dlist_decode(data, length, &pos, &op, a);
+    if (n < 0) {
+      ret = EINVAL;
+      break;
+    }
+    switch (op) {
+      case GC_OP_COLOR:
+        gc_set_color(handle, a[0]);
+        break;
+      case GC_OP_FILL_COLOR:
+        gc_set_fill_color(handle, a[0]);
+        break;
+      case GC_OP_FONT_COLOR:
+        gc_set_font_color(handle, a[0]);
+        break;
+      case GC_OP_FONT:
+        gc_set_font(handle, a[0] ? &custom_font : NULL);
+        break;
+      case GC_OP_FONT_SCALE:
+        gc_set_font_scale(handle, a[0], a[1]);
+        break;
+      case GC_OP_ROTATION:
+        gc_set_rotation(handle, a[0]);
+        break;
+      case GC_OP_FILL_SCREEN:
+        gc_fill_screen(handle, a[0]);
+        break;
+      case GC_OP_PIXEL:
+        gc_set_pixel(handle, a[0], a[1], a[2]);
+        break;
+      case GC_OP_LINE:
+        gc_draw_line(handle, a[0], a[1], a[2], a[3]);
+        break;
+      case GC_OP_RECT:
+        gc_draw_rect(handle, a[0], a[1], a[2], a[3]);
+        break;
+      case GC_OP_FILL_RECT:
+        gc_fill_rect(handle, a[0], a[1], a[2], a[3]);
+        break;
+      case GC_OP_CIRCLE:
+        gc_draw_circle(handle, a[0], a[1], a[2]);
+        break;
+      case GC_OP_FILL_CIRCLE:
+        gc_fill_circle(handle, a[0], a[1], a[2]);
+        break;
+      case GC_OP_ROUNDRECT:
+        gc_draw_roundrect(handle, a[0], a[1], a[2], a[3], a[4]);
+        break;
+      case GC_OP_FILL_ROUNDRECT:
+        gc_fill_roundrect(handle, a[0], a[1], a[2], a[3], a[4]);
+        break;
+      case GC_OP_TEXT:
+        gc_draw_text_n(handle, a[0], a[1], (const char *)data + pos, n);
+        break;
+      case GC_OP_BITMAP:
+      case GC_OP_BITMAP_REF: {
+        const uint8_t *bitmap = data + pos;
+        if (op == GC_OP_BITMAP_REF) {
+          uint16_t ref = a[10];
+          if (dlist == NULL || ref >= dlist->ref_count) {
+            ret = EINVAL;
+            break;
+          }
+          bitmap = dlist->refs[ref].data;
+        }
+        uint8_t flags = a[6];
+        gc_draw_bitmap(handle, a[0], a[1], (uint8_t *)bitmap, a[2], a[3],
+                       a[4], a[5], flags & GC_DLIST_BITMAP_TRANSPARENT, a[7],
+                       a[8], a[9], flags & GC_DLIST_BITMAP_FLIP_X,
+                       flags & GC_DLIST_BITMAP_FLIP_Y);
+        break;
+      }
+      case GC_OP_CLIP: {
+        if (a[2] < 0) {
+          if (depth == 0) {
+            ret = EINVAL;
+            break;
+          }
+          handle->clip = clip_stack[--depth];
+          break;
+        }
+        if (depth == GC_DLIST_MAX_CLIP_DEPTH) {
+          ret = EINVAL;
+          break;
+        }
+        clip_stack[depth++] = handle->clip;
+        gc_rect_t rect;
+        if (!gc_clip_to_device(handle, a[0], a[1], a[2], a[3], &rect)) {
+          rect.w = 0;  // clipped out entirely
+          rect.h = 0;
+        }
+        handle->clip = rect;
+        break;
+      }
+    }
+    if (ret < 0) break;
+    pos += n;
+  }
+  handle->clip = clip;
+  handle->dlist = dlist;
+  return ret;
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __GC_DLIST_H
+#define __GC_DLIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gc.h"
+
+/**
+ * Display list opcodes. A command is an opcode byte followed by its
+ * arguments, each a 16-bit little-endian value. Text and bitmap commands
+ * are followed by their bytes.
+ */
+typedef enum {
+  GC_OP_COLOR = 1,       // color
+  GC_OP_FILL_COLOR,      // color
+  GC_OP_FONT_COLOR,      // color
+  GC_OP_FONT,            // custom (0: default font, 1: custom font)
+  GC_OP_FONT_SCALE,      // scale_x, scale_y
+  GC_OP_ROTATION,        // rotation
+  GC_OP_FILL_SCREEN,     // color
+  GC_OP_PIXEL,           // x, y, color
+  GC_OP_LINE,            // x0, y0, x1, y1
+  GC_OP_RECT,            // x, y, w, h
+  GC_OP_FILL_RECT,       // x, y, w, h
+  GC_OP_CIRCLE,          // x, y, r
+  GC_OP_FILL_CIRCLE,     // x, y, r
+  GC_OP_ROUNDRECT,       // x, y, w, h, r
+  GC_OP_FILL_ROUNDRECT,  // x, y, w, h, r
+  GC_OP_TEXT,            // x, y, length, <length bytes>
+  GC_OP_BITMAP,  // x, y, w, h, bpp, color, flags, transparent_color,
+                 // scale_x, scale_y, <bitmap bytes>
+  GC_OP_CLIP,    // x, y, w, h (w < 0: back to the enclosing clip)
+  GC_OP_BITMAP_REF,  // arguments of GC_OP_BITMAP, ref (index of a buffer
+                     // pinned by the list instead of the bitmap bytes)
+  GC_OP_COUNT
+} gc_dlist_op_t;
+
+/* GC_OP_BITMAP flags */
+#define GC_DLIST_BITMAP_TRANSPARENT 0x01
+#define GC_DLIST_BITMAP_FLIP_X 0x02
+#define GC_DLIST_BITMAP_FLIP_Y 0x04
+
+/**
+ * Buffer referenced by a display list, kept alive until the list is cleared
+ */
+typedef struct {
+  jerry_value_t value;
+  const uint8_t *data;
+} gc_dlist_ref_t;
+
+/**
+ * Growable display list. Lists of banded contexts pin the bitmaps they draw
+ * (GC_OP_BITMAP_REF) rather than copying them, so a bitmap changed before
+ * display() is drawn with its new contents.
+ */
+struct gc_dlist_s {
+  uint8_t *data;
+  uint32_t length;
+  uint32_t capacity;
+  uint32_t limit;  // max length in bytes (0: no limit)
+  bool failed;     // out of memory or over the limit while recording
+  bool pin;        // bitmaps may be pinned instead of copied
+  gc_dlist_ref_t *refs;
+  uint16_t ref_count;
+  uint16_t ref_capacity;
+};
+
+void gc_dlist_init(gc_dlist_t *dlist);
+void gc_dlist_free(gc_dlist_t *dlist);
+void gc_dlist_begin(gc_dlist_t *dlist, gc_handle_t *handle);
+void gc_dlist_put_state(gc_dlist_t *dlist, gc_handle_t *handle);
+void gc_dlist_put(gc_dlist_t *dlist, uint8_t op, uint8_t argc, ...);
+void gc_dlist_put_bytes(gc_dlist_t *dlist, const uint8_t *bytes,
+                        uint32_t length);
+void gc_dlist_pin(gc_dlist_t *dlist, jerry_value_t value,
+                  const uint8_t *data);
+int32_t gc_dlist_find_ref(gc_dlist_t *dlist, const uint8_t *data);
+uint32_t gc_dlist_bitmap_size(int16_t w, int16_t h, uint8_t bpp);
+int gc_dlist_check(const uint8_t *data, uint32_t length);
+int gc_dlist_replay(gc_handle_t *handle, const uint8_t *data,
+                    uint32_t length);
+
+#endif /* __GC_DLIST_H */
@@ -0,0 +1,98 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gc_panel_prims.h"
+
+#include <stdlib.h>
+
+#include "gc.h"
+
+/**
+ * Graphic primitive functions drawing directly on a display panel (no
+ * framebuffer). Each primitive is clipped and mapped to device coordinates
+ * once, then sent to the panel as a window fill.
+ */
+
+void gc_prim_panel_set_pixel(gc_handle_t *handle, int16_t x, int16_t y,
+                             uint16_t color) {
+  gc_prim_panel_fill_rect(handle, x, y, 1, 1, color);
+}
+
+/**
+ * Panels are write-only, so pixels read back as 0.
+ */
+void gc_prim_panel_get_pixel(gc_handle_t *handle, int16_t x, int16_t y,
+                             uint16_t *color) {
+  *color = 0;
+}
+
+void gc_prim_panel_draw_vline(gc_handle_t *handle, int16_t x, int16_t y,
+                              int16_t h, uint16_t color) {
+  gc_prim_panel_fill_rect(handle, x, y, 1, h, color);
+}
+
+void gc_prim_panel_draw_hline(gc_handle_t *handle, int16_t x, int16_t y,
+                              int16_t w, uint16_t color) {
+  gc_prim_panel_fill_rect(handle, x, y, w, 1, color);
+}
+
+void gc_prim_panel_fill_rect(gc_handle_t *handle, int16_t x, int16_t y,
+                             int16_t w, int16_t h, uint16_t color) {
+  gc_rect_t rect;
+  if (gc_clip_to_device(handle, x, y, w, h, &rect)) {
+    handle->panel->ops->fill(handle->panel, &rect, color);
+  }
+}
+
+void gc_prim_panel_fill_screen(gc_handle_t *handle, uint16_t color) {
+  handle->panel->ops->fill(handle->panel, &handle->clip, color);
+}
+
+/**
+ * Copy a 16-bit bitmap to the panel. Without rotation or transparency the
+ * clipped bitmap is written as one window; otherwise pixel by pixel.
+ */
+void gc_prim_panel_blit(gc_handle_t *handle, int16_t x, int16_t y,
+                        const uint8_t *bitmap, int16_t w, int16_t h,
+                        bool transparent, uint16_t transparent_color) {
+  gc_rect_t clip;
+  gc_get_logical_clip(handle, &clip);
+  int16_t xx0 = MAX(0, clip.x - x);
+  int16_t yy0 = MAX(0, clip.y - y);
+  int16_t xx1 = MIN(w, clip.x + clip.w - x);
+  int16_t yy1 = MIN(h, clip.y + clip.h - y);
+  if (xx0 >= xx1 || yy0 >= yy1) return;
+  if (handle->rotation == 0 && !transparent) {
+    gc_rect_t rect = {x + xx0, y + yy0, xx1 - xx0, yy1 - yy0};
+    handle->panel->ops->write(handle->panel, &rect,
+                              bitmap + ((uint32_t)yy0 * w + xx0) * 2, w * 2);
+    return;
+  }
+  for (int16_t yy = yy0; yy < yy1; yy++) {
+    const uint8_t *src = bitmap + ((uint32_t)yy * w + xx0) * 2;
+    for (int16_t xx = xx0; xx < xx1; xx++, src += 2) {
+      uint16_t color = src[0] << 8 | src[1];
+      if (!transparent || color != transparent_color) {
+        gc_prim_panel_fill_rect(handle, x + xx, y + yy, 1, 1, color);
+      }
+    }
+  }
+}
@@ -28,6 +28,9 @@
 #define MSTR_GRAPHICS_SETPIXEL_CB "__setPixel_cb"
 #define MSTR_GRAPHICS_GETPIXEL_CB "__getPixel_cb"
 #define MSTR_GRAPHICS_FILLRECT_CB "__fillRect_cb"
+#define MSTR_GRAPHICS_PANEL_REF "__panel"
+#define MSTR_GRAPHICS_X "x"
+#define MSTR_GRAPHICS_Y "y"
 #define MSTR_GRAPHICS_WIDTH "width"
 #define MSTR_GRAPHICS_HEIGHT "height"
 #define MSTR_GRAPHICS_FIRST "first"
@@ -39,6 +42,9 @@
 #define MSTR_GRAPHICS_BUFFER "buffer"
 #define MSTR_GRAPHICS_ROTATION "rotation"
 #define MSTR_GRAPHICS_BPP "bpp"
+#define MSTR_GRAPHICS_BAND_HEIGHT "bandHeight"
+#define MSTR_GRAPHICS_LIST_SIZE "listSize"
+#define MSTR_GRAPHICS_PANEL "panel"
 #define MSTR_GRAPHICS_DATA "data"
 #define MSTR_GRAPHICS_SCALE_X "scaleX"
 #define MSTR_GRAPHICS_SCALE_Y "scaleY"
@@ -71,6 +77,8 @@
 #define MSTR_GRAPHICS_DRAW_TEXT "drawText"
 #define MSTR_GRAPHICS_MEASURE_TEXT "measureText"
 #define MSTR_GRAPHICS_DRAW_BITMAP "drawBitmap"
+#define MSTR_GRAPHICS_RECORD "record"
+#define MSTR_GRAPHICS_REPLAY "replay"
 #define MSTR_GRAPHICS_DISPLAY "display"
 #define MSTR_GRAPHICS_FLIP_X "flipX"
 #define MSTR_GRAPHICS_FLIP_Y "flipY"
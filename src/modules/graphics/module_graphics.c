@@ -22,13 +22,17 @@
 #include "module_graphics.h"
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "err.h"
 #include "font.h"
 #include "gc.h"
 #include "gc_16bit_prims.h"
 #include "gc_3bit_prims.h"
 #include "gc_1bit_prims.h"
 #include "gc_cb_prims.h"
+#include "gc_dlist.h"
+#include "gc_panel_prims.h"
 #include "graphics_magic_strings.h"
 #include "jerryscript.h"
 #include "jerryxx.h"
@@ -36,11 +40,49 @@
 
 gc_font_t custom_font;
 
-static void gc_handle_freecb(void *handle) { free(handle); }
+static void gc_handle_freecb(void *ptr) {
+  gc_handle_t *handle = (gc_handle_t *)ptr;
+  if (handle->dlist != NULL) {
+    gc_dlist_free(handle->dlist);
+    free(handle->dlist);
+  }
+  free(handle);
+}
 
 static const jerry_object_native_info_t gc_handle_info = {.free_cb =
                                                               gc_handle_freecb};
 
+static void gc_panel_freecb(void *ptr) {
+  gc_panel_t *panel = (gc_panel_t *)ptr;
+  if (panel->ops->free != NULL) {
+    panel->ops->free(panel);
+  } else {
+    free(panel);
+  }
+}
+
+const jerry_object_native_info_t gc_panel_native_info = {.free_cb =
+                                                             gc_panel_freecb};
+
+/**
+ * Get the native display panel given in options.panel (NULL if none). The
+ * panel object is kept referenced from `this` for the context's lifetime.
+ */
+static gc_panel_t *gc_get_panel(jerry_value_t this_val,
+                                jerry_value_t options) {
+  void *panel = NULL;
+  jerry_value_t panel_obj = jerryxx_get_property(options, MSTR_GRAPHICS_PANEL);
+  if (jerry_value_is_object(panel_obj) &&
+      jerry_get_object_native_pointer(panel_obj, &panel,
+                                      &gc_panel_native_info)) {
+    jerryxx_set_property(this_val, MSTR_GRAPHICS_PANEL_REF, panel_obj);
+  } else {
+    panel = NULL;
+  }
+  jerry_release_value(panel_obj);
+  return (gc_panel_t *)panel;
+}
+
 /* ************************************************************************** */
 /*                            GRAPHIC CONTEXT CLASS                           */
 /* ************************************************************************** */
@@ -61,11 +103,19 @@ JERRYXX_FUN(gc_ctor_fn) {
   gc_handle->font_color = 1;
   gc_handle->font_scale_x = 1;
   gc_handle->font_scale_y = 1;
+  gc_handle->buffer = NULL;
+  gc_handle->buffer_y = 0;
+  gc_handle->dirty_count = 0;
+  gc_handle->panel = NULL;
+  gc_handle->dlist = NULL;
+  gc_handle->band_height = 0;
   jerry_set_object_native_pointer(this_val, gc_handle, &gc_handle_info);
 
   // read parameters
   gc_handle->device_width = (int16_t)JERRYXX_GET_ARG_NUMBER(0);
   gc_handle->device_height = (int16_t)JERRYXX_GET_ARG_NUMBER(1);
+  gc_set_rotation(gc_handle, 0);
+  gc_reset_clip(gc_handle);
 
   if (JERRYXX_HAS_ARG(2)) {
     jerry_value_t options = JERRYXX_GET_ARG(2);
@@ -75,6 +125,14 @@ JERRYXX_FUN(gc_ctor_fn) {
           options, MSTR_GRAPHICS_ROTATION, 0);
       gc_set_rotation(gc_handle, rotation);
 
+      // native display panel
+      gc_handle->panel = gc_get_panel(JERRYXX_GET_THIS, options);
+      if (gc_handle->panel != NULL && gc_handle->panel->ops->fill == NULL) {
+        return jerry_create_error(
+            JERRY_ERROR_TYPE,
+            (const jerry_char_t *)"panel does not support direct drawing.");
+      }
+
       // setPixel callback
       jerry_value_t set_pixel_js_cb =
           jerryxx_get_property(options, MSTR_GRAPHICS_SET_PIXEL);
@@ -105,12 +163,24 @@ JERRYXX_FUN(gc_ctor_fn) {
   }
 
   // setup primitive functions
-  gc_handle->set_pixel_cb = gc_prim_cb_set_pixel;
-  gc_handle->get_pixel_cb = gc_prim_cb_get_pixel;
-  gc_handle->draw_hline_cb = gc_prim_cb_draw_hline;
-  gc_handle->draw_vline_cb = gc_prim_cb_draw_vline;
-  gc_handle->fill_rect_cb = gc_prim_cb_fill_rect;
-  gc_handle->fill_screen_cb = gc_prim_cb_fill_screen;
+  if (gc_handle->panel != NULL) {
+    gc_handle->set_pixel_cb = gc_prim_panel_set_pixel;
+    gc_handle->get_pixel_cb = gc_prim_panel_get_pixel;
+    gc_handle->draw_hline_cb = gc_prim_panel_draw_hline;
+    gc_handle->draw_vline_cb = gc_prim_panel_draw_vline;
+    gc_handle->fill_rect_cb = gc_prim_panel_fill_rect;
+    gc_handle->fill_screen_cb = gc_prim_panel_fill_screen;
+    gc_handle->blit16_cb =
+        gc_handle->panel->ops->write != NULL ? gc_prim_panel_blit : NULL;
+  } else {
+    gc_handle->set_pixel_cb = gc_prim_cb_set_pixel;
+    gc_handle->get_pixel_cb = gc_prim_cb_get_pixel;
+    gc_handle->draw_hline_cb = gc_prim_cb_draw_hline;
+    gc_handle->draw_vline_cb = gc_prim_cb_draw_vline;
+    gc_handle->fill_rect_cb = gc_prim_cb_fill_rect;
+    gc_handle->fill_screen_cb = gc_prim_cb_fill_screen;
+    gc_handle->blit16_cb = NULL;
+  }
 
   return jerry_create_undefined();
 }
@@ -567,6 +637,9 @@ JERRYXX_FUN(gc_draw_bitmap_fn) {
         jerry_value_t buffer =
             jerry_get_typedarray_buffer(data, &byteOffset, &byteLength);
         uint8_t *buf = jerry_get_arraybuffer_pointer(buffer);
+        if (gc_handle->dlist != NULL) {
+          gc_dlist_pin(gc_handle->dlist, data, buf);
+        }
         gc_draw_bitmap(gc_handle, x, y, buf, w, h, bpp, color, transparent,
                        transparent_color, scale_x, scale_y, flip_x, flip_y);
         jerry_release_value(buffer);
@@ -581,6 +654,9 @@ JERRYXX_FUN(gc_draw_bitmap_fn) {
         jerry_value_t buffer =
             jerry_get_typedarray_buffer(decoded, &byteOffset, &byteLength);
         uint8_t *buf = jerry_get_arraybuffer_pointer(buffer);
+        if (gc_handle->dlist != NULL) {
+          gc_dlist_pin(gc_handle->dlist, decoded, buf);
+        }
         gc_draw_bitmap(gc_handle, x, y, buf, w, h, bpp, color, transparent,
                        transparent_color, scale_x, scale_y, flip_x, flip_y);
         jerry_release_value(buffer);
@@ -599,18 +675,301 @@ JERRYXX_FUN(gc_draw_bitmap_fn) {
   return jerry_create_undefined();
 }
 
+/**
+ * GraphicsContext.prototype.record(callback)
+ * Call `callback(gc)` and return the draw calls it made as a display list
+ * (Uint8Array) instead of drawing them. The drawing state is restored
+ * afterwards. See gc_dlist.h for the format: an opcode byte followed by
+ * 16-bit little-endian arguments, so coordinates and colors can be
+ * patched in place before replay().
+ */
+JERRYXX_FUN(gc_record_fn) {
+  JERRYXX_CHECK_ARG_FUNCTION(0, "callback")
+  jerry_value_t callback = JERRYXX_GET_ARG(0);
+  JERRYXX_GET_NATIVE_HANDLE(gc_handle, gc_handle_t, gc_handle_info);
+  gc_state_t state;
+  gc_save_state(gc_handle, &state);
+  gc_dlist_t *outer = gc_handle->dlist;
+  gc_dlist_t dlist;
+  gc_dlist_init(&dlist);
+  gc_handle->dlist = &dlist;
+  jerry_value_t args[] = {JERRYXX_GET_THIS};
+  jerry_value_t ret = jerry_call_function(callback, JERRYXX_GET_THIS, args, 1);
+  gc_handle->dlist = NULL;
+  gc_restore_state(gc_handle, &state);
+  gc_handle->dlist = outer;
+  if (jerry_value_is_error(ret)) {
+    gc_dlist_free(&dlist);
+    return ret;
+  }
+  jerry_release_value(ret);
+  if (dlist.failed) {
+    gc_dlist_free(&dlist);
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  jerry_value_t list =
+      jerry_create_typedarray(JERRY_TYPEDARRAY_UINT8, dlist.length);
+  jerry_length_t byteOffset = 0;
+  jerry_length_t byteLength = 0;
+  jerry_value_t arrbuf =
+      jerry_get_typedarray_buffer(list, &byteOffset, &byteLength);
+  if (dlist.length > 0) {
+    memcpy(jerry_get_arraybuffer_pointer(arrbuf) + byteOffset, dlist.data,
+           dlist.length);
+  }
+  jerry_release_value(arrbuf);
+  gc_dlist_free(&dlist);
+  return list;
+}
+
+/**
+ * GraphicsContext.prototype.replay(list, clip)
+ * Draw a display list made by record() in one call.
+ * - list: {Uint8Array}
+ * - clip: {x, y, width, height} optional, drawing is limited to this rect
+ * The drawing state is restored afterwards.
+ */
+JERRYXX_FUN(gc_replay_fn) {
+  JERRYXX_CHECK_ARG_TYPEDARRAY(0, "list")
+  JERRYXX_CHECK_ARG_OBJECT_OPT(1, "clip")
+  jerry_value_t list = JERRYXX_GET_ARG(0);
+  JERRYXX_GET_NATIVE_HANDLE(gc_handle, gc_handle_t, gc_handle_info);
+  bool clipped = JERRYXX_HAS_ARG(1);
+  int16_t cx = 0, cy = 0, cw = 0, ch = 0;
+  if (clipped) {
+    jerry_value_t clip = JERRYXX_GET_ARG(1);
+    cx = (int16_t)jerryxx_get_property_number(clip, MSTR_GRAPHICS_X, 0);
+    cy = (int16_t)jerryxx_get_property_number(clip, MSTR_GRAPHICS_Y, 0);
+    cw = (int16_t)jerryxx_get_property_number(clip, MSTR_GRAPHICS_WIDTH, 0);
+    ch = (int16_t)jerryxx_get_property_number(clip, MSTR_GRAPHICS_HEIGHT, 0);
+    cw = MAX(cw, 0);  // a negative width would reset the clip
+  }
+  jerry_length_t byteOffset = 0;
+  jerry_length_t byteLength = 0;
+  jerry_value_t arrbuf =
+      jerry_get_typedarray_buffer(list, &byteOffset, &byteLength);
+  const uint8_t *data = jerry_get_arraybuffer_pointer(arrbuf) + byteOffset;
+  // a malformed list draws nothing
+  int ret = gc_dlist_check(data, byteLength);
+  if (ret < 0) {
+    jerry_release_value(arrbuf);
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  gc_state_t state;
+  gc_save_state(gc_handle, &state);
+  if (gc_handle->dlist != NULL) {
+    // recording (banded context or record()): append the list, drawn later
+    gc_dlist_t *dlist = gc_handle->dlist;
+    if (clipped) gc_dlist_put(dlist, GC_OP_CLIP, 4, cx, cy, cw, ch);
+    gc_dlist_put_bytes(dlist, data, byteLength);
+    if (clipped) gc_dlist_put(dlist, GC_OP_CLIP, 4, 0, 0, -1, 0);
+    gc_dlist_put_state(dlist, gc_handle);
+  } else {
+    gc_rect_t clip = gc_handle->clip;
+    if (clipped) {
+      gc_rect_t rect;
+      if (!gc_clip_to_device(gc_handle, cx, cy, cw, ch, &rect)) {
+        rect.w = 0;  // clipped out entirely
+        rect.h = 0;
+      }
+      gc_handle->clip = rect;
+    }
+    ret = gc_dlist_replay(gc_handle, data, byteLength);
+    gc_handle->clip = clip;
+    gc_restore_state(gc_handle, &state);
+  }
+  jerry_release_value(arrbuf);
+  if (ret < 0) {
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  return jerry_create_undefined();
+}
+
+/**
+ * Create a contiguous view of a dirty rectangle's bytes. Full-width
+ * rectangles are a view into the buffer; others are packed into a copy.
+ */
+static jerry_value_t gc_create_dirty_rect_data(gc_handle_t *gc_handle,
+                                               jerry_value_t buffer,
+                                               gc_rect_t *rect) {
+  uint32_t row_bytes, rows, stride;
+  uint32_t start =
+      gc_dirty_rect_layout(gc_handle, rect, &row_bytes, &rows, &stride);
+  if (row_bytes == stride) {
+    jerry_length_t byteOffset = 0;
+    jerry_length_t byteLength = 0;
+    jerry_value_t arrbuf =
+        jerry_get_typedarray_buffer(buffer, &byteOffset, &byteLength);
+    jerry_value_t data = jerry_create_typedarray_for_arraybuffer_sz(
+        JERRY_TYPEDARRAY_UINT8, arrbuf, byteOffset + start, row_bytes * rows);
+    jerry_release_value(arrbuf);
+    return data;
+  }
+  jerry_value_t data =
+      jerry_create_typedarray(JERRY_TYPEDARRAY_UINT8, row_bytes * rows);
+  jerry_length_t byteOffset = 0;
+  jerry_length_t byteLength = 0;
+  jerry_value_t arrbuf =
+      jerry_get_typedarray_buffer(data, &byteOffset, &byteLength);
+  uint8_t *dst = jerry_get_arraybuffer_pointer(arrbuf) + byteOffset;
+  for (uint32_t i = 0; i < rows; i++) {
+    memcpy(dst + i * row_bytes, gc_handle->buffer + start + i * stride,
+           row_bytes);
+  }
+  jerry_release_value(arrbuf);
+  return data;
+}
+
+/**
+ * Create an array of { x, y, width, height, data } for the dirty rectangles
+ * (device coordinates) and clear the dirty state.
+ */
+static jerry_value_t gc_create_dirty_rects(gc_handle_t *gc_handle,
+                                           jerry_value_t buffer) {
+  jerry_value_t rects = jerry_create_array(gc_handle->dirty_count);
+  for (uint8_t i = 0; i < gc_handle->dirty_count; i++) {
+    gc_rect_t rect = gc_handle->dirty_rects[i];
+    jerry_value_t data = gc_create_dirty_rect_data(gc_handle, buffer, &rect);
+    jerry_value_t obj = jerry_create_object();
+    jerryxx_set_property_number(obj, MSTR_GRAPHICS_X, rect.x);
+    jerryxx_set_property_number(obj, MSTR_GRAPHICS_Y, rect.y);
+    jerryxx_set_property_number(obj, MSTR_GRAPHICS_WIDTH, rect.w);
+    jerryxx_set_property_number(obj, MSTR_GRAPHICS_HEIGHT, rect.h);
+    jerryxx_set_property(obj, MSTR_GRAPHICS_DATA, data);
+    jerry_release_value(jerry_set_property_by_index(rects, i, obj));
+    jerry_release_value(obj);
+    jerry_release_value(data);
+  }
+  gc_clear_dirty(gc_handle);
+  return rects;
+}
+
+/**
+ * Stream the dirty rectangles of the buffer to the native display panel and
+ * clear the dirty state.
+ */
+static jerry_value_t gc_flush_panel(gc_handle_t *gc_handle, bool full) {
+  if (full) {
+    gc_mark_dirty_all(gc_handle);
+  }
+  for (uint8_t i = 0; i < gc_handle->dirty_count; i++) {
+    gc_rect_t rect = gc_handle->dirty_rects[i];
+    uint32_t row_bytes, rows, stride;
+    // align to the buffer layout (pages, pixel pairs, full-width bands)
+    gc_dirty_rect_layout(gc_handle, &rect, &row_bytes, &rows, &stride);
+    int ret = gc_handle->panel->ops->flush(gc_handle->panel, gc_handle->buffer,
+                                           0, &rect);
+    if (ret < 0) {
+      gc_clear_dirty(gc_handle);
+      return jerry_create_error_from_value(create_system_error(ret), true);
+    }
+  }
+  gc_clear_dirty(gc_handle);
+  return jerry_create_undefined();
+}
+
+/**
+ * Render the recorded draw calls band by band into the strip buffer and
+ * send each band to the panel or to the display callback as
+ * (buffer, [{ x, y, width, height, data }]).
+ */
+static jerry_value_t gc_display_bands(gc_handle_t *gc_handle,
+                                      jerry_value_t buffer) {
+  gc_dlist_t *dlist = gc_handle->dlist;
+  if (dlist->failed) {  // some draw calls were lost
+    gc_dlist_begin(dlist, gc_handle);
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  jerry_value_t ret_val = jerry_create_undefined();
+  int16_t dh = gc_handle->device_height;
+  for (int16_t y = 0; y < dh; y += gc_handle->band_height) {
+    gc_rect_t band = {0, y, gc_handle->device_width,
+                      MIN(gc_handle->band_height, dh - y)};
+    gc_handle->buffer_y = y;
+    gc_handle->clip = band;
+    memset(gc_handle->buffer, 0, gc_handle->buffer_size);
+    int ret = gc_dlist_replay(gc_handle, dlist->data, dlist->length);
+    gc_clear_dirty(gc_handle);
+    if (ret == 0 && gc_handle->panel != NULL) {
+      ret = gc_handle->panel->ops->flush(gc_handle->panel, gc_handle->buffer,
+                                         y, &band);
+    } else if (ret == 0 && jerry_value_is_function(gc_handle->display_js_cb)) {
+      uint32_t row_bytes, rows, stride;
+      gc_rect_t rect = band;
+      gc_dirty_rect_layout(gc_handle, &rect, &row_bytes, &rows, &stride);
+      jerry_length_t byteOffset = 0;
+      jerry_length_t byteLength = 0;
+      jerry_value_t arrbuf =
+          jerry_get_typedarray_buffer(buffer, &byteOffset, &byteLength);
+      jerry_value_t data = jerry_create_typedarray_for_arraybuffer_sz(
+          JERRY_TYPEDARRAY_UINT8, arrbuf, byteOffset, row_bytes * rows);
+      jerry_release_value(arrbuf);
+      jerry_value_t obj = jerry_create_object();
+      jerryxx_set_property_number(obj, MSTR_GRAPHICS_X, band.x);
+      jerryxx_set_property_number(obj, MSTR_GRAPHICS_Y, band.y);
+      jerryxx_set_property_number(obj, MSTR_GRAPHICS_WIDTH, band.w);
+      jerryxx_set_property_number(obj, MSTR_GRAPHICS_HEIGHT, band.h);
+      jerryxx_set_property(obj, MSTR_GRAPHICS_DATA, data);
+      jerry_value_t rects = jerry_create_array(1);
+      jerry_release_value(jerry_set_property_by_index(rects, 0, obj));
+      jerry_value_t this_ = jerry_create_undefined();
+      jerry_value_t args[] = {buffer, rects};
+      jerry_release_value(ret_val);
+      ret_val = jerry_call_function(gc_handle->display_js_cb, this_, args, 2);
+      jerry_release_value(this_);
+      jerry_release_value(rects);
+      jerry_release_value(obj);
+      jerry_release_value(data);
+      if (jerry_value_is_error(ret_val)) break;
+    }
+    if (ret < 0) {
+      jerry_release_value(ret_val);
+      ret_val = jerry_create_error_from_value(create_system_error(ret), true);
+      break;
+    }
+  }
+  gc_handle->buffer_y = 0;
+  gc_handle->clip.w = 0;  // nothing is drawn outside display()
+  gc_handle->clip.h = 0;
+  return ret_val;
+}
+
 /**
  * GraphicsContext.prototype.display() function
+ * args:
+ *   full {boolean} flush the whole buffer regardless of tracked damage
+ *
+ * With a native display panel, the dirty rectangles are streamed to it.
+ * Otherwise the display callback is called with (buffer, rects). `rects` lists the
+ * regions modified since the last display() as { x, y, width, height, data }
+ * in device coordinates, where `data` holds the region's bytes contiguously
+ * (for 1-bit buffers, `y` and `height` are multiples of the 8-pixel page).
+ * A banded context renders and sends the whole screen one band at a time.
  */
 JERRYXX_FUN(gc_display_fn) {
+  JERRYXX_CHECK_ARG_BOOLEAN_OPT(0, "full");
+  bool full = JERRYXX_GET_ARG_BOOLEAN_OPT(0, false);
   JERRYXX_GET_NATIVE_HANDLE(gc_handle, gc_handle_t, gc_handle_info);
-  if (jerry_value_is_function(gc_handle->display_js_cb)) {
+  if (gc_handle->band_height > 0) {
+    jerry_value_t buffer =
+        jerryxx_get_property(JERRYXX_GET_THIS, MSTR_GRAPHICS_BUFFER);
+    jerry_value_t ret_val = gc_display_bands(gc_handle, buffer);
+    jerry_release_value(buffer);
+    return ret_val;
+  } else if (gc_handle->panel != NULL && gc_handle->buffer != NULL) {
+    return gc_flush_panel(gc_handle, full);
+  } else if (jerry_value_is_function(gc_handle->display_js_cb)) {
     jerry_value_t buffer =
         jerryxx_get_property(JERRYXX_GET_THIS, MSTR_GRAPHICS_BUFFER);
+    if (full) {
+      gc_mark_dirty_all(gc_handle);
+    }
+    jerry_value_t rects = gc_create_dirty_rects(gc_handle, buffer);
     jerry_value_t this_ = jerry_create_undefined();
-    jerry_value_t args[] = {buffer};
+    jerry_value_t args[] = {buffer, rects};
     jerry_value_t ret_val =
-        jerry_call_function(gc_handle->display_js_cb, this_, args, 1);
+        jerry_call_function(gc_handle->display_js_cb, this_, args, 2);
+    jerry_release_value(rects);
     jerry_release_value(buffer);
     jerry_release_value(this_);
     return ret_val;
@@ -625,11 +984,18 @@ JERRYXX_FUN(gc_display_fn) {
 
 /**
  * BufferedGraphicsContext() constructor
+ *
+ * With `bandHeight`, draw calls are recorded and replayed band by band on
+ * display(), so the recorded list holds everything drawn since the last
+ * fillScreen(), clearScreen() or fillRect() covering the whole screen.
+ * Redraw each frame from one of those, or the list keeps growing.
+ * `listSize` caps the list in bytes (display() throws once it is over).
  */
 JERRYXX_FUN(buffered_gc_ctor_fn) {
   JERRYXX_CHECK_ARG_NUMBER(0, "width");
   JERRYXX_CHECK_ARG_NUMBER(1, "height");
   JERRYXX_CHECK_ARG_OBJECT_OPT(2, "options");
+  uint32_t list_size = 0;
 
   // set native handle
   gc_handle_t *gc_handle = (gc_handle_t *)malloc(sizeof(gc_handle_t));
@@ -639,11 +1005,20 @@ JERRYXX_FUN(buffered_gc_ctor_fn) {
   gc_handle->font_color = 1;
   gc_handle->font_scale_x = 1;
   gc_handle->font_scale_y = 1;
+  gc_handle->bpp = 1;
+  gc_handle->buffer_y = 0;
+  gc_handle->dirty_count = 0;
+  gc_handle->display_js_cb = jerry_create_undefined();
+  gc_handle->panel = NULL;
+  gc_handle->dlist = NULL;
+  gc_handle->band_height = 0;
   jerry_set_object_native_pointer(this_val, gc_handle, &gc_handle_info);
 
   // read parameters
   gc_handle->device_width = (int16_t)JERRYXX_GET_ARG_NUMBER(0);
   gc_handle->device_height = (int16_t)JERRYXX_GET_ARG_NUMBER(1);
+  gc_set_rotation(gc_handle, 0);
+  gc_reset_clip(gc_handle);
   if (JERRYXX_HAS_ARG(2)) {
     jerry_value_t options = JERRYXX_GET_ARG(2);
     if (jerry_value_is_object(options)) {
@@ -663,6 +1038,18 @@ JERRYXX_FUN(buffered_gc_ctor_fn) {
         gc_handle->bpp = 1;
       }
 
+      // native display panel (takes a framebuffer in its own format)
+      gc_handle->panel = gc_get_panel(JERRYXX_GET_THIS, options);
+      if (gc_handle->panel != NULL) {
+        gc_handle->bpp = gc_handle->panel->bpp;
+      }
+
+      // banded rendering (rows of the strip buffer, 0 for a full buffer)
+      gc_handle->band_height = (int16_t)jerryxx_get_property_number(
+          options, MSTR_GRAPHICS_BAND_HEIGHT, 0);
+      list_size = (uint32_t)jerryxx_get_property_number(
+          options, MSTR_GRAPHICS_LIST_SIZE, 0);
+
       // display callback
       jerry_value_t display_js_cb =
           jerryxx_get_property(options, MSTR_GRAPHICS_DISPLAY);
@@ -681,6 +1068,7 @@ JERRYXX_FUN(buffered_gc_ctor_fn) {
     gc_handle->draw_vline_cb = gc_prim_1bit_draw_vline;
     gc_handle->fill_rect_cb = gc_prim_1bit_fill_rect;
     gc_handle->fill_screen_cb = gc_prim_1bit_fill_screen;
+    gc_handle->blit16_cb = NULL;
   } else if (gc_handle->bpp == 3) {
     gc_handle->set_pixel_cb = gc_prim_3bit_set_pixel;
     gc_handle->get_pixel_cb = gc_prim_3bit_get_pixel;
@@ -688,6 +1076,7 @@ JERRYXX_FUN(buffered_gc_ctor_fn) {
     gc_handle->draw_vline_cb = gc_prim_3bit_draw_vline;
     gc_handle->fill_rect_cb = gc_prim_3bit_fill_rect;
     gc_handle->fill_screen_cb = gc_prim_3bit_fill_screen;
+    gc_handle->blit16_cb = NULL;
   } else {
     gc_handle->set_pixel_cb = gc_prim_16bit_set_pixel;
     gc_handle->get_pixel_cb = gc_prim_16bit_get_pixel;
@@ -695,10 +1084,34 @@ JERRYXX_FUN(buffered_gc_ctor_fn) {
     gc_handle->draw_vline_cb = gc_prim_16bit_draw_vline;
     gc_handle->fill_rect_cb = gc_prim_16bit_fill_rect;
     gc_handle->fill_screen_cb = gc_prim_16bit_fill_screen;
+    gc_handle->blit16_cb = gc_prim_16bit_blit;
+  }
+
+  // banded: a strip of band_height rows (whole pages for 1-bit buffers)
+  // is rendered at a time by replaying the recorded draw calls
+  int16_t rows = gc_handle->device_height;
+  if (gc_handle->band_height > 0 &&
+      gc_handle->band_height < gc_handle->device_height) {
+    if (gc_handle->bpp == 1) {
+      gc_handle->band_height = MAX(8, gc_handle->band_height & ~7);
+    }
+    rows = gc_handle->band_height;
+    gc_handle->dlist = (gc_dlist_t *)malloc(sizeof(gc_dlist_t));
+    if (gc_handle->dlist == NULL) {
+      return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+    }
+    gc_dlist_init(gc_handle->dlist);
+    gc_handle->dlist->limit = list_size;
+    gc_handle->dlist->pin = true;
+    gc_dlist_begin(gc_handle->dlist, gc_handle);
+    gc_handle->clip.w = 0;  // nothing is drawn outside display()
+    gc_handle->clip.h = 0;
+  } else {
+    gc_handle->band_height = 0;
   }
 
   // allocate buffer
-  size_t size = gc_handle->device_width * gc_handle->device_height;
+  uint32_t size = (uint32_t)gc_handle->device_width * rows;
   if (gc_handle->bpp == 1) {
     size = size / 8;
   } else if (gc_handle->bpp == 3) {
@@ -714,6 +1127,9 @@ JERRYXX_FUN(buffered_gc_ctor_fn) {
       jerry_get_typedarray_buffer(buffer, &byteOffset, &byteLength);
   gc_handle->buffer = jerry_get_arraybuffer_pointer(buf);
   gc_handle->buffer_size = size;
+  if (gc_handle->dlist == NULL) {
+    gc_mark_dirty_all(gc_handle);  // the first display() flushes everything
+  }
   jerry_release_value(buf);
   jerry_release_value(buffer);
   return jerry_create_undefined();
@@ -783,6 +1199,10 @@ jerry_value_t module_graphics_init() {
                                 gc_measure_text_fn);
   jerryxx_set_property_function(gc_prototype, MSTR_GRAPHICS_DRAW_BITMAP,
                                 gc_draw_bitmap_fn);
+  jerryxx_set_property_function(gc_prototype, MSTR_GRAPHICS_RECORD,
+                                gc_record_fn);
+  jerryxx_set_property_function(gc_prototype, MSTR_GRAPHICS_REPLAY,
+                                gc_replay_fn);
   jerry_release_value(gc_prototype);
 
   /* BufferedGraphicsContext */
@@ -851,6 +1271,10 @@ jerry_value_t module_graphics_init() {
                                 MSTR_GRAPHICS_MEASURE_TEXT, gc_measure_text_fn);
   jerryxx_set_property_function(buffered_gc_prototype,
                                 MSTR_GRAPHICS_DRAW_BITMAP, gc_draw_bitmap_fn);
+  jerryxx_set_property_function(buffered_gc_prototype, MSTR_GRAPHICS_RECORD,
+                                gc_record_fn);
+  jerryxx_set_property_function(buffered_gc_prototype, MSTR_GRAPHICS_REPLAY,
+                                gc_replay_fn);
   jerryxx_set_property_function(buffered_gc_prototype, MSTR_GRAPHICS_DISPLAY,
                                 gc_display_fn);
   jerry_release_value(buffered_gc_prototype);
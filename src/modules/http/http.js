@@ -1,5 +1,6 @@
 var stream = require('stream');
 var net = require('net');
+var {HTTPParserNative} = process.binding(process.binding.http);
 
 /**
  * HTTPParser class
@@ -7,105 +8,37 @@ var net = require('net');
  */
 class HTTPParser {
   constructor(incoming) {
-    this._buf = '';
     this.incoming = incoming;
     this.incoming.socket.on('data', (chunk) => { this.push(chunk) });
     this.incoming.socket.on('end', () => { this.end() });
     this.incoming.socket.on('close', () => { this.end() });
-    this.body = '';
     this.headersComplete = false;
     this.onHeadersComplete = null;
     this.onComplete = null;
+    this._native = new HTTPParserNative();
+    this._native.onHeadersComplete = (info) => {
+      Object.assign(this.incoming, info);
+      this.headersComplete = true;
+      if (this.onHeadersComplete) this.onHeadersComplete();
+    };
+    this._native.onBody = (chunk) => { this.incoming.push(chunk) };
+    this._native.onMessageComplete = () => { this.end() };
   }
 
   /**
-   * Push a chunk of data to buffer
+   * Push a chunk of data to the parser
    * @param {Uint8Array|string} chunk
    */
   push(chunk) {
-    if (chunk instanceof Uint8Array) {
-      this._buf += String.fromCharCode.apply(null, chunk);
-    } else {
-      this._buf += chunk;
+    if (this.incoming.complete) return;
+    if (typeof chunk === 'string') {
+      chunk = new TextEncoder('ascii').encode(chunk);
     }
-    if (this.headersComplete) {
-      this.parseBody();
-    } else {
-      var idx = this._buf.indexOf('\r\n\r\n'); // end of header
-      if (idx > -1) {
-        var head = this._buf.substr(0, idx);
-        var body = this._buf.substr(idx + 4);
-        this._buf = body;
-        this.parseHead(head);
-        this.headersComplete = true;
-        if (this.onHeadersComplete) this.onHeadersComplete();
-        this.parseBody();
-      }
-    }
-  }
-
-  /**
-   * Parse HTTP header and assign to incoming message
-   * @param {string} head
-   */
-  parseHead(head) {
-    var ls = head.split('\n');
-    var lt = ls[0].split(' ');
-    if (lt[0].trim().startsWith('HTTP/')) { // http response
-      this.incoming.httpVersion = lt[0].trim().split('/')[1];
-      this.incoming.statusCode = parseInt(lt[1].trim());
-      this.incoming.statusMessage = lt[2].trim();
-    } else { // http request
-      this.incoming.method = lt[0].trim();
-      this.incoming.url = lt[1].trim();
-      this.incoming.httpVersion = lt[2].trim().split('/')[1];
-    }
-    // headers
-    for (var i = 1; i < ls.length; i++) {
-      if (ls[i].includes(':')) {
-        var ht = ls[i].split(':');
-        this.incoming.headers[ht[0].trim().toLowerCase()] = ht[1].trim();
-      }
-    }
-  }
-
-  /**
-   * Parse HTTP body
-   */
-  parseBody() {
-    if (this.incoming.headers['transfer-encoding'] === 'chunked') {
-      var quit = false;
-      while (!quit) {
-        var idx = this._buf.indexOf('\r\n');
-        if (idx > -1) {
-          var l = this._buf.substr(0, idx);
-          var cl = parseInt('0x' + l); // chunk length
-          if (cl > 0) {
-            if (this._buf.length >= idx + cl + 2) { // chunk received
-              var chunk = this._buf.substr(idx + 2, cl)
-              var encoder = new TextEncoder('ascii');
-              this.incoming.push(encoder.encode(chunk));
-              this.body += chunk;
-              this._buf = this._buf.substr(idx + 2 + cl + 2);
-            } else { // data not received yet
-              quit = true;
-            }
-          } else { // end chunk
-            quit = true;
-            this._buf = '';
-            this.end();
-          }
-        }
-      }
-    } else {
-      var len = parseInt(this.incoming.headers['Content-Length'] || '0');
-      if (this._buf.length >= len) {
-        this.body = this._buf;
-        this._buf = '';
-        var encoder = new TextEncoder('ascii');
-        this.incoming.push(encoder.encode(this.body));
-        this.end();
-      }
+    try {
+      this._native.execute(chunk);
+    } catch (err) {
+      this.incoming.emit('error', err);
+      this.end();
     }
   }
 
@@ -115,12 +48,12 @@ class HTTPParser {
    */
   end() {
     if (!this.incoming.complete) {
-      if (this._buf.length > 0) {
-        var encoder = new TextEncoder('ascii');
-        this.incoming.push(encoder.encode(this._buf));
-        this._buf = '';
-      }
       this.incoming.complete = true;
+      try {
+        this._native.finish();
+      } catch (err) {
+        this.incoming.emit('error', err);
+      }
       this.incoming._afterEnd();
       if (this.onComplete) this.onComplete();
     }
@@ -172,14 +105,20 @@ class OutgoingMessage extends stream.Writable {
   }
 
   /**
-   * Encode chunk
+   * Queue a chunk of body, framed in chunked transfer encoding if needed.
+   * Uint8Array chunks are queued as is, without copying.
    * @param {Uint8Array|string} chunk
-   * @return {string}
    */
-  _encodeChunk(chunk) {
-    if (chunk instanceof Uint8Array)
-      chunk = String.fromCharCode.apply(null, chunk);
-    return chunk.length.toString(16) + '\r\n' + chunk + '\r\n';
+  _enqueueBody(chunk) {
+    if (chunk && chunk.length > 0) {
+      if (this._isTransferChunked()) {
+        this._enqueue(chunk.length.toString(16) + '\r\n');
+        this._enqueue(chunk);
+        this._enqueue('\r\n');
+      } else {
+        this._enqueue(chunk);
+      }
+    }
   }
 
   /**
@@ -259,11 +198,12 @@ class ClientRequest extends OutgoingMessage {
       // Disable automatic chunked header - some http server do not accept it.
       // this.setHeader('transfer-encoding', 'chunked');
     }
-    this._wbuf += `${this.options.method} ${this.path} HTTP/1.1\r\n`;
+    var msg = `${this.options.method} ${this.path} HTTP/1.1\r\n`;
     for (var key in this.headers) {
-      this._wbuf += `${key}: ${this.headers[key]}\r\n`;
+      msg += `${key}: ${this.headers[key]}\r\n`;
     }
-    this._wbuf += '\r\n'; // end of header
+    msg += '\r\n'; // end of header
+    this._enqueue(msg);
   }
 
   /**
@@ -278,15 +218,7 @@ class ClientRequest extends OutgoingMessage {
       this.flushHeaders();
       this.headersSent = true;
     }
-    if (chunk) {
-      if (chunk instanceof Uint8Array)
-        chunk = String.fromCharCode.apply(null, chunk);
-      if (this._isTransferChunked()) {
-        this._wbuf += this._encodeChunk(chunk);
-      } else {
-        this._wbuf += chunk;
-      }
-    }
+    this._enqueueBody(chunk);
     if (cb) cb();
     return this;
   }
@@ -303,15 +235,7 @@ class ClientRequest extends OutgoingMessage {
       this.flushHeaders();
       this.headersSent = true;
     }
-    if (chunk) {
-      if (chunk instanceof Uint8Array)
-        chunk = String.fromCharCode.apply(null, chunk);
-      if (this._isTransferChunked()) {
-        this._wbuf += this._encodeChunk(chunk);
-      } else {
-        this._wbuf += chunk;
-      }
-    }
+    this._enqueueBody(chunk);
     this.socket.connect(this.options, () => {
       var last = (this._isTransferChunked() ? '0\r\n\r\n' : undefined); // end of body
       super.end(last, cb);
@@ -366,10 +290,8 @@ class ServerResponse extends OutgoingMessage {
     if (!this.headersSent) {
       this.writeHead(200);
     }
-    if (chunk && this._isTransferChunked()) {
-      chunk = this._encodeChunk(chunk);
-    }
-    super.write(chunk, cb);
+    this._enqueueBody(chunk);
+    super.write(undefined, cb);
     return this;
   }
 
@@ -380,14 +302,15 @@ class ServerResponse extends OutgoingMessage {
     if (!this.headersSent) {
       this.writeHead(200);
     }
+    if (typeof chunk === 'function') {
+      cb = chunk;
+      chunk = undefined;
+    }
+    this._enqueueBody(chunk);
     if (this._isTransferChunked()) {
-      if (chunk) {
-        chunk = this._encodeChunk(chunk, true) + '0\r\n\r\n'; // end of body
-      } else {
-        chunk = '0\r\n\r\n'; // end of body
-      }
+      this._enqueue('0\r\n\r\n'); // end of body
     }
-    super.end(chunk, cb);
+    super.end(undefined, cb);
     this._afterFinish();
     return this;
   }
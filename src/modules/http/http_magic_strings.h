@@ -24,15 +24,12 @@
 
 #define MSTR_HTTP_HTTP "http"
 #define MSTR_HTTP_HTTP_PARSER "HTTPParser"
-#define MSTR_HTTP__BUF "_buf"
 #define MSTR_HTTP_INCOMING "incoming"
-#define MSTR_HTTP_BODY "body"
 #define MSTR_HTTP_HEADERS_COMPLETE "headersComplete"
 #define MSTR_HTTP_ON_HEADERS_COMPLETE "onHeadersComplete"
 #define MSTR_HTTP_ON_COMPLETE "onComplete"
+#define MSTR_HTTP__NATIVE "_native"
 #define MSTR_HTTP_PUSH "push"
-#define MSTR_HTTP_PARSE_HEAD "parseHead"
-#define MSTR_HTTP_PARSE_BODY "parseBody"
 #define MSTR_HTTP_END "end"
 #define MSTR_HTTP_INCOMING_MESSAGE "IncomingMessage"
 #define MSTR_HTTP_HEADERS "headers"
@@ -46,7 +43,7 @@
 #define MSTR_HTTP_OUTGOING_MESSAGE "OutgoingMessage"
 #define MSTR_HTTP_HEADERS_SENT "headersSent"
 #define MSTR_HTTP__IS_TRANSFER_CHUNKED "_isTransferChunked"
-#define MSTR_HTTP__ENCODE_CHUNK "_encodeChunk"
+#define MSTR_HTTP__ENQUEUE_BODY "_enqueueBody"
 #define MSTR_HTTP_SET_HEADER "setHeader"
 #define MSTR_HTTP_GET_HEADER "getHeader"
 #define MSTR_HTTP_REMOVE_HEADER "removeHeader"
@@ -64,4 +61,11 @@
 #define MSTR_HTTP_GET "get"
 #define MSTR_HTTP_CREATE_SERVER "createServer"
 
+#define MSTR_HTTP_HTTP_PARSER_NATIVE "HTTPParserNative"
+#define MSTR_HTTP_EXECUTE "execute"
+#define MSTR_HTTP_FINISH "finish"
+#define MSTR_HTTP_RESET "reset"
+#define MSTR_HTTP_ON_BODY "onBody"
+#define MSTR_HTTP_ON_MESSAGE_COMPLETE "onMessageComplete"
+
 #endif /* __HTTP_MAGIC_STRINGS_H */
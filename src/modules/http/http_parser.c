@@ -0,0 +1,337 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "http_parser.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+
+#define HEAD_ALLOC_STEP 256
+
+enum {
+  HP_HEAD,
+  HP_BODY_LENGTH,
+  HP_BODY_EOF,
+  HP_CHUNK_SIZE,
+  HP_CHUNK_EXT,
+  HP_CHUNK_DATA,
+  HP_CHUNK_DATA_END,
+  HP_TRAILER,
+  HP_DONE,
+  HP_ERROR
+};
+
+static int hex_value(uint8_t ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+  return -1;
+}
+
+static char *trim(char *s) {
+  while (*s == ' ' || *s == '\t') s++;
+  char *e = s + strlen(s);
+  while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+  *e = '\0';
+  return s;
+}
+
+/**
+ * Cut the string at the next space and return the rest
+ */
+static char *next_token(char *s) {
+  char *sp = strchr(s, ' ');
+  if (sp == NULL) return NULL;
+  *sp = '\0';
+  sp++;
+  while (*sp == ' ') sp++;
+  return sp;
+}
+
+static bool contains_token(const char *s, const char *token) {
+  size_t n = strlen(token);
+  for (; *s; s++) {
+    if (strncasecmp(s, token, n) == 0) return true;
+  }
+  return false;
+}
+
+static int head_append(km_http_parser_t *parser, uint8_t ch) {
+  if (parser->head_len + 1 >= parser->head_size) {
+    if (parser->head_size >= KM_HTTP_HEAD_MAX) return E2BIG;
+    uint16_t size = parser->head_size + HEAD_ALLOC_STEP;
+    char *head = realloc(parser->head, size);
+    if (head == NULL) return ENOMEM;
+    parser->head = head;
+    parser->head_size = size;
+  }
+  parser->head[parser->head_len++] = ch;
+  return 0;
+}
+
+static int message_complete(km_http_parser_t *parser) {
+  parser->state = HP_DONE;
+  if (parser->on_message_complete) {
+    return parser->on_message_complete(parser);
+  }
+  return 0;
+}
+
+/**
+ * Parse the buffered message head in place and select the body framing
+ */
+static int parse_head(km_http_parser_t *parser) {
+  bool has_length = false;
+  char *line = parser->head;
+  parser->head[parser->head_len] = '\0';
+
+  // start line
+  char *eol = strchr(line, '\n');
+  if (eol == NULL) return EPROTO;
+  *eol = '\0';
+  line = trim(line);
+  if (strncmp(line, "HTTP/", 5) == 0) {
+    char *status = next_token(line);
+    if (status == NULL) return EPROTO;
+    char *message = next_token(status);
+    parser->response = true;
+    parser->version = line + 5;
+    parser->status_code = (uint16_t)strtoul(status, NULL, 10);
+    parser->status_message = message ? message : "";
+  } else {
+    char *url = next_token(line);
+    char *version = url ? next_token(url) : NULL;
+    if (version == NULL || strncmp(version, "HTTP/", 5) != 0) return EPROTO;
+    parser->response = false;
+    parser->method = line;
+    parser->url = url;
+    parser->version = version + 5;
+  }
+
+  // header fields
+  line = eol + 1;
+  while (*line) {
+    eol = strchr(line, '\n');
+    if (eol != NULL) *eol = '\0';
+    char *colon = strchr(line, ':');
+    if (colon != NULL) {
+      *colon = '\0';
+      char *name = trim(line);
+      char *value = trim(colon + 1);
+      for (char *p = name; *p; p++) *p = tolower((unsigned char)*p);
+      if (strcmp(name, "content-length") == 0) {
+        parser->remain = strtoul(value, NULL, 10);
+        has_length = true;
+      } else if (strcmp(name, "transfer-encoding") == 0) {
+        parser->chunked = contains_token(value, "chunked");
+      }
+      if (parser->on_header) {
+        int ret = parser->on_header(parser, name, value);
+        if (ret < 0) return ret;
+      }
+    }
+    if (eol == NULL) break;
+    line = eol + 1;
+  }
+
+  if (parser->on_headers_complete) {
+    int ret = parser->on_headers_complete(parser);
+    if (ret < 0) return ret;
+  }
+
+  // body framing (RFC 7230, 3.3.3)
+  if (parser->chunked) {
+    parser->remain = 0;
+    parser->state = HP_CHUNK_SIZE;
+  } else if (has_length) {
+    parser->state = HP_BODY_LENGTH;
+  } else if (parser->response && parser->status_code >= 200 &&
+             parser->status_code != 204 && parser->status_code != 304) {
+    parser->state = HP_BODY_EOF;
+  } else {
+    parser->remain = 0;
+    parser->state = HP_BODY_LENGTH;
+  }
+  if (parser->state == HP_BODY_LENGTH && parser->remain == 0) {
+    return message_complete(parser);
+  }
+  return 0;
+}
+
+static int body(km_http_parser_t *parser, const uint8_t *at, size_t len) {
+  if (len > 0 && parser->on_body) {
+    return parser->on_body(parser, at, len);
+  }
+  return 0;
+}
+
+void km_http_parser_init(km_http_parser_t *parser) {
+  parser->state = HP_HEAD;
+  parser->newlines = 0;
+  parser->response = false;
+  parser->chunked = false;
+  parser->head_len = 0;
+  parser->remain = 0;
+  parser->method = NULL;
+  parser->url = NULL;
+  parser->version = NULL;
+  parser->status_code = 0;
+  parser->status_message = NULL;
+}
+
+void km_http_parser_cleanup(km_http_parser_t *parser) {
+  free(parser->head);
+  parser->head = NULL;
+  parser->head_size = 0;
+  parser->head_len = 0;
+}
+
+int km_http_parser_execute(km_http_parser_t *parser, const uint8_t *data,
+                           size_t len) {
+  size_t i = 0;
+  int ret = 0;
+  while (i < len && ret == 0) {
+    uint8_t ch = data[i];
+    switch (parser->state) {
+      case HP_HEAD:
+        i++;
+        if (parser->head_len == 0 && (ch == '\r' || ch == '\n')) {
+          break;  // skip empty lines before the start line
+        }
+        if (ch == '\n') {
+          parser->newlines++;
+        } else if (ch != '\r') {
+          parser->newlines = 0;
+        }
+        ret = head_append(parser, ch);
+        if (ret == 0 && parser->newlines == 2) {
+          ret = parse_head(parser);
+          // the head is no longer needed
+          km_http_parser_cleanup(parser);
+        }
+        break;
+      case HP_BODY_LENGTH: {
+        size_t n = len - i;
+        if (n > parser->remain) n = parser->remain;
+        ret = body(parser, data + i, n);
+        i += n;
+        parser->remain -= n;
+        if (ret == 0 && parser->remain == 0) {
+          ret = message_complete(parser);
+        }
+        break;
+      }
+      case HP_BODY_EOF:
+        ret = body(parser, data + i, len - i);
+        i = len;
+        break;
+      case HP_CHUNK_SIZE:
+        i++;
+        if (ch == '\n') {
+          if (parser->remain > 0) {
+            parser->state = HP_CHUNK_DATA;
+          } else {
+            parser->newlines = 1;
+            parser->state = HP_TRAILER;
+          }
+        } else if (ch == ';' || ch == ' ' || ch == '\t' || ch == '\r') {
+          parser->state = HP_CHUNK_EXT;
+        } else {
+          int v = hex_value(ch);
+          if (v < 0 || parser->remain > 0x0FFFFFFF) {
+            ret = EPROTO;
+          } else {
+            parser->remain = (parser->remain << 4) | v;
+          }
+        }
+        break;
+      case HP_CHUNK_EXT:
+        if (ch == '\n') {
+          parser->state = HP_CHUNK_SIZE;  // handles LF in HP_CHUNK_SIZE
+        } else {
+          i++;
+        }
+        break;
+      case HP_CHUNK_DATA: {
+        size_t n = len - i;
+        if (n > parser->remain) n = parser->remain;
+        ret = body(parser, data + i, n);
+        i += n;
+        parser->remain -= n;
+        if (parser->remain == 0) {
+          parser->state = HP_CHUNK_DATA_END;
+        }
+        break;
+      }
+      case HP_CHUNK_DATA_END:
+        i++;
+        if (ch == '\n') {
+          parser->state = HP_CHUNK_SIZE;
+        } else if (ch != '\r') {
+          ret = EPROTO;
+        }
+        break;
+      case HP_TRAILER:
+        i++;
+        if (ch == '\n') {
+          if (++parser->newlines == 2) {
+            ret = message_complete(parser);
+          }
+        } else if (ch != '\r') {
+          parser->newlines = 0;
+        }
+        break;
+      case HP_DONE:
+        return i;
+      default:
+        return EPROTO;
+    }
+  }
+  if (ret < 0) {
+    parser->state = HP_ERROR;
+    km_http_parser_cleanup(parser);
+    return ret;
+  }
+  return i;
+}
+
+int km_http_parser_finish(km_http_parser_t *parser) {
+  switch (parser->state) {
+    case HP_BODY_EOF:
+      return message_complete(parser);
+    case HP_DONE:
+      return 0;
+    case HP_HEAD:
+      if (parser->head_len == 0) return 0;  // no message
+      /* fall through */
+    default:
+      km_http_parser_cleanup(parser);
+      parser->state = HP_ERROR;
+      return EPROTO;
+  }
+}
+
+bool km_http_parser_is_done(km_http_parser_t *parser) {
+  return parser->state == HP_DONE;
+}
@@ -0,0 +1,101 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __HTTP_PARSER_H
+#define __HTTP_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum size of request/status line and headers */
+#define KM_HTTP_HEAD_MAX 4096
+
+typedef struct km_http_parser_s km_http_parser_t;
+
+/*
+ * Callbacks return 0 to continue, or a negative value to abort parsing.
+ * The abort value is returned from km_http_parser_execute().
+ */
+typedef int (*km_http_cb)(km_http_parser_t *);
+typedef int (*km_http_header_cb)(km_http_parser_t *, const char *name,
+                                 const char *value);
+typedef int (*km_http_body_cb)(km_http_parser_t *, const uint8_t *at,
+                               size_t len);
+
+/**
+ * Incremental HTTP/1.x message parser. Only the message head is buffered,
+ * body data is reported as ranges of the input buffer.
+ */
+struct km_http_parser_s {
+  uint8_t state;
+  uint8_t newlines; /* consecutive line feeds seen (CR ignored) */
+  bool response;
+  bool chunked;
+  char *head;
+  uint16_t head_len;
+  uint16_t head_size;
+  uint32_t remain; /* bytes left in body or current chunk */
+  /* message head, valid in on_header and on_headers_complete only */
+  const char *method;
+  const char *url;
+  const char *version;
+  uint16_t status_code;
+  const char *status_message;
+  /* callbacks */
+  void *data;
+  km_http_header_cb on_header;
+  km_http_cb on_headers_complete;
+  km_http_body_cb on_body;
+  km_http_cb on_message_complete;
+};
+
+/**
+ * Reset the parser to parse a new message. Callbacks and data are kept.
+ * The parser must be zero-initialized before the first call.
+ */
+void km_http_parser_init(km_http_parser_t *parser);
+
+/**
+ * Release the memory used by the parser.
+ */
+void km_http_parser_cleanup(km_http_parser_t *parser);
+
+/**
+ * Parse a chunk of received data. Parsing stops at the end of a message.
+ * @return Number of bytes consumed, or a negative error.
+ */
+int km_http_parser_execute(km_http_parser_t *parser, const uint8_t *data,
+                           size_t len);
+
+/**
+ * Signal the end of input. Completes a message whose body is delimited by
+ * the connection close.
+ * @return 0 on success, or a negative error if the message is incomplete.
+ */
+int km_http_parser_finish(km_http_parser_t *parser);
+
+/**
+ * Check whether a complete message has been parsed.
+ */
+bool km_http_parser_is_done(km_http_parser_t *parser);
+
+#endif /* __HTTP_PARSER_H */
@@ -0,0 +1,4 @@
+list(APPEND SOURCES
+  ${SRC_DIR}/modules/http/http_parser.c
+  ${SRC_DIR}/modules/http/module_http.c)
+include_directories(${SRC_DIR}/modules/http)
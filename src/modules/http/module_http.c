@@ -0,0 +1,284 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "module_http.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "err.h"
+#include "http_magic_strings.h"
+#include "http_parser.h"
+#include "jerryscript.h"
+#include "jerryxx.h"
+#include "magic_strings.h"
+
+typedef struct {
+  km_http_parser_t parser;
+  jerry_value_t this_val; /* parser object during execute() and finish() */
+  jerry_value_t buffer;   /* array buffer of the chunk being parsed */
+  const uint8_t *base;    /* start of the array buffer */
+  jerry_value_t headers;
+  jerry_value_t error; /* exception thrown by a JS callback */
+} http_parser_handle_t;
+
+static void http_parser_freecb(void *handle) {
+  http_parser_handle_t *parser_handle = (http_parser_handle_t *)handle;
+  km_http_parser_cleanup(&parser_handle->parser);
+  jerry_release_value(parser_handle->headers);
+  free(parser_handle);
+}
+
+static const jerry_object_native_info_t http_parser_handle_info = {
+    .free_cb = http_parser_freecb};
+
+/**
+ * Create a string from ISO-8859-1 text as received on the wire
+ */
+static jerry_value_t create_latin1_string(const char *str) {
+  size_t len = 0;
+  size_t utf8_len = 0;
+  for (; str[len]; len++) {
+    utf8_len += ((uint8_t)str[len] < 0x80) ? 1 : 2;
+  }
+  if (utf8_len == len) {
+    return jerry_create_string_sz((const jerry_char_t *)str, len);
+  }
+  uint8_t *buf = malloc(utf8_len);
+  if (buf == NULL) {
+    return jerry_create_string((const jerry_char_t *)"");
+  }
+  uint8_t *p = buf;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t ch = (uint8_t)str[i];
+    if (ch < 0x80) {
+      *p++ = ch;
+    } else {
+      *p++ = 0xC0 | (ch >> 6);
+      *p++ = 0x80 | (ch & 0x3F);
+    }
+  }
+  jerry_value_t ret = jerry_create_string_sz_from_utf8(buf, utf8_len);
+  free(buf);
+  return ret;
+}
+
+static void set_property_latin1(jerry_value_t object, const char *name,
+                                const char *value) {
+  jerry_value_t prop = jerry_create_string((const jerry_char_t *)name);
+  jerry_value_t val = create_latin1_string(value);
+  jerry_value_t ret = jerry_set_property(object, prop, val);
+  jerry_release_value(ret);
+  jerry_release_value(val);
+  jerry_release_value(prop);
+}
+
+/**
+ * Call a callback property of the parser object if it is a function
+ */
+static int call_callback(http_parser_handle_t *parser_handle, char *name,
+                         jerry_value_t *args, int args_count) {
+  jerry_value_t fn = jerryxx_get_property(parser_handle->this_val, name);
+  int ret = 0;
+  if (jerry_value_is_function(fn)) {
+    jerry_value_t res =
+        jerry_call_function(fn, parser_handle->this_val, args, args_count);
+    if (jerry_value_is_error(res)) {
+      parser_handle->error = res;
+      ret = EINTR;
+    } else {
+      jerry_release_value(res);
+    }
+  }
+  jerry_release_value(fn);
+  return ret;
+}
+
+static int on_header(km_http_parser_t *parser, const char *name,
+                     const char *value) {
+  http_parser_handle_t *parser_handle = (http_parser_handle_t *)parser->data;
+  if (!jerry_value_is_object(parser_handle->headers)) {
+    jerry_release_value(parser_handle->headers);
+    parser_handle->headers = jerry_create_object();
+  }
+  set_property_latin1(parser_handle->headers, name, value);
+  return 0;
+}
+
+static int on_headers_complete(km_http_parser_t *parser) {
+  http_parser_handle_t *parser_handle = (http_parser_handle_t *)parser->data;
+  jerry_value_t info = jerry_create_object();
+  if (parser->response) {
+    jerryxx_set_property_number(info, MSTR_HTTP_STATUS_CODE,
+                                parser->status_code);
+    set_property_latin1(info, MSTR_HTTP_STATUS_MESSAGE,
+                        parser->status_message);
+  } else {
+    set_property_latin1(info, MSTR_HTTP_METHOD, parser->method);
+    set_property_latin1(info, MSTR_HTTP_URL, parser->url);
+  }
+  set_property_latin1(info, MSTR_HTTP_HTTP_VERSION, parser->version);
+  if (!jerry_value_is_object(parser_handle->headers)) {
+    jerry_release_value(parser_handle->headers);
+    parser_handle->headers = jerry_create_object();
+  }
+  jerryxx_set_property(info, MSTR_HTTP_HEADERS, parser_handle->headers);
+  jerry_release_value(parser_handle->headers);
+  parser_handle->headers = jerry_create_undefined();
+  int ret = call_callback(parser_handle, MSTR_HTTP_ON_HEADERS_COMPLETE,
+                          &info, 1);
+  jerry_release_value(info);
+  return ret;
+}
+
+static int on_body(km_http_parser_t *parser, const uint8_t *at, size_t len) {
+  http_parser_handle_t *parser_handle = (http_parser_handle_t *)parser->data;
+  // a view on the received buffer, no copy
+  jerry_value_t slice = jerry_create_typedarray_for_arraybuffer_sz(
+      JERRY_TYPEDARRAY_UINT8, parser_handle->buffer, at - parser_handle->base,
+      len);
+  int ret = call_callback(parser_handle, MSTR_HTTP_ON_BODY, &slice, 1);
+  jerry_release_value(slice);
+  return ret;
+}
+
+static int on_message_complete(km_http_parser_t *parser) {
+  http_parser_handle_t *parser_handle = (http_parser_handle_t *)parser->data;
+  return call_callback(parser_handle, MSTR_HTTP_ON_MESSAGE_COMPLETE, NULL, 0);
+}
+
+/**
+ * Return the pending JS exception or a system error for the result
+ */
+static jerry_value_t parser_result(http_parser_handle_t *parser_handle,
+                                   int ret) {
+  parser_handle->this_val = jerry_create_undefined();
+  if (jerry_value_is_error(parser_handle->error)) {
+    jerry_value_t error = parser_handle->error;
+    parser_handle->error = jerry_create_undefined();
+    return error;
+  }
+  if (ret < 0) {
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  return jerry_create_number(ret);
+}
+
+/**
+ * HTTPParserNative constructor
+ */
+JERRYXX_FUN(http_parser_ctor_fn) {
+  http_parser_handle_t *parser_handle =
+      (http_parser_handle_t *)calloc(1, sizeof(http_parser_handle_t));
+  if (parser_handle == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  parser_handle->parser.data = parser_handle;
+  parser_handle->parser.on_header = on_header;
+  parser_handle->parser.on_headers_complete = on_headers_complete;
+  parser_handle->parser.on_body = on_body;
+  parser_handle->parser.on_message_complete = on_message_complete;
+  parser_handle->this_val = jerry_create_undefined();
+  parser_handle->buffer = jerry_create_undefined();
+  parser_handle->headers = jerry_create_undefined();
+  parser_handle->error = jerry_create_undefined();
+  km_http_parser_init(&parser_handle->parser);
+  jerry_set_object_native_pointer(JERRYXX_GET_THIS, parser_handle,
+                                  &http_parser_handle_info);
+  return jerry_create_undefined();
+}
+
+/**
+ * HTTPParserNative.prototype.execute()
+ * args:
+ *   chunk {Uint8Array}
+ * returns:
+ *   {number} bytes consumed. Parsing stops at the end of a message.
+ */
+JERRYXX_FUN(http_parser_execute_fn) {
+  JERRYXX_CHECK_ARG_TYPEDARRAY(0, "chunk")
+  jerry_value_t chunk = JERRYXX_GET_ARG(0);
+  JERRYXX_GET_NATIVE_HANDLE(parser_handle, http_parser_handle_t,
+                            http_parser_handle_info);
+  jerry_length_t byteOffset = 0;
+  jerry_length_t byteLength = 0;
+  jerry_value_t buffer =
+      jerry_get_typedarray_buffer(chunk, &byteOffset, &byteLength);
+  parser_handle->this_val = JERRYXX_GET_THIS;
+  parser_handle->buffer = buffer;
+  parser_handle->base = jerry_get_arraybuffer_pointer(buffer);
+  int ret = km_http_parser_execute(&parser_handle->parser,
+                                   parser_handle->base + byteOffset,
+                                   byteLength);
+  parser_handle->buffer = jerry_create_undefined();
+  parser_handle->base = NULL;
+  jerry_release_value(buffer);
+  return parser_result(parser_handle, ret);
+}
+
+/**
+ * HTTPParserNative.prototype.finish()
+ * Signal the end of input (e.g. the connection is closed)
+ */
+JERRYXX_FUN(http_parser_finish_fn) {
+  JERRYXX_GET_NATIVE_HANDLE(parser_handle, http_parser_handle_t,
+                            http_parser_handle_info);
+  parser_handle->this_val = JERRYXX_GET_THIS;
+  int ret = km_http_parser_finish(&parser_handle->parser);
+  return parser_result(parser_handle, ret);
+}
+
+/**
+ * HTTPParserNative.prototype.reset()
+ * Prepare to parse a new message
+ */
+JERRYXX_FUN(http_parser_reset_fn) {
+  JERRYXX_GET_NATIVE_HANDLE(parser_handle, http_parser_handle_t,
+                            http_parser_handle_info);
+  km_http_parser_cleanup(&parser_handle->parser);
+  km_http_parser_init(&parser_handle->parser);
+  jerry_release_value(parser_handle->headers);
+  parser_handle->headers = jerry_create_undefined();
+  return jerry_create_undefined();
+}
+
+/**
+ * Initialize 'http' module
+ */
+jerry_value_t module_http_init() {
+  /* HTTPParserNative class */
+  jerry_value_t parser_ctor = jerry_create_external_function(http_parser_ctor_fn);
+  jerry_value_t parser_prototype = jerry_create_object();
+  jerryxx_set_property(parser_ctor, MSTR_PROTOTYPE, parser_prototype);
+  jerryxx_set_property_function(parser_prototype, MSTR_HTTP_EXECUTE,
+                                http_parser_execute_fn);
+  jerryxx_set_property_function(parser_prototype, MSTR_HTTP_FINISH,
+                                http_parser_finish_fn);
+  jerryxx_set_property_function(parser_prototype, MSTR_HTTP_RESET,
+                                http_parser_reset_fn);
+  jerry_release_value(parser_prototype);
+
+  /* http module exports */
+  jerry_value_t exports = jerry_create_object();
+  jerryxx_set_property(exports, MSTR_HTTP_HTTP_PARSER_NATIVE, parser_ctor);
+  jerry_release_value(parser_ctor);
+  return exports;
+}
@@ -26,12 +26,44 @@
 #include "i2c_magic_strings.h"
 #include "jerryscript.h"
 #include "jerryxx.h"
+#include "kaluma_magic_strings.h"
 
 #define I2C_DEFAULT_MODE KM_I2C_MASTER
 #define I2C_DEFAULT_BAUDRATE 100000  // 100kbps
 
+/**
+ * Native handle of an I2C object. The bus and mode are read from here by
+ * every transfer; the JS properties (this.bus, ...) are for information.
+ */
+typedef struct {
+  uint8_t bus;
+  km_i2c_mode_t mode;
+  bool closed;
+} i2c_handle_t;
+
 static void buffer_free_cb(void *native_p) { free(native_p); }
 
+static const jerry_object_native_info_t i2c_handle_info = {
+    .free_cb = buffer_free_cb};
+
+/**
+ * Get the handle of an opened I2C object, NULL if not initialized or closed
+ */
+static i2c_handle_t *get_i2c_handle(jerry_value_t this_val) {
+  void *native_p;
+  if (jerry_get_object_native_pointer(this_val, &native_p, &i2c_handle_info) &&
+      !((i2c_handle_t *)native_p)->closed) {
+    return (i2c_handle_t *)native_p;
+  }
+  return NULL;
+}
+
+static jerry_value_t create_bus_error() {
+  return jerry_create_error(
+      JERRY_ERROR_REFERENCE,
+      (const jerry_char_t *)"I2C bus is not initialized.");
+}
+
 /**
  * I2C() constructor
  */
@@ -80,13 +112,31 @@ JERRYXX_FUN(i2c_ctor_fn) {
       return jerry_create_error_from_value(create_system_error(ret), true);
     }
   }
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_I2C_MODE, mode);
-  // check this.bus number
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_I2C_BUS, bus);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_I2C_MODE, mode);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_I2C_BAUDRATE, baudrate);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_I2C_SDA, pins.sda);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_I2C_SCL, pins.scl);
+  // native handle (reused if the object is initialized again)
+  void *native_p;
+  i2c_handle_t *i2c = NULL;
+  if (jerry_get_object_native_pointer(JERRYXX_GET_THIS, &native_p,
+                                      &i2c_handle_info)) {
+    i2c = (i2c_handle_t *)native_p;
+  } else {
+    i2c = (i2c_handle_t *)malloc(sizeof(i2c_handle_t));
+    if (i2c == NULL) {
+      km_i2c_close(bus);
+      return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+    }
+    jerry_set_object_native_pointer(JERRYXX_GET_THIS, i2c, &i2c_handle_info);
+  }
+  i2c->bus = bus;
+  i2c->mode = mode;
+  i2c->closed = false;
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_I2C_BUS_KEY, bus);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_I2C_MODE_KEY, mode);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_I2C_BAUDRATE_KEY,
+                                     baudrate);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_I2C_SDA_KEY,
+                                     pins.sda);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_I2C_SCL_KEY,
+                                     pins.scl);
   return jerry_create_undefined();
 }
 
@@ -97,19 +147,13 @@ JERRYXX_FUN(i2c_write_fn) {
   JERRYXX_CHECK_ARG(0, "data");
   jerry_value_t data = JERRYXX_GET_ARG(0);
 
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"I2C bus is not initialized.");
+  // get the bus and the mode (determine slave mode or master mode)
+  i2c_handle_t *i2c = get_i2c_handle(JERRYXX_GET_THIS);
+  if (i2c == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
-  // check the mode (determine slave mode or master mode)
-  km_i2c_mode_t i2cmode = jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_MODE);
+  uint8_t bus = i2c->bus;
+  km_i2c_mode_t i2cmode = i2c->mode;
 
   // read optional parameters (address, timeout)
   uint8_t address = 0;
@@ -184,19 +228,13 @@ JERRYXX_FUN(i2c_read_fn) {
   JERRYXX_CHECK_ARG_NUMBER(0, "length");
   jerry_length_t length = (jerry_length_t)JERRYXX_GET_ARG_NUMBER(0);
 
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"I2C bus is not initialized.");
+  // get the bus and the mode (determine slave mode or master mode)
+  i2c_handle_t *i2c = get_i2c_handle(JERRYXX_GET_THIS);
+  if (i2c == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
-  // check the mode (determine slave mode or master mode)
-  km_i2c_mode_t i2cmode = jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_MODE);
+  uint8_t bus = i2c->bus;
+  km_i2c_mode_t i2cmode = i2c->mode;
 
   // read data with optional parameters (address, timeout)
   uint8_t address = 0;
@@ -247,19 +285,13 @@ JERRYXX_FUN(i2c_memwrite_fn) {
   uint32_t timeout = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(4, 5000);
   uint32_t count = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(5, 1);
 
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"I2C bus is not initialized.");
+  // get the bus and the mode (determine slave mode or master mode)
+  i2c_handle_t *i2c = get_i2c_handle(JERRYXX_GET_THIS);
+  if (i2c == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
-  // check the mode (determine slave mode or master mode)
-  km_i2c_mode_t i2cmode = jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_MODE);
+  uint8_t bus = i2c->bus;
+  km_i2c_mode_t i2cmode = i2c->mode;
   if (i2cmode == KM_I2C_SLAVE)
     return jerry_create_error(
         JERRY_ERROR_RANGE,
@@ -319,26 +351,20 @@ JERRYXX_FUN(i2c_memread_fn) {
   uint16_t memAddressSize = (uint16_t)JERRYXX_GET_ARG_NUMBER_OPT(3, 8);
   uint32_t timeout = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(4, 5000);
 
-  uint8_t *buf = malloc(length);
-
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"I2C bus is not initialized.");
+  // get the bus and the mode (determine slave mode or master mode)
+  i2c_handle_t *i2c = get_i2c_handle(JERRYXX_GET_THIS);
+  if (i2c == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
-  // check the mode (determine slave mode or master mode)
-  km_i2c_mode_t i2cmode = jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_MODE);
+  uint8_t bus = i2c->bus;
+  km_i2c_mode_t i2cmode = i2c->mode;
   if (i2cmode == KM_I2C_SLAVE)
     return jerry_create_error(
         JERRY_ERROR_RANGE,
         (const jerry_char_t *)"This function runs in master mode only.");
 
+  uint8_t *buf = malloc(length);
+
   int ret = km_i2c_mem_read_master(bus, address, memAddress, memAddressSize,
                                    buf, length, timeout);
 
@@ -360,25 +386,19 @@ JERRYXX_FUN(i2c_memread_fn) {
  * I2C.prototype.close() function
  */
 JERRYXX_FUN(i2c_close_fn) {
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_I2C_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"I2C bus is not initialized.");
+  i2c_handle_t *i2c = get_i2c_handle(JERRYXX_GET_THIS);
+  if (i2c == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
   // close the bus
-  int ret = km_i2c_close(bus);
+  int ret = km_i2c_close(i2c->bus);
   if (ret < 0) {
     return jerry_create_error_from_value(create_system_error(ret), true);
   }
+  i2c->closed = true;
 
   // delete this.bus property
-  jerryxx_delete_property(JERRYXX_GET_THIS, MSTR_I2C_BUS);
+  jerryxx_delete_property_by_key(JERRYXX_GET_THIS, MSTR_I2C_BUS_KEY);
 
   return jerry_create_undefined();
 }
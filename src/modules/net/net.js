@@ -39,6 +39,7 @@ class Socket extends stream.Duplex {
         sck.close_cb = () => { this._afterDestroy() }
         sck.read_cb = (data) => { this.push(data) }
         sck.shutdown_cb = () => { this._afterEnd() }
+        sck.error_cb = (errno) => { this.emit('error', new SystemError(errno)) }
       }
     } else {
       throw new SystemError(6); // ENXIO
@@ -166,7 +167,7 @@ class Server extends EventEmitter {
         var sck = this._dev.get(this._fd);
         sck.accept_cb = (fd) => {
           var client = new Socket();
-          client._socket(fd, sck);
+          client._socket(fd);
           this.emit('connection', client);
         }
       }
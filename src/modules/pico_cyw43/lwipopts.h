@@ -23,6 +23,8 @@
 #define MEM_ALIGNMENT 4
 #define MEM_SIZE 4000
 #define MEMP_NUM_TCP_SEG 32
+// PBUF_REF/ROM pbufs for the data written without copy
+#define MEMP_NUM_PBUF TCP_SND_QUEUELEN
 #define MEMP_NUM_ARP_QUEUE 10
 #define PBUF_POOL_SIZE 24
 #define LWIP_ARP 1
@@ -49,7 +51,8 @@
 #define LWIP_UDP 1
 #define LWIP_DNS 1
 #define LWIP_TCP_KEEPALIVE 1
-#define LWIP_NETIF_TX_SINGLE_PBUF 1
+// 0 to allow tcp_write() without copy (cyw43 driver sends pbuf chains)
+#define LWIP_NETIF_TX_SINGLE_PBUF 0
 #define DHCP_DOES_ARP_CHECK 0
 #define LWIP_DHCP_DOES_ACD_CHECK 0
 #define MEMP_NUM_SYS_TIMEOUT (LWIP_NUM_SYS_TIMEOUT_INTERNAL+1)
@@ -34,6 +34,7 @@
 #include "dhcpserver.h"
 
 #include "pico_cyw43_magic_strings.h"
+#include "ringbuffer.h"
 
 #define MAX_GPIO_NUM 2
 #define SCAN_TIMEOUT 2000     /* 2 sec */
@@ -49,6 +50,19 @@
 
 #define KM_MAX_SOCKET_NO 16
 
+/* received pbufs lent to JS at most (the rest are copied) */
+#define KM_RX_PBUF_MAX (PBUF_POOL_SIZE / 2)
+#define KM_TCP_POLL_INTERVAL 2 /* 1 sec */
+
+/**
+ * Received datagrams are queued in a ring per socket and passed to
+ * message_cb in a batch per poll. Each datagram in a batch is a header
+ * (length, remote port in 2 bytes little-endian each, remote IPv4 address
+ * in 4 bytes) followed by the data.
+ */
+#define KM_DGRAM_RING_SIZE 4096
+#define KM_DGRAM_HEADER_SIZE 8
+
 #define KM_CYW43_STATUS_DISABLED 0
 #define KM_CYW43_STATUS_INIT 1 /* BIT 0 */
 #define KM_CYW43_STATUS_DNS_DONE 2 /* BIT 1 */
@@ -58,6 +72,34 @@
 #define CYW43_WIFI_AUTH_WPA 2 /* BIT 1 */
 #define CYW43_WIFI_AUTH_WPA2 4 /* BIT 2 */
 
+/**
+ * Data written to a TCP socket. The data is passed to lwIP without a copy,
+ * so it is pinned until acknowledged by the peer.
+ */
+typedef struct __write_req_s {
+  struct __write_req_s *next;
+  jerry_value_t data; /* pinned JS value, or 0 if buf is allocated */
+  uint8_t *buf;
+  size_t len;
+  size_t queued; /* passed to tcp_write() */
+  size_t acked;
+  jerry_value_t cb; /* called when all data is acknowledged (or 0) */
+} __write_req_t;
+
+typedef struct {
+  __write_req_t *head;
+  __write_req_t *tail;
+} __write_queue_t;
+
+/**
+ * Closed TCP connection waiting for the written data to be acknowledged
+ */
+typedef struct __tcp_linger_s {
+  struct __tcp_linger_s *next;
+  struct tcp_pcb *pcb;
+  __write_queue_t queue;
+} __tcp_linger_t;
+
 typedef struct {
   int8_t fd;
   int8_t server_fd;
@@ -72,6 +114,10 @@ typedef struct {
     struct udp_pcb *udp_pcb;
   };
   struct tcp_pcb *tcp_server_pcb;
+  __write_queue_t write_queue;
+  uint8_t *rx_buf; /* received datagrams (DGRAM) */
+  ringbuffer_t rx_ring;
+  bool rx_pending;
 } __socket_data_t;
 
 typedef struct {
@@ -103,8 +149,55 @@ __socket_t __socket_info;
 
 dhcp_server_t dhcp_server;
 
+static __tcp_linger_t *__tcp_lingers = NULL;
+static struct pbuf *__rx_pbufs[KM_RX_PBUF_MAX];
+
 static void buffer_free_cb(void *native_p) { free(native_p); }
 
+/**
+ * Free a received pbuf lent to JS as an external ArrayBuffer
+ */
+static void __rx_pbuf_free_cb(void *native_p) {
+  for (int i = 0; i < KM_RX_PBUF_MAX; i++) {
+    if (__rx_pbufs[i] != NULL && __rx_pbufs[i]->payload == native_p) {
+      cyw43_arch_lwip_begin();
+      pbuf_free(__rx_pbufs[i]);
+      cyw43_arch_lwip_end();
+      __rx_pbufs[i] = NULL;
+      return;
+    }
+  }
+}
+
+/**
+ * Create an Uint8Array of a received pbuf. The pbuf is referenced by the
+ * array if possible, otherwise the data is copied.
+ */
+static jerry_value_t __rx_pbuf_to_array(struct pbuf *q) {
+  jerry_value_t buffer = 0;
+  for (int i = 0; i < KM_RX_PBUF_MAX; i++) {
+    if (__rx_pbufs[i] == NULL) {
+      pbuf_ref(q);
+      __rx_pbufs[i] = q;
+      buffer = jerry_create_arraybuffer_external(q->len, (uint8_t *)q->payload,
+                                                 __rx_pbuf_free_cb);
+      break;
+    }
+  }
+  if (buffer == 0) {
+    uint8_t *buf = (uint8_t *)malloc(q->len);
+    if (buf == NULL) {
+      return jerry_create_undefined();
+    }
+    memcpy(buf, q->payload, q->len);
+    buffer = jerry_create_arraybuffer_external(q->len, buf, buffer_free_cb);
+  }
+  jerry_value_t data =
+      jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8, buffer);
+  jerry_release_value(buffer);
+  return data;
+}
+
 bool km_is_valid_fd(int8_t fd) {
   if ((fd >= 0) && (fd < KM_MAX_SOCKET_NO)) {
     return true;
@@ -132,6 +225,289 @@ static err_t __tcp_close(struct tcp_pcb *pcb) {
   return err;
 }
 
+/**
+ * Pass the datagrams queued while polling to message_cb in batches
+ */
+static void __dgram_deliver_all() {
+  for (int i = 0; i < KM_MAX_SOCKET_NO; i++) {
+    __socket_data_t *sck = &(__socket_info.socket[i]);
+    if (!sck->rx_pending || sck->rx_buf == NULL || sck->obj == 0) {
+      continue;
+    }
+    sck->rx_pending = false;
+    uint32_t len = ringbuffer_length(&(sck->rx_ring));
+    jerry_value_t buffer = jerry_create_arraybuffer(len);
+    ringbuffer_read(&(sck->rx_ring), jerry_get_arraybuffer_pointer(buffer),
+                    len);
+    jerry_value_t batch =
+        jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8, buffer);
+    jerry_release_value(buffer);
+    jerry_value_t message_js_cb =
+        jerryxx_get_property(sck->obj, MSTR_PICO_CYW43_SOCKET_MESSAGE_CB);
+    if (jerry_value_is_function(message_js_cb)) {
+      jerry_value_t this_val = jerry_create_undefined();
+      jerry_value_t ret_val =
+          jerry_call_function(message_js_cb, this_val, &batch, 1);
+      jerry_release_value(ret_val);
+      jerry_release_value(this_val);
+    }
+    jerry_release_value(message_js_cb);
+    jerry_release_value(batch);
+  }
+}
+
+static bool __dgram_ring_alloc(__socket_data_t *sck) {
+  if (sck->rx_buf == NULL) {
+    sck->rx_buf = (uint8_t *)malloc(KM_DGRAM_RING_SIZE);
+    if (sck->rx_buf == NULL) {
+      return false;
+    }
+    ringbuffer_init(&(sck->rx_ring), sck->rx_buf, KM_DGRAM_RING_SIZE);
+    sck->rx_pending = false;
+  }
+  return true;
+}
+
+/**
+ * Get the data to write: Uint8Array and ArrayBuffer are used in place and
+ * returned pinned, a string is converted to a new buffer (returns 0).
+ */
+static jerry_value_t __get_write_data(jerry_value_t data, uint8_t **buf,
+                                      jerry_size_t *len) {
+  if (jerry_value_is_typedarray(data) &&
+      jerry_get_typedarray_type(data) == JERRY_TYPEDARRAY_UINT8) {
+    jerry_length_t byteLength = 0;
+    jerry_length_t byteOffset = 0;
+    jerry_value_t array_buffer =
+        jerry_get_typedarray_buffer(data, &byteOffset, &byteLength);
+    *buf = jerry_get_arraybuffer_pointer(array_buffer) + byteOffset;
+    *len = byteLength;
+    jerry_release_value(array_buffer);
+    return jerry_acquire_value(data);
+  } else if (jerry_value_is_arraybuffer(data)) {
+    *buf = jerry_get_arraybuffer_pointer(data);
+    *len = jerry_get_arraybuffer_byte_length(data);
+    return jerry_acquire_value(data);
+  }
+  jerry_value_t str = jerry_value_to_string(data);
+  *len = jerryxx_get_ascii_string_size(str);
+  *buf = calloc(1, *len + 1);
+  jerryxx_string_to_ascii_char_buffer(str, *buf, *len);
+  jerry_release_value(str);
+  return 0;
+}
+
+static void __call_errno_cb(jerry_value_t js_cb, int err) {
+  jerry_value_t this_val = jerry_create_undefined();
+  jerry_value_t errno_val = jerry_create_number(err);
+  jerry_value_t ret_val = jerry_call_function(js_cb, this_val, &errno_val, 1);
+  jerry_release_value(ret_val);
+  jerry_release_value(errno_val);
+  jerry_release_value(this_val);
+}
+
+/**
+ * Free a write request. JS values are not released after the JS context is
+ * cleaned up (release_js = false).
+ */
+static void __write_req_free(__write_req_t *req, bool release_js) {
+  if (release_js) {
+    if (req->data != 0) {
+      jerry_release_value(req->data);
+    }
+    if (req->cb != 0) {
+      jerry_release_value(req->cb);
+    }
+  }
+  if (req->data == 0) {
+    free(req->buf);
+  }
+  free(req);
+}
+
+static void __write_queue_free(__write_queue_t *queue, bool release_js) {
+  __write_req_t *req = queue->head;
+  while (req != NULL) {
+    __write_req_t *next = req->next;
+    __write_req_free(req, release_js);
+    req = next;
+  }
+  queue->head = NULL;
+  queue->tail = NULL;
+}
+
+/**
+ * Release the written data acknowledged by the peer and call the write
+ * callbacks, as lwIP no longer references the data.
+ */
+static void __write_queue_ack(__write_queue_t *queue, size_t len) {
+  __write_req_t *done = NULL;
+  __write_req_t **done_tail = &done;
+  while (queue->head != NULL) {
+    __write_req_t *req = queue->head;
+    size_t n = req->queued - req->acked;
+    if (n > len) {
+      n = len;
+    }
+    req->acked += n;
+    len -= n;
+    if (req->acked < req->len) {
+      break;
+    }
+    queue->head = req->next;
+    if (queue->head == NULL) {
+      queue->tail = NULL;
+    }
+    req->next = NULL;
+    *done_tail = req;
+    done_tail = &req->next;
+  }
+  // the callbacks may write or close, so the queue is updated first
+  while (done != NULL) {
+    __write_req_t *req = done;
+    jerry_value_t js_cb = req->cb;
+    done = req->next;
+    req->cb = 0;
+    __write_req_free(req, true);
+    if (js_cb != 0) {
+      __call_errno_cb(js_cb, 0);
+      jerry_release_value(js_cb);
+    }
+  }
+}
+
+/**
+ * Pass the pending data to lwIP as much as the send buffer allows
+ */
+static err_t __tcp_write_pending(__socket_data_t *sck) {
+  struct tcp_pcb *pcb = sck->tcp_pcb;
+  err_t err = ERR_OK;
+  bool written = false;
+  cyw43_arch_lwip_check();
+  for (__write_req_t *req = sck->write_queue.head; req != NULL;
+       req = req->next) {
+    while (req->queued < req->len) {
+      size_t n = req->len - req->queued;
+      size_t room = tcp_sndbuf(pcb);
+      if (room == 0 || tcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN) {
+        goto out;  // continued when the sent data is acknowledged
+      }
+      if (n > room) {
+        n = room;
+      }
+      bool more = (req->next != NULL) || (req->queued + n < req->len);
+      err = tcp_write(pcb, req->buf + req->queued, n,
+                      more ? TCP_WRITE_FLAG_MORE : 0);
+      if (err != ERR_OK) {
+        if (err == ERR_MEM) {
+          err = ERR_OK;  // retried on sent or poll
+        }
+        goto out;
+      }
+      req->queued += n;
+      written = true;
+    }
+  }
+out:
+  if (written) {
+    tcp_output(pcb);
+  }
+  return err;
+}
+
+static err_t __tcp_data_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+  int8_t fd = *(int8_t *)arg;
+  if (km_is_valid_fd(fd) && __socket_info.socket[fd].tcp_pcb == tpcb) {
+    __write_queue_ack(&(__socket_info.socket[fd].write_queue), len);
+    if (__socket_info.socket[fd].tcp_pcb == tpcb) {  // not closed by a callback
+      __tcp_write_pending(&(__socket_info.socket[fd]));
+    }
+  }
+  return ERR_OK;
+}
+
+static err_t __tcp_poll_cb(void *arg, struct tcp_pcb *tpcb) {
+  int8_t fd = *(int8_t *)arg;
+  if (km_is_valid_fd(fd) && __socket_info.socket[fd].tcp_pcb == tpcb &&
+      __socket_info.socket[fd].write_queue.head != NULL) {
+    __tcp_write_pending(&(__socket_info.socket[fd]));
+  }
+  return ERR_OK;
+}
+
+static void __tcp_linger_remove(__tcp_linger_t *linger) {
+  __tcp_linger_t **pp = &__tcp_lingers;
+  while (*pp != NULL) {
+    if (*pp == linger) {
+      *pp = linger->next;
+      break;
+    }
+    pp = &((*pp)->next);
+  }
+  free(linger);
+}
+
+static err_t __tcp_linger_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+  __tcp_linger_t *linger = (__tcp_linger_t *)arg;
+  __write_queue_ack(&(linger->queue), len);
+  if (linger->queue.head == NULL) {
+    tcp_arg(tpcb, NULL);
+    tcp_sent(tpcb, NULL);
+    tcp_err(tpcb, NULL);
+    __tcp_linger_remove(linger);
+  }
+  return ERR_OK;
+}
+
+static void __tcp_linger_err_cb(void *arg, err_t err) {
+  (void)err;
+  // the pcb is already freed
+  __tcp_linger_t *linger = (__tcp_linger_t *)arg;
+  __write_queue_free(&(linger->queue), true);
+  __tcp_linger_remove(linger);
+}
+
+/**
+ * Close the TCP connection of a socket. Data not acknowledged yet stays
+ * pinned until it is acknowledged or the connection is aborted.
+ */
+static void __tcp_close_socket(__socket_data_t *sck) {
+  struct tcp_pcb *pcb = sck->tcp_pcb;
+  __write_queue_t *queue = &(sck->write_queue);
+  cyw43_arch_lwip_check();
+  tcp_sent(pcb, NULL);
+  tcp_err(pcb, NULL);
+  tcp_poll(pcb, NULL, 0);
+  // data not passed to lwIP is dropped, without calling back
+  for (__write_req_t *req = queue->head; req != NULL; req = req->next) {
+    if (req->queued < req->len && req->cb != 0) {
+      jerry_release_value(req->cb);
+      req->cb = 0;
+    }
+    req->len = req->queued;
+  }
+  __write_queue_ack(queue, 0);
+  if (queue->head != NULL) {
+    __tcp_linger_t *linger = (__tcp_linger_t *)malloc(sizeof(__tcp_linger_t));
+    if (linger == NULL) {
+      tcp_abort(pcb);
+      __write_queue_free(queue, true);
+      return;
+    }
+    linger->pcb = pcb;
+    linger->queue = *queue;
+    queue->head = NULL;
+    queue->tail = NULL;
+    linger->next = __tcp_lingers;
+    __tcp_lingers = linger;
+    tcp_arg(pcb, linger);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, __tcp_linger_sent_cb);
+    tcp_err(pcb, __tcp_linger_err_cb);
+  }
+  __tcp_close(pcb);  // calls __tcp_linger_err_cb if aborted
+}
+
 void km_cyw43_deinit() {
   cyw43_arch_lwip_begin();
   for (int i = 0; i < KM_MAX_SOCKET_NO; i++) {
@@ -141,8 +517,18 @@ void km_cyw43_deinit() {
       __socket_info.socket[i].obj = 0;
       if (__socket_info.socket[i].ptcl == NET_SOCKET_STREAM) {
         if (__socket_info.socket[i].tcp_pcb) {
-          __tcp_close(__socket_info.socket[i].tcp_pcb);
+          struct tcp_pcb *pcb = __socket_info.socket[i].tcp_pcb;
+          tcp_sent(pcb, NULL);
+          tcp_err(pcb, NULL);
+          tcp_poll(pcb, NULL, 0);
+          if (__socket_info.socket[i].write_queue.head != NULL) {
+            tcp_abort(pcb);  // the pinned data is freed
+          } else {
+            __tcp_close(pcb);
+          }
+          __socket_info.socket[i].tcp_pcb = NULL;
         }
+        __write_queue_free(&(__socket_info.socket[i].write_queue), false);
         if (__socket_info.socket[i].tcp_server_pcb) {
           __tcp_close(__socket_info.socket[i].tcp_server_pcb);
         }
@@ -150,10 +536,22 @@ void km_cyw43_deinit() {
         if (__socket_info.socket[i].udp_pcb) {
           udp_remove(__socket_info.socket[i].udp_pcb);
         }
+        free(__socket_info.socket[i].rx_buf);
+        __socket_info.socket[i].rx_buf = NULL;
       }
       __socket_info.socket[i].fd = -1;
     }
   }
+  while (__tcp_lingers != NULL) {
+    __tcp_linger_t *linger = __tcp_lingers;
+    __tcp_lingers = linger->next;
+    tcp_arg(linger->pcb, NULL);
+    tcp_sent(linger->pcb, NULL);
+    tcp_err(linger->pcb, NULL);
+    tcp_abort(linger->pcb);
+    __write_queue_free(&(linger->queue), false);
+    free(linger);
+  }
   __cyw43_drv.status_flag = KM_CYW43_STATUS_DISABLED;
   cyw43_arch_lwip_end();
   cyw43_arch_deinit();
@@ -169,9 +567,14 @@ void km_cyw43_infinite_loop() {
     cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, (km_gettime() / 500) % 2 == 0 ? 1 : 0);
 #endif
     cyw43_arch_poll();
+    __dgram_deliver_all();
   }
 }
 
+bool km_cyw43_is_initialized() {
+  return (__cyw43_drv.status_flag & KM_CYW43_STATUS_INIT) != 0;
+}
+
 static int __cyw43_init() {
   int ret = 0;
   if (__cyw43_drv.status_flag == KM_CYW43_STATUS_DISABLED) {
@@ -616,6 +1019,10 @@ JERRYXX_FUN(pico_cyw43_network_socket) {
   }
   __socket_info.socket[fd].server_fd = -1;
   __socket_info.socket[fd].tcp_server_pcb = NULL;
+  __socket_info.socket[fd].write_queue.head = NULL;
+  __socket_info.socket[fd].write_queue.tail = NULL;
+  __socket_info.socket[fd].rx_buf = NULL;
+  __socket_info.socket[fd].rx_pending = false;
   __socket_info.socket[fd].state = NET_SOCKET_STATE_CLOSED;
   __socket_info.socket[fd].ptcl = protocol_param;
   __socket_info.socket[fd].lport = 0;
@@ -693,15 +1100,18 @@ static err_t __net_socket_close(int8_t fd) {
       __socket_info.socket[fd].tcp_server_pcb = NULL;
     }
     if (__socket_info.socket[fd].tcp_pcb != NULL) {
-      __tcp_close(__socket_info.socket[fd].tcp_pcb);
+      __tcp_close_socket(&(__socket_info.socket[fd]));
       __socket_info.socket[fd].tcp_pcb = NULL;
     }
+    __write_queue_free(&(__socket_info.socket[fd].write_queue), true);
   } else { /** UDP */
     if (__socket_info.socket[fd].udp_pcb != NULL) {
       udp_disconnect(__socket_info.socket[fd].udp_pcb);
       udp_remove(__socket_info.socket[fd].udp_pcb);
       __socket_info.socket[fd].udp_pcb = NULL;
     }
+    free(__socket_info.socket[fd].rx_buf);
+    __socket_info.socket[fd].rx_buf = NULL;
   }
   cyw43_arch_lwip_end();
   if (__socket_info.socket[fd].obj == 0) {
@@ -725,44 +1135,34 @@ static err_t __net_data_received(int8_t fd, struct tcp_pcb *tpcb,
                                 struct pbuf *p) {
   err_t err = ERR_OK;
   if (p == NULL) {
-    if (__socket_info.socket[fd].state != NET_SOCKET_STATE_CLOSED || __socket_info.socket[fd].obj != 0)
+    if (km_is_valid_fd(fd) && (__socket_info.socket[fd].state != NET_SOCKET_STATE_CLOSED || __socket_info.socket[fd].obj != 0))
       err = __net_socket_close(fd);
   } else {
-    int8_t read_fd = km_is_valid_fd(__socket_info.socket[fd].server_fd)
-                          ? __socket_info.socket[fd].server_fd : fd;
+    int8_t read_fd = fd;
     if (km_is_valid_fd(read_fd)) {
-      if (__socket_info.socket[read_fd].state == NET_SOCKET_STATE_CLOSED)
-        return err;
-      if (p->tot_len > 0) {
-        uint8_t *receiver_buffer = (uint8_t *)malloc(sizeof(uint8_t) * p->tot_len);
-        uint32_t buff_offset = 0;
-        for (struct pbuf *q = p; q != NULL; q = q->next) {
-          memcpy((uint8_t *)(receiver_buffer + buff_offset), q->payload, q->len);
-          buff_offset += q->len;
-        }
-        if (tpcb) {
-          cyw43_arch_lwip_check();
-          tcp_recved(tpcb, p->tot_len);
+      if (tpcb) {
+        cyw43_arch_lwip_check();
+        tcp_recved(tpcb, p->tot_len);
+      }
+      for (struct pbuf *q = p; q != NULL; q = q->next) {
+        if (__socket_info.socket[read_fd].obj == 0 ||
+            __socket_info.socket[read_fd].state == NET_SOCKET_STATE_CLOSED) {
+          break;
         }
-        if ( __socket_info.socket[read_fd].obj == 0) {
-          free(receiver_buffer);
-          return err;
+        if (q->len == 0) {
+          continue;
         }
         jerry_value_t read_js_cb = jerryxx_get_property(
             __socket_info.socket[read_fd].obj, MSTR_PICO_CYW43_SOCKET_READ_CB);
         if (jerry_value_is_function(read_js_cb)) {
           jerry_value_t this_val = jerry_create_undefined();
-          jerry_value_t buffer =
-              jerry_create_arraybuffer_external(p->tot_len, receiver_buffer, buffer_free_cb);
-          jerry_value_t data = jerry_create_typedarray_for_arraybuffer(
-              JERRY_TYPEDARRAY_UINT8, buffer);
-          jerry_release_value(buffer);
+          jerry_value_t data = __rx_pbuf_to_array(q);
           jerry_value_t args_p[1] = {data};
-          jerry_call_function(read_js_cb, this_val, args_p, 2);
+          jerry_value_t ret_val =
+              jerry_call_function(read_js_cb, this_val, args_p, 1);
+          jerry_release_value(ret_val);
           jerry_release_value(data);
           jerry_release_value(this_val);
-        } else {
-          free(receiver_buffer);
         }
         jerry_release_value(read_js_cb);
       }
@@ -783,14 +1183,43 @@ static err_t __tcp_data_recv_cb(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
   return err;
 }
 
+static void __tcp_err_cb(void *arg, err_t err) {
+  (void)err;
+  // the pcb is already freed (with the data passed to lwIP)
+  int8_t fd = *(int8_t *)arg;
+  if (km_is_valid_fd(fd)) {
+    __socket_info.socket[fd].tcp_pcb = NULL;
+    __write_queue_free(&(__socket_info.socket[fd].write_queue), true);
+    if (__socket_info.socket[fd].state != NET_SOCKET_STATE_CLOSED ||
+        __socket_info.socket[fd].obj != 0) {
+      __net_socket_close(fd);
+    }
+  }
+}
+
 static void __udp_data_recv_cb(void *arg, struct udp_pcb *upcb, struct pbuf *p,
                                const struct ip4_addr *addr,
                                short unsigned int port) {
   (void)upcb;
-  (void)addr;
-  (void)port;
-  int8_t *fd = (int8_t *)arg;
-  __net_data_received(*fd, NULL, p);
+  int8_t fd = *(int8_t *)arg;
+  if (km_is_valid_fd(fd) && __socket_info.socket[fd].rx_buf != NULL) {
+    __socket_data_t *sck = &(__socket_info.socket[fd]);
+    // queued without allocation (dropped if the ring is full)
+    if (ringbuffer_freespace(&(sck->rx_ring)) >=
+        KM_DGRAM_HEADER_SIZE + p->tot_len) {
+      uint32_t raddr = ip4_addr_get_u32(addr);
+      uint8_t header[KM_DGRAM_HEADER_SIZE] = {
+          p->tot_len & 0xff, (p->tot_len >> 8) & 0xff, port & 0xff,
+          (port >> 8) & 0xff};
+      memcpy(header + 4, &raddr, 4);
+      ringbuffer_write(&(sck->rx_ring), header, KM_DGRAM_HEADER_SIZE);
+      for (struct pbuf *q = p; q != NULL; q = q->next) {
+        ringbuffer_write(&(sck->rx_ring), (uint8_t *)q->payload, q->len);
+      }
+      sck->rx_pending = true;
+    }
+  }
+  pbuf_free(p);
 }
 
 static err_t __net_client_connect_cb(void *arg, struct tcp_pcb *tpcb,
@@ -856,10 +1285,13 @@ static err_t __tcp_server_accept_cb(void *arg, struct tcp_pcb *newpcb,
       free(p_str_buff);
       __socket_info.socket[fd].tcp_pcb = newpcb;
       cyw43_arch_lwip_check();
+      __socket_info.socket[fd].write_queue.head = NULL;
+      __socket_info.socket[fd].write_queue.tail = NULL;
       tcp_arg(__socket_info.socket[fd].tcp_pcb, &(__socket_info.socket[fd].fd));
-      tcp_poll(__socket_info.socket[fd].tcp_pcb, NULL, 0);
-      tcp_sent(__socket_info.socket[fd].tcp_pcb, NULL);
-      tcp_err(__socket_info.socket[fd].tcp_pcb, NULL);
+      tcp_poll(__socket_info.socket[fd].tcp_pcb, __tcp_poll_cb,
+               KM_TCP_POLL_INTERVAL);
+      tcp_sent(__socket_info.socket[fd].tcp_pcb, __tcp_data_sent_cb);
+      tcp_err(__socket_info.socket[fd].tcp_pcb, __tcp_err_cb);
       tcp_recv(__socket_info.socket[fd].tcp_pcb, __tcp_data_recv_cb);
       jerry_value_t acept_js_cb =
           jerryxx_get_property(__socket_info.socket[*server_fd].obj,
@@ -952,9 +1384,10 @@ JERRYXX_FUN(pico_cyw43_network_connect) {
       } else {
         tcp_arg(__socket_info.socket[fd].tcp_pcb,
                 &(__socket_info.socket[fd].fd));
-        tcp_poll(__socket_info.socket[fd].tcp_pcb, NULL, 0);
-        tcp_sent(__socket_info.socket[fd].tcp_pcb, NULL);
-        tcp_err(__socket_info.socket[fd].tcp_pcb, NULL);
+        tcp_poll(__socket_info.socket[fd].tcp_pcb, __tcp_poll_cb,
+                 KM_TCP_POLL_INTERVAL);
+        tcp_sent(__socket_info.socket[fd].tcp_pcb, __tcp_data_sent_cb);
+        tcp_err(__socket_info.socket[fd].tcp_pcb, __tcp_err_cb);
         tcp_recv(__socket_info.socket[fd].tcp_pcb, __tcp_data_recv_cb);
         err = tcp_connect(
             __socket_info.socket[fd].tcp_pcb, &(__socket_info.socket[fd].raddr),
@@ -966,6 +1399,8 @@ JERRYXX_FUN(pico_cyw43_network_connect) {
       if (!(__socket_info.socket[fd].udp_pcb)) {
         jerryxx_set_property_number(JERRYXX_GET_THIS,
                                     MSTR_PICO_CYW43_NETWORK_ERRNO, -1);
+      } else if (!__dgram_ring_alloc(&(__socket_info.socket[fd]))) {
+        err = ERR_MEM;
       } else {
         udp_recv(__socket_info.socket[fd].udp_pcb, __udp_data_recv_cb,
                  &(__socket_info.socket[fd].fd));
@@ -1007,31 +1442,63 @@ JERRYXX_FUN(pico_cyw43_network_connect) {
 
 JERRYXX_FUN(pico_cyw43_network_write) {
   JERRYXX_CHECK_ARG_NUMBER(0, "fd");
-  JERRYXX_CHECK_ARG_STRING(1, "data");
+  JERRYXX_CHECK_ARG(1, "data");
   JERRYXX_CHECK_ARG_FUNCTION_OPT(2, "callback");
   int8_t fd = JERRYXX_GET_ARG_NUMBER(0);
   jerry_value_t data = JERRYXX_GET_ARG(1);
   if (km_is_valid_fd(fd) && (((__socket_info.socket[fd].ptcl == NET_SOCKET_DGRAM) &&
                           (__socket_info.socket[fd].state != NET_SOCKET_STATE_CLOSED)) ||
                          ((__socket_info.socket[fd].ptcl == NET_SOCKET_STREAM) &&
-                          (__socket_info.socket[fd].state >= NET_SOCKET_STATE_CONNECTED)))) {
-    jerry_size_t data_str_sz = jerryxx_get_ascii_string_size(data);
-    char *data_str = calloc(1, data_str_sz + 1);
-    jerryxx_string_to_ascii_char_buffer(data, (uint8_t *)data_str, data_str_sz);
+                          (__socket_info.socket[fd].state >= NET_SOCKET_STATE_CONNECTED) &&
+                          (__socket_info.socket[fd].tcp_pcb != NULL)))) {
+    uint8_t *data_buf = NULL;
+    jerry_size_t data_len = 0;
+    jerry_value_t data_pin = __get_write_data(data, &data_buf, &data_len);
     err_t err = ERR_OK;
     cyw43_arch_lwip_begin();
-    if (__socket_info.socket[fd].ptcl == NET_SOCKET_STREAM) {
-      err = tcp_write(__socket_info.socket[fd].tcp_pcb, data_str,
-                      data_str_sz, TCP_WRITE_FLAG_COPY);
-      if (err == ERR_OK) {
-        err = tcp_output(__socket_info.socket[fd].tcp_pcb);
+    if (__socket_info.socket[fd].ptcl == NET_SOCKET_STREAM && data_len > 0) {
+      __write_req_t *req = (__write_req_t *)malloc(sizeof(__write_req_t));
+      if (req == NULL) {
+        err = ERR_MEM;
+      } else {
+        req->next = NULL;
+        req->data = data_pin;
+        req->buf = data_buf;
+        req->len = data_len;
+        req->queued = 0;
+        req->acked = 0;
+        req->cb = JERRYXX_HAS_ARG(2) ? jerry_acquire_value(JERRYXX_GET_ARG(2))
+                                     : 0;
+        __write_queue_t *queue = &(__socket_info.socket[fd].write_queue);
+        if (queue->tail != NULL) {
+          queue->tail->next = req;
+        } else {
+          queue->head = req;
+        }
+        queue->tail = req;
+        data_pin = 0;
+        data_buf = NULL;  // owned by the request
+        err = __tcp_write_pending(&(__socket_info.socket[fd]));
+        if (err == ERR_OK) {
+          cyw43_arch_lwip_end();
+          jerryxx_set_property_number(JERRYXX_GET_THIS,
+                                      MSTR_PICO_CYW43_NETWORK_ERRNO, 0);
+          // callback is called when the data is acknowledged (backpressure)
+          return jerry_create_undefined();
+        }
+        if (req->cb != 0) {
+          jerry_release_value(req->cb);
+          req->cb = 0;
+        }
       }
-    } else {
-      struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, data_str_sz, PBUF_POOL);
+    } else if (__socket_info.socket[fd].ptcl == NET_SOCKET_DGRAM) {
+      struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, data_len, PBUF_REF);
       if (p) {
-        pbuf_take(p, data_str, data_str_sz);
+        p->payload = data_buf;  // lwIP copies if the packet is queued
         err = udp_send(__socket_info.socket[fd].udp_pcb, p);
         pbuf_free(p);
+      } else {
+        err = ERR_MEM;
       }
     }
     cyw43_arch_lwip_end();
@@ -1042,7 +1509,11 @@ JERRYXX_FUN(pico_cyw43_network_write) {
       jerryxx_set_property_number(JERRYXX_GET_THIS,
                                   MSTR_PICO_CYW43_NETWORK_ERRNO, 0);
     }
-    free(data_str);
+    if (data_pin != 0) {
+      jerry_release_value(data_pin);
+    } else if (data_buf != NULL) {
+      free(data_buf);
+    }
   } else {
     jerryxx_set_property_number(JERRYXX_GET_THIS,
                                 MSTR_PICO_CYW43_NETWORK_ERRNO, -1);
@@ -1062,6 +1533,58 @@ JERRYXX_FUN(pico_cyw43_network_write) {
   return jerry_create_undefined();
 }
 
+JERRYXX_FUN(pico_cyw43_network_sendto) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG(1, "data");
+  JERRYXX_CHECK_ARG_STRING(2, "addr");
+  JERRYXX_CHECK_ARG_NUMBER(3, "port");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(4, "callback");
+  int8_t fd = JERRYXX_GET_ARG_NUMBER(0);
+  JERRYXX_GET_ARG_STRING_AS_CHAR(2, addr_str);
+  uint16_t port = JERRYXX_GET_ARG_NUMBER(3);
+  ip_addr_t raddr;
+  err_t err = ERR_ARG;
+  if (km_is_valid_fd(fd) &&
+      __socket_info.socket[fd].ptcl == NET_SOCKET_DGRAM &&
+      __socket_info.socket[fd].udp_pcb != NULL &&
+      ipaddr_aton((const char *)addr_str, &raddr)) {
+    uint8_t *data_buf = NULL;
+    jerry_size_t data_len = 0;
+    jerry_value_t data_pin =
+        __get_write_data(JERRYXX_GET_ARG(1), &data_buf, &data_len);
+    cyw43_arch_lwip_begin();
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, data_len, PBUF_REF);
+    if (p) {
+      p->payload = data_buf;  // lwIP copies if the packet is queued
+      err = udp_sendto(__socket_info.socket[fd].udp_pcb, p, &raddr, port);
+      pbuf_free(p);
+    } else {
+      err = ERR_MEM;
+    }
+    cyw43_arch_lwip_end();
+    if (data_pin != 0) {
+      jerry_release_value(data_pin);
+    } else {
+      free(data_buf);
+    }
+  }
+  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_PICO_CYW43_NETWORK_ERRNO,
+                              err == ERR_OK ? 0 : -1);
+  if (JERRYXX_HAS_ARG(4)) {
+    jerry_value_t callback = JERRYXX_GET_ARG(4);
+    jerry_value_t js_cb = jerry_acquire_value(callback);
+    jerry_value_t errno = jerryxx_get_property_number(
+        JERRYXX_GET_THIS, MSTR_PICO_CYW43_NETWORK_ERRNO, 0);
+    jerry_value_t this_val = jerry_create_undefined();
+    jerry_value_t args_p[1] = {errno};
+    jerry_call_function(js_cb, this_val, args_p, 1);
+    jerry_release_value(errno);
+    jerry_release_value(this_val);
+    jerry_release_value(js_cb);
+  }
+  return jerry_create_undefined();
+}
+
 JERRYXX_FUN(pico_cyw43_network_close) {
   JERRYXX_CHECK_ARG_NUMBER(0, "fd");
   JERRYXX_CHECK_ARG_FUNCTION_OPT(1, "callback");
@@ -1225,7 +1748,13 @@ JERRYXX_FUN(pico_cyw43_network_bind) {
       if (__socket_info.socket[fd].udp_pcb != NULL) {
         err = udp_bind(__socket_info.socket[fd].udp_pcb, &(__socket_info.laddr),
                      __socket_info.socket[fd].lport);
+        if (err == ERR_OK && !__dgram_ring_alloc(&(__socket_info.socket[fd]))) {
+          err = ERR_MEM;
+        }
         if (err == ERR_OK) {
+          // the port is assigned if 0
+          __socket_info.socket[fd].lport =
+              __socket_info.socket[fd].udp_pcb->local_port;
           udp_recv(__socket_info.socket[fd].udp_pcb, __udp_data_recv_cb,
                    &(__socket_info.socket[fd].fd));
         }
@@ -1242,6 +1771,9 @@ JERRYXX_FUN(pico_cyw43_network_bind) {
       jerryxx_set_property_number(__socket_info.socket[fd].obj,
                                   MSTR_PICO_CYW43_SOCKET_STATE,
                                   __socket_info.socket[fd].state);
+      jerryxx_set_property_number(__socket_info.socket[fd].obj,
+                                  MSTR_PICO_CYW43_SOCKET_LPORT,
+                                  __socket_info.socket[fd].lport);
     }
   } else {
     jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_PICO_CYW43_NETWORK_ERRNO,
@@ -1533,6 +2065,9 @@ jerry_value_t module_pico_cyw43_init() {
   jerryxx_set_property_function(network_prototype,
                                 MSTR_PICO_CYW43_NETWORK_WRITE,
                                 pico_cyw43_network_write);
+  jerryxx_set_property_function(network_prototype,
+                                MSTR_PICO_CYW43_NETWORK_SENDTO,
+                                pico_cyw43_network_sendto);
   jerryxx_set_property_function(network_prototype,
                                 MSTR_PICO_CYW43_NETWORK_CLOSE,
                                 pico_cyw43_network_close);
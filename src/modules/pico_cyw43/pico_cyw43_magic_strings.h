@@ -45,6 +45,7 @@
 #define MSTR_PICO_CYW43_NETWORK_GET "get"
 #define MSTR_PICO_CYW43_NETWORK_CONNECT "connect"
 #define MSTR_PICO_CYW43_NETWORK_WRITE "write"
+#define MSTR_PICO_CYW43_NETWORK_SENDTO "sendto"
 #define MSTR_PICO_CYW43_NETWORK_CLOSE "close"
 #define MSTR_PICO_CYW43_NETWORK_SHUTDOWN "shutdown"
 #define MSTR_PICO_CYW43_NETWORK_BIND "bind"
@@ -68,6 +69,7 @@
 #define MSTR_PICO_CYW43_SOCKET_READ_CB "read_cb"
 #define MSTR_PICO_CYW43_SOCKET_ACCEPT_CB "accept_cb"
 #define MSTR_PICO_CYW43_SOCKET_SHUTDOWN_CB "shutdown_cb"
+#define MSTR_PICO_CYW43_SOCKET_MESSAGE_CB "message_cb"
 
 /* AP_mode strings */
 #define MSTR_PICO_CYW43_WIFI_APMODE_FN "wifiApMode"
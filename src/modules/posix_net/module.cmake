@@ -0,0 +1,4 @@
+list(APPEND SOURCES
+  ${SRC_DIR}/modules/posix_net/module_posix_net.c)
+include_directories(${SRC_DIR}/modules/posix_net)
+add_definitions(-DMODULE_POSIX_NET_SELECTED)
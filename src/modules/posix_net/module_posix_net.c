@@ -0,0 +1,860 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE /* accept4 */
+
+#include "module_posix_net.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "fdpoll.h"
+#include "jerryscript.h"
+#include "jerryxx.h"
+#include "magic_strings.h"
+#include "posix_net_magic_strings.h"
+#include "ringbuffer.h"
+
+/**
+ * Network device on POSIX sockets, with the same interface as the
+ * PicoCYW43Network device (global.__netdev). Sockets are non-blocking and
+ * driven by the event loop (fdpoll), and socket numbers are the file
+ * descriptors so the number of sockets is limited only by the system.
+ */
+
+#define NET_SOCKET_STREAM 0 /* TCP SOCKET */
+#define NET_SOCKET_DGRAM 1  /* UDP SOCKET */
+
+#define NET_SOCKET_STATE_CLOSED 0
+#define NET_SOCKET_STATE_BIND 1
+#define NET_SOCKET_STATE_CONNECTED 2
+#define NET_SOCKET_STATE_LISTENING 3
+
+#define NET_READ_SIZE 16384
+#define NET_ADDR_LEN 16
+
+/**
+ * Received datagrams are queued in a ring per socket and passed to
+ * message_cb in batches. Each datagram in a batch is a header (length,
+ * remote port in 2 bytes little-endian each, remote IPv4 address in 4
+ * bytes) followed by the data.
+ */
+#define NET_DGRAM_RING_SIZE 65536
+#define NET_DGRAM_HEADER_SIZE 8
+#define NET_DGRAM_MAX_SIZE 65507
+#define NET_DGRAM_BATCH_MAX 64 /* datagrams received per event */
+
+typedef struct {
+  int fd;
+  int8_t ptcl;
+  int8_t state;
+  bool connecting;
+  bool eof;             /* received end of stream from the peer */
+  int8_t shutdown_how;  /* shutdown waiting for the pending data, or -1 */
+  jerry_value_t obj;
+  uint8_t *wbuf; /* pending data not written yet */
+  size_t wlen;
+  size_t woff;
+  jerry_value_t write_cb; /* called when the pending data is written */
+  ringbuffer_t rx_ring;   /* received datagrams (DGRAM) */
+  uint8_t *rx_buf;
+} __socket_t;
+
+static __socket_t **__sockets = NULL;
+static int __sockets_size = 0;
+static jerry_value_t __netdev = 0;
+static uint8_t __dgram_buf[NET_DGRAM_HEADER_SIZE + NET_DGRAM_MAX_SIZE];
+
+static void __readable_cb(int fd, void *data);
+static void __writable_cb(int fd, void *data);
+
+static void buffer_free_cb(void *native_p) { free(native_p); }
+
+static __socket_t *__socket_get(int fd) {
+  if (fd >= 0 && fd < __sockets_size) {
+    return __sockets[fd];
+  }
+  return NULL;
+}
+
+static void __set_errno(int err) {
+  if (__netdev != 0) {
+    jerryxx_set_property_number(__netdev, MSTR_POSIX_NET_ERRNO, err);
+  }
+}
+
+/**
+ * Call a callback property of the socket object
+ */
+static void __socket_call(__socket_t *sck, const char *name,
+                          const jerry_value_t *args, jerry_size_t args_cnt) {
+  jerry_value_t obj = jerry_acquire_value(sck->obj);
+  jerry_value_t js_cb = jerryxx_get_property(obj, name);
+  if (jerry_value_is_function(js_cb)) {
+    jerry_value_t this_val = jerry_create_undefined();
+    jerry_value_t ret_val = jerry_call_function(js_cb, this_val, args,
+                                                args_cnt);
+    if (jerry_value_is_error(ret_val)) {
+      jerryxx_print_error(ret_val, true);
+    }
+    jerry_release_value(ret_val);
+    jerry_release_value(this_val);
+  }
+  jerry_release_value(js_cb);
+  jerry_release_value(obj);
+}
+
+/**
+ * Call the result callback of a function with the errno
+ */
+static void __call_result_cb(jerry_value_t js_cb, int err) {
+  __set_errno(err);
+  if (jerry_value_is_function(js_cb)) {
+    jerry_value_t this_val = jerry_create_undefined();
+    jerry_value_t err_val = jerry_create_number(err);
+    jerry_value_t ret_val = jerry_call_function(js_cb, this_val, &err_val, 1);
+    if (jerry_value_is_error(ret_val)) {
+      jerryxx_print_error(ret_val, true);
+    }
+    jerry_release_value(ret_val);
+    jerry_release_value(err_val);
+    jerry_release_value(this_val);
+  }
+}
+
+static void __set_addr_props(jerry_value_t obj, const char *addr_name,
+                             const char *port_name, struct sockaddr_in *addr) {
+  char addr_str[NET_ADDR_LEN];
+  inet_ntop(AF_INET, &addr->sin_addr, addr_str, sizeof(addr_str));
+  jerryxx_set_property_string(obj, addr_name, addr_str);
+  jerryxx_set_property_number(obj, port_name, ntohs(addr->sin_port));
+}
+
+/**
+ * Update local and remote addresses of the socket object
+ */
+static void __socket_update_addr(__socket_t *sck) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (getsockname(sck->fd, (struct sockaddr *)&addr, &len) == 0) {
+    __set_addr_props(sck->obj, MSTR_POSIX_NET_SOCKET_LADDR,
+                     MSTR_POSIX_NET_SOCKET_LPORT, &addr);
+  }
+  len = sizeof(addr);
+  if (getpeername(sck->fd, (struct sockaddr *)&addr, &len) == 0) {
+    __set_addr_props(sck->obj, MSTR_POSIX_NET_SOCKET_RADDR,
+                     MSTR_POSIX_NET_SOCKET_RPORT, &addr);
+  }
+}
+
+static void __socket_set_state(__socket_t *sck, int8_t state) {
+  sck->state = state;
+  jerryxx_set_property_number(sck->obj, MSTR_POSIX_NET_SOCKET_STATE, state);
+}
+
+static __socket_t *__socket_create(int fd, int8_t ptcl) {
+  if (fd >= __sockets_size) {
+    int size = __sockets_size > 0 ? __sockets_size : 16;
+    while (size <= fd) {
+      size *= 2;
+    }
+    __socket_t **sockets =
+        (__socket_t **)realloc(__sockets, size * sizeof(__socket_t *));
+    if (sockets == NULL) {
+      return NULL;
+    }
+    memset(sockets + __sockets_size, 0,
+           (size - __sockets_size) * sizeof(__socket_t *));
+    __sockets = sockets;
+    __sockets_size = size;
+  }
+  __socket_t *sck = (__socket_t *)calloc(1, sizeof(__socket_t));
+  if (sck == NULL) {
+    return NULL;
+  }
+  if (ptcl == NET_SOCKET_DGRAM) {
+    sck->rx_buf = (uint8_t *)malloc(NET_DGRAM_RING_SIZE);
+    if (sck->rx_buf == NULL) {
+      free(sck);
+      return NULL;
+    }
+    ringbuffer_init(&sck->rx_ring, sck->rx_buf, NET_DGRAM_RING_SIZE);
+  }
+  sck->fd = fd;
+  sck->ptcl = ptcl;
+  sck->state = NET_SOCKET_STATE_CLOSED;
+  sck->shutdown_how = -1;
+  sck->obj = jerry_create_object();
+  jerryxx_set_property_number(sck->obj, MSTR_POSIX_NET_SOCKET_FD, fd);
+  jerryxx_set_property_string(sck->obj, MSTR_POSIX_NET_SOCKET_PTCL,
+                              ptcl == NET_SOCKET_STREAM ? "STREAM" : "DGRAM");
+  jerryxx_set_property_number(sck->obj, MSTR_POSIX_NET_SOCKET_STATE,
+                              sck->state);
+  struct sockaddr_in addr = {.sin_family = AF_INET};
+  __set_addr_props(sck->obj, MSTR_POSIX_NET_SOCKET_LADDR,
+                   MSTR_POSIX_NET_SOCKET_LPORT, &addr);
+  __set_addr_props(sck->obj, MSTR_POSIX_NET_SOCKET_RADDR,
+                   MSTR_POSIX_NET_SOCKET_RPORT, &addr);
+  __sockets[fd] = sck;
+  return sck;
+}
+
+/**
+ * Close the socket and call close_cb
+ */
+static void __socket_close(__socket_t *sck) {
+  __sockets[sck->fd] = NULL;
+  km_fdpoll_remove(sck->fd);
+  close(sck->fd);
+  free(sck->wbuf);
+  free(sck->rx_buf);
+  if (sck->write_cb != 0) {
+    jerry_release_value(sck->write_cb);
+  }
+  __socket_call(sck, MSTR_POSIX_NET_SOCKET_CLOSE_CB, NULL, 0);
+  jerry_release_value(sck->obj);
+  free(sck);
+}
+
+static int __socket_shutdown(__socket_t *sck, int how) {
+  int ret = shutdown(sck->fd, how == 0 ? SHUT_RD : (how == 1 ? SHUT_WR
+                                                             : SHUT_RDWR));
+  if (ret < 0) {
+    return -errno;
+  }
+  __socket_call(sck, MSTR_POSIX_NET_SOCKET_SHUTDOWN_CB, NULL, 0);
+  return 0;
+}
+
+/**
+ * Resolve an IPv4 address (dotted or host name)
+ */
+static int __resolve(const char *host, struct in_addr *addr) {
+  if (inet_pton(AF_INET, host, addr) == 1) {
+    return 0;
+  }
+  struct addrinfo hints = {.ai_family = AF_INET};
+  struct addrinfo *res = NULL;
+  if (getaddrinfo(host, NULL, &hints, &res) != 0 || res == NULL) {
+    return -EHOSTUNREACH;
+  }
+  *addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+  freeaddrinfo(res);
+  return 0;
+}
+
+/**
+ * Get data (Uint8Array or string) to write. Returns the pointer to the data,
+ * which should be freed if *alloc is set.
+ */
+static uint8_t *__get_data(jerry_value_t data, size_t *len, bool *alloc) {
+  if (jerry_value_is_typedarray(data) &&
+      jerry_get_typedarray_type(data) == JERRY_TYPEDARRAY_UINT8) {
+    jerry_length_t byteLength = 0;
+    jerry_length_t byteOffset = 0;
+    jerry_value_t array_buffer =
+        jerry_get_typedarray_buffer(data, &byteOffset, &byteLength);
+    uint8_t *buf = jerry_get_arraybuffer_pointer(array_buffer) + byteOffset;
+    jerry_release_value(array_buffer);
+    *len = byteLength;
+    *alloc = false;
+    return buf;
+  }
+  jerry_value_t str = jerry_value_to_string(data);
+  *len = jerryxx_get_ascii_string_size(str);
+  uint8_t *buf = (uint8_t *)malloc(*len + 1);
+  if (buf != NULL) {
+    jerryxx_string_to_ascii_char_buffer(str, buf, *len);
+  }
+  jerry_release_value(str);
+  *alloc = true;
+  return buf;
+}
+
+static void __accept(__socket_t *server) {
+  int server_fd = server->fd;
+  while ((server = __socket_get(server_fd)) != NULL) {
+    int fd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      break;  // EAGAIN, or out of descriptors (retried when readable)
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    __socket_t *sck = __socket_create(fd, NET_SOCKET_STREAM);
+    if (sck == NULL || km_fdpoll_add(fd, __readable_cb, NULL) < 0) {
+      if (sck != NULL) {
+        __sockets[fd] = NULL;
+        jerry_release_value(sck->obj);
+        free(sck);
+      }
+      close(fd);
+      continue;
+    }
+    __socket_set_state(sck, NET_SOCKET_STATE_CONNECTED);
+    __socket_update_addr(sck);
+    jerry_value_t fd_val = jerry_create_number(fd);
+    __socket_call(server, MSTR_POSIX_NET_SOCKET_ACCEPT_CB, &fd_val, 1);
+    jerry_release_value(fd_val);
+  }
+}
+
+/**
+ * Pass the queued datagrams to message_cb in a batch
+ */
+static void __dgram_deliver(__socket_t *sck) {
+  uint32_t len = ringbuffer_length(&sck->rx_ring);
+  if (len == 0) {
+    return;
+  }
+  jerry_value_t buffer = jerry_create_arraybuffer(len);
+  ringbuffer_read(&sck->rx_ring, jerry_get_arraybuffer_pointer(buffer), len);
+  jerry_value_t batch =
+      jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8, buffer);
+  __socket_call(sck, MSTR_POSIX_NET_SOCKET_MESSAGE_CB, &batch, 1);
+  jerry_release_value(batch);
+  jerry_release_value(buffer);
+}
+
+static void __read_dgram(__socket_t *sck) {
+  int fd = sck->fd;
+  uint8_t *data = __dgram_buf + NET_DGRAM_HEADER_SIZE;
+  for (int i = 0; i < NET_DGRAM_BATCH_MAX; i++) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    ssize_t n = recvfrom(fd, data, NET_DGRAM_MAX_SIZE, 0,
+                         (struct sockaddr *)&addr, &addr_len);
+    if (n < 0) {
+      break;
+    }
+    uint16_t port = ntohs(addr.sin_port);
+    __dgram_buf[0] = n & 0xff;
+    __dgram_buf[1] = (n >> 8) & 0xff;
+    __dgram_buf[2] = port & 0xff;
+    __dgram_buf[3] = (port >> 8) & 0xff;
+    memcpy(__dgram_buf + 4, &addr.sin_addr, 4);
+    uint32_t size = NET_DGRAM_HEADER_SIZE + n;
+    if (ringbuffer_freespace(&sck->rx_ring) < size) {
+      __dgram_deliver(sck);
+      if ((sck = __socket_get(fd)) == NULL) {
+        return;
+      }
+    }
+    ringbuffer_write(&sck->rx_ring, __dgram_buf, size);
+  }
+  __dgram_deliver(sck);
+}
+
+static void __read_stream(__socket_t *sck) {
+  uint8_t *buf = (uint8_t *)malloc(NET_READ_SIZE);
+  if (buf == NULL) {
+    return;
+  }
+  ssize_t n = read(sck->fd, buf, NET_READ_SIZE);
+  if (n > 0) {
+    uint8_t *data_buf = (uint8_t *)realloc(buf, n);
+    jerry_value_t buffer = jerry_create_arraybuffer_external(
+        n, data_buf ? data_buf : buf, buffer_free_cb);
+    jerry_value_t data =
+        jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8, buffer);
+    __socket_call(sck, MSTR_POSIX_NET_SOCKET_READ_CB, &data, 1);
+    jerry_release_value(data);
+    jerry_release_value(buffer);
+    return;
+  }
+  free(buf);
+  if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+  if (n == 0) {
+    // end of stream: close after the pending data is written
+    sck->eof = true;
+    km_fdpoll_set_readable(sck->fd, NULL);
+    int fd = sck->fd;
+    __socket_call(sck, MSTR_POSIX_NET_SOCKET_SHUTDOWN_CB, NULL, 0);
+    sck = __socket_get(fd);
+    if (sck == NULL || sck->wbuf != NULL) {
+      return;
+    }
+  }
+  __socket_close(sck);
+}
+
+static void __readable_cb(int fd, void *data) {
+  __socket_t *sck = __socket_get(fd);
+  if (sck == NULL) {
+    return;
+  }
+  if (sck->state == NET_SOCKET_STATE_LISTENING) {
+    __accept(sck);
+  } else if (sck->ptcl == NET_SOCKET_DGRAM) {
+    __read_dgram(sck);
+  } else if (!sck->connecting) {
+    __read_stream(sck);
+  }
+}
+
+/**
+ * Write the pending data. Returns negative errno on failure.
+ */
+static int __socket_flush(__socket_t *sck) {
+  while (sck->woff < sck->wlen) {
+    ssize_t n = send(sck->fd, sck->wbuf + sck->woff, sck->wlen - sck->woff,
+                     MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return errno == EAGAIN ? 0 : -errno;
+    }
+    sck->woff += n;
+  }
+  return 0;
+}
+
+static void __writable_cb(int fd, void *data) {
+  __socket_t *sck = __socket_get(fd);
+  if (sck == NULL) {
+    return;
+  }
+  if (sck->connecting) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+      __set_errno(-err);
+      jerry_value_t err_val = jerry_create_number(-err);
+      __socket_call(sck, MSTR_POSIX_NET_SOCKET_ERROR_CB, &err_val, 1);
+      jerry_release_value(err_val);
+      if ((sck = __socket_get(fd)) != NULL) {
+        __socket_close(sck);
+      }
+      return;
+    }
+    sck->connecting = false;
+    __socket_update_addr(sck);
+    if (sck->wbuf == NULL) {
+      km_fdpoll_set_writable(fd, NULL);
+    }
+    __socket_call(sck, MSTR_POSIX_NET_SOCKET_CONNECT_CB, NULL, 0);
+    return;
+  }
+  int ret = __socket_flush(sck);
+  if (ret < 0) {
+    __set_errno(ret);
+    __socket_close(sck);
+    return;
+  }
+  if (sck->woff < sck->wlen) {
+    return;  // wait for writable again
+  }
+  free(sck->wbuf);
+  sck->wbuf = NULL;
+  sck->wlen = 0;
+  sck->woff = 0;
+  km_fdpoll_set_writable(fd, NULL);
+  if (sck->write_cb != 0) {
+    jerry_value_t write_cb = sck->write_cb;
+    sck->write_cb = 0;
+    __call_result_cb(write_cb, 0);
+    jerry_release_value(write_cb);
+  }
+  if ((sck = __socket_get(fd)) == NULL) {
+    return;
+  }
+  if (sck->shutdown_how >= 0) {
+    int how = sck->shutdown_how;
+    sck->shutdown_how = -1;
+    __socket_shutdown(sck, how);
+    if ((sck = __socket_get(fd)) == NULL) {
+      return;
+    }
+  }
+  if (sck->eof) {
+    __socket_close(sck);
+  }
+}
+
+JERRYXX_FUN(posix_net_ctor_fn) {
+  if (__netdev != 0) {
+    jerry_release_value(__netdev);
+  }
+  __netdev = jerry_acquire_value(JERRYXX_GET_THIS);
+  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_POSIX_NET_ERRNO, 0);
+  jerryxx_set_property_string(JERRYXX_GET_THIS, MSTR_POSIX_NET_IP, "0.0.0.0");
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_socket_fn) {
+  JERRYXX_CHECK_ARG_STRING(0, "domain");
+  JERRYXX_CHECK_ARG_STRING(1, "protocol");
+  JERRYXX_GET_ARG_STRING_AS_CHAR(1, protocol);
+  int8_t ptcl = NET_SOCKET_STREAM;
+  if (strcmp(protocol, "DGRAM") == 0) {
+    ptcl = NET_SOCKET_DGRAM;
+  } else if (strcmp(protocol, "STREAM") != 0) {
+    return jerry_create_error(
+        JERRY_ERROR_TYPE,
+        (const jerry_char_t *)"un-supported domain or protocol.");
+  }
+  int fd = socket(AF_INET,
+                  (ptcl == NET_SOCKET_STREAM ? SOCK_STREAM : SOCK_DGRAM) |
+                      SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  0);
+  if (fd < 0) {
+    __set_errno(-errno);
+    return jerry_create_number(-1);
+  }
+  if (__socket_create(fd, ptcl) == NULL) {
+    close(fd);
+    __set_errno(-ENOMEM);
+    return jerry_create_number(-1);
+  }
+  __set_errno(0);
+  return jerry_create_number(fd);
+}
+
+JERRYXX_FUN(posix_net_get_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  __socket_t *sck = __socket_get(JERRYXX_GET_ARG_NUMBER(0));
+  if (sck == NULL) {
+    return jerry_create_undefined();
+  }
+  return jerry_acquire_value(sck->obj);
+}
+
+JERRYXX_FUN(posix_net_connect_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG_STRING(1, "addr");
+  JERRYXX_CHECK_ARG_NUMBER(2, "port");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(3, "callback");
+  int fd = JERRYXX_GET_ARG_NUMBER(0);
+  JERRYXX_GET_ARG_STRING_AS_CHAR(1, addr_str);
+  uint16_t port = JERRYXX_GET_ARG_NUMBER(2);
+  __socket_t *sck = __socket_get(fd);
+  int err = 0;
+  if (sck == NULL || sck->state == NET_SOCKET_STATE_CONNECTED ||
+      sck->state == NET_SOCKET_STATE_LISTENING) {
+    err = -EBADF;
+  } else {
+    struct sockaddr_in addr = {.sin_family = AF_INET,
+                               .sin_port = htons(port)};
+    err = __resolve(addr_str, &addr.sin_addr);
+    if (err == 0) {
+      __set_addr_props(sck->obj, MSTR_POSIX_NET_SOCKET_RADDR,
+                       MSTR_POSIX_NET_SOCKET_RPORT, &addr);
+      if (sck->ptcl == NET_SOCKET_STREAM) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+      if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 &&
+          errno != EINPROGRESS) {
+        err = -errno;
+      } else if ((sck->state == NET_SOCKET_STATE_BIND &&
+                  sck->ptcl == NET_SOCKET_DGRAM) ||
+                 km_fdpoll_add(fd, __readable_cb, NULL) == 0) {
+        if (sck->ptcl == NET_SOCKET_STREAM) {
+          // connect_cb is called when the socket gets writable
+          sck->connecting = true;
+          km_fdpoll_set_writable(fd, __writable_cb);
+        } else {
+          __socket_update_addr(sck);
+        }
+        __socket_set_state(sck, NET_SOCKET_STATE_CONNECTED);
+      } else {
+        err = -ENOMEM;
+      }
+    }
+  }
+  if (JERRYXX_HAS_ARG(3)) {
+    __call_result_cb(JERRYXX_GET_ARG(3), err);
+  } else {
+    __set_errno(err);
+  }
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_write_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG(1, "data");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(2, "callback");
+  int fd = JERRYXX_GET_ARG_NUMBER(0);
+  jerry_value_t callback =
+      JERRYXX_HAS_ARG(2) ? JERRYXX_GET_ARG(2) : jerry_create_undefined();
+  __socket_t *sck = __socket_get(fd);
+  int err = 0;
+  if (sck == NULL || sck->state != NET_SOCKET_STATE_CONNECTED) {
+    err = -ENOTCONN;
+  } else {
+    size_t len = 0;
+    bool alloc = false;
+    uint8_t *buf = __get_data(JERRYXX_GET_ARG(1), &len, &alloc);
+    if (buf == NULL) {
+      err = -ENOMEM;
+    } else if (sck->wbuf != NULL) {
+      // queued after the pending data (the callback is called now)
+      uint8_t *wbuf = (uint8_t *)realloc(sck->wbuf, sck->wlen + len);
+      if (wbuf == NULL) {
+        err = -ENOMEM;
+      } else {
+        memcpy(wbuf + sck->wlen, buf, len);
+        sck->wbuf = wbuf;
+        sck->wlen += len;
+      }
+    } else {
+      size_t sent = 0;
+      while (!sck->connecting && sent < len) {
+        ssize_t n = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+          if (errno == EINTR) continue;
+          if (errno != EAGAIN) err = -errno;
+          break;
+        }
+        sent += n;
+      }
+      if (err == 0 && sent < len) {
+        // keep the rest and call back when it is written (backpressure)
+        sck->wbuf = (uint8_t *)malloc(len - sent);
+        if (sck->wbuf == NULL) {
+          err = -ENOMEM;
+        } else {
+          memcpy(sck->wbuf, buf + sent, len - sent);
+          sck->wlen = len - sent;
+          sck->woff = 0;
+          if (!sck->connecting) {
+            km_fdpoll_set_writable(fd, __writable_cb);
+          }
+          if (jerry_value_is_function(callback)) {
+            sck->write_cb = jerry_acquire_value(callback);
+          }
+          if (alloc) {
+            free(buf);
+          }
+          return jerry_create_undefined();
+        }
+      }
+    }
+    if (alloc) {
+      free(buf);
+    }
+  }
+  __call_result_cb(callback, err);
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_sendto_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG(1, "data");
+  JERRYXX_CHECK_ARG_STRING(2, "addr");
+  JERRYXX_CHECK_ARG_NUMBER(3, "port");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(4, "callback");
+  int fd = JERRYXX_GET_ARG_NUMBER(0);
+  JERRYXX_GET_ARG_STRING_AS_CHAR(2, addr_str);
+  uint16_t port = JERRYXX_GET_ARG_NUMBER(3);
+  __socket_t *sck = __socket_get(fd);
+  int err = 0;
+  if (sck == NULL || sck->ptcl != NET_SOCKET_DGRAM) {
+    err = -EBADF;
+  } else {
+    struct sockaddr_in addr = {.sin_family = AF_INET,
+                               .sin_port = htons(port)};
+    err = __resolve(addr_str, &addr.sin_addr);
+    if (err == 0) {
+      size_t len = 0;
+      bool alloc = false;
+      uint8_t *buf = __get_data(JERRYXX_GET_ARG(1), &len, &alloc);
+      if (buf == NULL) {
+        err = -ENOMEM;
+      } else {
+        if (sendto(fd, buf, len, 0, (struct sockaddr *)&addr, sizeof(addr)) <
+            0) {
+          err = -errno;
+        }
+        if (alloc) {
+          free(buf);
+        }
+      }
+    }
+  }
+  if (JERRYXX_HAS_ARG(4)) {
+    __call_result_cb(JERRYXX_GET_ARG(4), err);
+  } else {
+    __set_errno(err);
+  }
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_close_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(1, "callback");
+  __socket_t *sck = __socket_get(JERRYXX_GET_ARG_NUMBER(0));
+  if (sck != NULL) {
+    __socket_close(sck);
+  }
+  if (JERRYXX_HAS_ARG(1)) {
+    __call_result_cb(JERRYXX_GET_ARG(1), 0);
+  } else {
+    __set_errno(0);
+  }
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_shutdown_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG_NUMBER(1, "how");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(2, "callback");
+  __socket_t *sck = __socket_get(JERRYXX_GET_ARG_NUMBER(0));
+  int how = JERRYXX_GET_ARG_NUMBER(1);
+  int err = 0;
+  if (sck == NULL) {
+    err = -EBADF;
+  } else if (sck->ptcl == NET_SOCKET_STREAM) {
+    if (sck->wbuf != NULL || sck->connecting) {
+      sck->shutdown_how = how;  // after the pending data is written
+    } else {
+      err = __socket_shutdown(sck, how);
+    }
+  }
+  if (JERRYXX_HAS_ARG(2)) {
+    __call_result_cb(JERRYXX_GET_ARG(2), err);
+  } else {
+    __set_errno(err);
+  }
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_bind_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG_STRING(1, "addr");
+  JERRYXX_CHECK_ARG_NUMBER(2, "port");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(3, "callback");
+  int fd = JERRYXX_GET_ARG_NUMBER(0);
+  JERRYXX_GET_ARG_STRING_AS_CHAR(1, addr_str);
+  uint16_t port = JERRYXX_GET_ARG_NUMBER(2);
+  __socket_t *sck = __socket_get(fd);
+  int err = 0;
+  if (sck == NULL || sck->state != NET_SOCKET_STATE_CLOSED) {
+    err = -EBADF;
+  } else {
+    struct sockaddr_in addr = {.sin_family = AF_INET,
+                               .sin_port = htons(port)};
+    err = __resolve(addr_str, &addr.sin_addr);
+    if (err == 0) {
+      int one = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        err = -errno;
+      } else if (sck->ptcl == NET_SOCKET_DGRAM &&
+                 km_fdpoll_add(fd, __readable_cb, NULL) < 0) {
+        err = -ENOMEM;
+      } else {
+        __socket_update_addr(sck);
+        __socket_set_state(sck, NET_SOCKET_STATE_BIND);
+      }
+    }
+  }
+  if (JERRYXX_HAS_ARG(3)) {
+    __call_result_cb(JERRYXX_GET_ARG(3), err);
+  } else {
+    __set_errno(err);
+  }
+  return jerry_create_undefined();
+}
+
+JERRYXX_FUN(posix_net_listen_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "fd");
+  JERRYXX_CHECK_ARG_FUNCTION_OPT(1, "callback");
+  int fd = JERRYXX_GET_ARG_NUMBER(0);
+  __socket_t *sck = __socket_get(fd);
+  int err = 0;
+  if (sck == NULL || sck->state != NET_SOCKET_STATE_BIND ||
+      sck->ptcl != NET_SOCKET_STREAM) {
+    err = -EBADF;
+  } else if (listen(fd, SOMAXCONN) < 0) {
+    err = -errno;
+  } else if (km_fdpoll_add(fd, __readable_cb, NULL) < 0) {
+    err = -ENOMEM;
+  } else {
+    __socket_set_state(sck, NET_SOCKET_STATE_LISTENING);
+  }
+  if (JERRYXX_HAS_ARG(1)) {
+    __call_result_cb(JERRYXX_GET_ARG(1), err);
+  } else {
+    __set_errno(err);
+  }
+  return jerry_create_undefined();
+}
+
+void km_posix_net_cleanup() {
+  // JS values are not released since the JS context is already cleaned up
+  for (int fd = 0; fd < __sockets_size; fd++) {
+    __socket_t *sck = __sockets[fd];
+    if (sck != NULL) {
+      km_fdpoll_remove(fd);
+      close(fd);
+      free(sck->wbuf);
+      free(sck->rx_buf);
+      free(sck);
+    }
+  }
+  free(__sockets);
+  __sockets = NULL;
+  __sockets_size = 0;
+  __netdev = 0;
+}
+
+jerry_value_t module_posix_net_init() {
+  jerry_value_t network_ctor =
+      jerry_create_external_function(posix_net_ctor_fn);
+  jerry_value_t prototype = jerry_create_object();
+  jerryxx_set_property(network_ctor, MSTR_PROTOTYPE, prototype);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_SOCKET,
+                                posix_net_socket_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_GET,
+                                posix_net_get_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_CONNECT,
+                                posix_net_connect_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_WRITE,
+                                posix_net_write_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_SENDTO,
+                                posix_net_sendto_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_CLOSE,
+                                posix_net_close_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_SHUTDOWN,
+                                posix_net_shutdown_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_BIND,
+                                posix_net_bind_fn);
+  jerryxx_set_property_function(prototype, MSTR_POSIX_NET_LISTEN,
+                                posix_net_listen_fn);
+  jerry_release_value(prototype);
+
+  jerry_value_t exports = jerry_create_object();
+  jerryxx_set_property(exports, MSTR_POSIX_NET_POSIX_NETWORK, network_ctor);
+  jerry_release_value(network_ctor);
+  return exports;
+}
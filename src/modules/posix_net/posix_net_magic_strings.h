@@ -0,0 +1,52 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __POSIX_NET_MAGIC_STRINGS_H
+#define __POSIX_NET_MAGIC_STRINGS_H
+
+#define MSTR_POSIX_NET_POSIX_NETWORK "PosixNetwork"
+#define MSTR_POSIX_NET_ERRNO "errno"
+#define MSTR_POSIX_NET_IP "ip"
+#define MSTR_POSIX_NET_SOCKET "socket"
+#define MSTR_POSIX_NET_GET "get"
+#define MSTR_POSIX_NET_CONNECT "connect"
+#define MSTR_POSIX_NET_WRITE "write"
+#define MSTR_POSIX_NET_SENDTO "sendto"
+#define MSTR_POSIX_NET_CLOSE "close"
+#define MSTR_POSIX_NET_SHUTDOWN "shutdown"
+#define MSTR_POSIX_NET_BIND "bind"
+#define MSTR_POSIX_NET_LISTEN "listen"
+#define MSTR_POSIX_NET_SOCKET_FD "fd"
+#define MSTR_POSIX_NET_SOCKET_PTCL "ptcl"
+#define MSTR_POSIX_NET_SOCKET_STATE "state"
+#define MSTR_POSIX_NET_SOCKET_LADDR "laddr"
+#define MSTR_POSIX_NET_SOCKET_LPORT "lport"
+#define MSTR_POSIX_NET_SOCKET_RADDR "raddr"
+#define MSTR_POSIX_NET_SOCKET_RPORT "rport"
+#define MSTR_POSIX_NET_SOCKET_CONNECT_CB "connect_cb"
+#define MSTR_POSIX_NET_SOCKET_CLOSE_CB "close_cb"
+#define MSTR_POSIX_NET_SOCKET_READ_CB "read_cb"
+#define MSTR_POSIX_NET_SOCKET_ACCEPT_CB "accept_cb"
+#define MSTR_POSIX_NET_SOCKET_SHUTDOWN_CB "shutdown_cb"
+#define MSTR_POSIX_NET_SOCKET_ERROR_CB "error_cb"
+#define MSTR_POSIX_NET_SOCKET_MESSAGE_CB "message_cb"
+
+#endif /* __POSIX_NET_MAGIC_STRINGS_H */
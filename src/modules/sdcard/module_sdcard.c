@@ -23,6 +23,7 @@
 
 #include <stdlib.h>
 
+#include "blkdev.h"
 #include "board.h"
 #include "err.h"
 #include "gpio.h"
@@ -346,6 +347,116 @@ static void init_sd(void) {
   __sdcard_handle.count = 0;
   __sdcard_handle.size = 0;
 }
+static int sdcard_blkdev_read(km_blkdev_t *blkdev, uint32_t block,
+                              uint32_t offset, uint8_t *buffer,
+                              uint32_t size) {
+  if (!(__sdcard_handle.status & SD_STATUS_INIT)) {
+    return ENODEV;
+  }
+  if (offset != 0 || size < __sdcard_handle.size) {
+    return EINVAL;
+  }
+  uint32_t count = size / __sdcard_handle.size;
+  for (uint32_t i = 0; i < count; i++) {
+    if (__send_command(SD_CMD17, block + i, 0x00) != 0xFF) {
+      if (__receive_datablock(buffer, __sdcard_handle.size) < 0) {
+        return EIO;
+      }
+    }
+    buffer += __sdcard_handle.size;
+  }
+  return 0;
+}
+
+static int sdcard_blkdev_write(km_blkdev_t *blkdev, uint32_t block,
+                               uint32_t offset, const uint8_t *buffer,
+                               uint32_t size) {
+  if (!(__sdcard_handle.status & SD_STATUS_INIT)) {
+    return ENODEV;
+  }
+  if (offset != 0 || size < __sdcard_handle.size) {
+    return EINVAL;
+  }
+  uint32_t count = size / __sdcard_handle.size;
+  for (uint32_t i = 0; i < count; i++) {
+    if ((__send_command(SD_CMD24, block + i, 0x00) != 0x00) ||
+        (__send_datablock((uint8_t *)buffer, __sdcard_handle.size) < 0)) {
+      return EIO;
+    }
+    buffer += __sdcard_handle.size;
+  }
+  return 0;
+}
+
+static int sdcard_blkdev_ioctl(km_blkdev_t *blkdev, int op, int arg) {
+  switch (op) {
+    case KM_BLKDEV_IOCTL_INIT: {
+      int ret = __sdcard_init();
+      if (ret == EALREADY) {
+        return __sdcard_handle.status;
+      }
+      return (ret <= 0) ? EIO : ret;
+    }
+    case KM_BLKDEV_IOCTL_SHUTDOWN:
+      init_sd();
+      return 0;
+    case KM_BLKDEV_IOCTL_SYNC:
+      return 0;
+    case KM_BLKDEV_IOCTL_BLOCK_COUNT:
+      return __sdcard_handle.count;
+    case KM_BLKDEV_IOCTL_BLOCK_SIZE:
+      return __sdcard_handle.size;
+    case KM_BLKDEV_IOCTL_BLOCK_ERASE:
+      if (!(__sdcard_handle.status & SD_STATUS_INIT)) {
+        return ENODEV;
+      }
+      if (__erase_datablock(arg, arg) < 0) {
+        return EIO;
+      }
+      return 0;
+    case KM_BLKDEV_IOCTL_BUFFER_SIZE:
+      return __sdcard_handle.size;
+    default:
+      return EINVAL;
+  }
+}
+
+static const km_blkdev_ops_t sdcard_blkdev_ops = {
+    .read = sdcard_blkdev_read,
+    .write = sdcard_blkdev_write,
+    .ioctl = sdcard_blkdev_ioctl,
+    .free = NULL};  // static, there is only one SD card handle
+
+static km_blkdev_t sdcard_blkdev = {.ops = &sdcard_blkdev_ops};
+
+static jerry_value_t create_sdcard_error(int ret) {
+  switch (ret) {
+    case ENODEV:
+      return jerry_create_error(
+          JERRY_ERROR_COMMON,
+          (const jerry_char_t *)"SDCard is not initialized.");
+    case EINVAL:
+      return jerry_create_error(JERRY_ERROR_RANGE,
+                                (const jerry_char_t *)"Invalid buffer size.");
+    default:
+      return jerry_create_error(JERRY_ERROR_COMMON,
+                                (const jerry_char_t *)"SDCard I/O error.");
+  }
+}
+
+/**
+ * Get pointer and length of the Uint8Array
+ */
+static uint8_t *get_buffer_pointer(jerry_value_t buffer,
+                                   jerry_length_t *length) {
+  jerry_length_t buffer_offset = 0;
+  jerry_value_t arrbuf =
+      jerry_get_typedarray_buffer(buffer, &buffer_offset, length);
+  uint8_t *buffer_pointer = jerry_get_arraybuffer_pointer(arrbuf);
+  jerry_release_value(arrbuf);
+  return buffer_pointer + buffer_offset;
+}
+
 /**
  * Sdcard (block device) constructor
  * args:
@@ -398,6 +509,8 @@ JERRYXX_FUN(sdcard_ctor_fn) {
   init_sd();
   __sdcard_handle.bus = bus;
   __sdcard_handle.cs_pin = cs_pin;
+  jerry_set_object_native_pointer(JERRYXX_GET_THIS, &sdcard_blkdev,
+                                  &km_blkdev_native_info);
   return jerry_create_undefined();
 }
 
@@ -419,20 +532,11 @@ JERRYXX_FUN(sdcard_read_fn) {
 
   // get buffer pointer
   jerry_length_t buffer_length = 0;
-  jerry_length_t buffer_offset = 0;
-  jerry_value_t arrbuf =
-      jerry_get_typedarray_buffer(buffer, &buffer_offset, &buffer_length);
-  uint8_t *buffer_pointer = jerry_get_arraybuffer_pointer(arrbuf);
-  jerry_release_value(arrbuf);
-  if (!(__sdcard_handle.status & SD_STATUS_INIT)) {
-    return jerry_create_error(
-        JERRY_ERROR_COMMON, (const jerry_char_t *)"SDCard is not initialized.");
-  }
-  if (__send_command(SD_CMD17, block, 0x00) != 0xFF) {
-    if (__receive_datablock(buffer_pointer, __sdcard_handle.size) < 0) {
-      return jerry_create_error(JERRY_ERROR_COMMON,
-                                (const jerry_char_t *)"SDCard read error.");
-    }
+  uint8_t *buffer_pointer = get_buffer_pointer(buffer, &buffer_length);
+  int ret = km_blkdev_read(&sdcard_blkdev, block, 0, buffer_pointer,
+                           buffer_length);
+  if (ret < 0) {
+    return create_sdcard_error(ret);
   }
   return jerry_create_undefined();
 }
@@ -455,19 +559,11 @@ JERRYXX_FUN(sdcard_write_fn) {
 
   // get buffer pointer
   jerry_length_t buffer_length = 0;
-  jerry_length_t buffer_offset = 0;
-  jerry_value_t arrbuf =
-      jerry_get_typedarray_buffer(buffer, &buffer_offset, &buffer_length);
-  uint8_t *buffer_pointer = jerry_get_arraybuffer_pointer(arrbuf);
-  jerry_release_value(arrbuf);
-  if (!(__sdcard_handle.status & SD_STATUS_INIT)) {
-    return jerry_create_error(
-        JERRY_ERROR_COMMON, (const jerry_char_t *)"SDCard is not initialized.");
-  }
-  if ((__send_command(SD_CMD24, block, 0x00) != 0x00) ||
-      (__send_datablock(buffer_pointer, __sdcard_handle.size) < 0)) {
-    return jerry_create_error(JERRY_ERROR_COMMON,
-                              (const jerry_char_t *)"SDCard write error.");
+  uint8_t *buffer_pointer = get_buffer_pointer(buffer, &buffer_length);
+  int ret = km_blkdev_write(&sdcard_blkdev, block, 0, buffer_pointer,
+                            buffer_length);
+  if (ret < 0) {
+    return create_sdcard_error(ret);
   }
   return jerry_create_undefined();
 }
@@ -484,43 +580,25 @@ JERRYXX_FUN(sdcard_ioctl_fn) {
   JERRYXX_CHECK_ARG_NUMBER_OPT(1, "arg")
   int op = JERRYXX_GET_ARG_NUMBER(0);
   int arg = JERRYXX_GET_ARG_NUMBER_OPT(1, 0);
-  int ret;
 
-  switch (op) {
-    case 1:  // init
-      ret = __sdcard_init();
-      if (ret <= 0) {
+  int ret = km_blkdev_ioctl(&sdcard_blkdev, op, arg);
+  if (ret < 0) {
+    switch (op) {
+      case KM_BLKDEV_IOCTL_INIT:
         return jerry_create_error(JERRY_ERROR_COMMON,
                                   (const jerry_char_t *)"SD Card init error.");
-      }
-      return jerry_create_number(ret);
-    case 2:  // shutdown
-      init_sd();
-      return jerry_create_number(0);
-    case 3:  // sync
-      return jerry_create_number(0);
-    case 4:  // block count
-      return jerry_create_number(__sdcard_handle.count);
-    case 5:  // block size
-      return jerry_create_number(__sdcard_handle.size);
-    case 6:  // erase block
-      if (!(__sdcard_handle.status & SD_STATUS_INIT)) {
-        return jerry_create_error(
-            JERRY_ERROR_COMMON,
-            (const jerry_char_t *)"SDCard is not initialized.");
-      } else {
-        if (__erase_datablock(arg, arg) < 0) {
+      case KM_BLKDEV_IOCTL_BLOCK_ERASE:
+        if (ret != ENODEV) {
           return jerry_create_error(
               JERRY_ERROR_COMMON, (const jerry_char_t *)"SDCard earse error.");
         }
-      }
-      return jerry_create_number(0);
-    case 7:  // buffer size
-      return jerry_create_number(__sdcard_handle.size);
-    default:
-      return jerry_create_error(JERRY_ERROR_COMMON,
-                                (const jerry_char_t *)"Unknown operation.");
+        return create_sdcard_error(ret);
+      default:
+        return jerry_create_error(JERRY_ERROR_COMMON,
+                                  (const jerry_char_t *)"Unknown operation.");
+    }
   }
+  return jerry_create_number(ret);
 }
 
 /**
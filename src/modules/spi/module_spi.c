@@ -24,6 +24,7 @@
 #include "err.h"
 #include "jerryscript.h"
 #include "jerryxx.h"
+#include "kaluma_magic_strings.h"
 #include "spi.h"
 #include "spi_magic_strings.h"
 
@@ -31,8 +32,38 @@
 #define SPI_DEFAULT_BAUDRATE 3000000
 #define SPI_DEFAULT_BITORDER KM_SPI_BITORDER_MSB
 
+/**
+ * Native handle of a SPI object. The bus is read from here by every
+ * transfer; the JS properties (this.bus, ...) are for information.
+ */
+typedef struct {
+  uint8_t bus;
+  bool closed;
+} spi_handle_t;
+
 static void buffer_free_cb(void *native_p) { free(native_p); }
 
+static const jerry_object_native_info_t spi_handle_info = {
+    .free_cb = buffer_free_cb};
+
+/**
+ * Get the handle of an opened SPI object, NULL if not initialized or closed
+ */
+static spi_handle_t *get_spi_handle(jerry_value_t this_val) {
+  void *native_p;
+  if (jerry_get_object_native_pointer(this_val, &native_p, &spi_handle_info) &&
+      !((spi_handle_t *)native_p)->closed) {
+    return (spi_handle_t *)native_p;
+  }
+  return NULL;
+}
+
+static jerry_value_t create_bus_error() {
+  return jerry_create_error(
+      JERRY_ERROR_REFERENCE,
+      (const jerry_char_t *)"SPI bus is not initialized.");
+}
+
 /**
  * SPI() constructor
  */
@@ -79,16 +110,36 @@ JERRYXX_FUN(spi_ctor_fn) {
                          (km_spi_bitorder_t)bitorder, pins, pullup);
   if (ret < 0) {
     return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  // native handle (reused if the object is initialized again)
+  void *native_p;
+  spi_handle_t *spi = NULL;
+  if (jerry_get_object_native_pointer(JERRYXX_GET_THIS, &native_p,
+                                      &spi_handle_info)) {
+    spi = (spi_handle_t *)native_p;
   } else {
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_BUS, bus);
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_MODE, mode);
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_BAUDRATE, baudrate);
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_BITORDER, bitorder);
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_MISO, pins.miso);
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_MOSI, pins.mosi);
-    jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_SPI_SCK, pins.sck);
-    return jerry_create_undefined();
+    spi = (spi_handle_t *)malloc(sizeof(spi_handle_t));
+    if (spi == NULL) {
+      km_spi_close(bus);
+      return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+    }
+    jerry_set_object_native_pointer(JERRYXX_GET_THIS, spi, &spi_handle_info);
   }
+  spi->bus = bus;
+  spi->closed = false;
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_BUS_KEY, bus);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_MODE_KEY, mode);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_BAUDRATE_KEY,
+                                     baudrate);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_BITORDER_KEY,
+                                     bitorder);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_MISO_KEY,
+                                     pins.miso);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_MOSI_KEY,
+                                     pins.mosi);
+  jerryxx_set_property_number_by_key(JERRYXX_GET_THIS, MSTR_SPI_SCK_KEY,
+                                     pins.sck);
+  return jerry_create_undefined();
 }
 
 /**
@@ -100,17 +151,12 @@ JERRYXX_FUN(spi_transfer_fn) {
   jerry_value_t data = JERRYXX_GET_ARG(0);
   uint32_t timeout = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(1, 5000);
 
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_SPI_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"SPI bus is not initialized.");
+  // get the bus
+  spi_handle_t *spi = get_spi_handle(JERRYXX_GET_THIS);
+  if (spi == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
+  uint8_t bus = spi->bus;
 
   // write data to the bus
   if (jerry_value_is_typedarray(data) &&
@@ -171,17 +217,12 @@ JERRYXX_FUN(spi_send_fn) {
   uint32_t timeout = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(1, 5000);
   uint32_t count = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(2, 1);
 
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_SPI_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"SPI bus is not initialized.");
+  // get the bus
+  spi_handle_t *spi = get_spi_handle(JERRYXX_GET_THIS);
+  if (spi == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
+  uint8_t bus = spi->bus;
 
   // write data to the bus
   int ret = 0;
@@ -227,17 +268,12 @@ JERRYXX_FUN(spi_recv_fn) {
   uint32_t length = (uint32_t)JERRYXX_GET_ARG_NUMBER(0);
   uint32_t timeout = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(1, 5000);
 
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_SPI_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"SPI bus is not initialized.");
+  // get the bus
+  spi_handle_t *spi = get_spi_handle(JERRYXX_GET_THIS);
+  if (spi == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
+  uint8_t bus = spi->bus;
 
   // recv data
   uint8_t *buf = malloc(length);
@@ -261,26 +297,22 @@ JERRYXX_FUN(spi_recv_fn) {
  * SPI.prototype.close() function
  */
 JERRYXX_FUN(spi_close_fn) {
-  // check this.bus number
-  jerry_value_t bus_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_SPI_BUS);
-  if (!jerry_value_is_number(bus_value)) {
-    jerry_release_value(bus_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"SPI bus is not initialized.");
+  // get the bus
+  spi_handle_t *spi = get_spi_handle(JERRYXX_GET_THIS);
+  if (spi == NULL) {
+    return create_bus_error();
   }
-  uint8_t bus = (uint8_t)jerry_get_number_value(bus_value);
-  jerry_release_value(bus_value);
+  uint8_t bus = spi->bus;
 
   // close the bus
   int ret = km_spi_close(bus);
   if (ret < 0) {
     return jerry_create_error_from_value(create_system_error(ret), true);
   }
+  spi->closed = true;
 
   // delete this.bus property
-  jerryxx_delete_property(JERRYXX_GET_THIS, MSTR_SPI_BUS);
+  jerryxx_delete_property_by_key(JERRYXX_GET_THIS, MSTR_SPI_BUS_KEY);
 
   return jerry_create_undefined();
 }
@@ -2,32 +2,184 @@
  * Module class
  */
 
-function Module(id) {
+function Module(id, parent) {
   this.id = id;
+  this.filename = null;
+  this.parent = parent || null;
   this.exports = {};
 }
 
 Module.cache = {};
 
-Module.require = function (id) {
-  if (Module.cache[id]) {
-    return Module.cache[id].exports;
+Module.require = function (id, parent) {
+  var mod = Module.cache[id];
+  if (mod && id[0] !== ".") {
+    return mod.exports;
   }
-  if (process.builtin_modules.indexOf(id) >= 0) {
-    var mod = new Module(id);
-    mod.loadBuiltin();
+  var fn = process.getBuiltinModule(id);
+  if (fn) {
+    mod = new Module(id);
+    mod.loadBuiltin(fn);
     Module.cache[id] = mod;
     return mod.exports;
   }
+  var filename = Module.resolve(id, parent);
+  if (filename) {
+    if (Module.cache[filename]) {
+      return Module.cache[filename].exports;
+    }
+    mod = new Module(filename, parent);
+    mod.filename = filename;
+    // cached before loading, so circular requires see partial exports
+    Module.cache[filename] = mod;
+    try {
+      mod.loadFile();
+    } catch (err) {
+      delete Module.cache[filename];
+      throw err;
+    }
+    return mod.exports;
+  }
   throw new Error("Failed to load module: " + id);
 };
 
-Module.prototype.loadBuiltin = function () {
-  var fn = process.getBuiltinModule(this.id);
+/**
+ * Resolve a module id to a file in the file system, relative to the
+ * requiring module (or the current directory), or from `node_modules`
+ * directories up to the root.
+ */
+Module.resolve = function (id, parent) {
+  var fs = Module.fs();
+  if (!fs) {
+    return null;
+  }
+  var path = Module.require("path");
+  var dir =
+    parent && parent.filename
+      ? path.join(parent.filename, "..")
+      : fs.cwd() || "/";
+  if (
+    id[0] === "/" ||
+    id === "." ||
+    id === ".." ||
+    id.startsWith("./") ||
+    id.startsWith("../")
+  ) {
+    var target = path.resolve(dir, id);
+    return (
+      Module.resolveFile(fs, target) || Module.resolveDirectory(fs, target)
+    );
+  }
+  while (true) {
+    if (!dir.endsWith("/node_modules")) {
+      var candidate = path.join(dir, "node_modules", id);
+      var found =
+        Module.resolveFile(fs, candidate) ||
+        Module.resolveDirectory(fs, candidate);
+      if (found) {
+        return found;
+      }
+    }
+    if (dir === "/") {
+      return null;
+    }
+    dir = path.join(dir, "..");
+  }
+};
+
+Module.fs = function () {
+  if (Module._fs === undefined) {
+    Module._fs =
+      process.builtin_modules.indexOf("fs") > -1 ? Module.require("fs") : null;
+  }
+  return Module._fs;
+};
+
+Module.isFile = function (fs, filename) {
+  try {
+    return fs.exists(filename) && fs.stat(filename).isFile();
+  } catch (err) {
+    return false;
+  }
+};
+
+Module.resolveFile = function (fs, filename) {
+  var candidates = [filename, filename + ".js", filename + ".json"];
+  for (var i = 0; i < candidates.length; i++) {
+    if (Module.isFile(fs, candidates[i])) {
+      return candidates[i];
+    }
+  }
+  return null;
+};
+
+Module.resolveDirectory = function (fs, dir) {
+  var pkg = dir + "/package.json";
+  if (Module.isFile(fs, pkg)) {
+    var main = JSON.parse(new TextDecoder().decode(fs.readFile(pkg))).main;
+    if (main) {
+      var target = Module.require("path").join(dir, main);
+      var found =
+        Module.resolveFile(fs, target) ||
+        Module.resolveFile(fs, target + "/index");
+      if (found) {
+        return found;
+      }
+    }
+  }
+  return Module.resolveFile(fs, dir + "/index");
+};
+
+Module.prototype.loadBuiltin = function (fn) {
+  fn = fn || process.getBuiltinModule(this.id);
   fn(this.exports, Module.require, this);
 };
 
-global.require = Module.require;
+/**
+ * Load a module file. A JS module is executed from the snapshot cached next
+ * to it (`<filename>.snapshot`), which is regenerated when the source or
+ * the firmware changes, so the source is parsed only once.
+ */
+Module.prototype.loadFile = function () {
+  var fs = Module.fs();
+  var filename = this.filename;
+  var source = fs.readFile(filename);
+  if (filename.endsWith(".json")) {
+    this.exports = JSON.parse(new TextDecoder().decode(source));
+    return;
+  }
+  var cache = filename + ".snapshot";
+  var fn;
+  if (Module.isFile(fs, cache)) {
+    fn = process.loadModuleSnapshot(fs.readFile(cache), source);
+  }
+  if (!fn) {
+    var snapshot = process.snapshotModule(source, filename);
+    if (snapshot) {
+      try {
+        fs.writeFile(cache, snapshot);
+      } catch (err) {
+        // read-only file system, compile again at next boot
+      }
+      fn = process.loadModuleSnapshot(snapshot, source);
+    }
+  }
+  if (!fn) {
+    fn = process.compileModule(source, filename);
+  }
+  source = null;
+  var self = this;
+  var require = function (id) {
+    return Module.require(id, self);
+  };
+  require.cache = Module.cache;
+  var dirname = Module.require("path").join(filename, "..");
+  fn.call(this.exports, this.exports, require, this, filename, dirname);
+};
+
+global.require = function (id) {
+  return Module.require(id);
+};
 
 /**
  * Storage object
@@ -112,6 +112,9 @@ JERRYXX_FUN(storage_key_fn) {
  * Initialize 'storage' module and return exports
  */
 jerry_value_t module_storage_init() {
+  /* rebuild the key index from flash */
+  storage_init();
+
   /* storage module exports */
   jerry_value_t exports = jerry_create_object();
   jerryxx_set_property_function(exports, MSTR_STORAGE_SET_ITEM,
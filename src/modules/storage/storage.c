@@ -21,189 +21,859 @@
 
 #include "storage.h"
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "err.h"
 #include "flash.h"
+#include "utils.h"
 
-// int get_available_slot();
-// storage_slot_data_t *slot_get_data(int slot);
-// int slot_set_data(slot_data_t *, key, value);
-// int slot_write(slot, slot_data);
-// int slot_find(char *key);
+/**
+ * Log-structured key/value store
+ *
+ * Each sector starts with a header holding its erase count, followed by
+ * records appended in order. Setting or removing a key appends a new record
+ * (removal appends an SR_REMOVED record), so the newest record of a key wins
+ * and a record torn by power loss fails its CRC and is ignored. The index in
+ * RAM maps key hashes to the offsets of their live records and is rebuilt by
+ * scanning the sectors in storage_init().
+ *
+ * One erased sector is always kept in reserve. When it is the last one left,
+ * the live records of the sector with the most garbage are copied into it
+ * and that sector is erased to become the new reserve.
+ *
+ * Storage written by the previous layout (one slot per flash page) is
+ * imported on the first storage_init() after an upgrade.
+ */
+
+#define STORAGE_ADDR (km_flash_addr + (SECTOR_BASE * SECTOR_SIZE))
+#define HEADER_SIZE sizeof(storage_sector_header_t)
+#define ALIGN_UP(n) (((n) + STORAGE_ALIGN - 1) & ~(STORAGE_ALIGN - 1))
+#define INDEX_MIN 16
+#define SLOT_EMPTY -1
+
+/* previous layout: one slot per flash page, in use if status is 0xF0 */
+#define LEGACY_SLOT_SIZE STORAGE_PAGE_SIZE
+#define LEGACY_SLOT_COUNT ((SECTOR_COUNT * SECTOR_SIZE) / LEGACY_SLOT_SIZE)
+#define LEGACY_SLOT_DATA_MAX (LEGACY_SLOT_SIZE - 3)
+#define LEGACY_SLOT_USE 0xF0
+
+typedef struct {
+  uint8_t status;
+  uint8_t key_length;
+  uint8_t value_length;
+  char buffer[LEGACY_SLOT_DATA_MAX];
+} legacy_slot_t;
+
+typedef struct {
+  uint32_t erase_count;
+  uint32_t used;  // bytes appended including the sector header
+  uint32_t live;  // bytes of records referenced by the index
+  uint32_t seq;   // highest record seq in the sector
+} storage_sector_t;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t addr;  // record offset from the storage base
+} storage_entry_t;
+
+static storage_sector_t sectors[SECTOR_COUNT];
+static int current = -1;  // sector to append records to
+static uint32_t next_seq = 0;
+static bool ready = false;
+
+// entries are dense (for key(index)), slots are an open addressing table
+static storage_entry_t *entries = NULL;
+static uint32_t entry_count = 0;
+static uint32_t entry_capacity = 0;
+static int32_t *slots = NULL;
+static uint32_t slot_mask = 0;
+
+static uint8_t page_buffer[STORAGE_PAGE_SIZE];
 
-static int slot_new() {
-  const uint8_t *STORAGE_ADDR =
-      (uint8_t *)(km_flash_addr + (SECTOR_BASE * KALUMA_FLASH_SECTOR_SIZE));
-  for (int i = 0; i < SLOT_COUNT; i++) {
-    storage_slot_data_t *slot_data =
-        (storage_slot_data_t *)(STORAGE_ADDR + i * SLOT_SIZE);
-    if (slot_data->status == SS_EMPTY) {
-      return i;
+static uint32_t key_hash(const char *key, uint32_t len) {
+  uint32_t hash = 2166136261u;  // FNV-1a
+  for (uint32_t i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static const storage_record_t *record_at(uint32_t addr) {
+  return (const storage_record_t *)(STORAGE_ADDR + addr);
+}
+
+static const char *record_key(const storage_record_t *rec) {
+  return (const char *)(rec + 1);
+}
+
+static const char *record_value(const storage_record_t *rec) {
+  return record_key(rec) + rec->key_length;
+}
+
+static uint32_t record_size(uint32_t key_length, uint32_t value_length) {
+  return ALIGN_UP(sizeof(storage_record_t) + key_length + value_length);
+}
+
+/**
+ * CRC of a record. The type is left out so a record can be killed in place.
+ */
+static uint32_t record_crc(const storage_record_t *rec, const char *key,
+                           const char *value) {
+  storage_record_t header = *rec;
+  header.type = 0xFF;
+  uint32_t crc =
+      km_crc32(0, (const uint8_t *)&header, offsetof(storage_record_t, crc));
+  crc = km_crc32(crc, (const uint8_t *)key, rec->key_length);
+  return km_crc32(crc, (const uint8_t *)value, rec->value_length);
+}
+
+static bool record_has_key(const storage_record_t *rec, const char *key,
+                           uint32_t len) {
+  return rec->key_length == len && memcmp(record_key(rec), key, len) == 0;
+}
+
+/**
+ * Return the first intact record at or after the offset of a sector and
+ * move the offset to it, or NULL at the end of the appended records. Bytes
+ * left by a torn write are skipped.
+ */
+static const storage_record_t *sector_next(int sector, uint32_t *offset) {
+  while (*offset + sizeof(storage_record_t) <= sectors[sector].used) {
+    const storage_record_t *rec = record_at(sector * SECTOR_SIZE + *offset);
+    if (rec->magic == STORAGE_RECORD_MAGIC &&
+        rec->value_length <= STORAGE_DATA_MAX &&
+        *offset + record_size(rec->key_length, rec->value_length) <=
+            sectors[sector].used &&
+        rec->crc == record_crc(rec, record_key(rec), record_value(rec))) {
+      return rec;
     }
+    *offset += STORAGE_ALIGN;
+  }
+  return NULL;
+}
+
+static bool sector_empty(int sector) {
+  return sectors[sector].used == HEADER_SIZE;
+}
+
+/**
+ * Program data at an offset from the storage base. Pages are rewritten
+ * with their current contents so the offset need not be page aligned.
+ */
+static int flash_write(uint32_t addr, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    uint32_t page = addr - (addr % STORAGE_PAGE_SIZE);
+    uint32_t offset = addr - page;
+    size_t n = STORAGE_PAGE_SIZE - offset;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(page_buffer, STORAGE_ADDR + page, STORAGE_PAGE_SIZE);
+    memcpy(page_buffer + offset, data, n);
+    int ret =
+        km_flash_program(SECTOR_BASE + page / SECTOR_SIZE, page % SECTOR_SIZE,
+                         page_buffer, STORAGE_PAGE_SIZE);
+    if (ret < 0) {
+      return ret;
+    }
+    addr += n;
+    data += n;
+    len -= n;
+  }
+  return 0;
+}
+
+static int sector_format(int sector, uint32_t erase_count) {
+  int ret = km_flash_erase(SECTOR_BASE + sector, 1);
+  if (ret < 0) {
+    return ret;
+  }
+  storage_sector_header_t header;
+  memset(&header, 0xFF, sizeof(header));
+  header.magic = STORAGE_SECTOR_MAGIC;
+  header.erase_count = erase_count;
+  ret = flash_write(sector * SECTOR_SIZE, (const uint8_t *)&header,
+                    sizeof(header));
+  if (ret < 0) {
+    return ret;
+  }
+  sectors[sector].erase_count = erase_count;
+  sectors[sector].used = HEADER_SIZE;
+  sectors[sector].live = 0;
+  sectors[sector].seq = 0;
+  return 0;
+}
+
+static void index_free() {
+  free(entries);
+  free(slots);
+  entries = NULL;
+  slots = NULL;
+  entry_count = 0;
+  entry_capacity = 0;
+  slot_mask = 0;
+}
+
+static void index_place(uint32_t index) {
+  uint32_t i = entries[index].hash & slot_mask;
+  while (slots[i] != SLOT_EMPTY) {
+    i = (i + 1) & slot_mask;
   }
-  return -1;  // storage full
+  slots[i] = index;
 }
 
-static storage_slot_data_t *slot_get_data(int slot) {
-  const uint8_t *STORAGE_ADDR =
-      (uint8_t *)(km_flash_addr + (SECTOR_BASE * KALUMA_FLASH_SECTOR_SIZE));
-  return (storage_slot_data_t *)(STORAGE_ADDR + (slot * SLOT_SIZE));
+/**
+ * Make room for one more entry (the slot table is kept at most half full)
+ */
+static int index_reserve() {
+  if (entry_count < entry_capacity) {
+    return 0;
+  }
+  uint32_t capacity = entry_capacity > 0 ? entry_capacity * 2 : INDEX_MIN;
+  storage_entry_t *new_entries =
+      (storage_entry_t *)realloc(entries, capacity * sizeof(storage_entry_t));
+  if (new_entries == NULL) {
+    return ENOMEM;
+  }
+  entries = new_entries;
+  int32_t *new_slots = (int32_t *)malloc(capacity * 2 * sizeof(int32_t));
+  if (new_slots == NULL) {
+    return ENOMEM;
+  }
+  free(slots);
+  slots = new_slots;
+  slot_mask = capacity * 2 - 1;
+  entry_capacity = capacity;
+  for (uint32_t i = 0; i <= slot_mask; i++) {
+    slots[i] = SLOT_EMPTY;
+  }
+  for (uint32_t i = 0; i < entry_count; i++) {
+    index_place(i);
+  }
+  return 0;
 }
 
-static void slot_set_data(storage_slot_data_t *slot_data, char *key,
-                          char *value) {
-  size_t key_length = strlen(key);
-  size_t value_length = strlen(value);
-  memcpy(slot_data->buffer, key, key_length);
-  memcpy(slot_data->buffer + key_length, value, value_length);
-  slot_data->status = SS_USE;
-  slot_data->key_length = key_length;
-  slot_data->value_length = value_length;
+static int index_insert(uint32_t hash, uint32_t addr) {
+  int ret = index_reserve();
+  if (ret < 0) {
+    return ret;
+  }
+  entries[entry_count].hash = hash;
+  entries[entry_count].addr = addr;
+  index_place(entry_count);
+  entry_count++;
+  return 0;
 }
 
-static void slot_write(int slot, storage_slot_data_t *slot_data) {
-  int sector = (slot * SLOT_SIZE) / KALUMA_FLASH_SECTOR_SIZE;
-  int offset = (slot * SLOT_SIZE) % KALUMA_FLASH_SECTOR_SIZE;
-  km_flash_program(SECTOR_BASE + sector, offset, (uint8_t *)slot_data,
-                   SLOT_SIZE);
+/**
+ * Return the slot of a key, or NULL if not found
+ */
+static int32_t *index_slot(const char *key, uint32_t len, uint32_t hash) {
+  if (slots == NULL) {
+    return NULL;
+  }
+  for (uint32_t i = hash & slot_mask;; i = (i + 1) & slot_mask) {
+    int32_t index = slots[i];
+    if (index == SLOT_EMPTY) {
+      return NULL;
+    }
+    if (entries[index].hash == hash &&
+        record_has_key(record_at(entries[index].addr), key, len)) {
+      return &slots[i];
+    }
+  }
 }
 
-static int slot_find(char *key, int len) {
-  const uint8_t *STORAGE_ADDR =
-      (uint8_t *)(km_flash_addr + (SECTOR_BASE * KALUMA_FLASH_SECTOR_SIZE));
-  for (int i = 0; i < SLOT_COUNT; i++) {
-    storage_slot_data_t *slot_data =
-        (storage_slot_data_t *)(STORAGE_ADDR + i * SLOT_SIZE);
-    if (slot_data->status == SS_USE && slot_data->key_length == len &&
-        strncmp(slot_data->buffer, key, len) == 0) {
-      return i;
+static void index_remove(int32_t *slot) {
+  uint32_t index = *slot;
+  // backward shift the following slots into the hole
+  uint32_t i = slot - slots;
+  for (uint32_t j = (i + 1) & slot_mask; slots[j] != SLOT_EMPTY;
+       j = (j + 1) & slot_mask) {
+    uint32_t home = entries[slots[j]].hash & slot_mask;
+    if (((j - home) & slot_mask) >= ((j - i) & slot_mask)) {
+      slots[i] = slots[j];
+      i = j;
     }
   }
-  return -1;  // not found
+  slots[i] = SLOT_EMPTY;
+  // move the last entry into the removed one
+  uint32_t last = entry_count - 1;
+  if (index != last) {
+    entries[index] = entries[last];
+    for (i = entries[index].hash & slot_mask; slots[i] != (int32_t)last;
+         i = (i + 1) & slot_mask) {
+    }
+    slots[i] = index;
+  }
+  entry_count--;
 }
 
 /**
- * Return index-th slot in USE status
+ * Add a record found while scanning to the index
  */
-static int slot_find_by_index(int index) {
-  const uint8_t *STORAGE_ADDR =
-      (uint8_t *)(km_flash_addr + (SECTOR_BASE * KALUMA_FLASH_SECTOR_SIZE));
-  int pos = 0;
-  for (int i = 0; i < SLOT_COUNT; i++) {
-    storage_slot_data_t *slot =
-        (storage_slot_data_t *)(STORAGE_ADDR + (i * SLOT_SIZE));
-    if (slot->status == SS_USE) {
-      if (pos == index) {
-        return i;
+static int index_load(uint32_t addr, const storage_record_t *rec) {
+  const char *key = record_key(rec);
+  uint32_t hash = key_hash(key, rec->key_length);
+  uint32_t size = record_size(rec->key_length, rec->value_length);
+  storage_sector_t *sector = &sectors[addr / SECTOR_SIZE];
+  if (rec->seq >= next_seq) {
+    next_seq = rec->seq + 1;
+  }
+  if (rec->seq > sector->seq) {
+    sector->seq = rec->seq;
+  }
+  int32_t *slot = index_slot(key, rec->key_length, hash);
+  if (slot == NULL) {
+    int ret = index_insert(hash, addr);
+    if (ret < 0) {
+      return ret;
+    }
+  } else {
+    storage_entry_t *entry = &entries[*slot];
+    const storage_record_t *old = record_at(entry->addr);
+    if (rec->seq <= old->seq) {
+      return 0;  // superseded
+    }
+    if (old->type == SR_VALUE) {
+      sectors[entry->addr / SECTOR_SIZE].live -=
+          record_size(old->key_length, old->value_length);
+    }
+    entry->addr = addr;
+  }
+  if (rec->type == SR_VALUE) {
+    sector->live += size;
+  }
+  return 0;
+}
+
+static int sector_scan(int sector) {
+  // everything up to the last programmed byte is taken
+  const uint8_t *base = STORAGE_ADDR + sector * SECTOR_SIZE;
+  uint32_t end = SECTOR_SIZE;
+  while (end > HEADER_SIZE && base[end - 1] == 0xFF) {
+    end--;
+  }
+  sectors[sector].used = ALIGN_UP(end);
+  // a torn record can end in bytes still reading as erased
+  const storage_record_t *rec;
+  for (uint32_t offset = HEADER_SIZE;
+       offset + sizeof(storage_record_t) <= sectors[sector].used;
+       offset += STORAGE_ALIGN) {
+    rec = record_at(sector * SECTOR_SIZE + offset);
+    if (rec->magic == STORAGE_RECORD_MAGIC &&
+        rec->value_length <= STORAGE_DATA_MAX) {
+      uint32_t rec_end =
+          offset + record_size(rec->key_length, rec->value_length);
+      if (rec_end > sectors[sector].used && rec_end <= SECTOR_SIZE) {
+        sectors[sector].used = rec_end;
       }
-      pos++;
     }
   }
-  return -1;
+  for (uint32_t offset = HEADER_SIZE;
+       (rec = sector_next(sector, &offset)) != NULL;
+       offset += record_size(rec->key_length, rec->value_length)) {
+    if (rec->type == SR_VALUE || rec->type == SR_REMOVED) {
+      int ret = index_load(sector * SECTOR_SIZE + offset, rec);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+  }
+  return 0;
 }
 
-static char *slot_get_key(storage_slot_data_t *slot_data) {
-  return (char *)(slot_data->buffer);
+/**
+ * Whether an older value of a removed key remains in another sector
+ */
+static bool record_shadows(int except, const storage_record_t *removed) {
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    if (s == except) {
+      continue;
+    }
+    const storage_record_t *rec;
+    for (uint32_t offset = HEADER_SIZE; (rec = sector_next(s, &offset)) != NULL;
+         offset += record_size(rec->key_length, rec->value_length)) {
+      if (rec->type == SR_VALUE && rec->seq < removed->seq &&
+          record_has_key(rec, record_key(removed), removed->key_length)) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
-static char *slot_get_value(storage_slot_data_t *slot_data) {
-  return (char *)(slot_data->buffer + slot_data->key_length);
+/**
+ * Copy the live records of a victim sector into another sector (normally
+ * the empty one) and erase the victim
+ */
+static int storage_gc(int dest) {
+  uint32_t max_erase = 0;
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    if (sectors[s].erase_count > max_erase) {
+      max_erase = sectors[s].erase_count;
+    }
+  }
+  int victim = -1;
+  uint32_t best = 0;
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    if (s == dest || sector_empty(s) ||
+        sectors[s].live > SECTOR_SIZE - sectors[dest].used) {
+      continue;
+    }
+    uint32_t garbage = sectors[s].used - HEADER_SIZE - sectors[s].live;
+    if (sectors[s].erase_count + STORAGE_WEAR_DELTA <= max_erase) {
+      garbage = SECTOR_SIZE;  // move cold records off a little worn sector
+    }
+    if (garbage > best) {
+      best = garbage;
+      victim = s;
+    }
+  }
+  if (victim < 0) {
+    return ESTGFULL;
+  }
+
+  current = dest;
+  const storage_record_t *rec;
+  for (uint32_t offset = HEADER_SIZE;
+       (rec = sector_next(victim, &offset)) != NULL;
+       offset += record_size(rec->key_length, rec->value_length)) {
+    if (rec->type != SR_VALUE && rec->type != SR_REMOVED) {
+      continue;
+    }
+    int32_t *slot = index_slot(record_key(rec), rec->key_length,
+                               key_hash(record_key(rec), rec->key_length));
+    bool live = rec->type == SR_VALUE
+                    ? (slot != NULL &&
+                       entries[*slot].addr == victim * SECTOR_SIZE + offset)
+                    : (slot == NULL && record_shadows(victim, rec));
+    if (!live) {
+      continue;
+    }
+    uint32_t size = record_size(rec->key_length, rec->value_length);
+    if (sectors[dest].used + size > SECTOR_SIZE) {
+      return ESTGFULL;  // the victim is left as it is
+    }
+    uint32_t addr = dest * SECTOR_SIZE + sectors[dest].used;
+    int ret = flash_write(addr, (const uint8_t *)rec, size);
+    if (ret < 0) {
+      return ret;
+    }
+    sectors[dest].used += size;
+    if (rec->seq > sectors[dest].seq) {
+      sectors[dest].seq = rec->seq;
+    }
+    if (rec->type == SR_VALUE) {
+      entries[*slot].addr = addr;
+      sectors[dest].live += size;
+    }
+  }
+  return sector_format(victim, sectors[victim].erase_count + 1);
 }
 
-int storage_set_item(char *key, char *value) {
-  if (strlen(key) + strlen(value) > SLOT_DATA_MAX) {
+/**
+ * Make the current sector able to take a record of the size
+ */
+static int storage_reserve(uint32_t size) {
+  for (int attempt = 0; attempt < SECTOR_COUNT * 2; attempt++) {
+    if (current >= 0 && sectors[current].used + size <= SECTOR_SIZE) {
+      return 0;
+    }
+    int empty_count = 0;
+    int next = -1;
+    for (int s = 0; s < SECTOR_COUNT; s++) {
+      if (s != current && sector_empty(s)) {
+        empty_count++;
+        if (next < 0 || sectors[s].erase_count < sectors[next].erase_count) {
+          next = s;
+        }
+      }
+    }
+    if (next < 0) {
+      return ESTGFULL;
+    }
+    if (empty_count > 1) {
+      current = next;
+    } else {
+      // the last empty sector is only used for garbage collection
+      int ret = storage_gc(next);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+  }
+  return ESTGFULL;
+}
+
+static int storage_append(uint8_t type, const char *key, uint32_t key_length,
+                          const char *value, uint32_t value_length,
+                          uint32_t *addr) {
+  if (key_length > STORAGE_KEY_MAX ||
+      key_length + value_length > STORAGE_DATA_MAX) {
     return ESTGSIZE;
   }
-  storage_slot_data_t temp;
+  uint32_t size = record_size(key_length, value_length);
+  int ret = storage_reserve(size);
+  if (ret < 0) {
+    return ret;
+  }
+  storage_record_t rec;
+  rec.magic = STORAGE_RECORD_MAGIC;
+  rec.type = type;
+  rec.key_length = key_length;
+  rec.value_length = value_length;
+  rec.seq = next_seq++;
+  rec.crc = record_crc(&rec, key, value);
 
-  // if key found, remove it
-  int slot = slot_find(key, strlen(key));
-  if (slot >= 0) {
-    storage_slot_data_t *old_slot_data = slot_get_data(slot);
-    memcpy(&temp, old_slot_data, sizeof(storage_slot_data_t));
-    temp.status = SS_REMOVED;
-    slot_write(slot, &temp);
+  // header first, so a torn record still tells where the next one starts
+  *addr = current * SECTOR_SIZE + sectors[current].used;
+  ret = flash_write(*addr, (const uint8_t *)&rec, sizeof(rec));
+  if (ret == 0) {
+    ret = flash_write(*addr + sizeof(rec), (const uint8_t *)key, key_length);
+  }
+  if (ret == 0) {
+    ret = flash_write(*addr + sizeof(rec) + key_length, (const uint8_t *)value,
+                      value_length);
   }
+  sectors[current].used += size;
+  sectors[current].seq = rec.seq;
+  return ret;
+}
 
-  // create new slot
-  int new_slot = slot_new();
-  if (new_slot < 0) {
-    return ESTGFULL;
+/**
+ * Invalidate every record of a key in place. Used to remove a key when
+ * there is no room left for an SR_REMOVED record.
+ */
+static int storage_kill(const char *key, uint32_t len, uint32_t newest) {
+  const uint8_t killed = SR_KILLED;
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    const storage_record_t *rec;
+    for (uint32_t offset = HEADER_SIZE; (rec = sector_next(s, &offset)) != NULL;
+         offset += record_size(rec->key_length, rec->value_length)) {
+      uint32_t addr = s * SECTOR_SIZE + offset;
+      // the newest last, so the key survives if interrupted
+      if (addr != newest && record_has_key(rec, key, len)) {
+        int ret = flash_write(addr + offsetof(storage_record_t, type),
+                              &killed, 1);
+        if (ret < 0) {
+          return ret;
+        }
+      }
+    }
+  }
+  return flash_write(newest + offsetof(storage_record_t, type), &killed, 1);
+}
+
+static int storage_put(const char *key, uint32_t key_length,
+                       const char *value, uint32_t value_length) {
+  uint32_t hash = key_hash(key, key_length);
+
+  // skip writing the same value again
+  int32_t *slot = index_slot(key, key_length, hash);
+  if (slot != NULL) {
+    const storage_record_t *rec = record_at(entries[*slot].addr);
+    if (rec->value_length == value_length &&
+        memcmp(record_value(rec), value, value_length) == 0) {
+      return 0;
+    }
+  }
+
+  // make sure the index can take the key before it goes to flash
+  int ret = index_reserve();
+  if (ret < 0) {
+    return ret;
+  }
+  uint32_t addr;
+  ret = storage_append(SR_VALUE, key, key_length, value, value_length, &addr);
+  if (ret < 0) {
+    return ret;
+  }
+  slot = index_slot(key, key_length, hash);  // may be moved by gc
+  if (slot != NULL) {
+    storage_entry_t *entry = &entries[*slot];
+    const storage_record_t *old = record_at(entry->addr);
+    sectors[entry->addr / SECTOR_SIZE].live -=
+        record_size(old->key_length, old->value_length);
+    entry->addr = addr;
   } else {
-    slot_set_data(&temp, key, value);
-    slot_write(new_slot, &temp);
+    index_insert(hash, addr);
   }
+  sectors[addr / SECTOR_SIZE].live += record_size(key_length, value_length);
   return 0;
 }
 
+/**
+ * Copy the slots in use of the previous layout to RAM, as key and value
+ * lengths followed by the bytes. Returns the number of slots, or an error.
+ */
+static int legacy_load(uint8_t **data) {
+  const legacy_slot_t *legacy = (const legacy_slot_t *)STORAGE_ADDR;
+  uint32_t size = 0;
+  int count = 0;
+  for (int i = 0; i < LEGACY_SLOT_COUNT; i++) {
+    if (legacy[i].status == LEGACY_SLOT_USE &&
+        legacy[i].key_length + legacy[i].value_length <= LEGACY_SLOT_DATA_MAX) {
+      size += 2 + legacy[i].key_length + legacy[i].value_length;
+      count++;
+    }
+  }
+  *data = NULL;
+  if (count == 0) {
+    return 0;
+  }
+  uint8_t *p = (uint8_t *)malloc(size);
+  if (p == NULL) {
+    return ENOMEM;  // not formatted, the slots are kept
+  }
+  *data = p;
+  for (int i = 0; i < LEGACY_SLOT_COUNT; i++) {
+    if (legacy[i].status == LEGACY_SLOT_USE &&
+        legacy[i].key_length + legacy[i].value_length <= LEGACY_SLOT_DATA_MAX) {
+      uint32_t len = legacy[i].key_length + legacy[i].value_length;
+      *p++ = legacy[i].key_length;
+      *p++ = legacy[i].value_length;
+      memcpy(p, legacy[i].buffer, len);
+      p += len;
+    }
+  }
+  return count;
+}
+
+/**
+ * Append the slots copied by legacy_load() as records
+ */
+static int legacy_import(const uint8_t *data, int count) {
+  for (int i = 0; i < count; i++) {
+    uint8_t key_length = data[0];
+    uint8_t value_length = data[1];
+    const char *key = (const char *)data + 2;
+    int ret = storage_put(key, key_length, key + key_length, value_length);
+    if (ret < 0) {
+      return ret;
+    }
+    data += 2 + key_length + value_length;
+  }
+  return 0;
+}
+
+static int storage_open() {
+  return ready ? 0 : storage_init();
+}
+
+int storage_init() {
+  storage_cleanup();
+  current = -1;
+  next_seq = 0;
+  bool formatted[SECTOR_COUNT];
+  bool upgrade = true;
+  uint32_t max_erase = 0;
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    const storage_sector_header_t *header =
+        (const storage_sector_header_t *)(STORAGE_ADDR + s * SECTOR_SIZE);
+    memset(&sectors[s], 0, sizeof(storage_sector_t));
+    formatted[s] = header->magic == STORAGE_SECTOR_MAGIC;
+    if (formatted[s]) {
+      upgrade = false;
+      sectors[s].erase_count = header->erase_count;
+      if (header->erase_count > max_erase) {
+        max_erase = header->erase_count;
+      }
+      int ret = sector_scan(s);
+      if (ret < 0) {
+        index_free();
+        return ret;
+      }
+    }
+  }
+
+  // no sector formatted yet: keep the slots of the previous layout
+  uint8_t *legacy = NULL;
+  int legacy_count = 0;
+  if (upgrade) {
+    legacy_count = legacy_load(&legacy);
+    if (legacy_count < 0) {
+      return legacy_count;
+    }
+  }
+
+  // sectors never formatted or interrupted while erasing
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    if (!formatted[s]) {
+      int ret = sector_format(s, max_erase + 1);
+      if (ret < 0) {
+        free(legacy);
+        index_free();
+        return ret;
+      }
+    }
+  }
+
+  // removed keys only matter while scanning
+  for (uint32_t i = 0; i < entry_count;) {
+    const storage_record_t *rec = record_at(entries[i].addr);
+    if (rec->type == SR_REMOVED) {
+      index_remove(index_slot(record_key(rec), rec->key_length,
+                              entries[i].hash));
+    } else {
+      i++;
+    }
+  }
+
+  // a collection interrupted by power loss can leave no empty sector
+  int empty = -1;
+  int dest = -1;
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    if (sector_empty(s)) {
+      empty = s;
+    } else if (dest < 0 || sectors[s].used < sectors[dest].used) {
+      dest = s;
+    }
+  }
+  if (empty < 0) {
+    int ret = storage_gc(dest);
+    if (ret < 0) {
+      index_free();
+      return ret;
+    }
+  }
+
+  // keep appending to the sector holding the newest record
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    if (!sector_empty(s) &&
+        (current < 0 || sectors[s].seq > sectors[current].seq)) {
+      current = s;
+    }
+  }
+  if (legacy != NULL) {
+    int ret = legacy_import(legacy, legacy_count);
+    free(legacy);
+    if (ret < 0) {
+      index_free();
+      return ret;
+    }
+  }
+  ready = true;
+  return 0;
+}
+
+void storage_cleanup() {
+  index_free();
+  ready = false;
+}
+
+int storage_set_item(char *key, char *value) {
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  return storage_put(key, strlen(key), value, strlen(value));
+}
+
 int storage_get_value_length(char *key) {
-  int slot = slot_find(key, strlen(key));
-  if (slot < 0) {
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  uint32_t len = strlen(key);
+  int32_t *slot = index_slot(key, len, key_hash(key, len));
+  if (slot == NULL) {
     return ESTGNOKEY;
   }
-  storage_slot_data_t *slot_data = slot_get_data(slot);
-  return slot_data->value_length;
+  return record_at(entries[*slot].addr)->value_length;
 }
 
 int storage_get_value(char *key, char *value) {
-  int slot = slot_find(key, strlen(key));
-  if (slot < 0) {
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  uint32_t len = strlen(key);
+  int32_t *slot = index_slot(key, len, key_hash(key, len));
+  if (slot == NULL) {
     return ESTGNOKEY;
   }
-  storage_slot_data_t *slot_data = slot_get_data(slot);
-  strcpy(value, slot_get_value(slot_data));
+  const storage_record_t *rec = record_at(entries[*slot].addr);
+  memcpy(value, record_value(rec), rec->value_length);
   return 0;
 }
 
 int storage_get_key_length(int index) {
-  int slot = slot_find_by_index(index);
-  if (slot < 0) {
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  if (index < 0 || (uint32_t)index >= entry_count) {
     return ESTGNOKEY;
   }
-  storage_slot_data_t *slot_data = slot_get_data(slot);
-  return slot_data->key_length;
+  return record_at(entries[index].addr)->key_length;
 }
 
 int storage_get_key(int index, char *key) {
-  int slot = slot_find_by_index(index);
-  if (slot < 0) {
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  if (index < 0 || (uint32_t)index >= entry_count) {
     return ESTGNOKEY;
   }
-  storage_slot_data_t *slot_data = slot_get_data(slot);
-  strcpy(key, slot_get_key(slot_data));
+  const storage_record_t *rec = record_at(entries[index].addr);
+  memcpy(key, record_key(rec), rec->key_length);
   return 0;
 }
 
 int storage_remove_item(char *key) {
-  int slot = slot_find(key, strlen(key));
-  if (slot < 0) {
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  uint32_t len = strlen(key);
+  uint32_t hash = key_hash(key, len);
+  if (index_slot(key, len, hash) == NULL) {
     return ESTGNOKEY;
   }
-  storage_slot_data_t *slot_data = slot_get_data(slot);
-  storage_slot_data_t temp;
-  memcpy(&temp, slot_data, sizeof(storage_slot_data_t));
-  temp.status = SS_REMOVED;
-  slot_write(slot, &temp);
+  uint32_t addr;
+  ret = storage_append(SR_REMOVED, key, len, NULL, 0, &addr);
+  int32_t *slot = index_slot(key, len, hash);  // may be moved by gc
+  storage_entry_t *entry = &entries[*slot];
+  if (ret == ESTGFULL) {
+    ret = storage_kill(key, len, entry->addr);
+  }
+  if (ret < 0) {
+    return ret;
+  }
+  const storage_record_t *old = record_at(entry->addr);
+  sectors[entry->addr / SECTOR_SIZE].live -=
+      record_size(old->key_length, old->value_length);
+  index_remove(slot);
   return 0;
 }
 
 int storage_clear() {
-  return km_flash_erase(KALUMA_STORAGE_SECTOR_BASE,
-                        KALUMA_STORAGE_SECTOR_COUNT);
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
+  }
+  for (int s = 0; s < SECTOR_COUNT; s++) {
+    ret = sector_format(s, sectors[s].erase_count + 1);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  index_free();
+  current = -1;
+  next_seq = 0;
+  return 0;
 }
 
 int storage_get_item_count() {
-  const uint8_t *STORAGE_ADDR =
-      (uint8_t *)(km_flash_addr + (SECTOR_BASE * KALUMA_FLASH_SECTOR_SIZE));
-  int len = 0;
-  for (int i = 0; i < SLOT_COUNT; i++) {
-    storage_slot_data_t *slot =
-        (storage_slot_data_t *)(STORAGE_ADDR + (i * SLOT_SIZE));
-    if (slot->status == SS_USE) {
-      len++;
-    }
+  int ret = storage_open();
+  if (ret < 0) {
+    return ret;
   }
-  return len;
+  return entry_count;
 }
@@ -19,6 +19,9 @@
  * SOFTWARE.
  */
 
+#ifndef __STORAGE_H
+#define __STORAGE_H
+
 #include <stdint.h>
 
 #include "board.h"
@@ -26,23 +29,52 @@
 
 #define SECTOR_BASE KALUMA_STORAGE_SECTOR_BASE
 #define SECTOR_COUNT KALUMA_STORAGE_SECTOR_COUNT
-#define SLOT_SIZE KALUMA_FLASH_PAGE_SIZE
-#define SLOT_DATA_MAX (SLOT_SIZE - 3)
-#define SLOT_COUNT ((SECTOR_COUNT * KALUMA_FLASH_SECTOR_SIZE) / SLOT_SIZE)
+#define SECTOR_SIZE KALUMA_FLASH_SECTOR_SIZE
+#define STORAGE_PAGE_SIZE KALUMA_FLASH_PAGE_SIZE
+
+#if SECTOR_COUNT < 2
+#error "storage requires at least 2 flash sectors"
+#endif
+
+#define STORAGE_SECTOR_MAGIC 0x3153564B  // "KVS1"
+#define STORAGE_RECORD_MAGIC 0x524B      // "KR"
+#define STORAGE_ALIGN 4
+#define STORAGE_KEY_MAX 255
+#define STORAGE_DATA_MAX \
+  (SECTOR_SIZE - sizeof(storage_sector_header_t) - sizeof(storage_record_t))
+// collect a sector first if it lags the most worn one by this many erases
+#define STORAGE_WEAR_DELTA 32
 
 typedef enum {
-  SS_REMOVED = 0x00,
-  SS_USE = 0xF0,
-  SS_EMPTY = 0xFF,
-} storage_slot_status_t;
+  SR_VALUE = 0xF0,
+  SR_REMOVED = 0x0F,
+  SR_KILLED = 0x00,
+} storage_record_type_t;
+
+/**
+ * Written at the start of each sector after it is erased
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t erase_count;
+  uint32_t reserved[2];
+} storage_sector_header_t;
 
+/**
+ * Records are appended to a sector (aligned to STORAGE_ALIGN) and followed
+ * by key and value bytes. The record with the highest seq wins for a key.
+ */
 typedef struct {
-  uint8_t status;
+  uint16_t magic;
+  uint8_t type;
   uint8_t key_length;
-  uint8_t value_length;
-  char buffer[SLOT_DATA_MAX];
-} storage_slot_data_t;
+  uint32_t value_length;
+  uint32_t seq;
+  uint32_t crc;  // of the fields above except type, key and value
+} storage_record_t;
 
+int storage_init();
+void storage_cleanup();
 int storage_set_item(char *key, char *value);
 int storage_get_value_length(char *key);
 int storage_get_value(char *key, char *value);
@@ -51,3 +83,5 @@ int storage_get_key(int index, char *key);
 int storage_remove_item(char *key);
 int storage_clear();
 int storage_get_item_count();
+
+#endif /* __STORAGE_H */
@@ -82,7 +82,7 @@ JERRYXX_FUN(stdout_write_fn) {
   jerry_length_t length = 0;
   jerry_length_t offset = 0;
   jerry_value_t arrbuf = jerry_get_typedarray_buffer(chunk, &offset, &length);
-  uint8_t *buf = jerry_get_arraybuffer_pointer(arrbuf);
+  uint8_t *buf = jerry_get_arraybuffer_pointer(arrbuf) + offset;
   jerry_release_value(arrbuf);
   for (int i = 0; i < length; i++) {
     km_tty_putc(buf[i]);
@@ -78,13 +78,63 @@ class Readable extends __Stream {
   }
 }
 
+/**
+ * Convert a binary string to Uint8Array
+ * @param {string} str
+ * @return {Uint8Array}
+ */
+function __toBytes(str) {
+  var len = str.length;
+  var bytes = new Uint8Array(len);
+  for (var i = 0; i < len; i++) {
+    bytes[i] = str.charCodeAt(i);
+  }
+  return bytes;
+}
+
+/**
+ * Concatenate queued chunks into a single chunk. Strings are joined as
+ * strings, and any Uint8Array in the list makes the result an Uint8Array.
+ * @param {Array<Uint8Array|string>} chunks
+ * @param {number} length Total length of chunks in bytes
+ * @return {Uint8Array|string}
+ */
+function __concat(chunks, length) {
+  if (chunks.length === 1) {
+    return chunks[0];
+  }
+  if (chunks.every((c) => typeof c === 'string')) {
+    return chunks.join('');
+  }
+  var buf = new Uint8Array(length);
+  var pos = 0;
+  chunks.forEach((c) => {
+    if (typeof c === 'string') c = __toBytes(c);
+    buf.set(c, pos);
+    pos += c.length;
+  });
+  return buf;
+}
+
 /**
  * Writable class
  */
 class Writable extends __Stream {
-  constructor() {
+  /**
+   * @param {object} options
+   *   .highWaterMark {number} Buffer level in bytes where write() starts
+   *     to return false. Default: 1024
+   */
+  constructor(options) {
     super();
-    this._wbuf = '';
+    options = Object.assign({highWaterMark: 1024}, options);
+    this._chunks = [];
+    this._flushCbs = [];
+    this._writing = false;
+    this._inflight = false;
+    this._needDrain = false;
+    this.writableLength = 0;
+    this.writableHighWaterMark = options.highWaterMark;
     this.writableEnded = false;
     this.writableFinished = false;
   }
@@ -117,25 +167,38 @@ class Writable extends __Stream {
     }
   }
 
+  /**
+   * @protected
+   * Append a chunk to the write queue without copying it. The chunk must
+   * not be modified until it is flushed.
+   * @param {Uint8Array|string} chunk
+   */
+  _enqueue(chunk) {
+    if (chunk && chunk.length > 0) {
+      this._chunks.push(chunk);
+      this.writableLength += chunk.length;
+    }
+  }
+
   /**
    * Write a chunk of data to the stream
    * @param {Uint8Array|string} chunk
    * @param {Function} cb
-   * @return {boolean}
+   * @return {boolean} false if the buffer is over highWaterMark. Wait for
+   *   'drain' event before writing more data.
    */
   write(chunk, cb) {
     if (!this.writableEnded) {
-      if (chunk) {
-        if (chunk instanceof Uint8Array) {
-          this._wbuf += String.fromCharCode.apply(null, chunk);
-        } else { // string
-          this._wbuf += chunk;
-        }
+      this._enqueue(chunk);
+      if (!this._writing) {
+        this._writing = true;
+        setTimeout(() => { this.flush(); }, 0);
       }
-      setTimeout(() => { this.flush(); }, 0);
       if (cb) cb();
     }
-    return this._wbuf.length === 0;
+    var ok = this.writableLength < this.writableHighWaterMark;
+    if (!ok) this._needDrain = true;
+    return ok;
   }
 
   /**
@@ -149,18 +212,12 @@ class Writable extends __Stream {
       cb = chunk;
       chunk = undefined;
     }
-    if (chunk) {
-      if (chunk instanceof Uint8Array) {
-        this._wbuf += String.fromCharCode.apply(null, chunk);
-      } else { // string
-        this._wbuf += chunk;
-      }
-    }
+    this._enqueue(chunk);
     if (cb) {
       this.once('finish', cb);
     }
     this.writableEnded = true;
-    if (this._wbuf.length > 0) {
+    if (this.writableLength > 0) {
       this.flush(() => {
         this.finish();
       });
@@ -172,40 +229,67 @@ class Writable extends __Stream {
 
   /**
    * @protected
-   * Flush data in internal buffer
+   * Flush data in internal buffer. All queued chunks are handed over in a
+   * single call, either as a list to _writev() if implemented or merged
+   * into one chunk for _write(). Only one write is in flight at a time.
    * @param {Function} cb
    */
   flush(cb) {
-    if (!this.writableFinished) {
-      if (this._wbuf.length > 0) {
-        this._write(this._wbuf, (err) => {
-          if (err) {
-            this._wbuf = '';
-            this.emit('error', err);
-          } else {
-            if (this._wbuf.length > 0) {
-              setTimeout(() => { this.flush(cb); }, 0);
-            } else {
-              this.emit('drain');
-              if (cb) cb();
-            }
+    if (cb) this._flushCbs.push(cb);
+    if (this._inflight) return;
+    if (!this.writableFinished && this.writableLength > 0) {
+      var chunks = this._chunks;
+      var length = this.writableLength;
+      this._chunks = [];
+      this.writableLength = 0;
+      this._writing = true;
+      this._inflight = true;
+      var done = (err) => {
+        this._inflight = false;
+        if (err) {
+          this._chunks = [];
+          this._flushCbs = [];
+          this.writableLength = 0;
+          this._writing = false;
+          this.emit('error', err);
+        } else if (this.writableLength > 0) {
+          setTimeout(() => { this.flush(); }, 0);
+        } else {
+          this._writing = false;
+          if (this._needDrain) {
+            this._needDrain = false;
+            this.emit('drain');
           }
-        })
-        this._wbuf = '';
+          this._afterFlush();
+        }
+      };
+      if (this._writev) {
+        this._writev(chunks, done);
       } else {
-        if (cb) cb();
+        this._write(__concat(chunks, length), done);
       }
     } else {
-      if (cb) cb();
+      this._writing = false;
+      this._afterFlush();
     }
   }
 
+  /**
+   * @private
+   * Call the pending flush callbacks
+   */
+  _afterFlush() {
+    var cbs = this._flushCbs;
+    this._flushCbs = [];
+    cbs.forEach((f) => f());
+  }
+
   /**
    * @protected
    * Finish to write on the stream
    */
   finish() {
-    if (this.writableEnded && this._wbuf.length === 0) {
+    if (this.writableEnded && this.writableLength === 0) {
       this._final((err) => {
         if (err) {
           this.emit('error', err);
@@ -221,8 +305,8 @@ class Writable extends __Stream {
  * Duplex class
  */
 class Duplex extends Writable /*, Readable */ {
-  constructor() {
-    super();
+  constructor(options) {
+    super(options);
     this.readableEnded = false;
   }
 
@@ -25,6 +25,7 @@
 #include "io.h"
 #include "jerryscript.h"
 #include "jerryxx.h"
+#include "kaluma_magic_strings.h"
 #include "uart.h"
 #include "uart_magic_strings.h"
 
@@ -64,6 +65,40 @@ static void uart_read_cb(km_io_uart_handle_t *handle, uint8_t *buf,
 
 static void uart_close_cb(km_io_handle_t *handle) { free(handle); }
 
+/**
+ * Native handle of a UART object. The port is read from here by every
+ * write; the JS properties (this.port, ...) are for information.
+ */
+typedef struct {
+  uint8_t port;
+  km_io_uart_handle_t *handle;  // NULL if closed
+} uart_native_t;
+
+static void uart_native_free_cb(void *native_p) { free(native_p); }
+
+static const jerry_object_native_info_t uart_native_info = {
+    .free_cb = uart_native_free_cb};
+
+/**
+ * Get the native handle of an opened UART object, NULL if not initialized
+ * or closed
+ */
+static uart_native_t *get_uart_native(jerry_value_t this_val) {
+  void *native_p;
+  if (jerry_get_object_native_pointer(this_val, &native_p,
+                                      &uart_native_info) &&
+      ((uart_native_t *)native_p)->handle != NULL) {
+    return (uart_native_t *)native_p;
+  }
+  return NULL;
+}
+
+static jerry_value_t create_port_error() {
+  return jerry_create_error(
+      JERRY_ERROR_REFERENCE,
+      (const jerry_char_t *)"UART port is not initialized.");
+}
+
 /**
  * uart_native constructor
  * args:
@@ -110,26 +145,45 @@ JERRYXX_FUN(uart_ctor_fn) {
     return jerry_create_error_from_value(create_system_error(ret), true);
   }
 
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_PORT, port);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_BAUDRATE, baudrate);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_BITS, bits);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_PARITY, parity);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_STOP, stop);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_FLOW, flow);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_BUFFERSIZE,
-                              buffer_size);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_TX, pins.tx);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_RX, pins.rx);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_CTS, pins.cts);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, MSTR_UART_RTS, pins.rts);
-  jerryxx_set_property(JERRYXX_GET_THIS, "callback", callback);
+  // native handle (reused if the object is initialized again)
+  void *native_p;
+  uart_native_t *uart = NULL;
+  if (jerry_get_object_native_pointer(JERRYXX_GET_THIS, &native_p,
+                                      &uart_native_info)) {
+    uart = (uart_native_t *)native_p;
+  } else {
+    uart = (uart_native_t *)malloc(sizeof(uart_native_t));
+    if (uart == NULL) {
+      km_uart_close(port);
+      return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+    }
+    uart->handle = NULL;
+    jerry_set_object_native_pointer(JERRYXX_GET_THIS, uart, &uart_native_info);
+  }
+
+  jerry_value_t this_obj = JERRYXX_GET_THIS;
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_PORT_KEY, port);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_BAUDRATE_KEY,
+                                     baudrate);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_BITS_KEY, bits);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_PARITY_KEY, parity);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_STOP_KEY, stop);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_FLOW_KEY, flow);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_BUFFERSIZE_KEY,
+                                     buffer_size);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_TX_KEY, pins.tx);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_RX_KEY, pins.rx);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_CTS_KEY, pins.cts);
+  jerryxx_set_property_number_by_key(this_obj, MSTR_UART_RTS_KEY, pins.rts);
+  jerryxx_set_property_by_key(this_obj, MSTR_CALLBACK_KEY, callback);
 
   // setup io handle
   km_io_uart_handle_t *handle = malloc(sizeof(km_io_uart_handle_t));
   km_io_uart_init(handle);
   handle->read_js_cb = jerry_acquire_value(callback);
-  jerryxx_set_property_number(JERRYXX_GET_THIS, "handle_id", handle->base.id);
   km_io_uart_read_start(handle, port, uart_available_cb, uart_read_cb);
+  uart->port = port;
+  uart->handle = handle;
 
   return jerry_create_undefined();
 }
@@ -141,17 +195,12 @@ JERRYXX_FUN(uart_write_fn) {
   jerry_value_t data = JERRYXX_GET_ARG(0);
   uint32_t count = (uint32_t)JERRYXX_GET_ARG_NUMBER_OPT(1, 1);
 
-  // check this.port
-  jerry_value_t port_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_UART_PORT);
-  if (!jerry_value_is_number(port_value)) {
-    jerry_release_value(port_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"UART port is not initialized.");
+  // get the port
+  uart_native_t *uart = get_uart_native(JERRYXX_GET_THIS);
+  if (uart == NULL) {
+    return create_port_error();
   }
-  uint8_t port = (uint8_t)jerry_get_number_value(port_value);
-  jerry_release_value(port_value);
+  uint8_t port = uart->port;
 
   // write data to the port
   int ret = 0;
@@ -193,17 +242,12 @@ JERRYXX_FUN(uart_write_fn) {
  * UART.prototype.close() function
  */
 JERRYXX_FUN(uart_close_fn) {
-  // check this.port
-  jerry_value_t port_value =
-      jerryxx_get_property(JERRYXX_GET_THIS, MSTR_UART_PORT);
-  if (!jerry_value_is_number(port_value)) {
-    jerry_release_value(port_value);
-    return jerry_create_error(
-        JERRY_ERROR_REFERENCE,
-        (const jerry_char_t *)"UART port is not initialized.");
+  // get the port
+  uart_native_t *uart = get_uart_native(JERRYXX_GET_THIS);
+  if (uart == NULL) {
+    return create_port_error();
   }
-  uint8_t port = (uint8_t)jerry_get_number_value(port_value);
-  jerry_release_value(port_value);
+  uint8_t port = uart->port;
 
   // close the port
   int ret = km_uart_close(port);
@@ -212,18 +256,14 @@ JERRYXX_FUN(uart_close_fn) {
   }
 
   // delete this.port
-  jerryxx_delete_property(JERRYXX_GET_THIS, MSTR_UART_PORT);
+  jerryxx_delete_property_by_key(JERRYXX_GET_THIS, MSTR_UART_PORT_KEY);
 
   // close io handle
-  uint32_t handle_id =
-      jerryxx_get_property_number(JERRYXX_GET_THIS, "handle_id", 0);
-  km_io_uart_handle_t *handle = km_io_uart_get_by_id(handle_id);
-  if (handle != NULL) {
-    jerry_release_value(handle->read_js_cb);
-    km_io_uart_read_stop(handle);
-    km_io_handle_close((km_io_handle_t *)handle, uart_close_cb);
-  }
-  jerryxx_delete_property(JERRYXX_GET_THIS, "handle_id");
+  km_io_uart_handle_t *handle = uart->handle;
+  uart->handle = NULL;
+  jerry_release_value(handle->read_js_cb);
+  km_io_uart_read_stop(handle);
+  km_io_handle_close((km_io_handle_t *)handle, uart_close_cb);
 
   return jerry_create_undefined();
 }
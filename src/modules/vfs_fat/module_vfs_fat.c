@@ -25,6 +25,7 @@
 #include <string.h>
 #include <time.h>
 
+#include "blkcache.h"
 #include "diskio.h"
 #include "err.h"
 #include "io.h"
@@ -41,6 +42,10 @@ extern vfs_fat_root_t vfs_fat_root;
 
 static void vfs_handle_freecb(void *handle) {
   vfs_fat_handle_t *vfs_handle = (vfs_fat_handle_t *)handle;
+  if (vfs_handle->cache != NULL) {
+    km_blkcache_free(vfs_handle->cache);
+  }
+  km_blkdev_close(vfs_handle->blkdev);
   jerry_release_value(vfs_handle->blkdev_js);
   vfs_fat_handle_remove(vfs_handle);
   free(vfs_handle->fat_fs);
@@ -50,23 +55,34 @@ static void vfs_handle_freecb(void *handle) {
 static const jerry_object_native_info_t vfs_handle_info = {
     .free_cb = vfs_handle_freecb};
 
-static int blkdev_ioctl(jerry_value_t blkdev_js, int op, int arg) {
-  // km_tty_printf("blkdev_ioctl(%d, %d)\r\n", op, arg);
-  jerry_value_t ioctl_js = jerryxx_get_property(blkdev_js, "ioctl");
-  jerry_value_t op_js = jerry_create_number(op);
-  jerry_value_t arg_js = jerry_create_number(arg);
-  jerry_value_t args[2] = {op_js, arg_js};
-  jerry_value_t ret = jerry_call_function(ioctl_js, blkdev_js, args, 2);
-  int ret_value = 0;
-  if (jerry_value_is_number(ret)) {
-    ret_value = (int)jerry_get_number_value(ret);
+/**
+ * Block device used by the file system (the cache if enabled)
+ */
+static km_blkdev_t *blkdev_io(vfs_fat_handle_t *vfs_handle) {
+  if (vfs_handle->cache != NULL) {
+    return &vfs_handle->cache->blkdev;
+  }
+  return vfs_handle->blkdev;
+}
+
+static int blkdev_ioctl(vfs_fat_handle_t *vfs_handle, int op, int arg) {
+  return km_blkdev_ioctl(blkdev_io(vfs_handle), op, arg);
+}
+
+static int blkdev_init(vfs_fat_handle_t *vfs_handle) {
+  vfs_handle->block_size = 0;  // may change after init
+  return blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_INIT, 0);
+}
+
+/**
+ * Sector size of the block device, cached after the first query
+ */
+static uint32_t blkdev_block_size(vfs_fat_handle_t *vfs_handle) {
+  if (vfs_handle->block_size == 0) {
+    int size = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_BLOCK_SIZE, 0);
+    vfs_handle->block_size = size > 0 ? size : 0;
   }
-  jerry_release_value(ret);
-  jerry_release_value(arg_js);
-  jerry_release_value(op_js);
-  jerry_release_value(ioctl_js);
-  // km_tty_printf("blkdev_ioctl() ->  %d\r\n", ret_value);
-  return ret_value;
+  return vfs_handle->block_size;
 }
 
 static int ret_conversion(int ret) {
@@ -109,24 +125,10 @@ DRESULT disk_read(void *drv,    /* [IN] Physical drive nmuber (0..) */
   }
   // get native vfs handle
   vfs_fat_handle_t *vfs_handle = (vfs_fat_handle_t *)drv;
-  int block_size = blkdev_ioctl(vfs_handle->blkdev_js, 5, 0);
-  jerry_value_t arraybuffer = jerry_create_arraybuffer_external(
-      count * block_size, (uint8_t *)buff, NULL);
-  jerry_value_t buffer_js = jerry_create_typedarray_for_arraybuffer(
-      JERRY_TYPEDARRAY_UINT8, arraybuffer);
-  jerry_value_t read_js = jerryxx_get_property(vfs_handle->blkdev_js, "read");
-  jerry_value_t block_js = jerry_create_number(sector);
-  jerry_value_t offset_js = jerry_create_number(0);
-  jerry_value_t args[3] = {block_js, buffer_js, offset_js};
-  jerry_value_t ret =
-      jerry_call_function(read_js, vfs_handle->blkdev_js, args, 3);
-  jerry_release_value(ret);
-  jerry_release_value(offset_js);
-  jerry_release_value(block_js);
-  jerry_release_value(read_js);
-  jerry_release_value(buffer_js);
-  jerry_release_value(arraybuffer);
-  return RES_OK;
+  uint32_t block_size = blkdev_block_size(vfs_handle);
+  int ret = km_blkdev_read(blkdev_io(vfs_handle), sector, 0, (uint8_t *)buff,
+                           count * block_size);
+  return ret < 0 ? RES_ERROR : RES_OK;
 }
 
 DRESULT disk_write(
@@ -140,24 +142,10 @@ DRESULT disk_write(
   }
   // get native vfs handle
   vfs_fat_handle_t *vfs_handle = (vfs_fat_handle_t *)drv;
-  int block_size = blkdev_ioctl(vfs_handle->blkdev_js, 5, 0);
-  jerry_value_t arraybuffer = jerry_create_arraybuffer_external(
-      count * block_size, (uint8_t *)buff, NULL);
-  jerry_value_t buffer_js = jerry_create_typedarray_for_arraybuffer(
-      JERRY_TYPEDARRAY_UINT8, arraybuffer);
-  jerry_value_t write_js = jerryxx_get_property(vfs_handle->blkdev_js, "write");
-  jerry_value_t block_js = jerry_create_number(sector);
-  jerry_value_t offset_js = jerry_create_number(0);
-  jerry_value_t args[3] = {block_js, buffer_js, offset_js};
-  jerry_value_t ret =
-      jerry_call_function(write_js, vfs_handle->blkdev_js, args, 3);
-  jerry_release_value(ret);
-  jerry_release_value(offset_js);
-  jerry_release_value(block_js);
-  jerry_release_value(write_js);
-  jerry_release_value(buffer_js);
-  jerry_release_value(arraybuffer);
-  return RES_OK;
+  uint32_t block_size = blkdev_block_size(vfs_handle);
+  int ret = km_blkdev_write(blkdev_io(vfs_handle), sector, 0,
+                            (const uint8_t *)buff, count * block_size);
+  return ret < 0 ? RES_ERROR : RES_OK;
 }
 
 DRESULT disk_ioctl(void *drv, /* [IN] Physical drive nmuber (0..) */
@@ -173,18 +161,18 @@ DRESULT disk_ioctl(void *drv, /* [IN] Physical drive nmuber (0..) */
   switch (cmd) {
     int res;
     case CTRL_SYNC:
-      res = blkdev_ioctl(vfs_handle->blkdev_js, 3, 0);
+      res = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_SYNC, 0);
       if (res == 0) {
         ret = RES_OK;
       }
       break;
     case GET_SECTOR_COUNT:
-      res = blkdev_ioctl(vfs_handle->blkdev_js, 4, 0);
+      res = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_BLOCK_COUNT, 0);
       *(DWORD *)buff = (DWORD)res;
       ret = RES_OK;
       break;
     case GET_SECTOR_SIZE:
-      res = blkdev_ioctl(vfs_handle->blkdev_js, 5, 0);
+      res = blkdev_block_size(vfs_handle);
       *(WORD *)buff = (WORD)res;
       ret = RES_OK;
       break;
@@ -197,7 +185,7 @@ DRESULT disk_ioctl(void *drv, /* [IN] Physical drive nmuber (0..) */
       ret = RES_OK;
       break;
     case IOCTL_INIT:
-      res = blkdev_ioctl(vfs_handle->blkdev_js, 1, 0);
+      res = blkdev_init(vfs_handle);
       if (res < 0) {
         break;
       }
@@ -240,11 +228,24 @@ DWORD get_fattime(void) {
  * VFSFAT constructor
  * args:
  *   blockdev {object}
+ *   options {object}
+ *     cache {number} block cache size in bytes (0 = no cache)
+ *     readahead {number} lines to read ahead on a cache miss
  */
 JERRYXX_FUN(vfsfat_ctor_fn) {
   // check and get args
   JERRYXX_CHECK_ARG_OBJECT(0, "blkdev")
+  JERRYXX_CHECK_ARG_OBJECT_OPT(1, "options")
   jerry_value_t blkdev = JERRYXX_GET_ARG(0);
+  uint32_t cache_size = 0;
+  uint32_t readahead = 0;
+  if (JERRYXX_HAS_ARG(1)) {
+    jerry_value_t options = JERRYXX_GET_ARG(1);
+    cache_size = (uint32_t)jerryxx_get_property_number(
+        options, MSTR_VFS_FAT_CACHE, 0);
+    readahead = (uint32_t)jerryxx_get_property_number(
+        options, MSTR_VFS_FAT_READAHEAD, 0);
+  }
 
   // initialize vfs native handle
   vfs_fat_handle_t *vfs_handle =
@@ -253,6 +254,19 @@ JERRYXX_FUN(vfsfat_ctor_fn) {
   vfs_fat_handle_add(vfs_handle);
   vfs_handle->blkdev_js = blkdev;
   jerry_acquire_value(vfs_handle->blkdev_js);
+  vfs_handle->blkdev = km_blkdev_open(blkdev);
+  vfs_handle->cache = NULL;
+  if (vfs_handle->blkdev == NULL) {
+    jerry_release_value(vfs_handle->blkdev_js);
+    vfs_fat_handle_remove(vfs_handle);
+    free(vfs_handle);
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  if (cache_size > 0) {
+    vfs_handle->cache =
+        km_blkcache_new(vfs_handle->blkdev, cache_size, readahead);
+  }
+  vfs_handle->block_size = 0;
   vfs_handle->fat_fs = (FATFS *)malloc(sizeof(FATFS));
   vfs_handle->fat_fs->drv = (void *)vfs_handle;
   vfs_handle->status = STA_NOINIT;
@@ -261,6 +275,26 @@ JERRYXX_FUN(vfsfat_ctor_fn) {
   return jerry_create_undefined();
 }
 
+/**
+ * VFSFAT.prototype.cacheStats()
+ * returns:
+ *   {object} {hits, misses, writebacks} or undefined if no cache
+ */
+JERRYXX_FUN(vfs_fat_cache_stats_fn) {
+  // get native vfs handle
+  JERRYXX_GET_NATIVE_HANDLE(vfs_handle, vfs_fat_handle_t, vfs_handle_info);
+  if (vfs_handle->cache == NULL) {
+    return jerry_create_undefined();
+  }
+  km_blkcache_stats_t *stats = &vfs_handle->cache->stats;
+  jerry_value_t obj = jerry_create_object();
+  jerryxx_set_property_number(obj, MSTR_VFS_FAT_HITS, stats->hits);
+  jerryxx_set_property_number(obj, MSTR_VFS_FAT_MISSES, stats->misses);
+  jerryxx_set_property_number(obj, MSTR_VFS_FAT_WRITEBACKS,
+                              stats->writebacks);
+  return obj;
+}
+
 /**
  * VFSFAT.prototype.mkfs()
  */
@@ -269,8 +303,8 @@ JERRYXX_FUN(vfs_fat_mkfs_fn) {
   JERRYXX_GET_NATIVE_HANDLE(vfs_handle, vfs_fat_handle_t, vfs_handle_info);
 
   // initialize block device
-  blkdev_ioctl(vfs_handle->blkdev_js, 1, 0);
-  int32_t buff_size = blkdev_ioctl(vfs_handle->blkdev_js, 5, 0);
+  blkdev_init(vfs_handle);
+  int32_t buff_size = blkdev_block_size(vfs_handle);
   BYTE *buff = (BYTE *)malloc(sizeof(BYTE) * buff_size);
   // make fs (format)
   FRESULT ret = f_mkfs(vfs_handle->fat_fs, FM_ANY, 0, buff, buff_size);
@@ -290,7 +324,7 @@ JERRYXX_FUN(vfs_fat_mount_fn) {
   JERRYXX_GET_NATIVE_HANDLE(vfs_handle, vfs_fat_handle_t, vfs_handle_info);
 
   // initialize block device
-  blkdev_ioctl(vfs_handle->blkdev_js, 1, 0);
+  blkdev_init(vfs_handle);
 
   FRESULT ret = f_mount(vfs_handle->fat_fs);
   int err = ret_conversion(ret);
@@ -314,7 +348,7 @@ JERRYXX_FUN(vfs_fat_unmount_fn) {
   }
 
   // shutdown block device
-  blkdev_ioctl(vfs_handle->blkdev_js, 2, 0);
+  blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_SHUTDOWN, 0);
   return jerry_create_undefined();
 }
 
@@ -708,6 +742,8 @@ jerry_value_t module_vfs_fat_init() {
                                 vfs_fat_readdir_fn);
   jerryxx_set_property_function(vfs_fat_prototype, MSTR_VFS_FAT_RMDIR,
                                 vfs_fat_rmdir_fn);
+  jerryxx_set_property_function(vfs_fat_prototype, MSTR_VFS_FAT_CACHE_STATS,
+                                vfs_fat_cache_stats_fn);
   jerry_release_value(vfs_fat_prototype);
 
   /* VFSFatFS module exports */
@@ -22,6 +22,8 @@
 #ifndef __VFSFAT_H
 #define __VFSFAT_H
 
+#include "blkcache.h"
+#include "blkdev.h"
 #include "diskio.h"
 #include "ff.h"
 #include "jerryscript.h"
@@ -61,6 +63,9 @@ struct vfs_fat_root_s {
 struct vfs_fat_handle_s {
   km_list_node_t base;
   jerry_value_t blkdev_js;
+  km_blkdev_t *blkdev;   // native block device or adapter to the JS one
+  km_blkcache_t *cache;  // block cache (NULL if disabled)
+  uint32_t block_size;   // sector size (0 if not known yet)
   km_list_t file_handles;
   FATFS *fat_fs;
   DSTATUS status;
@@ -48,5 +48,11 @@
 #define MSTR_VFS_FAT_POSITION "position"
 #define MSTR_VFS_FAT_TYPE "type"
 #define MSTR_VFS_FAT_SIZE "size"
+#define MSTR_VFS_FAT_CACHE "cache"
+#define MSTR_VFS_FAT_READAHEAD "readahead"
+#define MSTR_VFS_FAT_CACHE_STATS "cacheStats"
+#define MSTR_VFS_FAT_HITS "hits"
+#define MSTR_VFS_FAT_MISSES "misses"
+#define MSTR_VFS_FAT_WRITEBACKS "writebacks"
 
 #endif /* __VFS_FAT_MAGIC_STRINGS_H */
@@ -23,6 +23,7 @@
 
 #include <stdlib.h>
 
+#include "blkcache.h"
 #include "err.h"
 #include "io.h"
 #include "jerryscript.h"
@@ -37,6 +38,10 @@ static void vfs_handle_freecb(void *handle) {
   free(vfs_handle->config.lookahead_buffer);
   free(vfs_handle->config.prog_buffer);
   free(vfs_handle->config.read_buffer);
+  if (vfs_handle->cache != NULL) {
+    km_blkcache_free(vfs_handle->cache);
+  }
+  km_blkdev_close(vfs_handle->blkdev);
   jerry_release_value(vfs_handle->blkdev_js);
   vfs_lfs_handle_remove(handle);
   free(handle);
@@ -45,98 +50,78 @@ static void vfs_handle_freecb(void *handle) {
 static const jerry_object_native_info_t vfs_handle_info = {
     .free_cb = vfs_handle_freecb};
 
-static int blkdev_ioctl(jerry_value_t blkdev_js, int op, int arg) {
-  // km_tty_printf("blkdev_ioctl(%d, %d)\r\n", op, arg);
-  jerry_value_t ioctl_js = jerryxx_get_property(blkdev_js, "ioctl");
-  jerry_value_t op_js = jerry_create_number(op);
-  jerry_value_t arg_js = jerry_create_number(arg);
-  jerry_value_t args[2] = {op_js, arg_js};
-  jerry_value_t ret = jerry_call_function(ioctl_js, blkdev_js, args, 2);
-  int ret_value = 0;
-  if (jerry_value_is_number(ret)) {
-    ret_value = (int)jerry_get_number_value(ret);
+/**
+ * Block device used by the file system (the cache if enabled)
+ */
+static km_blkdev_t *blkdev_io(vfs_lfs_handle_t *vfs_handle) {
+  if (vfs_handle->cache != NULL) {
+    return &vfs_handle->cache->blkdev;
   }
-  jerry_release_value(ret);
-  jerry_release_value(arg_js);
-  jerry_release_value(op_js);
-  jerry_release_value(ioctl_js);
-  // km_tty_printf("blkdev_ioctl() ->  %d\r\n", ret_value);
-  return ret_value;
+  return vfs_handle->blkdev;
+}
+
+static int blkdev_ioctl(vfs_lfs_handle_t *vfs_handle, int op, int arg) {
+  return km_blkdev_ioctl(blkdev_io(vfs_handle), op, arg);
 }
 
 static int blkdev_read(const struct lfs_config *c, lfs_block_t block,
                        lfs_off_t off, void *buffer, lfs_size_t size) {
   vfs_lfs_handle_t *vfs_handle = (vfs_lfs_handle_t *)c->context;
-  // call blockdev.read(block, buffer, offset)
   // km_tty_printf("blkdev_read(lfs_config, %d, %d, buffer, %d)\r\n", block,
   // off, size);
-  jerry_value_t arraybuffer =
-      jerry_create_arraybuffer_external(size, (uint8_t *)buffer, NULL);
-  jerry_value_t buffer_js = jerry_create_typedarray_for_arraybuffer(
-      JERRY_TYPEDARRAY_UINT8, arraybuffer);
-  jerry_value_t read_js = jerryxx_get_property(vfs_handle->blkdev_js, "read");
-  jerry_value_t block_js = jerry_create_number(block);
-  jerry_value_t offset_js = jerry_create_number(off);
-  jerry_value_t args[3] = {block_js, buffer_js, offset_js};
-  jerry_value_t ret =
-      jerry_call_function(read_js, vfs_handle->blkdev_js, args, 3);
-  jerry_release_value(ret);
-  jerry_release_value(offset_js);
-  jerry_release_value(block_js);
-  jerry_release_value(read_js);
-  jerry_release_value(buffer_js);
-  jerry_release_value(arraybuffer);
-  return 0;
+  int ret = km_blkdev_read(blkdev_io(vfs_handle), block, off, buffer, size);
+  return ret < 0 ? LFS_ERR_IO : 0;
 }
 
 static int blkdev_prog(const struct lfs_config *c, lfs_block_t block,
                        lfs_off_t off, const void *buffer, lfs_size_t size) {
   vfs_lfs_handle_t *vfs_handle = (vfs_lfs_handle_t *)c->context;
-  // call blockdev.write(block, buffer, offset)
   // km_tty_printf("blkdev_prog(lfs_config, %d, %d, buffer, %d)\r\n", block,
   // off, size);
-  jerry_value_t arraybuffer =
-      jerry_create_arraybuffer_external(size, (uint8_t *)buffer, NULL);
-  jerry_value_t buffer_js = jerry_create_typedarray_for_arraybuffer(
-      JERRY_TYPEDARRAY_UINT8, arraybuffer);
-  jerry_value_t write_js = jerryxx_get_property(vfs_handle->blkdev_js, "write");
-  jerry_value_t block_js = jerry_create_number(block);
-  jerry_value_t offset_js = jerry_create_number(off);
-  jerry_value_t args[3] = {block_js, buffer_js, offset_js};
-  jerry_value_t ret =
-      jerry_call_function(write_js, vfs_handle->blkdev_js, args, 3);
-  jerry_release_value(ret);
-  jerry_release_value(offset_js);
-  jerry_release_value(block_js);
-  jerry_release_value(write_js);
-  jerry_release_value(buffer_js);
-  jerry_release_value(arraybuffer);
-  return 0;
+  int ret = km_blkdev_write(blkdev_io(vfs_handle), block, off, buffer, size);
+  return ret < 0 ? LFS_ERR_IO : 0;
 }
 
 static int blkdev_erase(const struct lfs_config *c, lfs_block_t block) {
   vfs_lfs_handle_t *vfs_handle = (vfs_lfs_handle_t *)c->context;
   // km_tty_printf("blkdev_erase(lfs_config, %d)\r\n", block);
-  blkdev_ioctl(vfs_handle->blkdev_js, 6, block);
-  return 0;
+  int ret = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_BLOCK_ERASE, block);
+  return ret < 0 ? LFS_ERR_IO : 0;
 }
 
 static int blkdev_sync(const struct lfs_config *c) {
   vfs_lfs_handle_t *vfs_handle = (vfs_lfs_handle_t *)c->context;
   // km_tty_printf("blkdev_sync(lfs_config)\r\n");
-  blkdev_ioctl(vfs_handle->blkdev_js, 3, 0);
-  return 0;
+  int ret = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_SYNC, 0);
+  return ret < 0 ? LFS_ERR_IO : 0;
 }
 
 /**
  * VFSLittleFS constructor
  * args:
  *   blockdev {object}
+ *   options {object}
+ *     cache {number} block cache size in bytes (0 = no cache)
+ *     lookahead {number} lookahead buffer size in bytes
+ *     readahead {number} lines to read ahead on a cache miss
  */
 JERRYXX_FUN(vfslfs_ctor_fn) {
   // check and get args
   JERRYXX_CHECK_ARG_OBJECT(0, "blkdev")
+  JERRYXX_CHECK_ARG_OBJECT_OPT(1, "options")
   jerry_value_t blkdev = JERRYXX_GET_ARG(0);
+  uint32_t cache_size = 0;
+  uint32_t lookahead_size = 0;
+  uint32_t readahead = 0;
+  if (JERRYXX_HAS_ARG(1)) {
+    jerry_value_t options = JERRYXX_GET_ARG(1);
+    cache_size = (uint32_t)jerryxx_get_property_number(
+        options, MSTR_VFS_LFS_CACHE, 0);
+    lookahead_size = (uint32_t)jerryxx_get_property_number(
+        options, MSTR_VFS_LFS_LOOKAHEAD, 0);
+    readahead = (uint32_t)jerryxx_get_property_number(
+        options, MSTR_VFS_LFS_READAHEAD, 0);
+  }
 
   // initialize vfs native handle
   vfs_lfs_handle_t *vfs_handle =
@@ -145,20 +130,37 @@ JERRYXX_FUN(vfslfs_ctor_fn) {
   vfs_lfs_handle_add(vfs_handle);
   vfs_handle->blkdev_js = blkdev;
   jerry_acquire_value(vfs_handle->blkdev_js);
+  vfs_handle->blkdev = km_blkdev_open(blkdev);
+  vfs_handle->cache = NULL;
+  if (vfs_handle->blkdev == NULL) {
+    jerry_release_value(vfs_handle->blkdev_js);
+    vfs_lfs_handle_remove(vfs_handle);
+    free(vfs_handle);
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  if (cache_size > 0) {
+    vfs_handle->cache =
+        km_blkcache_new(vfs_handle->blkdev, cache_size, readahead);
+  }
   vfs_handle->config.context = vfs_handle;
   vfs_handle->config.read = blkdev_read;
   vfs_handle->config.prog = blkdev_prog;
   vfs_handle->config.erase = blkdev_erase;
   vfs_handle->config.sync = blkdev_sync;
-  int block_count = blkdev_ioctl(vfs_handle->blkdev_js, 4, 0);
-  int block_size = blkdev_ioctl(vfs_handle->blkdev_js, 5, 0);
-  int unit_size = blkdev_ioctl(vfs_handle->blkdev_js, 7, 0);
+  int block_count =
+      blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_BLOCK_COUNT, 0);
+  int block_size = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_BLOCK_SIZE, 0);
+  int unit_size = blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_BUFFER_SIZE, 0);
   vfs_handle->config.read_size = unit_size;
   vfs_handle->config.prog_size = unit_size;
   vfs_handle->config.block_size = block_size;
   vfs_handle->config.block_count = block_count;
   vfs_handle->config.cache_size = unit_size;
-  vfs_handle->config.lookahead_size = unit_size;
+  // lookahead must be a multiple of 8 bytes
+  if (lookahead_size == 0) {
+    lookahead_size = unit_size;
+  }
+  vfs_handle->config.lookahead_size = ((lookahead_size + 7) / 8) * 8;
   vfs_handle->config.name_max = 255;
   vfs_handle->config.file_max = 1024 * 1024 * 16;  // 16MB
   vfs_handle->config.attr_max = 512;
@@ -182,7 +184,7 @@ JERRYXX_FUN(vfs_lfs_mkfs_fn) {
   JERRYXX_GET_NATIVE_HANDLE(vfs_handle, vfs_lfs_handle_t, vfs_handle_info);
 
   // initialize block device
-  blkdev_ioctl(vfs_handle->blkdev_js, 1, 0);
+  blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_INIT, 0);
 
   // make fs (format)
   int ret = lfs_format(&vfs_handle->lfs, &vfs_handle->config);
@@ -200,7 +202,7 @@ JERRYXX_FUN(vfs_lfs_mount_fn) {
   JERRYXX_GET_NATIVE_HANDLE(vfs_handle, vfs_lfs_handle_t, vfs_handle_info);
 
   // initialize block device
-  blkdev_ioctl(vfs_handle->blkdev_js, 1, 0);
+  blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_INIT, 0);
 
   // mount vfs
   int ret = lfs_mount(&vfs_handle->lfs, &vfs_handle->config);
@@ -224,10 +226,30 @@ JERRYXX_FUN(vfs_lfs_unmount_fn) {
   }
 
   // shutdown block device
-  blkdev_ioctl(vfs_handle->blkdev_js, 2, 0);
+  blkdev_ioctl(vfs_handle, KM_BLKDEV_IOCTL_SHUTDOWN, 0);
   return jerry_create_undefined();
 }
 
+/**
+ * VFSLittleFS.prototype.cacheStats()
+ * returns:
+ *   {object} {hits, misses, writebacks} or undefined if no cache
+ */
+JERRYXX_FUN(vfs_lfs_cache_stats_fn) {
+  // get native vfs handle
+  JERRYXX_GET_NATIVE_HANDLE(vfs_handle, vfs_lfs_handle_t, vfs_handle_info);
+  if (vfs_handle->cache == NULL) {
+    return jerry_create_undefined();
+  }
+  km_blkcache_stats_t *stats = &vfs_handle->cache->stats;
+  jerry_value_t obj = jerry_create_object();
+  jerryxx_set_property_number(obj, MSTR_VFS_LFS_HITS, stats->hits);
+  jerryxx_set_property_number(obj, MSTR_VFS_LFS_MISSES, stats->misses);
+  jerryxx_set_property_number(obj, MSTR_VFS_LFS_WRITEBACKS,
+                              stats->writebacks);
+  return obj;
+}
+
 /**
  * VFSLittleFS.prototype.open()
  * args:
@@ -601,6 +623,8 @@ jerry_value_t module_vfs_lfs_init() {
                                 vfs_lfs_readdir_fn);
   jerryxx_set_property_function(vfs_lfs_prototype, MSTR_VFS_LFS_RMDIR,
                                 vfs_lfs_rmdir_fn);
+  jerryxx_set_property_function(vfs_lfs_prototype, MSTR_VFS_LFS_CACHE_STATS,
+                                vfs_lfs_cache_stats_fn);
   jerry_release_value(vfs_lfs_prototype);
 
   /* vfslittlefs module exports */
@@ -22,6 +22,8 @@
 #ifndef __VFSLFS_H
 #define __VFSLFS_H
 
+#include "blkcache.h"
+#include "blkdev.h"
 #include "jerryscript.h"
 #include "lfs.h"
 #include "utils.h"
@@ -57,6 +59,8 @@ struct vfs_lfs_handle_s {
   struct lfs_config config;
   km_list_t file_handles;
   jerry_value_t blkdev_js;
+  km_blkdev_t *blkdev;   // native block device or adapter to the JS one
+  km_blkcache_t *cache;  // block cache (NULL if disabled)
 };
 
 struct vfs_lfs_file_handle_s {
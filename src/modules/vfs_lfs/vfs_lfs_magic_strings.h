@@ -48,5 +48,12 @@
 #define MSTR_VFS_LFS_POSITION "position"
 #define MSTR_VFS_LFS_TYPE "type"
 #define MSTR_VFS_LFS_SIZE "size"
+#define MSTR_VFS_LFS_CACHE "cache"
+#define MSTR_VFS_LFS_LOOKAHEAD "lookahead"
+#define MSTR_VFS_LFS_READAHEAD "readahead"
+#define MSTR_VFS_LFS_CACHE_STATS "cacheStats"
+#define MSTR_VFS_LFS_HITS "hits"
+#define MSTR_VFS_LFS_MISSES "misses"
+#define MSTR_VFS_LFS_WRITEBACKS "writebacks"
 
 #endif /* __VFS_LFS_MAGIC_STRINGS_H */
@@ -0,0 +1,5 @@
+list(APPEND SOURCES
+  ${SRC_DIR}/modules/worker/worker.c
+  ${SRC_DIR}/modules/worker/module_worker.c)
+include_directories(${SRC_DIR}/modules/worker)
+add_definitions(-DMODULE_WORKER_SELECTED)
@@ -0,0 +1,247 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "module_worker.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "adc.h"
+#include "err.h"
+#include "jerryscript.h"
+#include "jerryxx.h"
+#include "magic_strings.h"
+#include "worker.h"
+#include "worker_magic_strings.h"
+
+/**
+ * Create a typed array with a copy of the data
+ */
+static jerry_value_t create_typedarray(jerry_typedarray_type_t type,
+                                       size_t length, const uint8_t *data,
+                                       size_t size) {
+  jerry_value_t array = jerry_create_typedarray(type, length);
+  jerry_length_t offset = 0;
+  jerry_length_t byte_length = 0;
+  jerry_value_t buffer = jerry_get_typedarray_buffer(array, &offset,
+                                                     &byte_length);
+  memcpy(jerry_get_arraybuffer_pointer(buffer) + offset, data, size);
+  jerry_release_value(buffer);
+  return array;
+}
+
+/**
+ * Called in the event loop when a job is completed. Calls the JS callback
+ * with (error, result).
+ */
+static void worker_done_cb(km_worker_job_t *job) {
+  jerry_value_t callback = (jerry_value_t)job->data;
+  jerry_value_t err = jerry_create_null();
+  jerry_value_t result = jerry_create_undefined();
+  if (job->result < 0) {
+    jerry_release_value(err);
+    err = create_system_error(job->result);
+  } else if (job->type == KM_WORKER_JOB_UART_WRITE) {
+    jerry_release_value(result);
+    result = jerry_create_number(job->result);
+  } else if (job->type == KM_WORKER_JOB_SPI_TRANSFER) {
+    size_t len = job->size / 2;
+    jerry_release_value(result);
+    result = create_typedarray(JERRY_TYPEDARRAY_UINT8, len,
+                               job->buffer + len, len);
+  } else if (job->type == KM_WORKER_JOB_ADC_SAMPLE) {
+    jerry_release_value(result);
+    result = create_typedarray(JERRY_TYPEDARRAY_FLOAT32,
+                               job->size / sizeof(float), job->buffer,
+                               job->size);
+  }
+  km_worker_job_free(job);
+  if (jerry_value_is_function(callback)) {
+    jerry_value_t this_val = jerry_create_undefined();
+    jerry_value_t args[2] = {err, result};
+    jerry_value_t ret_val = jerry_call_function(callback, this_val, args, 2);
+    if (jerry_value_is_error(ret_val)) {
+      // print error
+      jerryxx_print_error(ret_val, true);
+    }
+    jerry_release_value(ret_val);
+    jerry_release_value(this_val);
+  }
+  jerry_release_value(result);
+  jerry_release_value(err);
+  jerry_release_value(callback);
+}
+
+/**
+ * Submit a job with the callback, or return the error
+ */
+static jerry_value_t worker_submit(km_worker_job_t *job,
+                                   jerry_value_t callback) {
+  job->data = (uint32_t)jerry_acquire_value(callback);
+  int ret = km_worker_submit(job, worker_done_cb);
+  if (ret < 0) {
+    jerry_release_value((jerry_value_t)job->data);
+    km_worker_job_free(job);
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  return jerry_create_undefined();
+}
+
+/**
+ * Allocate a job with a copy of the data (Uint8Array or string). The data
+ * is copied into the job buffer of (size * multiplier) bytes.
+ */
+static km_worker_job_t *worker_job_alloc_with_data(uint8_t type,
+                                                   jerry_value_t data,
+                                                   size_t multiplier) {
+  km_worker_job_t *job = NULL;
+  if (jerry_value_is_typedarray(data) &&
+      jerry_get_typedarray_type(data) == JERRY_TYPEDARRAY_UINT8) {
+    jerry_length_t offset = 0;
+    jerry_length_t len = 0;
+    jerry_value_t buffer = jerry_get_typedarray_buffer(data, &offset, &len);
+    job = km_worker_job_alloc(type, len * multiplier);
+    if (job != NULL) {
+      memcpy(job->buffer, jerry_get_arraybuffer_pointer(buffer) + offset, len);
+    }
+    jerry_release_value(buffer);
+  } else if (jerry_value_is_string(data)) {
+    jerry_size_t len = jerryxx_get_ascii_string_size(data);
+    job = km_worker_job_alloc(type, len * multiplier);
+    if (job != NULL) {
+      jerryxx_string_to_ascii_char_buffer(data, job->buffer, len);
+    }
+  }
+  return job;
+}
+
+#define WORKER_DATA_TYPE_ERROR                              \
+  jerry_create_error(JERRY_ERROR_TYPE,                      \
+                     (const jerry_char_t *)"The data argument " \
+                                           "must be Uint8Array or string.")
+
+/**
+ * delay(msec, callback) function. Occupies the worker for the delay.
+ */
+JERRYXX_FUN(worker_delay_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "msec");
+  JERRYXX_CHECK_ARG_FUNCTION(1, "callback");
+  km_worker_job_t *job = km_worker_job_alloc(KM_WORKER_JOB_DELAY, 0);
+  if (job == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  job->args[0] = (uint32_t)JERRYXX_GET_ARG_NUMBER(0);
+  return worker_submit(job, JERRYXX_GET_ARG(1));
+}
+
+/**
+ * uartWrite(port, data, callback) function
+ */
+JERRYXX_FUN(worker_uart_write_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "port");
+  JERRYXX_CHECK_ARG(1, "data");
+  JERRYXX_CHECK_ARG_FUNCTION(2, "callback");
+  km_worker_job_t *job = worker_job_alloc_with_data(
+      KM_WORKER_JOB_UART_WRITE, JERRYXX_GET_ARG(1), 1);
+  if (job == NULL) {
+    return WORKER_DATA_TYPE_ERROR;
+  }
+  job->args[0] = (uint32_t)JERRYXX_GET_ARG_NUMBER(0);
+  return worker_submit(job, JERRYXX_GET_ARG(2));
+}
+
+/**
+ * spiTransfer(bus, data, timeout, callback) function
+ */
+JERRYXX_FUN(worker_spi_transfer_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "bus");
+  JERRYXX_CHECK_ARG(1, "data");
+  JERRYXX_CHECK_ARG_NUMBER(2, "timeout");
+  JERRYXX_CHECK_ARG_FUNCTION(3, "callback");
+  km_worker_job_t *job = worker_job_alloc_with_data(
+      KM_WORKER_JOB_SPI_TRANSFER, JERRYXX_GET_ARG(1), 2);
+  if (job == NULL) {
+    return WORKER_DATA_TYPE_ERROR;
+  }
+  job->args[0] = (uint32_t)JERRYXX_GET_ARG_NUMBER(0);
+  job->args[1] = (uint32_t)JERRYXX_GET_ARG_NUMBER(2);
+  return worker_submit(job, JERRYXX_GET_ARG(3));
+}
+
+/**
+ * adcSample(pin, count, interval, callback) function. Takes count samples
+ * every interval (in microseconds).
+ */
+JERRYXX_FUN(worker_adc_sample_fn) {
+  JERRYXX_CHECK_ARG_NUMBER(0, "pin");
+  JERRYXX_CHECK_ARG_NUMBER(1, "count");
+  JERRYXX_CHECK_ARG_NUMBER(2, "interval");
+  JERRYXX_CHECK_ARG_FUNCTION(3, "callback");
+  uint8_t pin = (uint8_t)JERRYXX_GET_ARG_NUMBER(0);
+  uint32_t count = (uint32_t)JERRYXX_GET_ARG_NUMBER(1);
+  int ret = km_adc_setup(pin);
+  if (ret < 0) {
+    return jerry_create_error_from_value(create_system_error(ret), true);
+  }
+  km_worker_job_t *job =
+      km_worker_job_alloc(KM_WORKER_JOB_ADC_SAMPLE, count * sizeof(float));
+  if (job == NULL) {
+    return jerry_create_error_from_value(create_system_error(ENOMEM), true);
+  }
+  job->args[0] = (uint32_t)ret;
+  job->args[1] = (uint32_t)JERRYXX_GET_ARG_NUMBER(2);
+  return worker_submit(job, JERRYXX_GET_ARG(3));
+}
+
+/**
+ * stats() function
+ */
+JERRYXX_FUN(worker_stats_fn) {
+  km_worker_stats_t stats;
+  km_worker_get_stats(&stats);
+  jerry_value_t obj = jerry_create_object();
+  jerry_value_t running = jerry_create_boolean(km_worker_is_running());
+  jerryxx_set_property(obj, MSTR_WORKER_RUNNING, running);
+  jerry_release_value(running);
+  jerryxx_set_property_number(obj, MSTR_WORKER_PENDING, km_worker_pending());
+  jerryxx_set_property_number(obj, MSTR_WORKER_SUBMITTED, stats.submitted);
+  jerryxx_set_property_number(obj, MSTR_WORKER_COMPLETED, stats.completed);
+  jerryxx_set_property_number(obj, MSTR_WORKER_BUSY, stats.busy);
+  return obj;
+}
+
+/**
+ * Initialize 'worker' module
+ */
+jerry_value_t module_worker_init() {
+  jerry_value_t exports = jerry_create_object();
+  jerryxx_set_property_function(exports, MSTR_WORKER_DELAY, worker_delay_fn);
+  jerryxx_set_property_function(exports, MSTR_WORKER_UART_WRITE,
+                                worker_uart_write_fn);
+  jerryxx_set_property_function(exports, MSTR_WORKER_SPI_TRANSFER,
+                                worker_spi_transfer_fn);
+  jerryxx_set_property_function(exports, MSTR_WORKER_ADC_SAMPLE,
+                                worker_adc_sample_fn);
+  jerryxx_set_property_function(exports, MSTR_WORKER_STATS, worker_stats_fn);
+  jerryxx_set_property_number(exports, MSTR_WORKER_QUEUE_SIZE,
+                              KM_WORKER_QUEUE_SIZE);
+  return exports;
+}
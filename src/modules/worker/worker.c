@@ -0,0 +1,247 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "worker.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "adc.h"
+#include "err.h"
+#include "io.h"
+#include "spi.h"
+#include "system.h"
+#include "uart.h"
+#include "worker_port.h"
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define KM_WORKER_QUEUE_MASK (KM_WORKER_QUEUE_SIZE - 1)
+
+typedef struct {
+  km_worker_job_t *jobs[KM_WORKER_QUEUE_SIZE];
+  uint32_t head;  // written by the producer only
+  uint32_t tail;  // written by the consumer only
+} km_worker_queue_t;
+
+static km_worker_queue_t submit_queue;    // event loop -> worker
+static km_worker_queue_t complete_queue;  // worker -> event loop
+static km_worker_job_fn handlers[KM_WORKER_JOB_TYPE_MAX];
+static bool running = false;
+static uint32_t stop_flag = 0;
+static uint32_t pending = 0;
+static uint32_t submitted = 0;
+static uint32_t completed = 0;  // written by the worker only
+static uint32_t busy = 0;       // written by the worker only
+static km_io_idle_handle_t idler;
+
+static void km_worker_queue_push(km_worker_queue_t *queue,
+                                 km_worker_job_t *job) {
+  uint32_t head = queue->head;
+  queue->jobs[head & KM_WORKER_QUEUE_MASK] = job;
+  STORE_RELEASE(&queue->head, head + 1);
+}
+
+static km_worker_job_t *km_worker_queue_pop(km_worker_queue_t *queue) {
+  uint32_t tail = queue->tail;
+  if (tail == LOAD_ACQUIRE(&queue->head)) {
+    return NULL;
+  }
+  km_worker_job_t *job = queue->jobs[tail & KM_WORKER_QUEUE_MASK];
+  STORE_RELEASE(&queue->tail, tail + 1);
+  return job;
+}
+
+/* built-in job handlers (run in the worker context) */
+
+static int km_worker_delay(km_worker_job_t *job) {
+  km_delay(job->args[0]);
+  return 0;
+}
+
+static int km_worker_uart_write(km_worker_job_t *job) {
+  return km_uart_write(job->args[0], job->buffer, job->size);
+}
+
+/**
+ * The buffer holds the data to send in the first half, and receives the
+ * data in the second half.
+ */
+static int km_worker_spi_transfer(km_worker_job_t *job) {
+  size_t len = job->size / 2;
+  return km_spi_sendrecv(job->args[0], job->buffer, job->buffer + len, len,
+                         job->args[1]);
+}
+
+/**
+ * Fill the buffer with float samples, taken at every interval. Sampling is
+ * scheduled on absolute time so the handler overhead does not accumulate.
+ */
+static int km_worker_adc_sample(km_worker_job_t *job) {
+  float *samples = (float *)job->buffer;
+  size_t count = job->size / sizeof(float);
+  uint64_t next = km_micro_gettime();
+  for (size_t i = 0; i < count; i++) {
+    uint64_t now = km_micro_gettime();
+    if (next > now) {
+      km_micro_delay(next - now);
+    }
+    samples[i] = (float)km_adc_read(job->args[0]);
+    next += job->args[1];
+  }
+  return count;
+}
+
+static void km_worker_entry() {
+  while (!LOAD_ACQUIRE(&stop_flag)) {
+    km_worker_job_t *job = km_worker_queue_pop(&submit_queue);
+    if (job == NULL) {
+      km_worker_port_wait();
+      continue;
+    }
+    uint64_t start = km_micro_gettime();
+    km_worker_job_fn fn =
+        job->type < KM_WORKER_JOB_TYPE_MAX ? handlers[job->type] : NULL;
+    job->result = fn ? fn(job) : ENOSYS;
+    STORE_RELEASE(&busy, busy + (uint32_t)(km_micro_gettime() - start));
+    STORE_RELEASE(&completed, completed + 1);
+    km_worker_queue_push(&complete_queue, job);
+    km_worker_port_signal();
+  }
+}
+
+static void km_worker_idle_cb(km_io_idle_handle_t *handle) {
+  km_worker_poll();
+}
+
+static int km_worker_start() {
+  memset(&submit_queue, 0, sizeof(km_worker_queue_t));
+  memset(&complete_queue, 0, sizeof(km_worker_queue_t));
+  handlers[KM_WORKER_JOB_DELAY] = km_worker_delay;
+  handlers[KM_WORKER_JOB_UART_WRITE] = km_worker_uart_write;
+  handlers[KM_WORKER_JOB_SPI_TRANSFER] = km_worker_spi_transfer;
+  handlers[KM_WORKER_JOB_ADC_SAMPLE] = km_worker_adc_sample;
+  STORE_RELEASE(&stop_flag, 0);
+  int ret = km_worker_port_start(km_worker_entry);
+  if (ret < 0) {
+    return ret;
+  }
+  running = true;
+  km_io_idle_init(&idler);
+  km_io_idle_start(&idler, km_worker_idle_cb);
+  return 0;
+}
+
+km_worker_job_t *km_worker_job_alloc(uint8_t type, size_t size) {
+  km_worker_job_t *job =
+      (km_worker_job_t *)malloc(sizeof(km_worker_job_t) + size);
+  if (job != NULL) {
+    memset(job, 0, sizeof(km_worker_job_t));
+    job->type = type;
+    job->size = size;
+    job->buffer = (uint8_t *)(job + 1);
+  }
+  return job;
+}
+
+void km_worker_job_free(km_worker_job_t *job) { free(job); }
+
+int km_worker_register(uint8_t type, km_worker_job_fn fn) {
+  if (type < KM_WORKER_JOB_USER || type >= KM_WORKER_JOB_TYPE_MAX) {
+    return EINVAL;
+  }
+  // published to the worker by the release store of the next submission
+  handlers[type] = fn;
+  return 0;
+}
+
+int km_worker_submit(km_worker_job_t *job, km_worker_done_cb done_cb) {
+  if (job->type >= KM_WORKER_JOB_TYPE_MAX) {
+    return EINVAL;
+  }
+  if (!running) {
+    int ret = km_worker_start();
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  // jobs in flight never exceed the queue size, so the worker can always
+  // push to the completion queue.
+  if (pending >= KM_WORKER_QUEUE_SIZE) {
+    return EBUSY;
+  }
+  job->done_cb = done_cb;
+  pending++;
+  submitted++;
+  km_worker_queue_push(&submit_queue, job);
+  km_worker_port_notify();
+  return 0;
+}
+
+uint32_t km_worker_pending() { return pending; }
+
+void km_worker_poll() {
+  if (!running) {
+    return;
+  }
+  km_worker_job_t *job;
+  while ((job = km_worker_queue_pop(&complete_queue)) != NULL) {
+    pending--;
+    if (job->done_cb) {
+      job->done_cb(job);
+    } else {
+      km_worker_job_free(job);
+    }
+  }
+}
+
+void km_worker_get_stats(km_worker_stats_t *stats) {
+  stats->submitted = submitted;
+  stats->completed = LOAD_ACQUIRE(&completed);
+  stats->busy = LOAD_ACQUIRE(&busy);
+}
+
+bool km_worker_is_running() { return running; }
+
+void km_worker_cleanup() {
+  if (running) {
+    STORE_RELEASE(&stop_flag, 1);
+    km_worker_port_notify();
+    km_worker_port_join();
+    running = false;
+    km_io_idle_stop(&idler);
+    km_worker_job_t *job;
+    while ((job = km_worker_queue_pop(&submit_queue)) != NULL) {
+      km_worker_job_free(job);
+    }
+    while ((job = km_worker_queue_pop(&complete_queue)) != NULL) {
+      km_worker_job_free(job);
+    }
+  }
+  for (int i = KM_WORKER_JOB_USER; i < KM_WORKER_JOB_TYPE_MAX; i++) {
+    handlers[i] = NULL;
+  }
+  pending = 0;
+  submitted = 0;
+  completed = 0;
+  busy = 0;
+}
@@ -0,0 +1,138 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __KM_WORKER_H
+#define __KM_WORKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Jobs are passed to the worker (the second core, or a thread) through a
+ * submit queue and returned to the event loop through a completion queue.
+ * Both are single-producer single-consumer rings of job pointers, so the
+ * number of jobs in flight is limited to the queue size.
+ */
+#define KM_WORKER_QUEUE_SIZE 16  // should be a power of 2
+#define KM_WORKER_JOB_TYPE_MAX 16
+
+enum {
+  KM_WORKER_JOB_DELAY = 0,      // args[0]: msec
+  KM_WORKER_JOB_UART_WRITE,     // args[0]: port
+  KM_WORKER_JOB_SPI_TRANSFER,   // args[0]: bus, args[1]: timeout
+  KM_WORKER_JOB_ADC_SAMPLE,     // args[0]: adc index, args[1]: interval (us)
+  KM_WORKER_JOB_USER,           // first type for km_worker_register()
+};
+
+typedef struct km_worker_job_s km_worker_job_t;
+
+/**
+ * Job handler. Runs in the worker context, so it must not touch the JS heap
+ * or the event loop.
+ *
+ * @return The job result (negative errno on failure).
+ */
+typedef int (*km_worker_job_fn)(km_worker_job_t *job);
+
+/**
+ * Completion callback. Runs in the event loop and owns the job (should free
+ * it by km_worker_job_free()).
+ */
+typedef void (*km_worker_done_cb)(km_worker_job_t *job);
+
+struct km_worker_job_s {
+  uint8_t type;
+  int result;
+  uint32_t args[4];
+  size_t size;
+  uint8_t *buffer;  // owned by the job, valid until the job is freed
+  km_worker_done_cb done_cb;
+  uint32_t data;  // user data (e.g. a JS callback)
+};
+
+typedef struct {
+  uint32_t submitted;
+  uint32_t completed;
+  uint32_t busy;  // time spent in job handlers (us)
+} km_worker_stats_t;
+
+/**
+ * Allocate a job with a buffer of the given size in a single block.
+ *
+ * @param type
+ * @param size
+ * @return The job or NULL if out of memory.
+ */
+km_worker_job_t *km_worker_job_alloc(uint8_t type, size_t size);
+
+/**
+ * Free a job (and its buffer).
+ */
+void km_worker_job_free(km_worker_job_t *job);
+
+/**
+ * Register a job handler for a job type. Handlers are cleared when the
+ * worker is cleaned up.
+ *
+ * @param type
+ * @param fn
+ * @return Returns 0 on success or negative errno on failure.
+ */
+int km_worker_register(uint8_t type, km_worker_job_fn fn);
+
+/**
+ * Submit a job to the worker. The worker is started on the first
+ * submission. The job is owned by the worker until the done callback.
+ *
+ * @param job
+ * @param done_cb called in the event loop when the job is completed
+ * @return Returns 0 on success, EBUSY if the queue is full or negative errno.
+ */
+int km_worker_submit(km_worker_job_t *job, km_worker_done_cb done_cb);
+
+/**
+ * Return the number of submitted jobs not completed yet.
+ */
+uint32_t km_worker_pending();
+
+/**
+ * Deliver the completed jobs to their done callbacks (in the event loop).
+ */
+void km_worker_poll();
+
+/**
+ * Read the worker statistics.
+ */
+void km_worker_get_stats(km_worker_stats_t *stats);
+
+/**
+ * Check whether the worker is running.
+ */
+bool km_worker_is_running();
+
+/**
+ * Stop the worker and free all the jobs in the queues without calling the
+ * done callbacks.
+ */
+void km_worker_cleanup();
+
+#endif /* __KM_WORKER_H */
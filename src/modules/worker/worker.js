@@ -0,0 +1,65 @@
+var native = process.binding(process.binding.worker);
+
+function noop() {}
+
+/**
+ * Jobs run on the worker (the second core, or a thread on Linux) and the
+ * callbacks are called in the event loop with (err, result) when completed.
+ * A peripheral used by the worker should not be used by the main program at
+ * the same time.
+ */
+
+/**
+ * Occupy the worker for a time
+ * @param {number} msec
+ * @param {Function} callback
+ */
+exports.delay = function (msec, callback) {
+  native.delay(msec, callback || noop);
+};
+
+/**
+ * Write data to an UART port (should be open)
+ * @param {number} port
+ * @param {Uint8Array|string} data
+ * @param {Function} callback called with the number of bytes written
+ */
+exports.uartWrite = function (port, data, callback) {
+  native.uartWrite(port, data, callback || noop);
+};
+
+/**
+ * Send and receive data through a SPI bus (should be open)
+ * @param {number} bus
+ * @param {Uint8Array|string} data
+ * @param {number} timeout
+ * @param {Function} callback called with the data received (Uint8Array)
+ */
+exports.spiTransfer = function (bus, data, timeout, callback) {
+  if (typeof timeout === 'function') {
+    callback = timeout;
+    timeout = 5000;
+  }
+  native.spiTransfer(bus, data, timeout, callback || noop);
+};
+
+/**
+ * Read analog samples at a fixed interval
+ * @param {number} pin
+ * @param {number} count
+ * @param {number} interval in microseconds
+ * @param {Function} callback called with the samples (Float32Array)
+ */
+exports.adcSample = function (pin, count, interval, callback) {
+  native.adcSample(pin, count, interval, callback || noop);
+};
+
+/**
+ * Return the worker statistics
+ * @return {{running:boolean, pending:number, submitted:number, completed:number, busy:number}}
+ */
+exports.stats = function () {
+  return native.stats();
+};
+
+exports.QUEUE_SIZE = native.QUEUE_SIZE;
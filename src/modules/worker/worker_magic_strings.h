@@ -0,0 +1,37 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __WORKER_MAGIC_STRINGS_H
+#define __WORKER_MAGIC_STRINGS_H
+
+#define MSTR_WORKER_DELAY "delay"
+#define MSTR_WORKER_UART_WRITE "uartWrite"
+#define MSTR_WORKER_SPI_TRANSFER "spiTransfer"
+#define MSTR_WORKER_ADC_SAMPLE "adcSample"
+#define MSTR_WORKER_STATS "stats"
+#define MSTR_WORKER_QUEUE_SIZE "QUEUE_SIZE"
+#define MSTR_WORKER_RUNNING "running"
+#define MSTR_WORKER_PENDING "pending"
+#define MSTR_WORKER_SUBMITTED "submitted"
+#define MSTR_WORKER_COMPLETED "completed"
+#define MSTR_WORKER_BUSY "busy"
+
+#endif /* __WORKER_MAGIC_STRINGS_H */
@@ -100,3 +100,78 @@ uint8_t *km_prog_addr() {
   return (uint8_t *)(km_flash_addr +
                      (KALUMA_PROG_SECTOR_BASE * KALUMA_FLASH_SECTOR_SIZE));
 }
+
+/**
+ * Offset of the snapshot header from the program address
+ */
+static uint32_t snapshot_offset() {
+  uint32_t end = km_prog_get_size() + 1;  // including null terminator
+  return ((end + KALUMA_FLASH_SECTOR_SIZE - 1) / KALUMA_FLASH_SECTOR_SIZE) *
+         KALUMA_FLASH_SECTOR_SIZE;
+}
+
+km_prog_snapshot_header_t *km_prog_snapshot_header() {
+  if (km_prog_get_size() == 0) return NULL;
+  uint32_t offset = snapshot_offset();
+  if (offset + sizeof(km_prog_snapshot_header_t) > KALUMA_PROG_MAX) {
+    return NULL;
+  }
+  km_prog_snapshot_header_t *header =
+      (km_prog_snapshot_header_t *)(km_prog_addr() + offset);
+  if (header->magic != KM_PROG_SNAPSHOT_MAGIC ||
+      header->size > km_prog_snapshot_max_size()) {
+    return NULL;
+  }
+  return header;
+}
+
+uint32_t *km_prog_snapshot_addr() {
+  return (uint32_t *)(km_prog_addr() + snapshot_offset() +
+                      sizeof(km_prog_snapshot_header_t));
+}
+
+uint32_t km_prog_snapshot_max_size() {
+  uint32_t offset = snapshot_offset() + sizeof(km_prog_snapshot_header_t);
+  if (offset >= KALUMA_PROG_MAX) return 0;
+  return KALUMA_PROG_MAX - offset;
+}
+
+int km_prog_write_snapshot(km_prog_snapshot_header_t *header, uint8_t *data) {
+  if (km_prog_get_size() == 0) return -2;  // ENOENT
+  uint32_t offset = snapshot_offset();
+  // even an empty snapshot needs room for the header after the source
+  if (offset + sizeof(km_prog_snapshot_header_t) > KALUMA_PROG_MAX ||
+      header->size > km_prog_snapshot_max_size()) {
+    return -122;  // EDQUOT
+  }
+  uint32_t sector = KALUMA_PROG_SECTOR_BASE + offset / KALUMA_FLASH_SECTOR_SIZE;
+  uint32_t header_size = sizeof(km_prog_snapshot_header_t);
+  uint32_t total = header_size + header->size;
+  int ret = km_flash_erase(sector, (total + KALUMA_FLASH_SECTOR_SIZE - 1) /
+                                       KALUMA_FLASH_SECTOR_SIZE);
+  if (ret < 0) return ret;
+  uint8_t *page = malloc(KALUMA_FLASH_PAGE_SIZE);
+  if (page == NULL) return -12;  // ENOMEM
+  for (uint32_t pos = 0; pos < total; pos += KALUMA_FLASH_PAGE_SIZE) {
+    memset(page, 0xFF, KALUMA_FLASH_PAGE_SIZE);
+    uint32_t end = pos + KALUMA_FLASH_PAGE_SIZE;
+    if (end > total) end = total;
+    for (uint32_t i = pos; i < end;) {
+      uint32_t len;
+      if (i < header_size) {
+        len = (end < header_size ? end : header_size) - i;
+        memcpy(page + (i - pos), (uint8_t *)header + i, len);
+      } else {
+        len = end - i;
+        memcpy(page + (i - pos), data + (i - header_size), len);
+      }
+      i += len;
+    }
+    ret = km_flash_program(sector + pos / KALUMA_FLASH_SECTOR_SIZE,
+                           pos % KALUMA_FLASH_SECTOR_SIZE, page,
+                           KALUMA_FLASH_PAGE_SIZE);
+    if (ret < 0) break;
+  }
+  free(page);
+  return ret < 0 ? ret : 0;
+}
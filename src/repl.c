@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "err.h"
 #include "io.h"
 #include "jerryscript.h"
 #include "kaluma_config.h"
@@ -442,10 +443,12 @@ static void cmd_reset(km_repl_state_t *state, char *arg) {
 }
 
 static size_t bytes_remained = 0;
+static int compile_result = 0;
 
 static int header_cb(uint8_t *file_name, size_t file_size) {
   km_prog_begin();
   bytes_remained = file_size;
+  compile_result = 0;
   return 0;
 }
 
@@ -466,6 +469,19 @@ static int packet_cb(uint8_t *data, size_t len) {
 static void footer_cb() {
   km_prog_end();
   bytes_remained = 0;
+  compile_result = km_runtime_compile();
+}
+
+/**
+ * Stop the program if it runs from the snapshot in flash, before the flash
+ * is erased
+ */
+static void release_prog() {
+  if (km_runtime_snapshot_in_use()) {
+    km_runtime_cleanup();
+    reset_commands();
+    km_runtime_init(false, false);
+  }
 }
 
 /**
@@ -474,6 +490,7 @@ static void footer_cb() {
 static void cmd_flash(km_repl_state_t *state, char *arg) {
   /* erase flash */
   if (strcmp(arg, "-e") == 0) {
+    release_prog();
     km_prog_clear();
     km_repl_printf("Flash has erased\r\n");
 
@@ -500,6 +517,7 @@ static void cmd_flash(km_repl_state_t *state, char *arg) {
     km_repl_println();
     /* write a file to flash via Ymodem */
   } else if (strcmp(arg, "-w") == 0) {
+    release_prog();
     state->ymodem_state = 1;  // transfering
     km_tty_printf("Transfer a file via YMODEM... (press 'a' to abort)\r\n");
     km_io_tty_read_stop(&tty);
@@ -510,6 +528,12 @@ static void cmd_flash(km_repl_state_t *state, char *arg) {
     switch (result) {
       case KM_YMODEM_OK:
         km_tty_printf("\r\nDone\r\n");
+        // the code is stored, but runs from source without a snapshot
+        if (compile_result == EDQUOT) {
+          km_tty_printf("No space left for the snapshot in flash\r\n");
+        } else if (compile_result < 0) {
+          km_tty_printf("No snapshot stored, running from source\r\n");
+        }
         break;
       case KM_YMODEM_LIMIT:
         km_tty_printf("\r\nThe file size is too large\r\n");
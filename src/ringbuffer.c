@@ -1,10 +1,33 @@
 #include "ringbuffer.h"
 
+#include <string.h>
+
+/*
+ * Each index is written only by one side (w_ptr by the producer, r_ptr by
+ * the consumer). Loading the other side's index with acquire and storing own
+ * index with release ensures the data is visible before the index.
+ */
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
 void ringbuffer_init(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len) {
+  uint32_t size = 1;
+  while (size <= len / 2) {
+    size <<= 1;
+  }
   ringbuffer->r_ptr = 0;
   ringbuffer->w_ptr = 0;
   ringbuffer->buf = buf;
-  ringbuffer->length = len;
+  ringbuffer->length = (len > 0) ? size : 0;
+  ringbuffer->mask = (len > 0) ? size - 1 : 0;
+}
+
+uint32_t ringbuffer_round_size(uint32_t len) {
+  uint32_t size = 1;
+  while (size < len && size < 0x80000000u) {
+    size <<= 1;
+  }
+  return size;
 }
 
 uint32_t ringbuffer_size(ringbuffer_t *ringbuffer) {
@@ -12,80 +35,114 @@ uint32_t ringbuffer_size(ringbuffer_t *ringbuffer) {
 }
 
 uint32_t ringbuffer_length(ringbuffer_t *ringbuffer) {
-  uint32_t len;
-  uint32_t w_ptr = ringbuffer->w_ptr;
-  uint32_t r_ptr = ringbuffer->r_ptr;
-  if (r_ptr <= w_ptr) {
-    len = w_ptr - r_ptr;
-  } else {
-    len = w_ptr - r_ptr + ringbuffer->length;
-  }
-  return len;
+  uint32_t w_ptr = LOAD_ACQUIRE(&ringbuffer->w_ptr);
+  uint32_t r_ptr = LOAD_ACQUIRE(&ringbuffer->r_ptr);
+  return w_ptr - r_ptr;
 }
 
 uint32_t ringbuffer_freespace(ringbuffer_t *ringbuffer) {
   return (ringbuffer->length - ringbuffer_length(ringbuffer));
 }
 
+/**
+ * Copy data from the ring buffer at the (unmasked) position in two segments.
+ */
+static void copy_from(ringbuffer_t *ringbuffer, uint32_t ptr, uint8_t *buf,
+                      uint32_t len) {
+  uint32_t pos = ptr & ringbuffer->mask;
+  uint32_t seg = ringbuffer->length - pos;
+  if (len <= seg) {
+    memcpy(buf, ringbuffer->buf + pos, len);
+  } else {
+    memcpy(buf, ringbuffer->buf + pos, seg);
+    memcpy(buf + seg, ringbuffer->buf, len - seg);
+  }
+}
+
 void ringbuffer_read(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len) {
-  uint32_t k;
-  uint32_t r_ptr;
-  r_ptr = ringbuffer->r_ptr;
-  for (k = 0; k < len; k++) {
-    buf[k] = ringbuffer->buf[r_ptr];
-    r_ptr = (r_ptr + 1) % ringbuffer->length;
+  uint32_t r_ptr = ringbuffer->r_ptr;
+  uint32_t avail = LOAD_ACQUIRE(&ringbuffer->w_ptr) - r_ptr;
+  if (len > avail) {
+    len = avail;
   }
-  ringbuffer->r_ptr = r_ptr;
+  copy_from(ringbuffer, r_ptr, buf, len);
+  STORE_RELEASE(&ringbuffer->r_ptr, r_ptr + len);
 }
 
-void ringbuffer_write(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len) {
-  uint32_t k;
-  uint32_t w_ptr;
-  w_ptr = ringbuffer->w_ptr;
-  for (k = 0; k < len; k++) {
-    ringbuffer->buf[w_ptr] = buf[k];
-    w_ptr = (w_ptr + 1) % ringbuffer->length;
+uint32_t ringbuffer_write(ringbuffer_t *ringbuffer, uint8_t *buf,
+                          uint32_t len) {
+  uint32_t w_ptr = ringbuffer->w_ptr;
+  uint32_t space =
+      ringbuffer->length - (w_ptr - LOAD_ACQUIRE(&ringbuffer->r_ptr));
+  if (len > space) {
+    len = space;
+  }
+  uint32_t pos = w_ptr & ringbuffer->mask;
+  uint32_t seg = ringbuffer->length - pos;
+  if (len <= seg) {
+    memcpy(ringbuffer->buf + pos, buf, len);
+  } else {
+    memcpy(ringbuffer->buf + pos, buf, seg);
+    memcpy(ringbuffer->buf, buf + seg, len - seg);
   }
-  ringbuffer->w_ptr = w_ptr;
+  STORE_RELEASE(&ringbuffer->w_ptr, w_ptr + len);
+  return len;
 }
 
 uint8_t ringbuffer_look_at(ringbuffer_t *ringbuffer, uint32_t offset) {
-  uint32_t r_ptr;
-  r_ptr = ringbuffer->r_ptr;
-  r_ptr = (r_ptr + offset) % ringbuffer->length;
-  return ringbuffer->buf[r_ptr];
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return ringbuffer->buf[(ringbuffer->r_ptr + offset) & ringbuffer->mask];
 }
 
 void ringbuffer_look(ringbuffer_t *ringbuffer, uint8_t *buf, uint32_t len,
                      uint32_t offset) {
-  uint32_t k;
-  uint32_t r_ptr;
-  r_ptr = ringbuffer->r_ptr;
-  r_ptr = (r_ptr + offset) % ringbuffer->length;
-  for (k = 0; k < len; k++) {
-    buf[k] = ringbuffer->buf[r_ptr];
-    r_ptr = (r_ptr + 1) % ringbuffer->length;
-  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  copy_from(ringbuffer, ringbuffer->r_ptr + offset, buf, len);
 }
 
 void ringbuffer_flush(ringbuffer_t *ringbuffer, uint32_t len) {
-  uint32_t r_ptr;
-  r_ptr = ringbuffer->r_ptr;
-  r_ptr = (r_ptr + len) % ringbuffer->length;
-  ringbuffer->r_ptr = r_ptr;
+  STORE_RELEASE(&ringbuffer->r_ptr, ringbuffer->r_ptr + len);
 }
 
 int ringbuffer_find(ringbuffer_t *ringbuffer, uint8_t ch) {
-  uint32_t pos = -1;
-  uint32_t len = ringbuffer_length(ringbuffer);
-  uint32_t r_ptr;
-  r_ptr = ringbuffer->r_ptr % ringbuffer->length;
-  for (int n = 0; n < len; n++) {
-    if (ringbuffer->buf[r_ptr] == ch) {
-      pos = n;
-      break;
-    }
-    r_ptr = (r_ptr + 1) % ringbuffer->length;
+  uint32_t r_ptr = ringbuffer->r_ptr;
+  uint32_t len = LOAD_ACQUIRE(&ringbuffer->w_ptr) - r_ptr;
+  uint32_t pos = r_ptr & ringbuffer->mask;
+  uint32_t seg = ringbuffer->length - pos;
+  if (seg > len) {
+    seg = len;
+  }
+  uint8_t *found = memchr(ringbuffer->buf + pos, ch, seg);
+  if (found != NULL) {
+    return found - (ringbuffer->buf + pos);
+  }
+  found = memchr(ringbuffer->buf, ch, len - seg);
+  if (found != NULL) {
+    return seg + (found - ringbuffer->buf);
   }
-  return pos;
+  return -1;
+}
+
+uint32_t ringbuffer_peek_contiguous(ringbuffer_t *ringbuffer, uint8_t **buf) {
+  uint32_t r_ptr = ringbuffer->r_ptr;
+  uint32_t len = LOAD_ACQUIRE(&ringbuffer->w_ptr) - r_ptr;
+  uint32_t pos = r_ptr & ringbuffer->mask;
+  uint32_t seg = ringbuffer->length - pos;
+  *buf = ringbuffer->buf + pos;
+  return (len < seg) ? len : seg;
+}
+
+uint32_t ringbuffer_reserve_contiguous(ringbuffer_t *ringbuffer,
+                                       uint8_t **buf) {
+  uint32_t w_ptr = ringbuffer->w_ptr;
+  uint32_t space =
+      ringbuffer->length - (w_ptr - LOAD_ACQUIRE(&ringbuffer->r_ptr));
+  uint32_t pos = w_ptr & ringbuffer->mask;
+  uint32_t seg = ringbuffer->length - pos;
+  *buf = ringbuffer->buf + pos;
+  return (space < seg) ? space : seg;
+}
+
+void ringbuffer_commit(ringbuffer_t *ringbuffer, uint32_t len) {
+  STORE_RELEASE(&ringbuffer->w_ptr, ringbuffer->w_ptr + len);
 }
@@ -31,11 +31,31 @@
 #include "jerryscript-port.h"
 #include "jerryscript.h"
 #include "jerryxx.h"
+#include "kaluma_config.h"
 #include "kaluma_magic_strings.h"
 #include "prog.h"
 #include "repl.h"
 #include "system.h"
 #include "tty.h"
+#include "utils.h"
+#ifdef MODULE_WORKER_SELECTED
+#include "worker.h"
+#endif
+
+/**
+ * Smallest buffer worth trying to compile a snapshot into
+ */
+#define KM_RUNTIME_SNAPSHOT_BUFFER_MIN 1024
+
+/**
+ * Number of times a module snapshot buffer is doubled before giving up
+ */
+#define KM_RUNTIME_MODULE_SNAPSHOT_TRIES 3
+
+/**
+ * Magic of the module snapshots cached in the file system
+ */
+#define KM_RUNTIME_MODULE_SNAPSHOT_MAGIC 0x4D534D4B  // "KMSM"
 
 // --------------------------------------------------------------------------
 // PRIVATE VARIABLES
@@ -53,6 +73,13 @@ static uint8_t km_runtime_vm_stop = 0;
  */
 static km_io_idle_handle_t idler;
 
+/**
+ * Whether the running program is executed from the snapshot in flash. The
+ * bytecode is referenced in place, so the program must be stopped before
+ * the flash is rewritten.
+ */
+static bool km_runtime_snapshot_loaded = false;
+
 // --------------------------------------------------------------------------
 // PRIVATE FUNCTIONS
 // --------------------------------------------------------------------------
@@ -77,6 +104,76 @@ static void idler_cb() {
 #endif
 }
 
+/**
+ * Fingerprint of everything a snapshot depends on: the firmware version,
+ * the snapshot format of the engine and the external magic strings which
+ * are referenced by index.
+ */
+static uint32_t snapshot_version() {
+  uint32_t crc = km_crc32(0, (const uint8_t *)KALUMA_VERSION,
+                          strlen(KALUMA_VERSION));
+  uint32_t engine = JERRY_SNAPSHOT_VERSION;
+  crc = km_crc32(crc, (const uint8_t *)&engine, sizeof(engine));
+  for (uint32_t i = 0; i < num_magic_string_items; i++) {
+    crc = km_crc32(crc, magic_string_items[i], magic_string_lengths[i]);
+  }
+  return crc;
+}
+
+/**
+ * Check the snapshot header against the source and the firmware.
+ * @return 1 if the snapshot is valid, 0 if the source is known not to be
+ * compilable, -1 if there is no snapshot or it is stale.
+ */
+static int snapshot_check(km_prog_snapshot_header_t *header) {
+  if (header == NULL || header->version != snapshot_version()) return -1;
+  uint8_t *source = km_prog_addr();
+  if (header->source_size != km_prog_get_size() ||
+      header->source_crc != km_crc32(0, source, header->source_size)) {
+    return -1;
+  }
+  if (header->size == 0) return 0;
+  if (header->crc !=
+      km_crc32(0, (uint8_t *)km_prog_snapshot_addr(), header->size)) {
+    return -1;
+  }
+  return 1;
+}
+
+static jerry_value_t load_source() {
+  uint32_t size = km_prog_get_size();
+  uint8_t *script = km_prog_addr();
+  jerry_value_t parsed_code =
+      jerry_parse(NULL, 0, script, size, JERRY_PARSE_STRICT_MODE);
+  if (jerry_value_is_error(parsed_code)) {
+    return parsed_code;
+  }
+  jerry_value_t ret_value = jerry_run(parsed_code);
+  jerry_release_value(parsed_code);
+  return ret_value;
+}
+
+/**
+ * Wrap a module source in a function expression taking the module scope,
+ * the same way js2c wraps the builtin modules.
+ */
+static const char module_wrapper_header[] =
+    "(function (exports, require, module, __filename, __dirname) {\n";
+static const char module_wrapper_footer[] = "\n})";
+
+static uint8_t *module_wrap(const uint8_t *source, size_t size,
+                            size_t *wrapped_size) {
+  size_t header_len = sizeof(module_wrapper_header) - 1;
+  size_t footer_len = sizeof(module_wrapper_footer) - 1;
+  uint8_t *wrapped = malloc(header_len + size + footer_len);
+  if (wrapped == NULL) return NULL;
+  memcpy(wrapped, module_wrapper_header, header_len);
+  memcpy(wrapped + header_len, source, size);
+  memcpy(wrapped + header_len + size, module_wrapper_footer, footer_len);
+  *wrapped_size = header_len + size + footer_len;
+  return wrapped;
+}
+
 // --------------------------------------------------------------------------
 // PUBLIC FUNCTIONS
 // --------------------------------------------------------------------------
@@ -87,6 +184,7 @@ void km_runtime_init(bool load, bool first) {
                                   16);
   jerry_register_magic_strings(magic_string_items, num_magic_string_items,
                                magic_string_lengths);
+  jerryxx_init_keys();
   km_global_init();
   jerry_gc(JERRY_GC_PRESSURE_HIGH);
   if (load) {
@@ -100,31 +198,189 @@ void km_runtime_init(bool load, bool first) {
 }
 
 void km_runtime_cleanup() {
+  km_global_cleanup();
+  jerryxx_cleanup_keys();
   jerry_cleanup();
+#ifdef MODULE_WORKER_SELECTED
+  // stop the worker before the peripherals it may use are cleaned up
+  km_worker_cleanup();
+#endif
+  km_runtime_snapshot_loaded = false;
   km_system_cleanup();
   km_io_cleanup();
 }
 
-void km_runtime_load() {
-  uint32_t size = km_prog_get_size();
-  if (size > 0) {
-    uint8_t *script = km_prog_addr();
-    jerry_value_t parsed_code =
-        jerry_parse(NULL, 0, script, size, JERRY_PARSE_STRICT_MODE);
-    if (!jerry_value_is_error(parsed_code)) {
-      jerry_value_t ret_value = jerry_run(parsed_code);
-      if (jerry_value_is_error(ret_value)) {
-        jerryxx_print_error(ret_value, true);
-        km_runtime_cleanup();
-        km_runtime_init(false, false);
-        return;
-      }
-      jerry_release_value(ret_value);
-    } else {
-      jerryxx_print_error(parsed_code, true);
+int km_runtime_compile() {
+  uint32_t source_size = km_prog_get_size();
+  if (source_size == 0) return -2;  // ENOENT
+  uint8_t *source = km_prog_addr();
+  km_prog_snapshot_header_t header;
+  header.magic = KM_PROG_SNAPSHOT_MAGIC;
+  header.version = snapshot_version();
+  header.source_size = source_size;
+  header.source_crc = km_crc32(0, source, source_size);
+  header.size = 0;
+  header.crc = 0;
+
+  // the largest buffer we can get, up to the space left in flash
+  size_t buffer_size = km_prog_snapshot_max_size() & ~3;
+  uint32_t *buffer = NULL;
+  while (buffer_size >= KM_RUNTIME_SNAPSHOT_BUFFER_MIN) {
+    buffer = malloc(buffer_size);
+    if (buffer != NULL) break;
+    buffer_size = (buffer_size / 2) & ~3;
+  }
+  if (buffer != NULL) {
+    jerry_value_t ret = jerry_generate_snapshot(
+        NULL, 0, source, source_size, JERRY_SNAPSHOT_SAVE_STRICT, buffer,
+        buffer_size);
+    if (!jerry_value_is_error(ret)) {
+      header.size = (uint32_t)jerry_get_number_value(ret);
+      header.crc = km_crc32(0, (uint8_t *)buffer, header.size);
     }
-    jerry_release_value(parsed_code);
+    jerry_release_value(ret);
+  }
+  // an empty snapshot is still written to mark the source as not compilable
+  int ret = km_prog_write_snapshot(&header, (uint8_t *)buffer);
+  if (buffer != NULL) {
+    free(buffer);
+  }
+  jerry_gc(JERRY_GC_PRESSURE_HIGH);
+  if (ret < 0) return ret;
+  return header.size > 0 ? 0 : -1;
+}
+
+bool km_runtime_snapshot_in_use() { return km_runtime_snapshot_loaded; }
+
+void km_runtime_load() {
+  km_runtime_snapshot_loaded = false;
+  if (km_prog_get_size() == 0) return;
+  int check = snapshot_check(km_prog_snapshot_header());
+  if (check < 0) {
+    // compile once (e.g. after a firmware update), then use the result
+    km_runtime_compile();
+    check = snapshot_check(km_prog_snapshot_header());
+  }
+  jerry_value_t ret_value;
+  if (check > 0) {
+    km_prog_snapshot_header_t *header = km_prog_snapshot_header();
+    km_runtime_snapshot_loaded = true;
+    ret_value = jerry_exec_snapshot(km_prog_snapshot_addr(), header->size, 0,
+                                    0);
+  } else {
+    ret_value = load_source();
+  }
+  if (jerry_value_is_error(ret_value)) {
+    jerryxx_print_error(ret_value, true);
+    jerry_release_value(ret_value);
+    km_runtime_cleanup();
+    km_runtime_init(false, false);
+    return;
   }
+  jerry_release_value(ret_value);
 }
 
 void km_runtime_set_vm_stop(uint8_t stop) { km_runtime_vm_stop = stop; }
+
+jerry_value_t km_runtime_compile_module(const char *filename,
+                                        const uint8_t *source, size_t size) {
+  size_t wrapped_size;
+  uint8_t *wrapped = module_wrap(source, size, &wrapped_size);
+  if (wrapped == NULL) {
+    return jerry_create_error(JERRY_ERROR_RANGE,
+                              (const jerry_char_t *)"Out of memory");
+  }
+  jerry_value_t parsed_code =
+      jerry_parse((const jerry_char_t *)filename, strlen(filename), wrapped,
+                  wrapped_size, JERRY_PARSE_NO_OPTS);
+  free(wrapped);
+  if (jerry_value_is_error(parsed_code)) {
+    return parsed_code;
+  }
+  jerry_value_t fn = jerry_run(parsed_code);
+  jerry_release_value(parsed_code);
+  return fn;
+}
+
+jerry_value_t km_runtime_snapshot_module(const char *filename,
+                                         const uint8_t *source, size_t size) {
+  size_t wrapped_size;
+  uint8_t *wrapped = module_wrap(source, size, &wrapped_size);
+  if (wrapped == NULL) return jerry_create_undefined();
+  km_prog_snapshot_header_t header;
+  header.magic = KM_RUNTIME_MODULE_SNAPSHOT_MAGIC;
+  header.version = snapshot_version();
+  header.source_size = size;
+  header.source_crc = km_crc32(0, source, size);
+  header.size = 0;
+  header.crc = 0;
+  // the bytecode is usually smaller than the source, but grow the buffer
+  // a few times before giving up (a syntax error fails every try)
+  size_t buffer_size = (wrapped_size + KM_RUNTIME_SNAPSHOT_BUFFER_MIN) & ~3;
+  uint32_t *buffer = NULL;
+  for (int i = 0; i < KM_RUNTIME_MODULE_SNAPSHOT_TRIES; i++) {
+    buffer = malloc(sizeof(header) + buffer_size);
+    if (buffer == NULL) break;
+    uint32_t *data = buffer + sizeof(header) / sizeof(uint32_t);
+    jerry_value_t ret = jerry_generate_snapshot(
+        (const jerry_char_t *)filename, strlen(filename), wrapped,
+        wrapped_size, 0, data, buffer_size);
+    if (!jerry_value_is_error(ret)) {
+      header.size = (uint32_t)jerry_get_number_value(ret);
+      header.crc = km_crc32(0, (uint8_t *)data, header.size);
+    }
+    jerry_release_value(ret);
+    if (header.size > 0) break;
+    free(buffer);
+    buffer = NULL;
+    buffer_size *= 2;
+  }
+  free(wrapped);
+  jerry_gc(JERRY_GC_PRESSURE_HIGH);
+  if (buffer == NULL) return jerry_create_undefined();
+  memcpy(buffer, &header, sizeof(header));
+  size_t len = sizeof(header) + header.size;
+  jerry_value_t array = jerry_create_typedarray(JERRY_TYPEDARRAY_UINT8, len);
+  jerry_length_t offset = 0;
+  jerry_length_t length = 0;
+  jerry_value_t array_buffer =
+      jerry_get_typedarray_buffer(array, &offset, &length);
+  jerry_arraybuffer_write(array_buffer, offset, (uint8_t *)buffer, len);
+  jerry_release_value(array_buffer);
+  free(buffer);
+  return array;
+}
+
+jerry_value_t km_runtime_load_module(const uint8_t *snapshot, size_t len,
+                                     const uint8_t *source, size_t size) {
+  km_prog_snapshot_header_t header;
+  if (len < sizeof(header)) return jerry_create_undefined();
+  memcpy(&header, snapshot, sizeof(header));
+  const uint8_t *data = snapshot + sizeof(header);
+  if (header.magic != KM_RUNTIME_MODULE_SNAPSHOT_MAGIC ||
+      header.version != snapshot_version() || header.source_size != size ||
+      header.size == 0 || header.size != len - sizeof(header) ||
+      header.source_crc != km_crc32(0, source, size) ||
+      header.crc != km_crc32(0, data, header.size)) {
+    return jerry_create_undefined();
+  }
+  // the bytecode is copied out, so the snapshot need not outlive the call,
+  // but it must be word aligned
+  uint32_t *aligned = NULL;
+  if ((uintptr_t)data & 3) {
+    aligned = malloc(header.size);
+    if (aligned == NULL) return jerry_create_undefined();
+    memcpy(aligned, data, header.size);
+    data = (const uint8_t *)aligned;
+  }
+  jerry_value_t fn = jerry_exec_snapshot((const uint32_t *)data, header.size,
+                                         0, JERRY_SNAPSHOT_EXEC_COPY_DATA);
+  if (aligned != NULL) {
+    free(aligned);
+  }
+  if (jerry_value_is_error(fn) || !jerry_value_is_function(fn)) {
+    jerry_release_value(fn);
+    return jerry_create_undefined();
+  }
+  return fn;
+}
@@ -74,3 +74,20 @@ uint8_t km_hex2bin(unsigned char *hex) {
   uint8_t hl = km_hex1(hex[1]);
   return hh << 4 | hl;
 }
+
+/**
+ * CRC-32 (IEEE 802.3) with a 16-entry table to keep it small in flash.
+ * Pass 0 as the initial crc, or the previous result to continue.
+ */
+uint32_t km_crc32(uint32_t crc, const uint8_t *data, size_t len) {
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0x0F];
+    crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0x0F];
+  }
+  return ~crc;
+}
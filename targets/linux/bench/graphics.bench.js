@@ -0,0 +1,57 @@
+// Drawing throughput of BufferedGraphicsContext for each bpp and rotation:
+// filled rectangles, lines, text and bitmaps. Run it on builds before and
+// after a change to compare.
+//
+// $ cd build
+// $ ./kaluma ../targets/linux/bench/graphics.bench.js
+
+const { BufferedGraphicsContext } = require("graphics");
+
+const WIDTH = 240;
+const HEIGHT = 240;
+const CALLS = 2000;
+
+const bitmap1 = {
+  width: 32,
+  height: 32,
+  bpp: 1,
+  data: new Uint8Array(32 * 4).fill(0xa5),
+};
+const bitmap16 = {
+  width: 32,
+  height: 32,
+  bpp: 16,
+  data: new Uint8Array(32 * 32 * 2).fill(0x5a),
+};
+
+function bench(name, fn) {
+  const start = micros();
+  for (let i = 0; i < CALLS; i++) {
+    fn(i);
+  }
+  const elapsed = micros() - start;
+  const us = Math.round((elapsed * 100) / CALLS) / 100;
+  console.log(`${name}: ${us}us/call (${CALLS} calls in ${elapsed}us)`);
+}
+
+[1, 3, 16].forEach((bpp) => {
+  for (let rotation = 0; rotation < 4; rotation++) {
+    const gc = new BufferedGraphicsContext(WIDTH, HEIGHT, { bpp, rotation });
+    const tag = `bpp=${bpp} rotation=${rotation}`;
+    gc.setColor(0xffff);
+    gc.setFillColor(0xf800);
+    gc.setFontColor(0x07e0);
+    bench(`${tag} fillRect 100x100`, (i) => gc.fillRect(i % 64, 20, 100, 100));
+    bench(`${tag} drawLine diagonal`, (i) => gc.drawLine(0, i % 64, 239, 200));
+    bench(`${tag} drawLine horizontal`, (i) => gc.drawLine(0, i % 240, 239, i % 240));
+    bench(`${tag} drawText 20 chars`, (i) =>
+      gc.drawText(0, i % 200, "The quick brown fox!")
+    );
+    bench(`${tag} drawBitmap 1-bit 32x32`, (i) =>
+      gc.drawBitmap(i % 200, 40, bitmap1)
+    );
+    bench(`${tag} drawBitmap 16-bit 32x32`, (i) =>
+      gc.drawBitmap(i % 200, 40, bitmap16)
+    );
+  }
+});
@@ -0,0 +1,35 @@
+// Native call overhead of the I2C and SPI methods. The Linux bus drivers
+// are no-ops, so the time is spent in the bindings (argument checks and
+// reading the bus of `this`). Run it on builds before and after a change
+// to compare.
+//
+// $ cd build
+// $ ./kaluma ../targets/linux/bench/native_call.bench.js
+
+const { I2C } = require("i2c");
+const { SPI } = require("spi");
+
+const CALLS = 100000;
+
+function bench(name, fn) {
+  const start = micros();
+  for (let i = 0; i < CALLS; i++) {
+    fn();
+  }
+  const elapsed = micros() - start;
+  const ns = Math.round((elapsed * 1000) / CALLS);
+  console.log(`${name}: ${ns}ns/call (${CALLS} calls in ${elapsed}us)`);
+}
+
+const data = new Uint8Array([0x00]);
+const i2c = new I2C(0);
+const spi = new SPI(0);
+
+bench("noop (js)", () => {});
+bench("i2c.write", () => i2c.write(data, 0x3c));
+bench("i2c.memRead", () => i2c.memRead(1, 0x3c, 0x00));
+bench("spi.send", () => spi.send(data));
+bench("spi.transfer", () => spi.transfer(data));
+
+i2c.close();
+spi.close();
@@ -0,0 +1,168 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Ring buffer throughput benchmark
+ *
+ * $ cd build
+ * $ make ringbuffer_bench
+ * $ ./ringbuffer_bench
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ringbuffer.h"
+
+#define BUFFER_SIZE 2048
+#define TOTAL_BYTES (64 * 1024 * 1024)
+
+static uint8_t buffer[BUFFER_SIZE];
+static ringbuffer_t rb;
+
+static double now_sec() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * Write and read in the same thread with a given chunk size
+ */
+static void bench_copy(uint32_t chunk) {
+  uint8_t src[chunk];
+  uint8_t dst[chunk];
+  for (uint32_t i = 0; i < chunk; i++) {
+    src[i] = (uint8_t)i;
+  }
+  ringbuffer_init(&rb, buffer, sizeof(buffer));
+  uint64_t total = 0;
+  double start = now_sec();
+  while (total < TOTAL_BYTES) {
+    ringbuffer_write(&rb, src, chunk);
+    ringbuffer_read(&rb, dst, chunk);
+    total += chunk;
+  }
+  double elapsed = now_sec() - start;
+  printf("copy      chunk=%-5u %8.1f MB/s\n", chunk,
+         total / elapsed / 1e6);
+}
+
+/**
+ * Zero-copy read with ringbuffer_peek_contiguous()
+ */
+static void bench_zero_copy(uint32_t chunk) {
+  uint8_t src[chunk];
+  for (uint32_t i = 0; i < chunk; i++) {
+    src[i] = (uint8_t)i;
+  }
+  ringbuffer_init(&rb, buffer, sizeof(buffer));
+  uint64_t total = 0;
+  uint32_t sum = 0;
+  double start = now_sec();
+  while (total < TOTAL_BYTES) {
+    ringbuffer_write(&rb, src, chunk);
+    uint8_t *p;
+    uint32_t len;
+    while ((len = ringbuffer_peek_contiguous(&rb, &p)) > 0) {
+      sum += p[0];
+      ringbuffer_flush(&rb, len);
+    }
+    total += chunk;
+  }
+  double elapsed = now_sec() - start;
+  printf("zero-copy chunk=%-5u %8.1f MB/s (%u)\n", chunk,
+         total / elapsed / 1e6, sum & 1);
+}
+
+static void *producer(void *arg) {
+  uint32_t chunk = *(uint32_t *)arg;
+  uint8_t src[chunk];
+  uint8_t seq = 0;
+  uint64_t total = 0;
+  while (total < TOTAL_BYTES) {
+    uint32_t n = chunk;
+    for (uint32_t i = 0; i < n; i++) {
+      src[i] = seq + i;
+    }
+    n = ringbuffer_write(&rb, src, n);
+    if (n == 0) {
+      sched_yield();  // full
+    }
+    seq += n;
+    total += n;
+  }
+  return NULL;
+}
+
+/**
+ * Single producer (thread) and single consumer (main) with data check
+ */
+static void bench_spsc(uint32_t chunk) {
+  pthread_t thread;
+  uint8_t dst[chunk];
+  uint8_t seq = 0;
+  uint64_t total = 0;
+  bool ok = true;
+  ringbuffer_init(&rb, buffer, sizeof(buffer));
+  double start = now_sec();
+  pthread_create(&thread, NULL, producer, &chunk);
+  while (total < TOTAL_BYTES) {
+    uint32_t n = ringbuffer_length(&rb);
+    if (n > chunk) {
+      n = chunk;
+    } else if (n == 0) {
+      sched_yield();  // empty
+    }
+    ringbuffer_read(&rb, dst, n);
+    for (uint32_t i = 0; i < n; i++) {
+      if (dst[i] != (uint8_t)(seq + i)) {
+        ok = false;
+      }
+    }
+    seq += n;
+    total += n;
+  }
+  pthread_join(thread, NULL);
+  double elapsed = now_sec() - start;
+  printf("spsc      chunk=%-5u %8.1f MB/s %s\n", chunk, total / elapsed / 1e6,
+         ok ? "ok" : "CORRUPTED");
+}
+
+int main(int argc, char *argv[]) {
+  setvbuf(stdout, NULL, _IONBF, 0);
+  uint32_t chunks[] = {1, 16, 256, 1024};
+  for (int i = 0; i < 4; i++) {
+    bench_copy(chunks[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    bench_zero_copy(chunks[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    bench_spsc(chunks[i]);
+  }
+  return 0;
+}
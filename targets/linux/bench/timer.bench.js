@@ -0,0 +1,44 @@
+// Timer dispatch latency with 10, 100 and 1000 active timers.
+//
+// $ cd build
+// $ ./kaluma ../targets/linux/bench/timer.bench.js
+
+const ROUNDS = [10, 100, 1000];
+const DURATION = 3000; // msec for each round
+const PERIOD = 10; // msec (each timer gets PERIOD ~ PERIOD + 9)
+
+function run(count, done) {
+  const ids = [];
+  let fired = 0;
+  let total = 0;
+  let max = 0;
+  for (let i = 0; i < count; i++) {
+    const period = PERIOD + (i % 10);
+    let expected = micros() + period * 1000;
+    ids.push(
+      setInterval(() => {
+        const late = micros() - expected;
+        expected += period * 1000;
+        fired++;
+        total += late;
+        if (late > max) max = late;
+      }, period)
+    );
+  }
+  setTimeout(() => {
+    ids.forEach((id) => clearInterval(id));
+    const avg = fired > 0 ? Math.round(total / fired) : 0;
+    console.log(
+      `timers=${count} fired=${fired} avg=${avg}us max=${max}us`
+    );
+    done();
+  }, DURATION);
+}
+
+function next(i) {
+  if (i < ROUNDS.length) {
+    run(ROUNDS[i], () => next(i + 1));
+  }
+}
+
+next(0);
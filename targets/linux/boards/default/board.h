@@ -54,7 +54,7 @@
 // #define PWM_NUM 6
 // #define I2C_NUM 2
 // #define SPI_NUM 2
-// #define UART_NUM 2
+#define UART_NUM 2
 // #define LED_NUM 1
 // #define BUTTON_NUM 1
 
@@ -9,3 +9,7 @@ fs.register("lfs", VFSLittleFS);
 // fs block starts after 4(storage) + 128(program)
 const bd = new Flash(132, 128);
 fs.mount("/", bd, "lfs", true);
+
+// setup network driver on the host sockets
+const { PosixNetwork } = require("posix_net");
+global.__netdev = new PosixNetwork();
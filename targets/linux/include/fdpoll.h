@@ -0,0 +1,132 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __KM_FDPOLL_H
+#define __KM_FDPOLL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "io.h"
+#include "ringbuffer.h"
+
+/**
+ * Callback called when a file descriptor is readable
+ */
+typedef void (*km_fdpoll_cb)(int fd, void *data);
+
+/**
+ * Add a file descriptor to be watched for readability.
+ *
+ * @param fd
+ * @param readable_cb called (in the event loop) when fd is readable
+ * @param data user data passed to the callback
+ * @return 0 on success, negative otherwise (e.g. fd is a regular file)
+ */
+int km_fdpoll_add(int fd, km_fdpoll_cb readable_cb, void *data);
+
+/**
+ * Add a file descriptor which is read into a stream handle. Data read is
+ * pushed to the stream by km_io_stream_push().
+ *
+ * @param fd
+ * @param stream
+ * @return 0 on success, negative otherwise
+ */
+int km_fdpoll_add_stream(int fd, km_io_stream_handle_t *stream);
+
+/**
+ * Replace the readable callback of a file descriptor (already added), or NULL
+ * to stop watching for readability.
+ *
+ * @param fd
+ * @param readable_cb
+ * @return 0 on success, negative otherwise
+ */
+int km_fdpoll_set_readable(int fd, km_fdpoll_cb readable_cb);
+
+/**
+ * Set a callback called when the file descriptor (already added) is writable,
+ * or NULL to stop watching for writability.
+ *
+ * @param fd
+ * @param writable_cb called (in the event loop) when fd is writable
+ * @return 0 on success, negative otherwise
+ */
+int km_fdpoll_set_writable(int fd, km_fdpoll_cb writable_cb);
+
+/**
+ * Let a file descriptor (already added) not keep the event loop alive, e.g.
+ * stdin or internal event fds. File descriptors keep it alive by default.
+ *
+ * @param fd
+ * @return 0 on success, negative otherwise
+ */
+int km_fdpoll_unref(int fd);
+
+/**
+ * Get the number of watched file descriptors keeping the event loop alive.
+ *
+ * @return the number of file descriptors
+ */
+uint32_t km_fdpoll_count();
+
+/**
+ * Remove a file descriptor from watching.
+ *
+ * @param fd
+ * @return 0 on success, negative otherwise
+ */
+int km_fdpoll_remove(int fd);
+
+/**
+ * Wait until any file descriptor is readable or the timeout is elapsed, and
+ * call the readable callbacks.
+ *
+ * @param timeout in milliseconds (0 returns immediately)
+ * @return the number of readable file descriptors
+ */
+int km_fdpoll_wait(uint32_t timeout);
+
+/**
+ * Read all available data from a non-blocking fd directly into the free
+ * space of a ring buffer.
+ *
+ * @param fd
+ * @param ringbuffer
+ * @return the number of bytes read, or negative on error or end of file.
+ */
+int km_fdpoll_read_ringbuffer(int fd, ringbuffer_t *ringbuffer);
+
+/**
+ * Write all data to a non-blocking fd, waiting for it to be writable when
+ * its buffer is full.
+ *
+ * @param fd
+ * @param buf
+ * @param len
+ * @param timeout in milliseconds to wait for writability each time
+ * @return 0 on success, -1 on error, hang-up or timeout.
+ */
+int km_fdpoll_write_all(int fd, const uint8_t *buf, size_t len,
+                        int timeout);
+
+#endif /* __KM_FDPOLL_H */
@@ -0,0 +1,272 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "fdpoll.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#define FDPOLL_MAX_EVENTS 32
+#define FDPOLL_STREAM_BUFFER_SIZE 4096
+
+typedef struct {
+  km_list_node_t base;
+  int fd;
+  bool removed;
+  bool ref;  // keeps the event loop alive
+  km_fdpoll_cb readable_cb;
+  km_fdpoll_cb writable_cb;
+  void *data;
+} __fdpoll_entry_t;
+
+static int __epoll_fd = -1;
+static km_list_t __entries = {NULL, NULL};
+static km_list_t __removed_entries = {NULL, NULL};
+
+static __fdpoll_entry_t *__fdpoll_find(int fd) {
+  __fdpoll_entry_t *entry = (__fdpoll_entry_t *)__entries.head;
+  while (entry != NULL) {
+    // removed entries are freed after the wait, but the fd may be reused
+    if (entry->fd == fd && !entry->removed) {
+      return entry;
+    }
+    entry = (__fdpoll_entry_t *)((km_list_node_t *)entry)->next;
+  }
+  return NULL;
+}
+
+/**
+ * Free removed entries. Entries are not freed in km_fdpoll_remove() because
+ * pending events of km_fdpoll_wait() may still refer them.
+ */
+static void __fdpoll_free_removed() {
+  while (__removed_entries.head != NULL) {
+    km_list_node_t *node = __removed_entries.head;
+    km_list_remove(&__removed_entries, node);
+    free(node);
+  }
+}
+
+int km_fdpoll_add(int fd, km_fdpoll_cb readable_cb, void *data) {
+  if (__epoll_fd < 0) {
+    __epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (__epoll_fd < 0) {
+      return -errno;
+    }
+  }
+  if (__fdpoll_find(fd) != NULL) {
+    return -EEXIST;
+  }
+  __fdpoll_entry_t *entry = malloc(sizeof(__fdpoll_entry_t));
+  if (entry == NULL) {
+    return -ENOMEM;
+  }
+  entry->fd = fd;
+  entry->removed = false;
+  entry->ref = true;
+  entry->readable_cb = readable_cb;
+  entry->writable_cb = NULL;
+  entry->data = data;
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = entry;
+  if (epoll_ctl(__epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+    int err = errno;
+    free(entry);
+    return -err;
+  }
+  km_list_append(&__entries, (km_list_node_t *)entry);
+  return 0;
+}
+
+static void __fdpoll_stream_readable_cb(int fd, void *data) {
+  km_io_stream_handle_t *stream = (km_io_stream_handle_t *)data;
+  uint8_t buf[FDPOLL_STREAM_BUFFER_SIZE];
+  ssize_t n = read(fd, buf, sizeof(buf));
+  if (n > 0) {
+    km_io_stream_push(stream, buf, (size_t)n);
+  } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+    km_fdpoll_remove(fd);  // end of file or error
+  }
+}
+
+int km_fdpoll_add_stream(int fd, km_io_stream_handle_t *stream) {
+  return km_fdpoll_add(fd, __fdpoll_stream_readable_cb, stream);
+}
+
+/**
+ * Update the events watched for an entry to match its callbacks
+ */
+static int __fdpoll_update(__fdpoll_entry_t *entry, km_fdpoll_cb readable_cb,
+                           km_fdpoll_cb writable_cb) {
+  struct epoll_event event;
+  event.events = (readable_cb ? EPOLLIN : 0) | (writable_cb ? EPOLLOUT : 0);
+  event.data.ptr = entry;
+  if (epoll_ctl(__epoll_fd, EPOLL_CTL_MOD, entry->fd, &event) < 0) {
+    return -errno;
+  }
+  entry->readable_cb = readable_cb;
+  entry->writable_cb = writable_cb;
+  return 0;
+}
+
+int km_fdpoll_set_readable(int fd, km_fdpoll_cb readable_cb) {
+  __fdpoll_entry_t *entry = __fdpoll_find(fd);
+  if (entry == NULL) {
+    return -ENOENT;
+  }
+  return __fdpoll_update(entry, readable_cb, entry->writable_cb);
+}
+
+int km_fdpoll_set_writable(int fd, km_fdpoll_cb writable_cb) {
+  __fdpoll_entry_t *entry = __fdpoll_find(fd);
+  if (entry == NULL) {
+    return -ENOENT;
+  }
+  return __fdpoll_update(entry, entry->readable_cb, writable_cb);
+}
+
+int km_fdpoll_unref(int fd) {
+  __fdpoll_entry_t *entry = __fdpoll_find(fd);
+  if (entry == NULL) {
+    return -ENOENT;
+  }
+  entry->ref = false;
+  return 0;
+}
+
+uint32_t km_fdpoll_count() {
+  uint32_t count = 0;
+  __fdpoll_entry_t *entry = (__fdpoll_entry_t *)__entries.head;
+  while (entry != NULL) {
+    if (entry->ref) {
+      count++;
+    }
+    entry = (__fdpoll_entry_t *)((km_list_node_t *)entry)->next;
+  }
+  return count;
+}
+
+int km_fdpoll_remove(int fd) {
+  __fdpoll_entry_t *entry = __fdpoll_find(fd);
+  if (entry == NULL) {
+    return -ENOENT;
+  }
+  epoll_ctl(__epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+  entry->removed = true;
+  km_list_remove(&__entries, (km_list_node_t *)entry);
+  km_list_append(&__removed_entries, (km_list_node_t *)entry);
+  return 0;
+}
+
+int km_fdpoll_wait(uint32_t timeout) {
+  if (__epoll_fd < 0) {
+    if (timeout > 0) {
+      poll(NULL, 0, (int)timeout);
+    }
+    return 0;
+  }
+  struct epoll_event events[FDPOLL_MAX_EVENTS];
+  int n = epoll_wait(__epoll_fd, events, FDPOLL_MAX_EVENTS, (int)timeout);
+  for (int i = 0; i < n; i++) {
+    __fdpoll_entry_t *entry = (__fdpoll_entry_t *)events[i].data.ptr;
+    uint32_t ev = events[i].events;
+    // errors and hang-ups are reported to both callbacks to be handled
+    if ((ev & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && !entry->removed &&
+        entry->writable_cb != NULL) {
+      entry->writable_cb(entry->fd, entry->data);
+    }
+    if ((ev & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !entry->removed &&
+        entry->readable_cb != NULL) {
+      entry->readable_cb(entry->fd, entry->data);
+    }
+  }
+  __fdpoll_free_removed();
+  return n > 0 ? n : 0;
+}
+
+int km_fdpoll_read_ringbuffer(int fd, ringbuffer_t *ringbuffer) {
+  int total = 0;
+  while (true) {
+    // read into the free space (at most two segments) without copy
+    struct iovec iov[2];
+    uint8_t *seg;
+    uint32_t space = ringbuffer_freespace(ringbuffer);
+    if (space == 0) {
+      break;
+    }
+    iov[0].iov_len = ringbuffer_reserve_contiguous(ringbuffer, &seg);
+    iov[0].iov_base = seg;
+    iov[1].iov_len = space - iov[0].iov_len;
+    iov[1].iov_base = ringbuffer->buf;
+    ssize_t n = readv(fd, iov, iov[1].iov_len > 0 ? 2 : 1);
+    if (n > 0) {
+      ringbuffer_commit(ringbuffer, (uint32_t)n);
+      total += n;
+      if ((uint32_t)n < space) {
+        break;  // drained
+      }
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && errno == EAGAIN) {
+      break;
+    } else {
+      return total > 0 ? total : -1;  // end of file or error
+    }
+  }
+  return total;
+}
+
+int km_fdpoll_write_all(int fd, const uint8_t *buf, size_t len,
+                        int timeout) {
+  size_t written = 0;
+  while (written < len) {
+    ssize_t n = write(fd, buf + written, len - written);
+    if (n > 0) {
+      written += n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // wait until the fd is writable
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLOUT;
+      pfd.revents = 0;
+      int ret;
+      do {
+        ret = poll(&pfd, 1, timeout);
+      } while (ret < 0 && errno == EINTR);
+      if (ret <= 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        return -1;
+      }
+    } else {
+      return -1;  // hard error (EIO, EBADF, EPIPE, ...)
+    }
+  }
+  return 0;
+}
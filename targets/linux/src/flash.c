@@ -21,41 +21,154 @@
 
 #include "flash.h"
 
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "board.h"
+#include "err.h"
+#include "system.h"
 
-//  Flash implementation on RAM
+/**
+ * Flash emulation. The flash is mapped from an image file given by the
+ * KALUMA_FLASH_IMAGE environment variable (or the --flash option), so the
+ * contents persist across runs. Without an image, anonymous memory is used.
+ *
+ * Like NOR flash, programming can only clear bits (1 -> 0) and erasing sets
+ * a whole sector to 0xFF. Optional environment variables:
+ *   KALUMA_FLASH_PROGRAM_DELAY  latency per programmed page (us)
+ *   KALUMA_FLASH_ERASE_DELAY    latency per erased sector (us)
+ *   KALUMA_FLASH_STRICT         fail programming a bit from 0 to 1 (EIO)
+ */
+
+#define FLASH_IMAGE_ENV "KALUMA_FLASH_IMAGE"
+#define FLASH_PROGRAM_DELAY_ENV "KALUMA_FLASH_PROGRAM_DELAY"
+#define FLASH_ERASE_DELAY_ENV "KALUMA_FLASH_ERASE_DELAY"
+#define FLASH_STRICT_ENV "KALUMA_FLASH_STRICT"
 
 const size_t __flash_size =
     KALUMA_FLASH_SECTOR_SIZE * KALUMA_FLASH_SECTOR_COUNT;
-uint8_t __flash_buffer[KALUMA_FLASH_SECTOR_SIZE * KALUMA_FLASH_SECTOR_COUNT];
+static uint8_t *__flash_buffer = NULL;
+static uint32_t __program_delay = 0;
+static uint32_t __erase_delay = 0;
+static bool __strict = false;
+static km_flash_stats_t __stats;
+static uint32_t __sector_erases[KALUMA_FLASH_SECTOR_COUNT];
 
-const uint8_t *km_flash_addr = (const uint8_t *)(__flash_buffer);
+const uint8_t *km_flash_addr = NULL;
+
+static uint32_t __getenv_number(const char *name) {
+  const char *value = getenv(name);
+  return value ? (uint32_t)strtoul(value, NULL, 10) : 0;
+}
+
+/**
+ * Map the image file, growing it with erased (0xFF) sectors if it is
+ * smaller than the flash.
+ */
+static uint8_t *__flash_map_image(const char *path) {
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 ||
+      ((size_t)st.st_size < __flash_size && ftruncate(fd, __flash_size) < 0)) {
+    close(fd);
+    return NULL;
+  }
+  uint8_t *buffer = (uint8_t *)mmap(NULL, __flash_size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (buffer == MAP_FAILED) {
+    return NULL;
+  }
+  if ((size_t)st.st_size < __flash_size) {
+    memset(buffer + st.st_size, 0xFF, __flash_size - st.st_size);
+  }
+  return buffer;
+}
 
 void km_flash_init() {
-  for (int i = 0; i < __flash_size; i++) {
-    __flash_buffer[i] = 0xFF;
+  // the flash is kept mapped until the process exits
+  if (__flash_buffer == NULL) {
+    const char *path = getenv(FLASH_IMAGE_ENV);
+    if (path != NULL) {
+      __flash_buffer = __flash_map_image(path);
+      if (__flash_buffer == NULL) {
+        fprintf(stderr, "Failed to map flash image: %s\n", path);
+      }
+    }
+    if (__flash_buffer == NULL) {
+      __flash_buffer = (uint8_t *)mmap(NULL, __flash_size,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (__flash_buffer == MAP_FAILED) {
+        fprintf(stderr, "Failed to allocate flash memory\n");
+        abort();
+      }
+      memset(__flash_buffer, 0xFF, __flash_size);
+    }
+    km_flash_addr = (const uint8_t *)__flash_buffer;
   }
+  __program_delay = __getenv_number(FLASH_PROGRAM_DELAY_ENV);
+  __erase_delay = __getenv_number(FLASH_ERASE_DELAY_ENV);
+  __strict = __getenv_number(FLASH_STRICT_ENV) > 0;
 }
 
-void km_flash_cleanup() {}
+void km_flash_cleanup() { msync(__flash_buffer, __flash_size, MS_ASYNC); }
 
 int km_flash_program(uint32_t sector, uint32_t offset, uint8_t *buffer,
                      size_t size) {
   const uint32_t _base = (sector * KALUMA_FLASH_SECTOR_SIZE) + offset;
-  for (int i = 0; i < size; i++) {
-    __flash_buffer[_base + i] = buffer[i];
+  if (_base % KALUMA_FLASH_PAGE_SIZE > 0 || size % KALUMA_FLASH_PAGE_SIZE > 0 ||
+      _base + size > __flash_size) {
+    return EINVAL;
+  }
+  uint8_t *dst = __flash_buffer + _base;
+  if (__strict) {
+    for (size_t i = 0; i < size; i++) {
+      if (buffer[i] & ~dst[i]) {
+        return EIO;
+      }
+    }
+  }
+  for (size_t i = 0; i < size; i++) {
+    if (buffer[i] & ~dst[i]) {
+      __stats.program_conflicts++;
+    }
+    dst[i] &= buffer[i];
+  }
+  __stats.program_count++;
+  __stats.program_bytes += size;
+  if (__program_delay > 0) {
+    km_micro_delay(__program_delay * (size / KALUMA_FLASH_PAGE_SIZE));
   }
   return 0;
 }
 
 int km_flash_erase(uint32_t sector, size_t count) {
+  if (sector + count > KALUMA_FLASH_SECTOR_COUNT) {
+    return EINVAL;
+  }
   const uint32_t _base = sector * KALUMA_FLASH_SECTOR_SIZE;
-  for (int i = 0; i < (count * KALUMA_FLASH_SECTOR_SIZE); i++) {
-    __flash_buffer[_base + i] = 0xFF;
+  memset(__flash_buffer + _base, 0xFF, count * KALUMA_FLASH_SECTOR_SIZE);
+  for (size_t i = sector; i < sector + count; i++) {
+    __sector_erases[i]++;
+    if (__sector_erases[i] > __stats.erase_max) {
+      __stats.erase_max = __sector_erases[i];
+    }
+  }
+  __stats.erase_count += count;
+  if (__erase_delay > 0) {
+    km_micro_delay(__erase_delay * count);
   }
   return 0;
 }
+
+void km_flash_get_stats(km_flash_stats_t *stats) { *stats = __stats; }
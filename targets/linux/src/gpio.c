@@ -21,26 +21,98 @@
 
 #include "gpio.h"
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
-void km_gpio_init() {}
+#include "err.h"
 
-void km_gpio_cleanup() {}
+/*
+ * GPIO is simulated on Linux. Writing a pin sets its level and raises the
+ * edge interrupt attached to it, so a script can inject edges for testing.
+ */
+
+#define GPIO_COUNT 32
+
+static uint8_t __gpio_value[GPIO_COUNT];
+static uint8_t __gpio_irq_events[GPIO_COUNT];
+static km_gpio_irq_callback_t __gpio_irq_cb = NULL;
+static bool __gpio_irq_enabled = true;
+
+static int __check_gpio(uint8_t pin) {
+  return (pin < GPIO_COUNT) ? 0 : EINVPIN;
+}
+
+void km_gpio_init() {
+  memset(__gpio_value, 0, sizeof(__gpio_value));
+  memset(__gpio_irq_events, 0, sizeof(__gpio_irq_events));
+  __gpio_irq_enabled = true;
+}
+
+void km_gpio_cleanup() { km_gpio_init(); }
 
-int km_gpio_set_io_mode(uint8_t pin, km_gpio_io_mode_t mode) { return 0; }
+int km_gpio_set_io_mode(uint8_t pin, km_gpio_io_mode_t mode) {
+  if (__check_gpio(pin) < 0) {
+    return EINVPIN;
+  }
+  if (mode == KM_GPIO_IO_MODE_INPUT_PULLUP) {
+    __gpio_value[pin] = KM_GPIO_HIGH;
+  } else if (mode == KM_GPIO_IO_MODE_INPUT_PULLDOWN) {
+    __gpio_value[pin] = KM_GPIO_LOW;
+  }
+  return 0;
+}
 
-int km_gpio_write(uint8_t pin, uint8_t value) { return 0; }
+int km_gpio_write(uint8_t pin, uint8_t value) {
+  if (__check_gpio(pin) < 0) {
+    return EINVPIN;
+  }
+  value = value ? KM_GPIO_HIGH : KM_GPIO_LOW;
+  if (__gpio_value[pin] != value) {
+    __gpio_value[pin] = value;
+    uint8_t event = value ? KM_GPIO_IRQ_RISING : KM_GPIO_IRQ_FALLING;
+    if (__gpio_irq_enabled && __gpio_irq_cb != NULL &&
+        (__gpio_irq_events[pin] & event)) {
+      __gpio_irq_cb(pin, (km_gpio_io_mode_t)event);
+    }
+  }
+  return 0;
+}
 
-int km_gpio_read(uint8_t pin) { return 0; }
+int km_gpio_read(uint8_t pin) {
+  if (__check_gpio(pin) < 0) {
+    return EINVPIN;
+  }
+  return __gpio_value[pin];
+}
 
-int km_gpio_toggle(uint8_t pin) { return 0; }
+int km_gpio_toggle(uint8_t pin) {
+  if (__check_gpio(pin) < 0) {
+    return EINVPIN;
+  }
+  return km_gpio_write(pin, !__gpio_value[pin]);
+}
 
-void km_gpio_irq_set_callback(km_gpio_irq_callback_t cb) {}
+void km_gpio_irq_set_callback(km_gpio_irq_callback_t cb) {
+  __gpio_irq_cb = cb;
+}
 
-int km_gpio_irq_attach(uint8_t pin, uint8_t events) { return 0; }
+int km_gpio_irq_attach(uint8_t pin, uint8_t events) {
+  if (__check_gpio(pin) < 0) {
+    return EINVPIN;
+  }
+  __gpio_irq_events[pin] = events;
+  return 0;
+}
 
-int km_gpio_irq_detach(uint8_t pin) { return 0; }
+int km_gpio_irq_detach(uint8_t pin) {
+  if (__check_gpio(pin) < 0) {
+    return EINVPIN;
+  }
+  __gpio_irq_events[pin] = 0;
+  return 0;
+}
 
-void km_gpio_irq_enable() {}
+void km_gpio_irq_enable() { __gpio_irq_enabled = true; }
 
-void km_gpio_irq_disable() {}
+void km_gpio_irq_disable() { __gpio_irq_enabled = false; }
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "board.h"
 #include "gpio.h"
@@ -32,17 +33,28 @@
 #include "system.h"
 #include "tty.h"
 
+#define FLASH_OPTION "--flash="
+
 int main(int argc, char* argv[]) {
+  // options: [--flash=<image>] [script]
+  const char* script_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], FLASH_OPTION, strlen(FLASH_OPTION)) == 0) {
+      setenv("KALUMA_FLASH_IMAGE", argv[i] + strlen(FLASH_OPTION), 1);
+    } else if (script_path == NULL) {
+      script_path = argv[i];
+    }
+  }
   km_system_init();
   km_tty_init();
   km_io_init();
-  km_repl_init(argc < 2);
+  km_repl_init(script_path == NULL);
   km_runtime_init(false, false);
 
   // read file
-  if (argc > 1) {
+  if (script_path != NULL) {
     FILE* f;
-    f = fopen(argv[1], "r");
+    f = fopen(script_path, "r");
     fseek(f, 0, SEEK_END);
     long size = ftell(f);
     fseek(f, 0, SEEK_SET);
@@ -72,5 +84,5 @@ int main(int argc, char* argv[]) {
     jerry_release_value(parsed_code);
   }
   free(script);
-  km_io_run(argc < 2);
+  km_io_run(script_path == NULL);
 }
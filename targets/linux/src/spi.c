@@ -21,8 +21,64 @@
 
 #include "spi.h"
 
+#include <string.h>
+
+#include "err.h"
 #include "gpio.h"
 
+/*
+ * SPI is simulated on Linux. Every byte sent on a bus is recorded in a
+ * bounded log (the oldest bytes are dropped when it is full), and reads
+ * return the recorded bytes in order, so a script can check what a driver
+ * has transferred. Reads past the end of the log return the send byte.
+ */
+
+#define SPI_BUS_COUNT 2
+#define SPI_LOG_SIZE 4096
+
+typedef struct {
+  uint8_t data[SPI_LOG_SIZE];
+  uint16_t head;
+  uint16_t length;
+} spi_log_t;
+
+static spi_log_t __spi_log[SPI_BUS_COUNT];
+
+static int __check_spi(uint8_t bus) {
+  return (bus < SPI_BUS_COUNT) ? 0 : EINVAL;
+}
+
+static void __spi_log_clear(uint8_t bus) {
+  __spi_log[bus].head = 0;
+  __spi_log[bus].length = 0;
+}
+
+static void __spi_log_push(uint8_t bus, const uint8_t *buf, size_t len) {
+  spi_log_t *log = &__spi_log[bus];
+  for (size_t i = 0; i < len; i++) {
+    log->data[(log->head + log->length) % SPI_LOG_SIZE] = buf[i];
+    if (log->length < SPI_LOG_SIZE) {
+      log->length++;
+    } else {
+      log->head = (log->head + 1) % SPI_LOG_SIZE;
+    }
+  }
+}
+
+static void __spi_log_pop(uint8_t bus, uint8_t fill, uint8_t *buf,
+                          size_t len) {
+  spi_log_t *log = &__spi_log[bus];
+  for (size_t i = 0; i < len; i++) {
+    if (log->length > 0) {
+      buf[i] = log->data[log->head];
+      log->head = (log->head + 1) % SPI_LOG_SIZE;
+      log->length--;
+    } else {
+      buf[i] = fill;
+    }
+  }
+}
+
 /**
  * Return default SPI pins. -1 means there is no default value on that pin.
  */
@@ -36,35 +92,62 @@ km_spi_pins_t km_spi_get_default_pins(uint8_t bus) {
 /**
  * Initialize all SPI when system started
  */
-void km_spi_init() {}
+void km_spi_init() {
+  for (int i = 0; i < SPI_BUS_COUNT; i++) {
+    __spi_log_clear(i);
+  }
+}
 
 /**
  * Cleanup all SPI when system cleanup
  */
-void km_spi_cleanup() {}
+void km_spi_cleanup() { km_spi_init(); }
 
 /** SPI Setup
  */
 int km_spi_setup(uint8_t bus, km_spi_mode_t mode, uint32_t baudrate,
                  km_spi_bitorder_t bitorder, km_spi_pins_t pins,
                  bool miso_pullup) {
+  if (__check_spi(bus) < 0) {
+    return EINVAL;
+  }
+  __spi_log_clear(bus);
   return 0;
 }
 
 int km_spi_sendrecv(uint8_t bus, uint8_t *tx_buf, uint8_t *rx_buf, size_t len,
                     uint32_t timeout) {
-  return 0;
+  if (__check_spi(bus) < 0) {
+    return EDEVREAD;
+  }
+  __spi_log_pop(bus, 0xFF, rx_buf, len);
+  __spi_log_push(bus, tx_buf, len);
+  return len;
 }
 
 int km_spi_send(uint8_t bus, uint8_t *buf, size_t len, uint32_t timeout) {
-  return 0;
+  if (__check_spi(bus) < 0) {
+    return EDEVWRITE;
+  }
+  __spi_log_push(bus, buf, len);
+  return len;
 }
 
 int km_spi_recv(uint8_t bus, uint8_t send_byte, uint8_t *buf, size_t len,
                 uint32_t timeout) {
-  return 0;
+  if (__check_spi(bus) < 0) {
+    return EDEVREAD;
+  }
+  __spi_log_pop(bus, send_byte, buf, len);
+  return len;
 }
 
 int km_set_spi_baudrate(uint8_t bus, uint32_t baudrate) { return 0; }
 
-int km_spi_close(uint8_t bus) { return 0; }
+int km_spi_close(uint8_t bus) {
+  if (__check_spi(bus) < 0) {
+    return EINVAL;
+  }
+  __spi_log_clear(bus);
+  return 0;
+}
@@ -24,6 +24,7 @@
 #include <time.h>
 
 #include "adc.h"
+#include "fdpoll.h"
 #include "flash.h"
 #include "gpio.h"
 #include "i2c.h"
@@ -33,12 +34,16 @@
 #include "tty.h"
 #include "uart.h"
 
+#ifdef MODULE_POSIX_NET_SELECTED
+#include "module_posix_net.h"
+#endif
+
 const char km_system_arch[] = "i686";
 const char km_system_platform[] = "linux";
 
 /**
  */
-void km_delay(uint32_t msec) {}
+void km_delay(uint32_t msec) { km_micro_delay(msec * 1000); }
 
 /**
  */
@@ -76,7 +81,11 @@ uint64_t km_micro_gettime() {
 /**
  * micro secoded delay
  */
-void km_micro_delay(uint32_t usec) {}
+void km_micro_delay(uint32_t usec) {
+  struct timespec req = {usec / 1000000, (usec % 1000000) * 1000};
+  while (nanosleep(&req, &req) < 0) {
+  }
+}
 
 /**
  * Kaluma Hardware System Initializations
@@ -101,8 +110,21 @@ void km_system_cleanup() {
   km_gpio_cleanup();
   km_rtc_cleanup();
   km_flash_cleanup();
+#ifdef MODULE_POSIX_NET_SELECTED
+  km_posix_net_cleanup();
+#endif
 }
 
+/**
+ * Wait until any of the polled fds (stdin, UART, ...) is readable
+ */
+void km_wait_for_event(uint32_t timeout) { km_fdpoll_wait(timeout); }
+
+/**
+ * Sockets and other polled fds keep the event loop alive
+ */
+uint8_t km_has_active_io() { return km_fdpoll_count() > 0; }
+
 uint8_t km_running_script_check() { return false; }
 
 void km_custom_infinite_loop() {}
@@ -30,6 +30,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "fdpoll.h"
 #include "ringbuffer.h"
 #include "system.h"
 
@@ -38,6 +39,18 @@
 static unsigned char __tty_rx_buffer[TTY_RX_RINGBUFFER_SIZE];
 static ringbuffer_t __tty_rx_ringbuffer;
 
+/**
+ * true if stdin can't be polled (e.g. a regular file), then stdin is read
+ * whenever km_tty_available() is called.
+ */
+static bool __tty_no_poll = false;
+
+static void __tty_readable_cb(int fd, void *data) {
+  if (km_fdpoll_read_ringbuffer(fd, &__tty_rx_ringbuffer) < 0) {
+    km_fdpoll_remove(fd);  // end of file
+  }
+}
+
 void km_tty_init() {
   ringbuffer_init(&__tty_rx_ringbuffer, __tty_rx_buffer,
                   sizeof(__tty_rx_buffer));
@@ -45,14 +58,13 @@ void km_tty_init() {
   int fd = STDIN_FILENO;  // stdin
   int flags = fcntl(fd, F_GETFL, 0);
   fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  __tty_no_poll = (km_fdpoll_add(fd, __tty_readable_cb, NULL) < 0);
+  km_fdpoll_unref(fd);  // scripts exit regardless of the terminal
 }
 
 uint32_t km_tty_available() {
-  unsigned char ch[1];
-  int sz = read(STDIN_FILENO, ch, 1);
-  // printf("sz=%d\r\n", sz);
-  while (sz > 0) {
-    ringbuffer_write(&__tty_rx_ringbuffer, ch, 1);
+  if (__tty_no_poll) {
+    km_fdpoll_read_ringbuffer(STDIN_FILENO, &__tty_rx_ringbuffer);
   }
   return ringbuffer_length(&__tty_rx_ringbuffer);
 }
@@ -69,9 +81,15 @@ uint32_t km_tty_read(uint8_t *buf, size_t len) {
 uint32_t km_tty_read_sync(uint8_t *buf, size_t len, uint32_t timeout) {
   uint32_t sz;
   uint64_t to = km_gettime() + timeout;
-  do {
+  sz = km_tty_available();
+  while (sz < len) {
+    uint64_t now = km_gettime();
+    if (now >= to) {
+      break;
+    }
+    km_fdpoll_wait(__tty_no_poll ? 1 : (uint32_t)(to - now));
     sz = km_tty_available();
-  } while (km_gettime() < to && sz < len);
+  }
   if (sz >= len) {
     ringbuffer_read(&__tty_rx_ringbuffer, buf, len);
     return len;
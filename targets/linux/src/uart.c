@@ -20,10 +20,93 @@
  */
 #include "uart.h"
 
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
 
+#include "board.h"
+#include "err.h"
+#include "fdpoll.h"
 #include "ringbuffer.h"
 
+/**
+ * UART ports are mapped to host devices (e.g. a serial port or a pty) by the
+ * environment variables KALUMA_UART0, KALUMA_UART1, ... A port without the
+ * variable works as a null device.
+ */
+#define UART_DEVICE_ENV "KALUMA_UART%d"
+#define UART_WRITE_TIMEOUT 1000  // msec
+
+static ringbuffer_t __uart_rx_ringbuffer[UART_NUM];
+static uint8_t *__read_buffer[UART_NUM];
+static struct __uart_status_s {
+  bool enabled;
+  int fd;
+} __uart_status[UART_NUM];
+
+static void __uart_readable_cb(int fd, void *data) {
+  uint8_t port = (uint8_t)(intptr_t)data;
+  if (km_fdpoll_read_ringbuffer(fd, &__uart_rx_ringbuffer[port]) < 0) {
+    km_fdpoll_remove(fd);  // device closed
+  }
+}
+
+static speed_t __get_speed(uint32_t baudrate) {
+  switch (baudrate) {
+    case 1200:
+      return B1200;
+    case 2400:
+      return B2400;
+    case 4800:
+      return B4800;
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 230400:
+      return B230400;
+    case 460800:
+      return B460800;
+    case 921600:
+      return B921600;
+    default:
+      return B115200;
+  }
+}
+
+static void __set_termios(int fd, uint32_t baudrate, uint8_t bits,
+                          km_uart_parity_type_t parity, uint8_t stop,
+                          km_uart_flow_control_t flow) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) < 0) {
+    return;  // not a terminal (e.g. fifo)
+  }
+  cfmakeraw(&tio);
+  cfsetspeed(&tio, __get_speed(baudrate));
+  tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+  tio.c_cflag |= (bits == 7) ? CS7 : CS8;
+  if (parity == KM_UART_PARITY_TYPE_EVEN) {
+    tio.c_cflag |= PARENB;
+  } else if (parity == KM_UART_PARITY_TYPE_ODD) {
+    tio.c_cflag |= PARENB | PARODD;
+  }
+  if (stop == 2) {
+    tio.c_cflag |= CSTOPB;
+  }
+  if (flow != KM_UART_FLOW_NONE) {
+    tio.c_cflag |= CRTSCTS;
+  }
+  tio.c_cflag |= CLOCAL | CREAD;
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
 /**
  * Return default UART pins. -1 means there is no default value on that pin.
  */
@@ -40,24 +123,106 @@ km_uart_pins_t km_uart_get_default_pins(uint8_t port) {
 /**
  * Initialize all UART when system started
  */
-void km_uart_init() {}
+void km_uart_init() {
+  for (int i = 0; i < UART_NUM; i++) {
+    __uart_status[i].enabled = false;
+    __uart_status[i].fd = -1;
+    __read_buffer[i] = NULL;
+  }
+}
 
 /**
  * Cleanup all UART when system cleanup
  */
-void km_uart_cleanup() {}
+void km_uart_cleanup() {
+  for (int i = 0; i < UART_NUM; i++) {
+    if (__uart_status[i].enabled) {
+      km_uart_close(i);
+    }
+  }
+}
 
 int km_uart_setup(uint8_t port, uint32_t baudrate, uint8_t bits,
                   km_uart_parity_type_t parity, uint8_t stop,
                   km_uart_flow_control_t flow, size_t buffer_size,
                   km_uart_pins_t pins) {
+  if ((port >= UART_NUM) || (__uart_status[port].enabled)) {
+    return ENOPHRPL;
+  }
+  buffer_size = ringbuffer_round_size(buffer_size);
+  __read_buffer[port] = (uint8_t *)malloc(buffer_size);
+  if (__read_buffer[port] == NULL) {
+    return EDEVINIT;
+  }
+  ringbuffer_init(&__uart_rx_ringbuffer[port], __read_buffer[port],
+                  buffer_size);
+  char env[16];
+  sprintf(env, UART_DEVICE_ENV, port);
+  const char *path = getenv(env);
+  int fd = -1;
+  if (path != NULL) {
+    fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+      free(__read_buffer[port]);
+      __read_buffer[port] = NULL;
+      return EDEVINIT;
+    }
+    __set_termios(fd, baudrate, bits, parity, stop, flow);
+    km_fdpoll_add(fd, __uart_readable_cb, (void *)(intptr_t)port);
+    km_fdpoll_unref(fd);  // UART handles keep the loop alive
+  }
+  __uart_status[port].fd = fd;
+  __uart_status[port].enabled = true;
   return 0;
 }
 
-int km_uart_write(uint8_t port, uint8_t *buf, size_t len) { return 0; }
+int km_uart_write(uint8_t port, uint8_t *buf, size_t len) {
+  if ((port >= UART_NUM) || (__uart_status[port].enabled == false)) {
+    return EDEVWRITE;
+  }
+  int fd = __uart_status[port].fd;
+  if (fd < 0) {
+    return len;  // null device
+  }
+  if (km_fdpoll_write_all(fd, buf, len, UART_WRITE_TIMEOUT) < 0) {
+    return EDEVWRITE;
+  }
+  return len;
+}
 
-uint32_t km_uart_available(uint8_t port) { return 0; }
+uint32_t km_uart_available(uint8_t port) {
+  if ((port >= UART_NUM) || (__uart_status[port].enabled == false)) {
+    return ENOPHRPL;
+  }
+  return ringbuffer_length(&__uart_rx_ringbuffer[port]);
+}
 
-uint32_t km_uart_read(uint8_t port, uint8_t *buf, size_t len) { return 0; }
+uint32_t km_uart_read(uint8_t port, uint8_t *buf, size_t len) {
+  if ((port >= UART_NUM) || (__uart_status[port].enabled == false)) {
+    return EDEVREAD;
+  }
+  uint32_t n = ringbuffer_length(&__uart_rx_ringbuffer[port]);
+  if (n > len) {
+    n = len;
+  }
+  ringbuffer_read(&__uart_rx_ringbuffer[port], buf, n);
+  return n;
+}
 
-int km_uart_close(uint8_t port) { return 0; }
+int km_uart_close(uint8_t port) {
+  if ((port >= UART_NUM) || (__uart_status[port].enabled == false)) {
+    return EDEVINIT;
+  }
+  int fd = __uart_status[port].fd;
+  if (fd >= 0) {
+    km_fdpoll_remove(fd);
+    close(fd);
+    __uart_status[port].fd = -1;
+  }
+  if (__read_buffer[port]) {
+    free(__read_buffer[port]);
+    __read_buffer[port] = (uint8_t *)NULL;
+  }
+  __uart_status[port].enabled = false;
+  return 0;
+}
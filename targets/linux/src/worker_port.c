@@ -0,0 +1,100 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "worker_port.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "fdpoll.h"
+
+/**
+ * The worker runs in a thread. It sleeps on a semaphore, and wakes the event
+ * loop up by an eventfd watched by fdpoll.
+ */
+
+static pthread_t __worker;
+static sem_t __sem;
+static int __event_fd = -1;
+static void (*__entry)(void) = NULL;
+
+static void *__worker_thread(void *arg) {
+  __entry();
+  return NULL;
+}
+
+static void __event_fd_cb(int fd, void *data) {
+  uint64_t value;
+  (void)!read(fd, &value, sizeof(value));  // completions are polled in loop
+}
+
+int km_worker_port_start(void (*entry)(void)) {
+  __event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (__event_fd < 0) {
+    return -errno;
+  }
+  int ret = km_fdpoll_add(__event_fd, __event_fd_cb, NULL);
+  if (ret < 0) {
+    close(__event_fd);
+    __event_fd = -1;
+    return ret;
+  }
+  km_fdpoll_unref(__event_fd);  // internal wake-up fd
+  sem_init(&__sem, 0, 0);
+  __entry = entry;
+  ret = pthread_create(&__worker, NULL, __worker_thread, NULL);
+  if (ret != 0) {
+    km_fdpoll_remove(__event_fd);
+    close(__event_fd);
+    __event_fd = -1;
+    sem_destroy(&__sem);
+    return -ret;
+  }
+  return 0;
+}
+
+void km_worker_port_join() {
+  pthread_join(__worker, NULL);
+  sem_destroy(&__sem);
+  km_fdpoll_remove(__event_fd);
+  close(__event_fd);
+  __event_fd = -1;
+}
+
+void km_worker_port_wait() {
+  while (sem_wait(&__sem) < 0 && errno == EINTR) {
+  }
+}
+
+void km_worker_port_notify() { sem_post(&__sem); }
+
+void km_worker_port_signal() {
+  uint64_t value = 1;
+  (void)!write(__event_fd, &value, sizeof(value));
+}
+
+void km_worker_port_lockout_start() {}
+
+void km_worker_port_lockout_end() {}
@@ -26,12 +26,16 @@ if(NOT MODULES)
     spi
     uart
     graphics
+    display
     at
     storage
     wifi
     stream
     net
+    dgram
+    posix_net
     http
+    worker
     url
     rtc
     path
@@ -58,11 +62,13 @@ set(SOURCES
   ${TARGET_SRC_DIR}/gpio.c
   ${TARGET_SRC_DIR}/pwm.c
   ${TARGET_SRC_DIR}/tty.c
+  ${TARGET_SRC_DIR}/fdpoll.c
   ${TARGET_SRC_DIR}/flash.c
   ${TARGET_SRC_DIR}/uart.c
   ${TARGET_SRC_DIR}/i2c.c
   ${TARGET_SRC_DIR}/spi.c
   ${TARGET_SRC_DIR}/rtc.c
+  ${TARGET_SRC_DIR}/worker_port.c
   ${TARGET_SRC_DIR}/main.c
   ${BOARD_DIR}/board.c)
 
@@ -85,7 +91,7 @@ set(CMAKE_CXX_COMPILER ${PREFIX}g++)
 set(CMAKE_LINKER ${PREFIX}ld)
 set(CMAKE_OBJCOPY ${PREFIX}objcopy)
 
-set(TARGET_LIBS c m)
+set(TARGET_LIBS c m pthread)
 # set(CMAKE_EXE_LINKER_FLAGS "-u -Wl")
 
 include(${CMAKE_SOURCE_DIR}/tools/kaluma.cmake)
@@ -93,6 +99,12 @@ include(${CMAKE_SOURCE_DIR}/tools/kaluma.cmake)
 add_executable(${OUTPUT_TARGET} ${SOURCES} ${JERRY_LIBS})
 target_link_libraries(${OUTPUT_TARGET} ${JERRY_LIBS} ${TARGET_LIBS})
 
+# benchmarks (build with `make ringbuffer_bench`)
+add_executable(ringbuffer_bench EXCLUDE_FROM_ALL
+  ${CMAKE_CURRENT_LIST_DIR}/bench/ringbuffer_bench.c
+  ${SRC_DIR}/ringbuffer.c)
+target_link_libraries(ringbuffer_bench pthread)
+
 # add_custom_command(OUTPUT ${OUTPUT_TARGET}.hex ${OUTPUT_TARGET}.bin
 #   COMMAND ${CMAKE_OBJCOPY} -O ihex ${OUTPUT_TARGET}.elf ${OUTPUT_TARGET}.hex
 #   COMMAND ${CMAKE_OBJCOPY} -O binary -S ${OUTPUT_TARGET}.elf ${OUTPUT_TARGET}.bin
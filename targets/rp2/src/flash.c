@@ -28,10 +28,13 @@
 #include "hardware/flash.h"
 #include "hardware/sync.h"
 #include "pico/stdlib.h"
+#include "worker_port.h"
 
 const uint8_t *km_flash_addr =
     (const uint8_t *)(XIP_BASE + KALUMA_FLASH_OFFSET);
 
+static km_flash_stats_t stats;
+
 void km_flash_init() { return; }
 
 void km_flash_cleanup() { return; }
@@ -51,9 +54,13 @@ int km_flash_program(uint32_t sector, uint32_t offset, uint8_t *buffer,
     return -22;  // EINVAL
   }
 
+  km_worker_port_lockout_start();
   uint32_t saved_irq = save_and_disable_interrupts();
   flash_range_program(_base, buffer, size);
   restore_interrupts(saved_irq);
+  km_worker_port_lockout_end();
+  stats.program_count++;
+  stats.program_bytes += size;
   return 0;
 }
 
@@ -72,8 +79,15 @@ int km_flash_erase(uint32_t sector, size_t count) {
     return -22;  // EINVAL
   }
 
+  km_worker_port_lockout_start();
   uint32_t saved_irq = save_and_disable_interrupts();
   flash_range_erase(_base, _size);
   restore_interrupts(saved_irq);
+  km_worker_port_lockout_end();
+  stats.erase_count += count;
   return 0;
 }
+
+void km_flash_get_stats(km_flash_stats_t *flash_stats) {
+  *flash_stats = stats;
+}
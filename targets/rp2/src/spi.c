@@ -23,9 +23,13 @@
 
 #include "board.h"
 #include "err.h"
+#include "hardware/dma.h"
 #include "hardware/spi.h"
 #include "pico/stdlib.h"
 
+/* transfers of this size or larger are sent by DMA */
+#define SPI_DMA_MIN_LEN 64
+
 struct __spi_status_s {
   bool enabled;
 } __spi_status[SPI_NUM];
@@ -179,12 +183,45 @@ int km_spi_sendrecv(uint8_t bus, uint8_t *tx_buf, uint8_t *rx_buf, size_t len,
   return spi_write_read_blocking(spi, tx_buf, rx_buf, len);
 }
 
+/**
+ * Write a buffer by DMA. Returns -1 if no DMA channel is available.
+ */
+static int __spi_write_dma(spi_inst_t *spi, const uint8_t *buf, size_t len) {
+  int ch = dma_claim_unused_channel(false);
+  if (ch < 0) {
+    return -1;
+  }
+  dma_channel_config config = dma_channel_get_default_config(ch);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+  channel_config_set_dreq(&config, spi_get_dreq(spi, true));
+  channel_config_set_read_increment(&config, true);
+  channel_config_set_write_increment(&config, false);
+  dma_channel_configure(ch, &config, &spi_get_hw(spi)->dr, buf, len, true);
+  dma_channel_wait_for_finish_blocking(ch);
+  dma_channel_unclaim(ch);
+  // wait for the last bytes shifted out, then drain RX FIFO and overrun
+  while (spi_is_busy(spi)) {
+    tight_loop_contents();
+  }
+  while (spi_is_readable(spi)) {
+    (void)spi_get_hw(spi)->dr;
+  }
+  spi_get_hw(spi)->icr = SPI_SSPICR_RORIC_BITS;
+  return len;
+}
+
 int km_spi_send(uint8_t bus, uint8_t *buf, size_t len, uint32_t timeout) {
   spi_inst_t *spi = __get_spi_no(bus);
   if ((spi == NULL) || (__spi_status[bus].enabled == false)) {
     return EDEVWRITE;
   }
   (void)timeout;  // timeout is not supported.
+  if (len >= SPI_DMA_MIN_LEN) {
+    int ret = __spi_write_dma(spi, buf, len);
+    if (ret >= 0) {
+      return ret;
+    }
+  }
   return spi_write_blocking(spi, buf, len);
 }
 
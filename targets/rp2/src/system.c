@@ -46,6 +46,8 @@
 #include <pico/cyw43_arch.h>
 #endif /* PICO_CYW43 */
 
+#define KM_CYW43_POLL_INTERVAL 1  // msec
+
 static char serial[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
 
 /**
@@ -132,6 +134,24 @@ void km_system_cleanup() {
   km_flash_cleanup();
 }
 
+/**
+ * Wait for an event (any IRQ, e.g. USB or UART) until the timeout
+ */
+void km_wait_for_event(uint32_t timeout) {
+  if (timeout == 0) {
+    return;
+  }
+#ifdef PICO_CYW43
+  // cyw43 and lwIP are polled in the loop (pico_cyw43_arch_lwip_poll)
+  if (km_cyw43_is_initialized() && timeout > KM_CYW43_POLL_INTERVAL) {
+    timeout = KM_CYW43_POLL_INTERVAL;
+  }
+#endif
+  best_effort_wfe_or_timeout(make_timeout_time_ms(timeout));
+}
+
+uint8_t km_has_active_io() { return false; }
+
 uint8_t km_running_script_check() {
   gpio_set_pulls(SCR_LOAD_GPIO, true, false);
   sleep_us(100);
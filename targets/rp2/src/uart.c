@@ -50,10 +50,12 @@ static uart_inst_t *__get_uart_no(uint8_t bus) {
  */
 
 static void __uart_fill_ringbuffer(uart_inst_t *uart, uint8_t port) {
-  while (uart_is_readable(uart)) {
-    uint8_t ch = uart_getc(uart);
-    ringbuffer_write(&__uart_rx_ringbuffer[port], &ch, sizeof(ch));
+  uint8_t buf[32];  // RX FIFO depth
+  uint32_t len = 0;
+  while (uart_is_readable(uart) && len < sizeof(buf)) {
+    buf[len++] = uart_getc(uart);
   }
+  ringbuffer_write(&__uart_rx_ringbuffer[port], buf, len);
 }
 
 void __uart_irq_handler_0(void) { __uart_fill_ringbuffer(uart0, 0); }
@@ -166,6 +168,7 @@ int km_uart_setup(uint8_t port, uint32_t baudrate, uint8_t bits,
     pt = UART_PARITY_ODD;
   }
   uart_set_format(uart, bits, stop, pt);
+  buffer_size = ringbuffer_round_size(buffer_size);
   __read_buffer[port] = (uint8_t *)malloc(buffer_size);
   if (__read_buffer[port] == NULL) {
     return EDEVINIT;
@@ -206,7 +209,7 @@ uint32_t km_uart_available(uint8_t port) {
   if ((uart == NULL) || (__uart_status[port].enabled == false)) {
     return ENOPHRPL;
   }
-  __uart_fill_ringbuffer(uart, port);
+  // ring buffer is filled only by the IRQ handler (single producer)
   return ringbuffer_length(&__uart_rx_ringbuffer[port]);
 }
 
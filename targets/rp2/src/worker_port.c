@@ -0,0 +1,99 @@
+/* Copyright (c) 2017 Kaluma
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "worker_port.h"
+
+#include <stdbool.h>
+
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define KM_WORKER_JOIN_TIMEOUT 100  // msec
+
+/**
+ * The worker runs on core 1. Both cores sleep with WFE and wake each other
+ * up with SEV, which also wakes the event loop in km_wait_for_event().
+ */
+
+static void (*entry_fn)(void) = NULL;
+static bool running = false;
+static bool ready = false;   // written by core 1 only
+static bool exited = false;  // written by core 1 only
+
+static void core1_main() {
+  // core 1 is paused by core 0 while the flash is written
+  multicore_lockout_victim_init();
+  STORE_RELEASE(&ready, true);
+  __sev();
+  entry_fn();
+  STORE_RELEASE(&exited, true);
+  __sev();
+  while (true) {
+    __wfe();
+  }
+}
+
+int km_worker_port_start(void (*entry)(void)) {
+  entry_fn = entry;
+  STORE_RELEASE(&ready, false);
+  STORE_RELEASE(&exited, false);
+  multicore_reset_core1();
+  multicore_launch_core1(core1_main);
+  // lockout requests are dropped until core 1 is ready to handle them
+  while (!LOAD_ACQUIRE(&ready)) {
+    __wfe();
+  }
+  running = true;
+  return 0;
+}
+
+void km_worker_port_join() {
+  // a long running job is aborted by resetting core 1
+  absolute_time_t timeout = make_timeout_time_ms(KM_WORKER_JOIN_TIMEOUT);
+  while (!LOAD_ACQUIRE(&exited)) {
+    if (best_effort_wfe_or_timeout(timeout)) {
+      break;
+    }
+  }
+  multicore_reset_core1();
+  running = false;
+}
+
+void km_worker_port_wait() { __wfe(); }
+
+void km_worker_port_notify() { __sev(); }
+
+void km_worker_port_signal() { __sev(); }
+
+void km_worker_port_lockout_start() {
+  if (running) {
+    multicore_lockout_start_blocking();
+  }
+}
+
+void km_worker_port_lockout_end() {
+  if (running) {
+    multicore_lockout_end_blocking();
+  }
+}
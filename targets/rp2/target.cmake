@@ -27,13 +27,16 @@ if(NOT MODULES)
     spi
     uart
     graphics
+    display
     xpt2046
     at
     storage
     wifi
     stream
     net
+    dgram
     http
+    worker
     url
     rp2
     rtc
@@ -74,6 +77,7 @@ set(SOURCES
   ${TARGET_SRC_DIR}/spi.c
   ${TARGET_SRC_DIR}/rtc.c
   ${TARGET_SRC_DIR}/wdt.c
+  ${TARGET_SRC_DIR}/worker_port.c
   ${TARGET_SRC_DIR}/main.c
   ${BOARD_DIR}/board.c)
 
@@ -109,10 +113,12 @@ set(TARGET_LIBS c nosys m
   hardware_spi
   hardware_uart
   hardware_pio
+  hardware_dma
   hardware_flash
   hardware_rtc
   hardware_watchdog
-  hardware_sync)
+  hardware_sync
+  pico_multicore)
 set(CMAKE_EXE_LINKER_FLAGS "-specs=nano.specs -u _printf_float -Wl,-Map=${OUTPUT_TARGET}.map,--cref,--gc-sections")
 
 # For the pico-w board
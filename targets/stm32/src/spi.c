@@ -161,13 +161,17 @@ int km_spi_send(uint8_t bus, uint8_t *buf, size_t len, uint32_t timeout) {
   if ((bus != 0) && (bus != 1)) return ENOPHRPL;
 
   SPI_HandleTypeDef *hspi = spi_handle[bus];
-  HAL_StatusTypeDef status =
-      HAL_SPI_Transmit(hspi, buf, (uint16_t)len, timeout);
-
-  if (status == HAL_OK) {
-    return len;
+  // HAL transfers are limited to 16-bit lengths, send large buffers in chunks
+  size_t sent = 0;
+  while (sent < len) {
+    uint16_t n = (len - sent > 0xFFFF) ? 0xFFFF : (uint16_t)(len - sent);
+    HAL_StatusTypeDef status = HAL_SPI_Transmit(hspi, buf + sent, n, timeout);
+    if (status != HAL_OK) {
+      return ENOPHRPL;
+    }
+    sent += n;
   }
-  return ENOPHRPL;
+  return len;
 }
 
 int km_spi_recv(uint8_t bus, uint8_t send_byte, uint8_t *buf, size_t len,
@@ -235,6 +235,18 @@ void km_system_cleanup() {
   km_gpio_cleanup();
 }
 
+/**
+ * Wait for an interrupt. SysTick wakes up the core every 1 msec, so the
+ * timeout is always satisfied.
+ */
+void km_wait_for_event(uint32_t timeout) {
+  if (timeout > 0) {
+    __WFI();
+  }
+}
+
+uint8_t km_has_active_io() { return false; }
+
 uint8_t km_running_script_check() {
   GPIO_PinState pin_state =
       HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_4);  // Check status of the button
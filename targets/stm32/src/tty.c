@@ -63,41 +63,23 @@ uint32_t tty_get_tx_data_length() {
   return ringbuffer_length(&tty_tx_ringbuffer);
 }
 
-uint32_t tty_get_bytes(uint8_t *buf, uint32_t nToRead) {
-  __set_PRIMASK(1);
+/* ring buffers are lock-free between the USB IRQ and the main loop */
 
+uint32_t tty_get_bytes(uint8_t *buf, uint32_t nToRead) {
   uint32_t len = ringbuffer_length(&tty_rx_ringbuffer);
   if (len < nToRead) {
     nToRead = len;
   }
-
-  __set_PRIMASK(0);
   ringbuffer_read(&tty_rx_ringbuffer, buf, nToRead);
   return nToRead;
 }
 
 uint32_t tty_fill_rx_bytes(uint8_t *buf, uint32_t nToWrite) {
-  __set_PRIMASK(1);
-  uint32_t space = ringbuffer_freespace(&tty_rx_ringbuffer);
-  if (space < nToWrite) {
-    nToWrite = space;
-  }
-  __set_PRIMASK(0);
-
-  ringbuffer_write(&tty_rx_ringbuffer, buf, nToWrite);
-  return nToWrite;
+  return ringbuffer_write(&tty_rx_ringbuffer, buf, nToWrite);
 }
 
 uint32_t tty_put_bytes(uint8_t *buf, uint32_t nToWrite) {
-  __set_PRIMASK(1);
-  uint32_t space = ringbuffer_freespace(&tty_tx_ringbuffer);
-  if (space < nToWrite) {
-    nToWrite = space;
-  }
-  __set_PRIMASK(0);
-
-  ringbuffer_write(&tty_tx_ringbuffer, buf, nToWrite);
-  return nToWrite;
+  return ringbuffer_write(&tty_tx_ringbuffer, buf, nToWrite);
 }
 
 void km_tty_init() {
@@ -99,6 +99,7 @@ int km_uart_setup(uint8_t port, uint32_t baudrate, uint8_t bits,
   puart->Init.Mode = UART_MODE_TX_RX;
   puart->Init.OverSampling = UART_OVERSAMPLING_16;
 
+  buffer_size = ringbuffer_round_size(buffer_size);
   read_buffer[port] = (uint8_t *)malloc(buffer_size);
   if (read_buffer[port] == NULL) {
     return ENOPHRPL;
@@ -0,0 +1,64 @@
+const { test, start, expect } = require("__ujest");
+const dgram = require("dgram");
+
+test("[dgram] send and receive with rinfo", (done) => {
+  const server = dgram.createSocket("udp4");
+  const client = dgram.createSocket("udp4");
+  server.on("message", (msg, rinfo) => {
+    expect(String.fromCharCode.apply(null, msg)).toBe("ping");
+    expect(rinfo.address).toBe("127.0.0.1");
+    expect(rinfo.port).toBe(client.address().port);
+    expect(rinfo.size).toBe(4);
+    // reply to the sender
+    server.send(new Uint8Array([0x70, 0x6f, 0x6e, 0x67]), rinfo.port, rinfo.address);
+  });
+  client.on("message", (msg, rinfo) => {
+    expect(String.fromCharCode.apply(null, msg)).toBe("pong");
+    expect(rinfo.port).toBe(server.address().port);
+    client.close();
+    server.close(() => {
+      done();
+    });
+  });
+  server.bind(0, () => {
+    client.send("ping", server.address().port, "127.0.0.1", (err) => {
+      expect(err).toBe(null);
+    });
+  });
+});
+
+test("[dgram] receive many datagrams in order", (done) => {
+  const count = 100;
+  let received = 0;
+  const server = dgram.createSocket("udp4", (msg) => {
+    expect(msg.length).toBe(64);
+    expect(msg[0]).toBe(received % 256);
+    received++;
+    if (received === count) {
+      client.close();
+      server.close();
+      done();
+    }
+  });
+  const client = dgram.createSocket("udp4");
+  server.bind(() => {
+    const port = server.address().port;
+    const data = new Uint8Array(64);
+    for (let i = 0; i < count; i++) {
+      data[0] = i % 256;
+      client.send(data, port);
+    }
+  });
+});
+
+test("[dgram] emit close", (done) => {
+  const socket = dgram.createSocket("udp4");
+  socket.bind(0);
+  socket.on("close", () => {
+    expect(() => socket.address()).toThrow();
+    done();
+  });
+  socket.close();
+});
+
+start();
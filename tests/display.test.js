@@ -0,0 +1,86 @@
+const { test, start, expect } = require("__ujest");
+const { SPI } = require("spi");
+const { ST7789, SSD1306 } = require("display");
+
+// SPI is simulated on Linux: spi.recv() returns the bytes sent on the bus.
+function take(spi, length) {
+  return Array.from(spi.recv(length));
+}
+
+function drain(spi) {
+  spi.recv(4096);
+}
+
+test("[display] ST7789 sends the init sequence", (done) => {
+  const spi = new SPI(0);
+  const lcd = new ST7789();
+  lcd.setup(spi, { width: 8, height: 4, dc: 20, cs: 21 });
+  expect(lcd.width).toBe(8);
+  expect(lcd.height).toBe(4);
+  expect(take(spi, 9).join(",")).toBe(
+    [0x01, 0x11, 0x3a, 0x55, 0x13, 0x36, 0x00, 0x21, 0x29].join(",")
+  );
+  spi.close();
+  done();
+});
+
+test("[display] ST7789 streams the whole buffer on the first display()", (done) => {
+  const spi = new SPI(0);
+  const lcd = new ST7789();
+  lcd.setup(spi, { width: 8, height: 4, dc: 20, cs: 21 });
+  const gc = lcd.getContext();
+  drain(spi);
+  gc.display();
+  const window = [0x2a, 0, 0, 0, 7, 0x2b, 0, 0, 0, 3, 0x2c];
+  expect(take(spi, window.length).join(",")).toBe(window.join(","));
+  expect(take(spi, 8 * 4 * 2).every((b) => b === 0)).toBe(true);
+  spi.close();
+  done();
+});
+
+test("[display] ST7789 sends the dirty region only", (done) => {
+  const spi = new SPI(0);
+  const lcd = new ST7789();
+  lcd.setup(spi, { width: 8, height: 4, dc: 20, cs: 21 });
+  const gc = lcd.getContext();
+  gc.display();
+  drain(spi);
+  gc.setPixel(2, 1, 0xf800);
+  gc.display();
+  const bytes = [0x2a, 0, 2, 0, 2, 0x2b, 0, 1, 0, 1, 0x2c, 0xf8, 0x00];
+  expect(take(spi, bytes.length).join(",")).toBe(bytes.join(","));
+  spi.close();
+  done();
+});
+
+test("[display] ST7789 direct context fills the panel window", (done) => {
+  const spi = new SPI(0);
+  const lcd = new ST7789();
+  lcd.setup(spi, { width: 8, height: 4, dc: 20, cs: 21 });
+  const gc = lcd.getContext("direct");
+  drain(spi);
+  gc.setFillColor(0x07e0);
+  gc.fillRect(1, 1, 2, 2);
+  const bytes = [0x2a, 0, 1, 0, 2, 0x2b, 0, 1, 0, 2, 0x2c];
+  expect(take(spi, bytes.length).join(",")).toBe(bytes.join(","));
+  expect(take(spi, 8).join(",")).toBe([7, 0xe0, 7, 0xe0, 7, 0xe0, 7, 0xe0].join(","));
+  spi.close();
+  done();
+});
+
+test("[display] SSD1306 flushes dirty pages over SPI", (done) => {
+  const spi = new SPI(0);
+  const oled = new SSD1306();
+  oled.setup(spi, { width: 16, height: 16, dc: 20, cs: 21 });
+  const gc = oled.getContext();
+  gc.display();
+  drain(spi);
+  gc.setPixel(3, 13, 1);
+  gc.display();
+  const bytes = [0x21, 3, 3, 0x22, 1, 1, 0x20];
+  expect(take(spi, bytes.length).join(",")).toBe(bytes.join(","));
+  spi.close();
+  done();
+});
+
+start();
@@ -1,5 +1,5 @@
 const { test, start, expect } = require("__ujest");
-const { Flash } = require("flash");
+const { Flash, stats } = require("flash");
 
 const BLOCK_BASE = 0;
 const BLOCK_COUNT = 260;
@@ -62,4 +62,53 @@ test("[flash] ioctl(6) - erase block", (done) => {
   done();
 });
 
+test("[flash] read() - out of range", (done) => {
+  const flash = new Flash(BLOCK_BASE, 2);
+  let buf = new Uint8Array(BLOCK_SIZE);
+  expect(() => {
+    flash.read(2, buf);
+  }).toThrow();
+  done();
+});
+
+test("[flash] read() and write() - negative or overflowing offset", (done) => {
+  const flash = new Flash(BLOCK_BASE, 2);
+  let buf = new Uint8Array(16);
+  expect(() => {
+    flash.read(0, buf, -1);
+  }).toThrow();
+  expect(() => {
+    flash.write(0, buf, -16);
+  }).toThrow();
+  expect(() => {
+    flash.read(-1, buf);
+  }).toThrow();
+  // offset + size wraps around in uint32
+  expect(() => {
+    flash.read(0, buf, 0xfffffff8);
+  }).toThrow();
+  done();
+});
+
+test("[flash] write() - only clear bits without erase", (done) => {
+  const flash = new Flash(BLOCK_BASE, BLOCK_COUNT);
+  const before = stats();
+  flash.ioctl(6, 10);
+  let buf = new Uint8Array(BLOCK_SIZE);
+  buf.fill(0xf0);
+  flash.write(10, buf);
+  buf.fill(0x3c);
+  flash.write(10, buf);
+  flash.read(10, buf);
+  expect(buf[0]).toBe(0x30);
+  expect(buf[BLOCK_SIZE - 1]).toBe(0x30);
+  const after = stats();
+  expect(after.programCount - before.programCount).toBe(2);
+  expect(after.programBytes - before.programBytes).toBe(BLOCK_SIZE * 2);
+  expect(after.programConflicts - before.programConflicts).toBe(BLOCK_SIZE);
+  expect(after.eraseCount - before.eraseCount).toBe(1);
+  expect(after.eraseMax).toBeGreaterThanOrEqual(1);
+  done();
+});
+
 start(); // start to test
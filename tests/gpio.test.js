@@ -0,0 +1,128 @@
+const { test, start, expect } = require("__ujest");
+
+// GPIO is simulated on the Linux target: writing a pin raises its edge
+// interrupts, so edges are injected with digitalWrite().
+
+test("[gpio] setWatch() - debounce bouncing edges", (done) => {
+  const pin = 5;
+  pinMode(pin, INPUT_PULLUP);
+  let count = 0;
+  let elapsed = 0;
+  const t0 = millis();
+  const id = setWatch(
+    () => {
+      count++;
+      elapsed = millis() - t0;
+    },
+    pin,
+    FALLING,
+    50
+  );
+  // bouncing press
+  digitalWrite(pin, LOW);
+  digitalWrite(pin, HIGH);
+  digitalWrite(pin, LOW);
+  setTimeout(() => {
+    expect(count).toBe(0);
+  }, 30);
+  setTimeout(() => {
+    expect(count).toBe(1);
+    expect(elapsed).toBeGreaterThanOrEqual(50);
+    // release does not trigger FALLING
+    digitalWrite(pin, HIGH);
+    setTimeout(() => {
+      expect(count).toBe(1);
+      clearWatch(id);
+      done();
+    }, 80);
+  }, 120);
+});
+
+test("[gpio] setWatch() - debounce restarts on each edge", (done) => {
+  const pin = 6;
+  pinMode(pin, INPUT_PULLDOWN);
+  let count = 0;
+  const id = setWatch(() => count++, pin, RISING, 40);
+  digitalWrite(pin, HIGH);
+  setTimeout(() => {
+    // noise before the delay elapsed
+    digitalWrite(pin, LOW);
+    digitalWrite(pin, HIGH);
+  }, 20);
+  setTimeout(() => {
+    expect(count).toBe(0); // 50ms from the first edge, 30ms from the last
+  }, 50);
+  setTimeout(() => {
+    expect(count).toBe(1);
+    clearWatch(id);
+    done();
+  }, 120);
+});
+
+test("[gpio] setWatch() - short pulses without debounce", (done) => {
+  const pin = 7;
+  pinMode(pin, INPUT_PULLDOWN);
+  const values = [];
+  const id = setWatch(() => values.push(digitalRead(pin)), pin, CHANGE, 0);
+  digitalWrite(pin, HIGH);
+  digitalWrite(pin, LOW);
+  digitalWrite(pin, HIGH);
+  digitalWrite(pin, LOW);
+  setTimeout(() => {
+    expect(values.length).toBe(4);
+    clearWatch(id);
+    digitalWrite(pin, HIGH);
+    setTimeout(() => {
+      expect(values.length).toBe(4);
+      done();
+    }, 20);
+  }, 20);
+});
+
+test("[gpio] attachInterrupt() - batch events", (done) => {
+  const pin = 8;
+  pinMode(pin, INPUT_PULLDOWN);
+  const received = [];
+  attachInterrupt(
+    pin,
+    (events, overflow) => {
+      events.forEach((e) => received.push(e));
+      expect(overflow).toBe(0);
+    },
+    CHANGE,
+    { batch: true }
+  );
+  for (let i = 0; i < 10; i++) {
+    digitalWrite(pin, HIGH);
+    digitalWrite(pin, LOW);
+  }
+  setTimeout(() => {
+    expect(received.length).toBe(20);
+    expect(received[0].pin).toBe(pin);
+    expect(received[0].events).toBe(RISING);
+    expect(received[1].events).toBe(FALLING);
+    expect(received[1].time).toBeGreaterThanOrEqual(received[0].time);
+    expect(interruptStats(pin).count).toBe(20);
+    detachInterrupt(pin);
+    done();
+  }, 20);
+});
+
+test("[gpio] detachInterrupt() - keeps setWatch() on the pin", (done) => {
+  const pin = 9;
+  pinMode(pin, INPUT_PULLDOWN);
+  let count = 0;
+  const id = setWatch(() => count++, pin, CHANGE, 0);
+  detachInterrupt(pin); // no attachInterrupt() handle on the pin
+  attachInterrupt(pin, () => {}, CHANGE);
+  detachInterrupt(pin);
+  digitalWrite(pin, HIGH);
+  digitalWrite(pin, LOW);
+  setTimeout(() => {
+    expect(count).toBe(2);
+    clearWatch(id);
+    done();
+  }, 20);
+});
+
+start(); // start to test
@@ -0,0 +1,307 @@
+const { test, start, expect } = require("__ujest");
+const { GraphicsContext, BufferedGraphicsContext } = require("graphics");
+
+function createContext(options) {
+  const frames = [];
+  options = Object.assign({ bpp: 16 }, options);
+  options.display = (buffer, rects) => {
+    frames.push({ buffer, rects });
+  };
+  const gc = new BufferedGraphicsContext(64, 32, options);
+  return { gc, frames };
+}
+
+test("[graphics] display() flushes the whole buffer first", (done) => {
+  const { gc, frames } = createContext();
+  gc.display();
+  expect(frames.length).toBe(1);
+  expect(frames[0].rects.length).toBe(1);
+  const rect = frames[0].rects[0];
+  expect(rect.x).toBe(0);
+  expect(rect.y).toBe(0);
+  expect(rect.width).toBe(64);
+  expect(rect.height).toBe(32);
+  expect(rect.data.length).toBe(frames[0].buffer.length);
+  done();
+});
+
+test("[graphics] display() passes no rects when nothing changed", (done) => {
+  const { gc, frames } = createContext();
+  gc.display();
+  gc.display();
+  expect(frames[1].rects.length).toBe(0);
+  done();
+});
+
+test("[graphics] display() passes the damaged region only", (done) => {
+  const { gc, frames } = createContext();
+  gc.display();
+  gc.setFillColor(0xffff);
+  gc.fillRect(2, 3, 4, 5);
+  gc.display();
+  const rects = frames[1].rects;
+  expect(rects.length).toBe(1);
+  expect(rects[0].x).toBe(2);
+  expect(rects[0].y).toBe(3);
+  expect(rects[0].width).toBe(4);
+  expect(rects[0].height).toBe(5);
+  expect(rects[0].data.length).toBe(4 * 5 * 2);
+  expect(rects[0].data[0]).toBe(0xff);
+  done();
+});
+
+test("[graphics] display() coalesces overlapping regions", (done) => {
+  const { gc, frames } = createContext();
+  gc.display();
+  gc.setPixel(10, 10, 0xffff);
+  gc.setPixel(11, 10, 0xffff);
+  gc.setPixel(40, 20, 0xffff);
+  gc.display();
+  const rects = frames[1].rects;
+  expect(rects.length).toBe(2);
+  done();
+});
+
+test("[graphics] display() maps rotated regions to the device", (done) => {
+  const { gc, frames } = createContext({ rotation: 1 });
+  gc.display();
+  gc.setPixel(0, 0, 0xffff);
+  gc.display();
+  const rect = frames[1].rects[0];
+  expect(rect.x).toBe(63);
+  expect(rect.y).toBe(0);
+  done();
+});
+
+test("[graphics] display(true) forces a full refresh", (done) => {
+  const { gc, frames } = createContext();
+  gc.display();
+  gc.setPixel(1, 1, 0xffff);
+  gc.display(true);
+  const rects = frames[1].rects;
+  expect(rects.length).toBe(1);
+  expect(rects[0].width).toBe(64);
+  expect(rects[0].height).toBe(32);
+  done();
+});
+
+test("[graphics] 1-bit regions are aligned to pages", (done) => {
+  const { gc, frames } = createContext({ bpp: 1 });
+  gc.display();
+  gc.setPixel(5, 10, 1);
+  gc.display();
+  const rect = frames[1].rects[0];
+  expect(rect.y).toBe(8);
+  expect(rect.height).toBe(8);
+  expect(rect.data.length).toBe(1);
+  expect(rect.data[0]).toBe(1 << 2);
+  done();
+});
+
+function createBandedContext(options) {
+  const bands = [];
+  options = Object.assign({ bpp: 16, bandHeight: 8 }, options);
+  options.display = (buffer, rects) => {
+    const rect = rects[0];
+    bands.push({ y: rect.y, height: rect.height, data: rect.data.slice() });
+  };
+  const gc = new BufferedGraphicsContext(64, 32, options);
+  return { gc, bands };
+}
+
+test("[graphics] banded display() sends every band", (done) => {
+  const { gc, bands } = createBandedContext();
+  expect(gc.buffer.length).toBe(64 * 8 * 2);
+  gc.display();
+  expect(bands.length).toBe(4);
+  expect(bands[3].y).toBe(24);
+  expect(bands[3].height).toBe(8);
+  expect(bands[3].data.length).toBe(64 * 8 * 2);
+  done();
+});
+
+test("[graphics] banded display() replays draw calls per band", (done) => {
+  const { gc, bands } = createBandedContext();
+  gc.clearScreen();
+  gc.setFillColor(0xffff);
+  gc.fillRect(0, 6, 2, 4); // rows 6..9 span the first two bands
+  gc.display();
+  expect(bands[0].data[(6 * 64 + 1) * 2]).toBe(0xff);
+  expect(bands[0].data[(5 * 64) * 2]).toBe(0);
+  expect(bands[1].data[(1 * 64 + 1) * 2]).toBe(0xff);
+  expect(bands[1].data[(2 * 64) * 2]).toBe(0);
+  expect(bands[2].data[0]).toBe(0);
+  done();
+});
+
+test("[graphics] clearScreen() restarts the banded frame", (done) => {
+  const { gc, bands } = createBandedContext();
+  gc.setPixel(0, 0, 0xffff);
+  gc.display();
+  expect(bands[0].data[0]).toBe(0xff);
+  gc.clearScreen();
+  gc.setPixel(1, 0, 0xffff);
+  gc.display();
+  expect(bands[4].data[0]).toBe(0);
+  expect(bands[4].data[2]).toBe(0xff);
+  done();
+});
+
+test("[graphics] 1-bit bands are whole pages", (done) => {
+  const { gc, bands } = createBandedContext({ bpp: 1, bandHeight: 12 });
+  gc.setPixel(5, 10, 1);
+  gc.display();
+  expect(bands.length).toBe(4);
+  expect(bands[1].y).toBe(8);
+  expect(bands[1].data[5]).toBe(1 << 2);
+  done();
+});
+
+test("[graphics] record() returns draw calls without drawing", (done) => {
+  const gc = new BufferedGraphicsContext(64, 32, { bpp: 16 });
+  gc.setFillColor(0x1234);
+  const list = gc.record((g) => {
+    g.setFillColor(0xffff);
+    g.fillRect(10, 0, 2, 2);
+  });
+  expect(list instanceof Uint8Array).toBe(true);
+  expect(gc.getPixel(10, 0)).toBe(0);
+  expect(gc.getFillColor()).toBe(0x1234);
+  gc.replay(list);
+  expect(gc.getPixel(10, 0)).toBe(0xffff);
+  expect(gc.getFillColor()).toBe(0x1234);
+  done();
+});
+
+test("[graphics] replay() draws a list patched in place", (done) => {
+  const gc = new BufferedGraphicsContext(64, 32, { bpp: 16 });
+  gc.setFillColor(0xffff);
+  const list = gc.record((g) => g.fillRect(0, 0, 2, 2));
+  expect(list[0]).toBe(11); // fill rect opcode, then x, y, w, h
+  list[1] = 20; // x
+  gc.replay(list);
+  expect(gc.getPixel(0, 0)).toBe(0);
+  expect(gc.getPixel(21, 1)).toBe(0xffff);
+  done();
+});
+
+test("[graphics] replay() limits drawing to the clip rect", (done) => {
+  const gc = new BufferedGraphicsContext(64, 32, { bpp: 16 });
+  gc.setFillColor(0xffff);
+  const list = gc.record((g) => g.fillRect(0, 0, 64, 32));
+  gc.replay(list, { x: 4, y: 4, width: 8, height: 8 });
+  expect(gc.getPixel(3, 4)).toBe(0);
+  expect(gc.getPixel(4, 4)).toBe(0xffff);
+  expect(gc.getPixel(11, 11)).toBe(0xffff);
+  expect(gc.getPixel(12, 11)).toBe(0);
+  gc.fillRect(0, 0, 1, 1); // the clip doesn't outlive replay()
+  expect(gc.getPixel(0, 0)).toBe(0xffff);
+  done();
+});
+
+test("[graphics] replay() rejects a malformed list", (done) => {
+  const gc = new BufferedGraphicsContext(64, 32, { bpp: 16 });
+  expect(() => gc.replay(new Uint8Array([11, 0, 0]))).toThrow();
+  // a valid fill rect followed by a truncated command draws nothing
+  gc.setFillColor(0xffff);
+  const list = gc.record((g) => g.fillRect(0, 0, 2, 2));
+  const bad = new Uint8Array(list.length + 3);
+  bad.set(list);
+  bad.set([11, 0, 0], list.length);
+  expect(() => gc.replay(bad)).toThrow();
+  expect(gc.getPixel(0, 0)).toBe(0);
+  done();
+});
+
+test("[graphics] banded contexts replay lists per band", (done) => {
+  const { gc, bands } = createBandedContext();
+  gc.setFillColor(0xffff);
+  const list = gc.record((g) => g.fillRect(0, 0, 64, 32));
+  gc.setFillColor(0);
+  gc.replay(list, { x: 0, y: 6, width: 1, height: 4 });
+  gc.fillRect(0, 7, 1, 1); // drawn with the fill color restored after replay
+  gc.display();
+  expect(bands[0].data[6 * 64 * 2]).toBe(0xff);
+  expect(bands[0].data[7 * 64 * 2]).toBe(0);
+  expect(bands[1].data[64 * 2]).toBe(0xff);
+  expect(bands[1].data[2 * 64 * 2]).toBe(0);
+  done();
+});
+
+test("[graphics] banded contexts nest replay() clip rects", (done) => {
+  const { gc, bands } = createBandedContext();
+  gc.setFillColor(0xffff);
+  const inner = gc.record((g) => g.fillRect(0, 0, 64, 32));
+  const list = gc.record((g) =>
+    g.replay(inner, { x: 0, y: 0, width: 4, height: 32 })
+  );
+  gc.replay(list, { x: 2, y: 6, width: 8, height: 4 });
+  gc.display();
+  expect(bands[0].data[(5 * 64 + 2) * 2]).toBe(0);
+  expect(bands[0].data[(6 * 64 + 1) * 2]).toBe(0);
+  expect(bands[0].data[(6 * 64 + 2) * 2]).toBe(0xff);
+  expect(bands[0].data[(6 * 64 + 4) * 2]).toBe(0);
+  expect(bands[1].data[(1 * 64 + 3) * 2]).toBe(0xff);
+  expect(bands[1].data[(2 * 64 + 3) * 2]).toBe(0);
+  done();
+});
+
+test("[graphics] setPixel-only contexts draw lines and text", (done) => {
+  const pixels = {};
+  const gc = new GraphicsContext(64, 32, {
+    setPixel: (x, y, color) => {
+      pixels[x + "," + y] = color;
+    },
+  });
+  gc.setColor(1);
+  gc.drawLine(0, 0, 9, 0);
+  expect(pixels["0,0"]).toBe(1);
+  expect(pixels["9,0"]).toBe(1);
+  expect(pixels["10,0"]).toBe(undefined);
+  gc.setFontColor(2);
+  gc.drawText(0, 10, "H");
+  const text = Object.keys(pixels).filter((key) => pixels[key] === 2);
+  expect(text.length).toBeGreaterThan(0);
+  done();
+});
+
+test("[graphics] banded lists restart on a full-screen fillRect()", (done) => {
+  const { gc, bands } = createBandedContext({ listSize: 1024 });
+  for (let tick = 0; tick < 200; tick++) {
+    gc.setFillColor(0);
+    gc.fillRect(0, 0, 64, 32);
+    gc.setFillColor(0xffff);
+    gc.fillRect(0, 0, 20, 8);
+    gc.drawText(0, 10, "12:" + tick);
+    gc.display();
+  }
+  expect(bands[bands.length - 4].data[0]).toBe(0xff);
+  // without a full redraw the list outgrows listSize
+  expect(() => {
+    for (let tick = 0; tick < 200; tick++) {
+      gc.fillRect(0, 0, 20, 8);
+      gc.drawText(0, 10, "12:" + tick);
+    }
+    gc.display();
+  }).toThrow();
+  done();
+});
+
+test("[graphics] banded lists reference bitmaps", (done) => {
+  const { gc, bands } = createBandedContext({ listSize: 512 });
+  const sprite = {
+    width: 32,
+    height: 16,
+    bpp: 16,
+    data: new Uint8Array(32 * 16 * 2).fill(0xff),
+  };
+  for (let i = 0; i < 10; i++) {
+    gc.drawBitmap(i, 0, sprite); // 1 KB each if copied
+  }
+  gc.display();
+  expect(bands[0].data[0]).toBe(0xff);
+  expect(bands[2].data[0]).toBe(0);
+  done();
+});
+
+start();
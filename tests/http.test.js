@@ -0,0 +1,82 @@
+const { test, start, expect } = require("__ujest");
+const { HTTPParserNative } = process.binding(process.binding.http);
+
+function bytes(str) {
+  return new TextEncoder("ascii").encode(str);
+}
+
+function text(chunks) {
+  return chunks.map((c) => String.fromCharCode.apply(null, c)).join("");
+}
+
+function parser() {
+  const p = new HTTPParserNative();
+  p.info = null;
+  p.chunks = [];
+  p.done = false;
+  p.onHeadersComplete = (info) => {
+    p.info = info;
+  };
+  p.onBody = (chunk) => {
+    p.chunks.push(chunk);
+  };
+  p.onMessageComplete = () => {
+    p.done = true;
+  };
+  return p;
+}
+
+test("[http] HTTPParserNative - request with content-length", (done) => {
+  const p = parser();
+  const msg = "POST /api?x=1 HTTP/1.1\r\nHost: kaluma\r\nContent-Length: 5\r\n\r\nhello";
+  // feed in small pieces
+  for (let i = 0; i < msg.length; i += 7) {
+    p.execute(bytes(msg.substr(i, 7)));
+  }
+  expect(p.info.method).toBe("POST");
+  expect(p.info.url).toBe("/api?x=1");
+  expect(p.info.httpVersion).toBe("1.1");
+  expect(p.info.headers["host"]).toBe("kaluma");
+  expect(p.info.headers["content-length"]).toBe("5");
+  expect(text(p.chunks)).toBe("hello");
+  expect(p.done).toBe(true);
+  done();
+});
+
+test("[http] HTTPParserNative - chunked response", (done) => {
+  const p = parser();
+  const data = bytes(
+    "HTTP/1.1 404 Not Found\r\nTransfer-Encoding: chunked\r\n\r\n" +
+      "4\r\nabcd\r\n3;ext=1\r\nefg\r\n0\r\n\r\n"
+  );
+  const n = p.execute(data);
+  expect(n).toBe(data.length);
+  expect(p.info.statusCode).toBe(404);
+  expect(p.info.statusMessage).toBe("Not Found");
+  expect(p.chunks.length).toBe(2);
+  expect(p.chunks[0].buffer).toBe(data.buffer);
+  expect(text(p.chunks)).toBe("abcdefg");
+  expect(p.done).toBe(true);
+  done();
+});
+
+test("[http] HTTPParserNative - body until connection close", (done) => {
+  const p = parser();
+  p.execute(bytes("HTTP/1.0 200 OK\r\n\r\nsome"));
+  p.execute(bytes(" data"));
+  expect(p.done).toBe(false);
+  p.finish();
+  expect(text(p.chunks)).toBe("some data");
+  expect(p.done).toBe(true);
+  done();
+});
+
+test("[http] HTTPParserNative - malformed message", (done) => {
+  const p = parser();
+  expect(() => {
+    p.execute(bytes("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\n"));
+  }).toThrow();
+  done();
+});
+
+start(); // start to test
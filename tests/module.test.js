@@ -0,0 +1,72 @@
+const { test, start, expect } = require("__ujest");
+const { VFSLittleFS } = require("vfs_lfs");
+const { RAMBlockDev } = require("__test_utils");
+const fs = require("fs");
+
+fs.register('lfs', VFSLittleFS);
+
+const encoder = new TextEncoder();
+
+function writeText(path, text) {
+  fs.writeFile(path, encoder.encode(text));
+}
+
+function setup() {
+  const bd = new RAMBlockDev();
+  fs.mount('/', bd, 'lfs', true);
+  fs.mkdir('/app');
+  fs.mkdir('/app/lib');
+  fs.mkdir('/node_modules');
+  fs.mkdir('/node_modules/pkg');
+  writeText('/app/main.js',
+    'const a = require("./lib/a");\n' +
+    'module.exports = { a: a, pkg: require("pkg"), dir: __dirname };');
+  writeText('/app/lib/a.js', 'exports.name = "a";');
+  writeText('/app/data.json', '{"x": 42}');
+  writeText('/node_modules/pkg/package.json', '{"main": "entry.js"}');
+  writeText('/node_modules/pkg/entry.js', 'module.exports = "pkg";');
+}
+
+test("[module] require() relative, json and node_modules", (done) => {
+  setup();
+  const main = require('/app/main.js');
+  expect(main.a.name).toBe('a');
+  expect(main.pkg).toBe('pkg');
+  expect(main.dir).toBe('/app');
+  expect(require('/app/data').x).toBe(42);
+  expect(require('/app/lib/a')).toBe(main.a);
+  expect(() => {
+    require('./not_exists');
+  }).toThrow();
+  fs.unmount('/');
+  done();
+});
+
+test("[module] require() caches snapshots", (done) => {
+  setup();
+  writeText('/app/snap.js', 'module.exports = 1;');
+  expect(require('/app/snap.js')).toBe(1);
+  expect(fs.exists('/app/snap.js.snapshot')).toBe(true);
+  const source = fs.readFile('/app/snap.js');
+  const snapshot = fs.readFile('/app/snap.js.snapshot');
+  const fn = process.loadModuleSnapshot(snapshot, source);
+  expect(typeof fn).toBe('function');
+  // stale for a different source
+  expect(process.loadModuleSnapshot(snapshot, encoder.encode('1'))).toBe(
+    undefined
+  );
+  fs.unmount('/');
+  done();
+});
+
+test("[module] process.compileModule() throws syntax errors", (done) => {
+  expect(() => {
+    process.compileModule(encoder.encode('module.exports = ;'), 'bad.js');
+  }).toThrow();
+  expect(process.snapshotModule(encoder.encode('+'), 'bad.js')).toBe(
+    undefined
+  );
+  done();
+});
+
+start();
@@ -0,0 +1,23 @@
+// Runs as a plain script (no test runner timers): the open sockets alone
+// must keep the event loop alive until the echo completes.
+const net = require("net");
+
+let accepted = null;
+const server = net.createServer((client) => {
+  accepted = client;
+  client.on("data", (data) => {
+    client.write(data);
+  });
+});
+server.listen(0, () => {
+  const port = global.__netdev.get(server._fd).lport;
+  const socket = net.createConnection({ host: "127.0.0.1", port: port }, () => {
+    socket.write("hello");
+  });
+  socket.on("data", (data) => {
+    console.log("[net-script] echo: " + String.fromCharCode.apply(null, data));
+    socket.destroy();
+    accepted.destroy();
+    server.close();
+  });
+});
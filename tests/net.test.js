@@ -0,0 +1,94 @@
+const { test, start, expect } = require("__ujest");
+const net = require("net");
+
+function listen(server, cb) {
+  // listen on an ephemeral port
+  server.listen(0, () => {
+    cb(global.__netdev.get(server._fd).lport);
+  });
+}
+
+test("[net] echo over loopback", (done) => {
+  const server = net.createServer((client) => {
+    client.on("data", (data) => {
+      client.write(data);
+    });
+  });
+  listen(server, (port) => {
+    expect(port).toBeGreaterThan(0);
+    const socket = net.createConnection({ host: "127.0.0.1", port: port }, () => {
+      socket.write("hello");
+    });
+    socket.on("data", (data) => {
+      expect(String.fromCharCode.apply(null, data)).toBe("hello");
+      socket.destroy();
+      server.close();
+      done();
+    });
+  });
+});
+
+test("[net] each client has its own socket", (done) => {
+  const names = [];
+  const server = net.createServer((client) => {
+    client.on("data", (data) => {
+      client.write("re:" + String.fromCharCode.apply(null, data));
+    });
+  });
+  listen(server, (port) => {
+    const connect = (name) => {
+      const socket = net.createConnection({ host: "127.0.0.1", port: port }, () => {
+        socket.write(name);
+      });
+      socket.on("data", (data) => {
+        expect(String.fromCharCode.apply(null, data)).toBe("re:" + name);
+        names.push(name);
+        socket.destroy();
+        if (names.length === 2) {
+          server.close();
+          done();
+        }
+      });
+    };
+    connect("a");
+    connect("b");
+  });
+});
+
+test("[net] write large data with backpressure", (done) => {
+  const size = 1024 * 1024;
+  let received = 0;
+  const server = net.createServer((client) => {
+    client.on("data", (data) => {
+      received += data.length;
+      if (received === size) {
+        expect(received).toBe(size);
+        client.destroy();
+        server.close();
+        done();
+      }
+    });
+  });
+  listen(server, (port) => {
+    const socket = net.createConnection({ host: "127.0.0.1", port: port }, () => {
+      socket.write(new Uint8Array(size), () => {
+        socket.end();
+      });
+    });
+  });
+});
+
+test("[net] emit error when the connection is refused", (done) => {
+  const server = net.createServer();
+  listen(server, (port) => {
+    // nothing listens on the port after the server is closed
+    server.close();
+    const socket = net.createConnection({ host: "127.0.0.1", port: port }, () => {});
+    socket.on("error", (err) => {
+      expect(err instanceof SystemError).toBeTruthy();
+      done();
+    });
+  });
+});
+
+start();
@@ -1,5 +1,19 @@
 const { test, start, expect } = require("__ujest");
-const { Stream } = require("stream");
+const { Stream, Writable } = require("stream");
+
+class TestWritable extends Writable {
+  constructor(options) {
+    super(options);
+    this.written = [];
+  }
+  _write(data, cb) {
+    this.written.push(data);
+    setTimeout(cb, 10);
+  }
+  _final(cb) {
+    cb();
+  }
+}
 
 test("[stream] Stream initial values", (done) => {
   const stream = new Stream();
@@ -13,4 +27,46 @@ test("[stream] Stream initial values", (done) => {
   done();
 });
 
+test("[stream] Writable pass-through of Uint8Array", (done) => {
+  const w = new TestWritable();
+  const chunk = new Uint8Array([1, 2, 3]);
+  w.write(chunk);
+  w.end(() => {
+    expect(w.written.length).toBe(1);
+    expect(w.written[0]).toBe(chunk);
+    done();
+  });
+});
+
+test("[stream] Writable batches queued chunks", (done) => {
+  const w = new TestWritable();
+  w.write(new Uint8Array([1, 2]));
+  w.write("ab");
+  w.end(new Uint8Array([3]), () => {
+    expect(w.written.length).toBe(1);
+    const data = w.written[0];
+    expect(data instanceof Uint8Array).toBe(true);
+    expect(data.length).toBe(5);
+    expect(data[1]).toBe(2);
+    expect(data[2]).toBe(97);
+    expect(data[4]).toBe(3);
+    done();
+  });
+});
+
+test("[stream] Writable highWaterMark and drain", (done) => {
+  const w = new TestWritable({ highWaterMark: 8 });
+  expect(w.writableHighWaterMark).toBe(8);
+  expect(w.write(new Uint8Array(4))).toBe(true);
+  expect(w.write(new Uint8Array(4))).toBe(false);
+  expect(w.writableLength).toBe(8);
+  w.once("drain", () => {
+    expect(w.writableLength).toBe(0);
+    w.end(() => {
+      expect(w.writableEnded).toBe(true);
+      done();
+    });
+  });
+});
+
 start(); // start to test
@@ -4,6 +4,16 @@ function cmd(cmd, args) {
   childProcess.spawnSync(cmd, args, { stdio: "inherit" });
 }
 
+function cmdExpect(cmd, args, expected) {
+  const ret = childProcess.spawnSync(cmd, args, {
+    encoding: "utf8",
+    timeout: 10000,
+  });
+  process.stdout.write(ret.stdout || "");
+  const pass = ret.status === 0 && (ret.stdout || "").includes(expected);
+  console.log(`${pass ? "PASS" : "FAIL"} ${args[0]}\n`);
+}
+
 cmd("../build/kaluma", ["stream.test.js"]);
 cmd("../build/kaluma", ["path.test.js"]);
 cmd("../build/kaluma", ["process.test.js"]);
@@ -12,3 +22,13 @@ cmd("../build/kaluma", ["flash.test.js"]);
 cmd("../build/kaluma", ["vfs_lfs.test.js"]);
 cmd("../build/kaluma", ["vfs_fat.test.js"]);
 cmd("../build/kaluma", ["fs.test.js"]);
+cmd("../build/kaluma", ["module.test.js"]);
+cmd("../build/kaluma", ["http.test.js"]);
+cmd("../build/kaluma", ["gpio.test.js"]);
+cmd("../build/kaluma", ["worker.test.js"]);
+cmdExpect("../build/kaluma", ["worker-script.test.js"], "done: null");
+cmd("../build/kaluma", ["net.test.js"]);
+cmdExpect("../build/kaluma", ["net-script.test.js"], "echo: hello");
+cmd("../build/kaluma", ["dgram.test.js"]);
+cmd("../build/kaluma", ["graphics.test.js"]);
+cmd("../build/kaluma", ["display.test.js"]);
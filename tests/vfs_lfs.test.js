@@ -1,6 +1,7 @@
 const { test, start, expect } = require("__ujest");
 const { RAMBlockDev } = require("__test_utils");
 const { VFSLittleFS } = require("vfs_lfs");
+const { Flash } = require("flash");
 
 // constants for flags
 const VFS_FLAG_READ = 1;
@@ -301,4 +302,68 @@ test("[vfs_lfs] rename()", (done) => {
   done();
 });
 
+test("[vfs_lfs] open/write/read/close() - native block device", (done) => {
+  const bd = new Flash(132, 128);
+  const vfs = new VFSLittleFS(bd);
+  vfs.mkfs();
+  vfs.mount();
+  const fname = "/native.txt";
+
+  // file write (create)
+  let fd = vfs.open(fname, VFS_FLAG_WRITE | VFS_FLAG_CREATE, 0);
+  let buf = new Uint8Array(5000);
+  for (let i = 0; i < buf.length; i++) buf[i] = i % 251;
+  vfs.write(fd, buf, 0, buf.length, 0);
+  vfs.close(fd);
+
+  // remount and read
+  vfs.unmount();
+  vfs.mount();
+  let fd2 = vfs.open(fname, VFS_FLAG_READ, 0);
+  let buf2 = new Uint8Array(5000);
+  vfs.read(fd2, buf2, 0, buf2.length, 0);
+  vfs.close(fd2);
+  expect(buf.join(",")).toBe(buf2.join(","));
+
+  vfs.unmount();
+  done();
+});
+
+test("[vfs_lfs] open/write/read/close() - with block cache", (done) => {
+  const bd = new RAMBlockDev(4096, 16, 256);
+  const vfs = new VFSLittleFS(bd, { cache: 4096, readahead: 2, lookahead: 32 });
+  vfs.mkfs();
+  vfs.mount();
+  const fname = "/cached.txt";
+
+  // file write (create)
+  let fd = vfs.open(fname, VFS_FLAG_WRITE | VFS_FLAG_CREATE, 0);
+  let buf = new Uint8Array(3000);
+  for (let i = 0; i < buf.length; i++) buf[i] = i % 251;
+  vfs.write(fd, buf, 0, buf.length, 0);
+  vfs.close(fd);
+
+  // read through the cache
+  let fd2 = vfs.open(fname, VFS_FLAG_READ, 0);
+  let buf2 = new Uint8Array(3000);
+  vfs.read(fd2, buf2, 0, buf2.length, 0);
+  vfs.close(fd2);
+  expect(buf.join(",")).toBe(buf2.join(","));
+  expect(vfs.cacheStats().hits > 0).toBe(true);
+
+  // unmount flushes, so an uncached mount sees the same data
+  vfs.unmount();
+  const vfs2 = new VFSLittleFS(bd);
+  vfs2.mount();
+  expect(vfs2.cacheStats()).toBe(undefined);
+  let fd3 = vfs2.open(fname, VFS_FLAG_READ, 0);
+  let buf3 = new Uint8Array(3000);
+  vfs2.read(fd3, buf3, 0, buf3.length, 0);
+  vfs2.close(fd3);
+  expect(buf.join(",")).toBe(buf3.join(","));
+
+  vfs2.unmount();
+  done();
+});
+
 start();
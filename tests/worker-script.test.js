@@ -0,0 +1,7 @@
+// Runs as a plain script (no test runner timers): the pending worker job
+// alone must keep the event loop alive until its callback runs.
+const worker = require("worker");
+
+worker.delay(50, (err) => {
+  console.log("[worker-script] done: " + err);
+});
@@ -0,0 +1,67 @@
+const { test, start, expect } = require("__ujest");
+const worker = require("worker");
+const { UART } = require("uart");
+
+test("[worker] delay() - run jobs in order without blocking the loop", (done) => {
+  const order = [];
+  let ticks = 0;
+  const timer = setInterval(() => {
+    ticks++;
+  }, 10);
+  worker.delay(100, (err) => {
+    expect(err).toBe(null);
+    order.push(1);
+  });
+  worker.delay(10, (err) => {
+    order.push(2);
+    clearInterval(timer);
+    expect(order.join()).toBe("1,2");
+    // the loop kept running timers while the worker was busy
+    expect(ticks).toBeGreaterThanOrEqual(5);
+    done();
+  });
+});
+
+test("[worker] uartWrite() - write data on the worker", (done) => {
+  const serial = new UART(0);
+  worker.uartWrite(0, new Uint8Array([1, 2, 3, 4]).subarray(1), (err, len) => {
+    expect(err).toBe(null);
+    expect(len).toBe(3);
+    worker.uartWrite(0, "hello", (err, len) => {
+      expect(len).toBe(5);
+      serial.close();
+      done();
+    });
+  });
+});
+
+test("[worker] adcSample() - deliver samples as Float32Array", (done) => {
+  const t0 = millis();
+  worker.adcSample(26, 10, 5000, (err, samples) => {
+    expect(err).toBe(null);
+    expect(samples instanceof Float32Array).toBeTruthy();
+    expect(samples.length).toBe(10);
+    // 10 samples every 5ms
+    expect(millis() - t0).toBeGreaterThanOrEqual(45);
+    done();
+  });
+});
+
+test("[worker] delay() - throw when the queue is full", (done) => {
+  let completed = 0;
+  for (let i = 0; i < worker.QUEUE_SIZE; i++) {
+    worker.delay(1, () => {
+      completed++;
+      if (completed === worker.QUEUE_SIZE) {
+        const stats = worker.stats();
+        expect(stats.running).toBeTruthy();
+        expect(stats.pending).toBe(0);
+        expect(stats.completed).toBe(stats.submitted);
+        done();
+      }
+    });
+  }
+  expect(() => worker.delay(1)).toThrow();
+});
+
+start();
@@ -159,7 +159,16 @@ function generateSources() {
       builtinModules.push(mod);
     }
   });
-  var view = { modules: modules, builtinModules: builtinModules };
+  var hash = generatePerfectHash(builtinModules.map((mod) => mod.name));
+  var hashTable = hash.table.map((index) => ({ value: index }));
+  hashTable[hashTable.length - 1].last = true;
+  var view = {
+    modules: modules,
+    builtinModules: builtinModules,
+    hashSeed: hash.seed,
+    hashSize: hash.size,
+    hashTable: hashTable,
+  };
   var rendered_h = mustache.render(template_h, view);
   var rendered_c = mustache.render(template_c, view);
   var genPath = path.join(__dirname, "../src/gen");
@@ -167,3 +176,48 @@ function generateSources() {
   fs.writeFileSync(path.join(genPath, "kaluma_modules.h"), rendered_h, "utf8");
   fs.writeFileSync(path.join(genPath, "kaluma_modules.c"), rendered_c, "utf8");
 }
+
+/**
+ * FNV-1a hash of a module name with a seed. Must be the same with
+ * builtin_module_find() in kaluma_modules.c.mustache.
+ */
+function hashName(name, seed) {
+  var h = (2166136261 ^ seed) >>> 0;
+  for (var i = 0; i < name.length; i++) {
+    h ^= name.charCodeAt(i);
+    h = Math.imul(h, 16777619) >>> 0;
+  }
+  return h;
+}
+
+/**
+ * Find a seed mapping all names to distinct slots of a table (the size is
+ * a power of two at least twice the number of names).
+ */
+function generatePerfectHash(names) {
+  var size = 1;
+  while (size < names.length * 2) {
+    size <<= 1;
+  }
+  for (var seed = 0; ; seed++) {
+    if (seed >= 0x10000) {
+      size <<= 1;
+      seed = 0;
+    }
+    var table = new Array(size).fill(-1);
+    var found = names.every((name, index) => {
+      var slot = hashName(name, seed) & (size - 1);
+      if (table[slot] >= 0) {
+        return false;
+      }
+      table[slot] = index;
+      return true;
+    });
+    if (found) {
+      console.log(
+        "builtin modules hash: seed=" + seed + ", size=" + size
+      );
+      return { seed: seed, size: size, table: table };
+    }
+  }
+}
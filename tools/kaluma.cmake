@@ -28,6 +28,7 @@ set(JERRY_ARGS
   --js-parser=ON
   --mem-heap=${TARGET_HEAPSIZE}
   --mem-stats=ON
+  --snapshot-save=ON
   --snapshot-exec=ON
   --line-info=ON
   --vm-exec-stop=ON
@@ -81,6 +82,8 @@ list(APPEND SOURCES
   ${SRC_DIR}/prog.c
   ${SRC_DIR}/ymodem.c
   ${SRC_DIR}/ringbuffer.c
+  ${SRC_DIR}/blkdev.c
+  ${SRC_DIR}/blkcache.c
   ${KALUMA_GENERATED_C})
 
 FOREACH(MOD ${MODULES})
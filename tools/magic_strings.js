@@ -9,6 +9,7 @@ var modulesPath = path.join(__dirname, '../src/modules')
 
 var magicStringHeaders = [includePath + '/magic_strings.h']
 var magicStrings = [];
+var magicStringKeys = [];
 
 function generateMagicStrings(modules) {
   // Extract magic string from all modules
@@ -41,9 +42,11 @@ function generateMagicStrings(modules) {
   // Generate magic strings via templates
   magicStringItems = magicStrings.map(item => { return { id: item, len: item.length } })
   magicStringItems[magicStringItems.length - 1].last = true;
+  // Index of each MSTR_* macro in the sorted items for interned keys
+  var keyItems = magicStringKeys.map(key => { return { name: key.name, index: magicStrings.indexOf(key.item) } })
 
   const template_h = fs.readFileSync(__dirname + '/kaluma_magic_strings.h.mustache', 'utf8')
-  var rendered_h = mustache.render(template_h, { magicStrings: magicStringItems })
+  var rendered_h = mustache.render(template_h, { magicStrings: magicStringItems, magicStringKeys: keyItems })
   const template_c = fs.readFileSync(__dirname + '/kaluma_magic_strings.c.mustache', 'utf8')
   var rendered_c = mustache.render(template_c, { magicStrings: magicStringItems })
 
@@ -65,6 +68,9 @@ function extractMagicStrings(filePath) {
         if (!magicStrings.includes(item)) {
           magicStrings.push(item);
         }
+        if (!magicStringKeys.some(key => key.name === tokens[1])) {
+          magicStringKeys.push({ name: tokens[1], item: item });
+        }
       }
     }
   });